@@ -0,0 +1,203 @@
+#include "AssetCache.h"
+#include "FileWriter.h"
+
+#include <core/Logging.h>
+#include <core/Util.h>
+
+#include <fstream>
+
+using namespace assets;
+namespace fs = std::filesystem;
+
+// bump when the manifest layout changes
+static constexpr u32 kManifestVersion = 1;
+
+// size and modification time decide whether a source changed, the same test build systems use.
+// Hashing every source would mean reading hundreds of MB of textures on each run
+struct FileStamp
+{
+	u64 size = 0;
+	i64 time = 0;
+
+	bool operator==(const FileStamp& other) const { return size == other.size && time == other.time; }
+	bool operator!=(const FileStamp& other) const { return !(*this == other); }
+};
+
+static bool GetFileStamp(const fs::path& file, FileStamp& result)
+{
+	std::error_code error;
+	result.size = static_cast<u64>(fs::file_size(file, error));
+	if (error)
+	{
+		return false;
+	}
+
+	result.time = static_cast<i64>(fs::last_write_time(file, error).time_since_epoch().count());
+	return !error;
+}
+
+u64 assets::HashFile(const std::string& file, u64 hash)
+{
+	std::ifstream stream(file, std::ios::in | std::ios::binary);
+	if (!stream)
+	{
+		return hash;
+	}
+
+	std::vector<char> chunk(1 * gold::memory::MB);
+	while (stream)
+	{
+		stream.read(chunk.data(), chunk.size());
+		hash = util::Hash64(chunk.data(), static_cast<size_t>(stream.gcount()), hash);
+	}
+
+	return hash;
+}
+
+AssetCache::AssetCache(const std::string& root)
+	: mRoot(root)
+{
+	std::error_code error;
+	fs::create_directories(mRoot / "textures", error);
+	fs::create_directories(mRoot / "meshes", error);
+	fs::create_directories(mRoot / "models", error);
+
+	if (error)
+	{
+		G_WARN("Cannot create asset cache at {}, everything will be processed", mRoot.string());
+	}
+}
+
+fs::path AssetCache::GetManifestPath(const std::string& output) const
+{
+	const std::string absolute = fs::absolute(output).generic_string();
+	return mRoot / "models" / fmt::format("{:016x}.manifest", util::Hash64(absolute.data(), absolute.size()));
+}
+
+std::string AssetCache::GetBlobPath(BlobType type, u64 hash) const
+{
+	const char* directory = type == BlobType::Texture ? "textures" : "meshes";
+	return (mRoot / directory / fmt::format("{:016x}.bin", hash)).string();
+}
+
+bool AssetCache::HasBlob(BlobType type, u64 hash) const
+{
+	std::error_code error;
+	return fs::exists(GetBlobPath(type, hash), error);
+}
+
+bool AssetCache::StoreBlob(BlobType type, u64 hash, const std::function<void(FileWriter&)>& write)
+{
+	const std::string path = GetBlobPath(type, hash);
+	const std::string partialPath = path + ".partial";
+
+	{
+		FileWriter writer(partialPath);
+		if (!writer.IsOpen())
+		{
+			return false;
+		}
+
+		write(writer);
+		if (!writer.Close())
+		{
+			return false;
+		}
+	}
+
+	std::error_code error;
+	fs::rename(partialPath, path, error);
+	return !error;
+}
+
+bool AssetCache::IsUpToDate(const std::string& output, u64 settingsHash) const
+{
+	std::ifstream stream(GetManifestPath(output), std::ios::in | std::ios::binary);
+	if (!stream)
+	{
+		return false;
+	}
+
+	auto read = [&stream](auto& value)
+	{
+		stream.read(reinterpret_cast<char*>(&value), sizeof(value));
+		return static_cast<bool>(stream);
+	};
+
+	u32 version = 0;
+	u64 manifestSettings = 0;
+	if (!read(version) || version != kManifestVersion || !read(manifestSettings) || manifestSettings != settingsHash)
+	{
+		return false;
+	}
+
+	FileStamp outputStamp{};
+	FileStamp currentOutput{};
+	if (!read(outputStamp.size) || !read(outputStamp.time) || !GetFileStamp(output, currentOutput) || currentOutput != outputStamp)
+	{
+		return false;
+	}
+
+	u32 sourceCount = 0;
+	if (!read(sourceCount))
+	{
+		return false;
+	}
+
+	for (u32 i = 0; i < sourceCount; ++i)
+	{
+		u32 length = 0;
+		if (!read(length))
+		{
+			return false;
+		}
+
+		std::string source(length, '\0');
+		stream.read(source.data(), length);
+
+		FileStamp sourceStamp{};
+		FileStamp currentSource{};
+		if (!read(sourceStamp.size) || !read(sourceStamp.time) || !GetFileStamp(source, currentSource) || currentSource != sourceStamp)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void AssetCache::WriteManifest(const std::string& output, u64 settingsHash, const std::vector<std::string>& sources)
+{
+	FileStamp outputStamp{};
+	if (!GetFileStamp(output, outputStamp))
+	{
+		return;
+	}
+
+	FileWriter writer(GetManifestPath(output).string());
+	if (!writer.IsOpen())
+	{
+		return;
+	}
+
+	writer.Write(kManifestVersion);
+	writer.Write(settingsHash);
+	writer.Write(outputStamp.size);
+	writer.Write(outputStamp.time);
+
+	writer.Write(static_cast<u32>(sources.size()));
+	for (const std::string& source : sources)
+	{
+		// a source that vanished mid run simply never matches again
+		FileStamp sourceStamp{};
+		GetFileStamp(source, sourceStamp);
+
+		const std::string absolute = fs::absolute(source).generic_string();
+		writer.Write(static_cast<u32>(absolute.size()));
+		writer.Write(absolute.data(), absolute.size());
+		writer.Write(sourceStamp.size);
+		writer.Write(sourceStamp.time);
+	}
+
+	writer.Close();
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <core/Core.h>
+
+#include <filesystem>
+
+namespace assets
+{
+	class FileWriter;
+
+	// hashes a whole file, chained onto hash. Returns hash unchanged when the file cannot be read
+	u64 HashFile(const std::string& file, u64 hash);
+
+	// on disk cache for processed data, blobs are keyed by the hash of their source data and settings.
+	// Model manifests record the files an output was built from, an unchanged model skips the import
+	class AssetCache
+	{
+	public:
+		enum class BlobType : u8
+		{
+			Texture,
+			Mesh,
+		};
+
+	private:
+		std::filesystem::path mRoot;
+
+		std::filesystem::path GetManifestPath(const std::string& output) const;
+
+	public:
+		explicit AssetCache(const std::string& root);
+
+		std::string GetBlobPath(BlobType type, u64 hash) const;
+		bool HasBlob(BlobType type, u64 hash) const;
+
+		// blobs are written next to their final path and renamed once complete, an interrupted run never leaves
+		// a partial entry behind. Returns false when write failed
+		bool StoreBlob(BlobType type, u64 hash, const std::function<void(FileWriter&)>& write);
+
+		// true when output exists, was written by us with these settings and none of its sources changed since
+		bool IsUpToDate(const std::string& output, u64 settingsHash) const;
+		void WriteManifest(const std::string& output, u64 settingsHash, const std::vector<std::string>& sources);
+	};
+}
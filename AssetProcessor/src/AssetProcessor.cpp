@@ -1,20 +1,37 @@
 #include "AssetProcessor.h"
+#include "TextureProcessor.h"
+#include "TextureCompressor.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "MeshletBuilder.h"
+#include "FileWriter.h"
+#include "AssetCache.h"
 
 #include <core/Core.h>
 #include <core/Logging.h>
+#include <core/Util.h>
+#include <core/ThreadPool.h>
 
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 #include <assimp/Importer.hpp>
+#include <assimp/DefaultIOSystem.h>
 
 #include <graphics/Vertex.h>
+#include <graphics/VertexQuantization.h>
 #include <graphics/Texture.h>
+#include <graphics/DDS.h>
+
+#include <scene/ModelFormat.h>
 
 #include <memory/Utils.h>
-#include <memory/BinaryWriter.h>
+#include <memory/BlockCompression.h>
 
 #include <algorithm>
-#include <random>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <mutex>
 
 using namespace graphics;
 
@@ -23,7 +40,7 @@ struct AssetID
 	static constexpr u8 KEY_LENGTH = 16;
 	char key[KEY_LENGTH];
 
-	bool operator==(const AssetID other)
+	bool operator==(const AssetID other) const
 	{
 		for (int i = 0; i < KEY_LENGTH; ++i)
 		{
@@ -38,22 +55,27 @@ struct AssetID
 
 	const std::string Name() const
 	{
-		return std::string(key);
+		return std::string(key, KEY_LENGTH);
 	}
 };
 
+STATIC_ASSERT(sizeof(AssetID) == scene::model::kAssetIDLength, "AssetID size mismatch!");
+
 struct ParsedMaterial
 {
+	static constexpr u32 kNoTexture = ~0u;
+
 	AssetID id{};
 
 	glm::vec4 albedo{};
 	float metallic{};
 	float roughness{};
 
-	const Texture2D* albedoMap   { nullptr };
-	const Texture2D* normalMap   { nullptr };
-	const Texture2D* metallicMap { nullptr };
-	const Texture2D* roughnessMap{ nullptr };
+	// indices into the model texture list
+	u32 albedoMap   { kNoTexture };
+	u32 normalMap   { kNoTexture };
+	u32 metallicMap { kNoTexture };
+	u32 roughnessMap{ kNoTexture };
 
 	bool operator==(const ParsedMaterial& other)
 	{
@@ -68,56 +90,95 @@ struct ParsedMaterial
 	}
 };
 
+// textures are only decoded while their section is written, one at a time
+struct ParsedTexture
+{
+	std::string file;
+	assets::TextureUsage usage{};
+
+	// source content plus processing settings, also the cache key
+	u64 hash{};
+};
+
 struct ParsedMesh
 {
-	AssetID id;
+	AssetID id{};
 
 	glm::vec3 aabbMin{};
 	glm::vec3 aabbMax{};
 
 	VertexBuffer interlacedVertices{};
 	std::vector<u32> indices{};
+	IndexFormat indexFormat = IndexFormat::U32;
+
+	// coarser levels of detail, index only, they share interlacedVertices
+	std::vector<assets::SimplifiedLod> lods{};
+
+	// clusters of indices for runtime culling, level 0 only
+	std::vector<graphics::Meshlet> meshlets{};
 
 	AssetID materialID{};
 };
 
 struct ParsedModel
 {
-	AssetID id;
-	std::vector<ParsedMesh> meshes;
+	AssetID id{};
+	std::vector<ParsedTexture> textures;
+
+	// identical textures behind different paths share one entry
+	std::unordered_map<std::string, u32> pathIndices;
+	std::unordered_map<u64, u32> contentIndices;
+
+	u64 settingsHash{};
 };
 
-static const Texture2D* FindOrAddTexture(const std::string& file)
+// bump whenever processing produces different output for the same input, invalidates every cached entry
+static constexpr u32 kProcessingVersion = 2;
+
+static u32 FindOrAddTexture(ParsedModel& model, const std::string& file, assets::TextureUsage usage)
 {
-	static std::unordered_map<std::string, Texture2D> loadedTextures;
+	auto found = model.pathIndices.find(file);
+	if (found != model.pathIndices.end())
+	{
+		return found->second;
+	}
+
+	u64 hash = util::Hash64(&usage, sizeof(usage), model.settingsHash);
+	hash = assets::HashFile(file, hash);
 
-	if (loadedTextures.find(file) == loadedTextures.end())
+	auto sameContent = model.contentIndices.find(hash);
+	if (sameContent != model.contentIndices.end())
 	{
-		loadedTextures.emplace(file, file);
+		G_INFO("Texture {} is identical to {}, storing it once", file, model.textures[sameContent->second].file);
+		model.pathIndices.emplace(file, sameContent->second);
+		return sameContent->second;
 	}
 
-	return &loadedTextures[file];
+	const u32 index = static_cast<u32>(model.textures.size());
+	model.textures.push_back({ file, usage, hash });
+	model.pathIndices.emplace(file, index);
+	model.contentIndices.emplace(hash, index);
+	return index;
 }
 
-
-AssetID createAssetID()
+// ids are derived from content, processing the same input twice gives the same file
+static AssetID createAssetID(u64 hash)
 {
-	static std::random_device dev;
-	static std::mt19937 rng(dev());
-
-	std::uniform_int_distribution<int> dist(0, 15);
 	const char* v = "0123456789abcdef";
 
 	AssetID result;
-	for (int i = 0; i < 16; i++)
+	for (int i = 0; i < AssetID::KEY_LENGTH; i++)
 	{
-		result.key[i] = v[dist(rng)];
-		result.key[i] = v[dist(rng)];
+		result.key[i] = v[(hash >> (60 - i * 4)) & 0xf];
 	}
 
 	return result;
 }
 
+// levels of detail after the source mesh, and the largest error (relative to the bounds diagonal) they may reach
+static constexpr u32 kMaxLods = 4;
+static constexpr f32 kMaxLodError = 0.05f;
+
 static ParsedMesh CreateMesh(const aiMesh* mesh)
 {
 	using namespace graphics;
@@ -128,54 +189,103 @@ static ParsedMesh CreateMesh(const aiMesh* mesh)
 
 	ParsedMesh result;
 
-	result.interlacedVertices = VertexBuffer(std::move(VertexLayout().Push<VertexLayout::Position3>()
-																	.Push<VertexLayout::Normal>()
-																	.Push<VertexLayout::Texcoord2>()));
-
-	result.interlacedVertices.Reserve(mesh->mNumVertices);
+	using Layout = quantization::MeshVertexLayout;
+	result.interlacedVertices = VertexBuffer(Layout::ToRuntime());
 
-	constexpr float fMin = std::numeric_limits<float>::min();
-	constexpr float fMax = std::numeric_limits<float>::max();
-	result.aabbMin = { fMax,fMax,fMax };
-	result.aabbMax = { fMin, fMin, fMin };
+	const u32 vertexSize = Layout::kStride;
 
+	std::vector<glm::vec3> positions;
+	positions.reserve(mesh->mNumVertices);
 	for (size_t i = 0; i < mesh->mNumVertices; ++i)
 	{
-		glm::vec3 pos = { mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z };
+		positions.push_back({ mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z });
+	}
+
+	result.indices.reserve(mesh->mNumFaces * 3);
+	for (size_t i = 0; i < mesh->mNumFaces; ++i)
+	{
+		DEBUG_ASSERT(mesh->mFaces[i].mNumIndices == 3, "");
+		result.indices.push_back(mesh->mFaces[i].mIndices[0]);
+		result.indices.push_back(mesh->mFaces[i].mIndices[1]);
+		result.indices.push_back(mesh->mFaces[i].mIndices[2]);
+	}
+
+	const assets::VertexCacheStatistics cacheBefore = assets::AnalyzeVertexCache(result.indices, mesh->mNumVertices);
+	const assets::VertexFetchStatistics fetchBefore = assets::AnalyzeVertexFetch(result.indices, mesh->mNumVertices, vertexSize);
+
+	// triangle order first (cache, then overdraw on top of it), vertex order last since it follows the triangle order
+	std::vector<u32> remap;
+	assets::OptimizeVertexCache(result.indices, mesh->mNumVertices);
+	assets::OptimizeOverdraw(result.indices, positions);
+	const u32 vertexCount = assets::OptimizeVertexFetch(result.indices, mesh->mNumVertices, remap);
+
+	std::vector<u32> vertexOrder(vertexCount);
+	for (u32 i = 0; i < mesh->mNumVertices; ++i)
+	{
+		if (remap[i] != assets::kUnusedVertex)
+		{
+			vertexOrder[remap[i]] = i;
+		}
+	}
 
-		if (pos.x < result.aabbMin.x) result.aabbMin.x = pos.x;
-		if (pos.y < result.aabbMin.y) result.aabbMin.y = pos.y;
-		if (pos.z < result.aabbMin.z) result.aabbMin.z = pos.z;
+	constexpr float fMax = std::numeric_limits<float>::max();
+	constexpr float fLowest = std::numeric_limits<float>::lowest();
+	result.aabbMin = { fMax, fMax, fMax };
+	result.aabbMax = { fLowest, fLowest, fLowest };
 
-		if (pos.x > result.aabbMax.x) result.aabbMax.x = pos.x;
-		if (pos.y > result.aabbMax.y) result.aabbMax.y = pos.y;
-		if (pos.z > result.aabbMax.z) result.aabbMax.z = pos.z;
+	for (u32 i : vertexOrder)
+	{
+		result.aabbMin = glm::min(result.aabbMin, positions[i]);
+		result.aabbMax = glm::max(result.aabbMax, positions[i]);
+	}
 
+	// same quantized layout the runtime uses, the loader hands it to the GPU untouched
+	const quantization::PositionBounds bounds = quantization::ComputePositionBounds(result.aabbMin, result.aabbMax);
+
+	Layout::View vertices = result.interlacedVertices.Append<Layout>(vertexCount);
+	for (u32 vertex = 0; vertex < vertexCount; ++vertex)
+	{
+		const u32 i = vertexOrder[vertex];
 		auto nor = glm::vec3{ mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z };
 		auto tex = glm::vec2{ mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y };
 
-		result.interlacedVertices.Emplace(pos, nor, tex);
+		vertices.Write(vertex, quantization::QuantizePosition(positions[i], bounds), quantization::EncodeOctahedral16(nor), quantization::EncodeHalfTexcoord(tex));
 	}
 
-	DEBUG_ASSERT(result.interlacedVertices.VertexCount() == mesh->mNumVertices, "");
+	DEBUG_ASSERT(result.interlacedVertices.VertexCount() == vertexCount, "");
 
-	
-	result.indices.reserve(mesh->mNumFaces);
-	for (size_t i = 0; i < mesh->mNumFaces; ++i)
+	result.indexFormat = assets::SelectIndexFormat(vertexCount);
+
+	std::vector<glm::vec3> optimizedPositions(vertexCount);
+	for (u32 i = 0; i < vertexCount; ++i)
 	{
-		DEBUG_ASSERT(mesh->mFaces[i].mNumIndices == 3, "");
-		result.indices.push_back(mesh->mFaces[i].mIndices[0]);
-		result.indices.push_back(mesh->mFaces[i].mIndices[1]);
-		result.indices.push_back(mesh->mFaces[i].mIndices[2]);
+		optimizedPositions[i] = positions[vertexOrder[i]];
 	}
+	result.lods = assets::GenerateLods(result.indices, optimizedPositions, kMaxLods, kMaxLodError);
+
+	for (u32 i = 0; i < result.lods.size(); ++i)
+	{
+		G_INFO("    LOD {}: {} triangles, error {:.5f}", i + 1, result.lods[i].indices.size() / 3, result.lods[i].error);
+	}
+
+	result.meshlets = assets::BuildMeshlets(result.indices, optimizedPositions);
+
+	const assets::MeshletStatistics meshlets = assets::AnalyzeMeshlets(result.meshlets, result.indices);
+	G_INFO("    {} meshlets, {:.1f} vertices and {:.1f} triangles on average, {} with a normal cone", meshlets.meshletCount, meshlets.averageVertices, meshlets.averageTriangles, meshlets.coneCount);
+
+	const assets::VertexCacheStatistics cacheAfter = assets::AnalyzeVertexCache(result.indices, vertexCount);
+	const assets::VertexFetchStatistics fetchAfter = assets::AnalyzeVertexFetch(result.indices, vertexCount, vertexSize);
+
+	G_INFO("Mesh optimized: {} vertices ({} unused removed), {} triangles, {} bit indices", vertexCount, mesh->mNumVertices - vertexCount, result.indices.size() / 3, result.indexFormat == IndexFormat::U16 ? 16 : 32);
+	G_INFO("    ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}", cacheBefore.acmr, cacheAfter.acmr, cacheBefore.atvr, cacheAfter.atvr);
+	G_INFO("    fetched {} KB -> {} KB, overfetch {:.3f} -> {:.3f}", fetchBefore.bytesFetched / gold::memory::KB, fetchAfter.bytesFetched / gold::memory::KB, fetchBefore.overfetch, fetchAfter.overfetch);
 
 	return result;
 }
 
-static ParsedMaterial CreateMaterial(const std::string& filepath, const aiMaterial* const material)
+static ParsedMaterial CreateMaterial(ParsedModel& model, const std::string& filepath, const aiMaterial* const material)
 {
 	ParsedMaterial result;
-	result.id = createAssetID();
 
 	aiString albedo;
 	aiString normal;
@@ -187,7 +297,7 @@ static ParsedMaterial CreateMaterial(const std::string& filepath, const aiMateri
 		material->GetTexture(aiTextureType_DIFFUSE, 0, &albedo) ||
 		material->GetTexture(aiTextureType_AMBIENT, 0, &albedo))
 	{
-		result.albedoMap = FindOrAddTexture(filepath + albedo.C_Str());
+		result.albedoMap = FindOrAddTexture(model, filepath + albedo.C_Str(), assets::TextureUsage::Color);
 	}
 	else
 	{
@@ -201,13 +311,13 @@ static ParsedMaterial CreateMaterial(const std::string& filepath, const aiMateri
 	// normal
 	if (material->GetTexture(aiTextureType_NORMALS, 0, &normal) == AI_SUCCESS)
 	{
-		result.normalMap = FindOrAddTexture(filepath + normal.C_Str());
+		result.normalMap = FindOrAddTexture(model, filepath + normal.C_Str(), assets::TextureUsage::Normal);
 	}
 
 	// metallic
 	if (material->GetTexture(AI_MATKEY_METALLIC_TEXTURE, &metallic) == AI_SUCCESS)
 	{
-		result.metallicMap = FindOrAddTexture(filepath + metallic.C_Str());
+		result.metallicMap = FindOrAddTexture(model, filepath + metallic.C_Str(), assets::TextureUsage::Data);
 	}
 	else
 	{
@@ -221,7 +331,7 @@ static ParsedMaterial CreateMaterial(const std::string& filepath, const aiMateri
 	// roughness
 	if (material->GetTexture(AI_MATKEY_ROUGHNESS_TEXTURE, &roughness) == AI_SUCCESS)
 	{
-		result.roughnessMap = FindOrAddTexture(filepath + roughness.C_Str());
+		result.roughnessMap = FindOrAddTexture(model, filepath + roughness.C_Str(), assets::TextureUsage::Data);
 	}
 	else
 	{
@@ -232,129 +342,417 @@ static ParsedMaterial CreateMaterial(const std::string& filepath, const aiMateri
 		}
 	}
 
+	// constants plus texture content, materials that look the same get the same id
+	u64 hash = util::Hash64(&result.albedo, sizeof(result.albedo), model.settingsHash);
+	hash = util::Hash64(&result.metallic, sizeof(result.metallic), hash);
+	hash = util::Hash64(&result.roughness, sizeof(result.roughness), hash);
+	for (u32 map : { result.albedoMap, result.normalMap, result.metallicMap, result.roughnessMap })
+	{
+		const u64 textureHash = map != ParsedMaterial::kNoTexture ? model.textures[map].hash : 0;
+		hash = util::Hash64(&textureHash, sizeof(textureHash), hash);
+	}
+	result.id = createAssetID(hash);
+
 	return result;
 }
 
-static void WriteModelFile(const ParsedModel& model, const std::unordered_map<u32, ParsedMaterial>& materials, const std::string& fileName)
+// everything CreateMesh reads from the source mesh
+static u64 HashMesh(const aiMesh* mesh, u64 settingsHash)
 {
-	// TODO (danielg): currently assets have a max 2GB buffer. Fix this? calculate it? 
-	constexpr u32 bufferSize = 2 * gold::memory::GB;
-	u8* buffer = (u8*)malloc(bufferSize);
-	gold::BinaryWriter writer(buffer, bufferSize);
-	
-	writer.Write(model.id);
-	
-	// write materials
-	writer.Write(static_cast<u16>(materials.size()));
+	u64 hash = util::Hash64(mesh->mVertices, mesh->mNumVertices * sizeof(aiVector3D), settingsHash);
+	hash = util::Hash64(mesh->mNormals, mesh->mNumVertices * sizeof(aiVector3D), hash);
+	hash = util::Hash64(mesh->mTextureCoords[0], mesh->mNumVertices * sizeof(aiVector3D), hash);
+
+	for (u32 i = 0; i < mesh->mNumFaces; ++i)
+	{
+		hash = util::Hash64(mesh->mFaces[i].mIndices, mesh->mFaces[i].mNumIndices * sizeof(u32), hash);
+	}
+
+	return hash;
+}
+
+// materials are a few bytes each, not worth a block
+static scene::model::SectionCompression SelectCompression(scene::model::SectionType type, bool compress)
+{
+	return compress && type != scene::model::SectionType::Materials ? scene::model::SectionCompression::BlockLZ4 : scene::model::SectionCompression::Store;
+}
+
+// starts a section at the current offset, EndSection fills in its size
+static scene::model::SectionEntry BeginSection(assets::FileWriter& writer, scene::model::SectionType type, u32 count, scene::model::SectionCompression compression)
+{
+	scene::model::SectionEntry section{};
+	section.type = type;
+	section.count = count;
+	section.offset = writer.GetOffset();
+	section.compression = compression;
+
+	if (compression == scene::model::SectionCompression::BlockLZ4)
+	{
+		section.blockSize = gold::compression::kDefaultBlockSize;
+		writer.BeginBlocks(section.blockSize);
+	}
+
+	return section;
+}
+
+static void EndSection(assets::FileWriter& writer, scene::model::SectionEntry& section, std::vector<scene::model::SectionEntry>& sections)
+{
+	static constexpr const char* kSectionNames[] = { "Textures", "Materials", "Meshes" };
+
+	if (section.compression == scene::model::SectionCompression::BlockLZ4)
+	{
+		const assets::FileWriter::BlockStatistics blocks = writer.EndBlocks();
+		section.size = writer.GetOffset() - section.offset;
+		section.uncompressedSize = blocks.uncompressedBytes;
 
-	auto writeTexture = [](const Texture2D& tex, gold::BinaryWriter& writer)
+		G_INFO("{} section: {} KB -> {} KB ({:.1f}%), {} of {} blocks stored", kSectionNames[static_cast<u32>(section.type)], section.uncompressedSize / gold::memory::KB,
+			section.size / gold::memory::KB, section.uncompressedSize > 0 ? 100.0 * section.size / section.uncompressedSize : 100.0, blocks.storedBlocks, blocks.blockCount);
+	}
+	else
 	{
-		writer.Write(tex.GetWidth());
-		writer.Write(tex.GetHeight());
-		writer.Write(tex.GetChannels());
-		
-		const u32 dataSize = tex.GetDataSize();
-		const void* data = tex.GetData();
+		section.size = writer.GetOffset() - section.offset;
+		section.uncompressedSize = section.size;
+	}
+
+	sections.push_back(section);
+}
+
+static void WriteTexture(const ParsedTexture& texture, assets::FileWriter& writer, gold::ThreadPool& pool)
+{
+	const Texture2D source(texture.file);
 
-		writer.Write(dataSize);
-		writer.Write(data, dataSize);
+	const assets::MipChain chain = assets::GenerateMipChain(source, texture.usage);
+	const graphics::TextureFormat format = assets::SelectCompressedFormat(chain, texture.usage);
+	const assets::CompressedTexture compressed = assets::CompressMipChain(chain, format, pool);
+
+	// full mip chain in a dds container, loaded at runtime without decoding
+	std::vector<u8> dds;
+	graphics::dds::Write(compressed.format, compressed.width, compressed.height, compressed.levels, dds);
+
+	const u32 dataSize = static_cast<u32>(dds.size());
+	writer.Write(dataSize);
+	writer.Write(dds.data(), dataSize);
+
+	G_INFO("Processed texture: {} ({} KB)", texture.file, dataSize / gold::memory::KB);
+}
+
+static void WriteMaterial(const ParsedMaterial& material, assets::FileWriter& writer)
+{
+	G_INFO("Writing material: {}", material.id.Name());
+	writer.Write(material.id);
+
+	auto writeMap = [&writer](u32 map)
+	{
+		const u8 hasTexture = map != ParsedMaterial::kNoTexture;
+		writer.Write(hasTexture);
+		if (hasTexture) writer.Write(map);
+		return hasTexture;
 	};
 
-	for (const auto& entry : materials)
+	if (!writeMap(material.albedoMap))		writer.Write(material.albedo);
+	writeMap(material.normalMap);
+	if (!writeMap(material.metallicMap))	writer.Write(material.metallic);
+	if (!writeMap(material.roughnessMap))	writer.Write(material.roughness);
+}
+
+static void WriteMesh(const ParsedMesh& mesh, assets::FileWriter& writer)
+{
+	writer.Write(mesh.id);
+
+	//aabb
+	writer.Write(mesh.aabbMin);
+	writer.Write(mesh.aabbMax);
+
+	// vertex layout
+	VertexLayout layout = mesh.interlacedVertices.GetLayout();
+	writer.Write(layout.ElementCount());
+	for (u32 i = 0; i < layout.ElementCount(); ++i)
 	{
-		const auto& material = entry.second;
-		G_INFO("Writing material: {}", material.id.Name());
-		writer.Write(material.id);
+		auto element = layout.Resolve(i);
+		writer.Write(element.GetType());
+	}
 
-		{
-			u8 hasAlbedoTex = material.albedoMap != nullptr;
-			writer.Write(hasAlbedoTex);
-			if (hasAlbedoTex) writeTexture(*material.albedoMap, writer);
-			else			  writer.Write(material.albedo);
-		}
+	// vertex data
+	writer.Write(mesh.interlacedVertices.SizeInBytes());
+	writer.Write(mesh.interlacedVertices.Raw(), mesh.interlacedVertices.SizeInBytes());
 
+	// index data, narrowed to 16 bit whenever the vertex count allows it
+	auto writeIndices = [&writer, &mesh](const std::vector<u32>& indices)
+	{
+		writer.Write(indices.size());
+		if (mesh.indexFormat == IndexFormat::U16)
 		{
-			u8 hasNormalTex = material.normalMap != nullptr;
-			writer.Write(hasNormalTex);
-			if (hasNormalTex) writeTexture(*material.normalMap, writer);
+			std::vector<u16> narrowIndices(indices.begin(), indices.end());
+			writer.Write(narrowIndices.data(), narrowIndices.size() * sizeof(u16));
 		}
-
+		else
 		{
-			u8 hasMetallicTex = material.metallicMap != nullptr;
-			writer.Write(hasMetallicTex);
-			if (hasMetallicTex) writeTexture(*material.metallicMap, writer);
-			else				writer.Write(material.metallic);
+			writer.Write(indices.data(), indices.size() * sizeof(u32));
 		}
+	};
 
+	writer.Write(mesh.indexFormat);
+	writeIndices(mesh.indices);
+
+	// levels of detail, coarsest last
+	writer.Write(static_cast<u8>(mesh.lods.size()));
+	for (const assets::SimplifiedLod& lod : mesh.lods)
+	{
+		writer.Write(lod.error);
+		writeIndices(lod.indices);
+	}
+
+	// clusters of level 0
+	writer.Write(static_cast<u32>(mesh.meshlets.size()));
+	writer.Write(mesh.meshlets.data(), mesh.meshlets.size() * sizeof(graphics::Meshlet));
+}
+
+// records every file Assimp opens (the model, its buffers...), they are all sources of the output
+class RecordingIOSystem : public Assimp::DefaultIOSystem
+{
+private:
+	std::vector<std::string>& mFiles;
+
+public:
+	explicit RecordingIOSystem(std::vector<std::string>& files)
+		: mFiles(files)
+	{
+	}
 
+	Assimp::IOStream* Open(const char* file, const char* mode) override
+	{
+		Assimp::IOStream* stream = DefaultIOSystem::Open(file, mode);
+		if (stream)
 		{
-			u8 hasRoughnessTex = material.roughnessMap != nullptr;
-			writer.Write(hasRoughnessTex);
-			if (hasRoughnessTex) writeTexture(*material.roughnessMap, writer);
-			else				 writer.Write(material.roughness);
+			mFiles.push_back(file);
 		}
+		return stream;
+	}
+};
+
+
+using Clock = std::chrono::steady_clock;
+
+static constexpr unsigned int kAssimpFlags = 0	| aiProcess_Triangulate
+												| aiProcess_FlipUVs
+												| aiProcess_RemoveRedundantMaterials
+												| aiProcess_JoinIdenticalVertices
+												| aiProcess_SplitLargeMeshes
+												| aiProcess_OptimizeMeshes;
+
+enum class Stage : u8
+{
+	Import = 0,
+	Mesh,
+	Texture,
+	Write,
+	Count
+};
+
+static constexpr const char* kStageNames[] = { "import", "mesh", "texture", "write" };
+
+// summed over every worker, a stage can take longer than the whole run
+struct StageStatistics
+{
+	std::atomic<u32> count = 0;
+	std::atomic<u64> nanoseconds = 0;
+	std::atomic<u64> bytes = 0;
+};
+
+struct BlobState
+{
+	bool done = false;
+	bool succeeded = false;
+
+	// called once the blob is in the cache, with whether it got there
+	std::vector<std::function<void(bool)>> waiters;
+};
+
+// shared by every model of a batch
+struct BatchContext
+{
+	gold::ThreadPool& pool;
+	assets::AssetCache cache;
+	std::string cacheDirectory;
+	u64 settingsHash{};
+
+	// settings plus what only changes the output file, not the cached blobs
+	u64 outputHash{};
+	bool compress = true;
+
+	StageStatistics stages[static_cast<u8>(Stage::Count)];
+
+	// per SectionType over every written model
+	std::atomic<u64> sectionBytes[3] = {};
+	std::atomic<u64> sectionUncompressedBytes[3] = {};
+
+	// models share textures, the first model to need a blob produces it and the others wait for it
+	std::mutex blobMutex;
+	std::unordered_map<u64, BlobState> blobs[2];
+
+	std::atomic<u32> processedCount = 0;
+	std::atomic<u32> reusedCount = 0;
+	std::atomic<u32> upToDateCount = 0;
+	std::atomic<u32> failedCount = 0;
+
+	BatchContext(gold::ThreadPool& threadPool, const char* directory)
+		: pool(threadPool)
+		, cache(directory)
+		, cacheDirectory(directory)
+	{
 	}
 
-	writer.Write(static_cast<u16>(model.meshes.size()));
-	for (const ParsedMesh& mesh : model.meshes)
+	void Record(Stage stage, Clock::time_point start, u64 bytes)
 	{
-		G_INFO("Writing mesh: ", mesh.id.Name());
-		writer.Write(mesh.id);
+		StageStatistics& statistics = stages[static_cast<u8>(stage)];
+		++statistics.count;
+		statistics.nanoseconds += static_cast<u64>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+		statistics.bytes += bytes;
+	}
+};
+
+// one model moving through import -> meshes and textures -> write
+struct ModelJob
+{
+	assets::ModelAsset asset;
+	ParsedModel model;
+
+	std::vector<std::string> sources;
+	std::unique_ptr<Assimp::Importer> importer;
+	const aiScene* scene = nullptr;
+
+	std::unordered_map<u32, ParsedMaterial> materials;
+	std::vector<u64> meshHashes;
+
+	// meshes and textures not in the cache yet, the write is submitted when this reaches 0
+	std::atomic<u32> pendingBlobs = 0;
+	std::atomic<bool> failed = false;
+};
+
+static void WriteModel(BatchContext& context, ModelJob& job);
+
+static void OnBlobReady(BatchContext& context, ModelJob& job, bool succeeded)
+{
+	if (!succeeded)
+	{
+		job.failed = true;
+	}
+
+	if (--job.pendingBlobs == 0)
+	{
+		context.pool.Submit([&context, &job]() { WriteModel(context, job); });
+	}
+}
 
-		//aabb
-		writer.Write(mesh.aabbMin);
-		writer.Write(mesh.aabbMax);
+static void RequireBlob(BatchContext& context, ModelJob& job, assets::AssetCache::BlobType type, u64 hash, Stage stage, std::function<void(assets::FileWriter&)>&& produce)
+{
+	++job.pendingBlobs;
 
-		// vertex layout
-		VertexLayout layout = mesh.interlacedVertices.GetLayout();
-		writer.Write(layout.ElementCount());
-		for (u32 i = 0; i < layout.ElementCount(); ++i)
+	BlobState* state = nullptr;
+	bool ready = false;
+	bool succeeded = false;
+	bool claimed = false;
+	{
+		std::scoped_lock lock(context.blobMutex);
+		auto [entry, inserted] = context.blobs[static_cast<u8>(type)].try_emplace(hash);
+		state = &entry->second;
+
+		if (state->done)
 		{
-			auto element = layout.Resolve(i);
-			writer.Write(element.GetType());
+			ready = true;
+			succeeded = state->succeeded;
 		}
+		else
+		{
+			state->waiters.push_back([&context, &job](bool result) { OnBlobReady(context, job, result); });
+			claimed = inserted;
+		}
+	}
 
-		// vertex data
-		writer.Write(mesh.interlacedVertices.SizeInBytes());
-		writer.Write(mesh.interlacedVertices.Raw(), mesh.interlacedVertices.SizeInBytes());
-
-		// index data
-		writer.Write(mesh.indices.size());
-		writer.Write(mesh.indices.data(), mesh.indices.size() * sizeof(u32));
+	// produced earlier in this batch
+	if (ready)
+	{
+		++context.reusedCount;
+		OnBlobReady(context, job, succeeded);
+		return;
+	}
 
-		writer.Write(mesh.materialID);
+	// another model is producing it and will notify us
+	if (!claimed)
+	{
+		return;
 	}
-	gold::BinaryReader reader = writer.ToReader();
 
-	G_INFO("Writing complete. Now Compressing...");
+	context.pool.Submit([&context, state, type, hash, stage, produce = std::move(produce)]()
+	{
+		bool succeeded = true;
+		if (context.cache.HasBlob(type, hash))
+		{
+			++context.reusedCount;
+		}
+		else
+		{
+			const Clock::time_point start = Clock::now();
+			succeeded = context.cache.StoreBlob(type, hash, produce);
+
+			std::error_code error;
+			const u64 size = succeeded ? static_cast<u64>(std::filesystem::file_size(context.cache.GetBlobPath(type, hash), error)) : 0;
+			context.Record(stage, start, error ? 0 : size);
+
+			if (succeeded)
+			{
+				++context.processedCount;
+			}
+			else
+			{
+				G_ERROR("Failed to write to the asset cache at {}", context.cacheDirectory);
+			}
+		}
 
-	std::ofstream stream(fileName, std::ios::out | std::ios::binary | std::ios::trunc);
+		std::vector<std::function<void(bool)>> waiters;
+		{
+			std::scoped_lock lock(context.blobMutex);
+			state->done = true;
+			state->succeeded = succeeded;
+			waiters.swap(state->waiters);
+		}
 
-	stream.write((char*)reader.GetData(), reader.GetSize());
-	free(buffer);
+		for (auto& waiter : waiters)
+		{
+			waiter(succeeded);
+		}
+	});
 }
 
-void assets::ProcessModelAsset(const char* inputFile, const char* outputFile)
+static void ImportModel(BatchContext& context, ModelJob& job)
 {
-	G_INFO("Processing model file: ", inputFile);
-
-	constexpr unsigned int assimpFlags = 0	| aiProcess_Triangulate
-											| aiProcess_FlipUVs
-											| aiProcess_ImproveCacheLocality
-											| aiProcess_RemoveRedundantMaterials
-											| aiProcess_JoinIdenticalVertices
-											| aiProcess_SplitLargeMeshes
-											| aiProcess_OptimizeMeshes;
-
-	Assimp::Importer importer;
-	const aiScene* assimpScene = importer.ReadFile(inputFile, assimpFlags);
-	DEBUG_ASSERT(assimpScene && assimpScene->HasMeshes(), "Failed to load mesh file");
-	if (!assimpScene)
-	{
-		G_INFO("Failed to load file. Exiting.");
+	const Clock::time_point start = Clock::now();
+	const char* inputFile = job.asset.input.c_str();
+	const char* outputFile = job.asset.output.c_str();
+
+	G_INFO("Processing model file: {}", inputFile);
+
+	ParsedModel& model = job.model;
+	model.settingsHash = context.settingsHash;
+
+	if (context.cache.IsUpToDate(outputFile, context.outputHash))
+	{
+		G_INFO("{} is up to date", outputFile);
+		++context.upToDateCount;
 		return;
 	}
-	G_INFO("Successfully loaded file. Begin parsing.");
+
+	job.importer = std::make_unique<Assimp::Importer>();
+	job.importer->SetIOHandler(new RecordingIOSystem(job.sources)); // the importer owns it
+	job.scene = job.importer->ReadFile(inputFile, kAssimpFlags);
+	if (!job.scene || !job.scene->HasMeshes())
+	{
+		G_ERROR("Failed to load {}: {}", inputFile, job.importer->GetErrorString());
+		++context.failedCount;
+		job.importer.reset();
+		return;
+	}
+	G_INFO("Successfully loaded {}. Begin parsing.", inputFile);
 
 	std::string file(inputFile);
 	std::replace(file.begin(), file.end(), '\\', '/');
@@ -362,24 +760,261 @@ void assets::ProcessModelAsset(const char* inputFile, const char* outputFile)
 	std::string filepath = file.substr(0, file.find_last_of('/'));
 	filepath += '/';
 
-	ParsedModel result;
-	result.id = createAssetID();
+	const aiScene* assimpScene = job.scene;
 
-	std::unordered_map<u32, ParsedMaterial> materials;
+	// materials first, they are small and decide which textures the model needs
 	for (u32 i = 0; i < assimpScene->mNumMeshes; ++i)
 	{
-		ParsedMesh mesh = CreateMesh(assimpScene->mMeshes[i]);
-		G_INFO("Mesh {} parsed", i);
-
-		if (materials.find(assimpScene->mMeshes[i]->mMaterialIndex) == materials.end())
+		const u32 materialIndex = assimpScene->mMeshes[i]->mMaterialIndex;
+		if (job.materials.find(materialIndex) == job.materials.end())
 		{
-			materials[assimpScene->mMeshes[i]->mMaterialIndex] = CreateMaterial(filepath, assimpScene->mMaterials[assimpScene->mMeshes[i]->mMaterialIndex]);
-			G_INFO("Material {} parsed", assimpScene->mMeshes[i]->mMaterialIndex);
+			job.materials[materialIndex] = CreateMaterial(model, filepath, assimpScene->mMaterials[materialIndex]);
 		}
-		mesh.materialID = materials[assimpScene->mMeshes[i]->mMaterialIndex].id;
 	}
-	
+
+	u64 modelHash = model.settingsHash;
+	for (u32 i = 0; i < assimpScene->mNumMeshes; ++i)
+	{
+		job.meshHashes.push_back(HashMesh(assimpScene->mMeshes[i], model.settingsHash));
+
+		const AssetID& materialID = job.materials[assimpScene->mMeshes[i]->mMaterialIndex].id;
+		modelHash = util::Hash64(&job.meshHashes.back(), sizeof(u64), modelHash);
+		modelHash = util::Hash64(materialID.key, AssetID::KEY_LENGTH, modelHash);
+	}
+	model.id = createAssetID(modelHash);
+
+	std::error_code error;
+	const u64 inputSize = static_cast<u64>(std::filesystem::file_size(inputFile, error));
+	context.Record(Stage::Import, start, error ? 0 : inputSize);
+
+	// held until every blob is requested, a fast blob cannot start the write early
+	job.pendingBlobs = 1;
+
+	for (const ParsedTexture& texture : model.textures)
+	{
+		RequireBlob(context, job, assets::AssetCache::BlobType::Texture, texture.hash, Stage::Texture, [texture, &context](assets::FileWriter& blob) { WriteTexture(texture, blob, context.pool); });
+	}
+
+	for (u32 i = 0; i < assimpScene->mNumMeshes; ++i)
+	{
+		const aiMesh* sourceMesh = assimpScene->mMeshes[i];
+		auto produce = [sourceMesh, i, hash = job.meshHashes[i]](assets::FileWriter& blob)
+		{
+			ParsedMesh mesh = CreateMesh(sourceMesh);
+			mesh.id = createAssetID(hash);
+			G_INFO("Mesh {} processed", i);
+
+			WriteMesh(mesh, blob);
+		};
+
+		RequireBlob(context, job, assets::AssetCache::BlobType::Mesh, job.meshHashes[i], Stage::Mesh, std::move(produce));
+	}
+
+	OnBlobReady(context, job, true);
+}
+
+static void WriteModel(BatchContext& context, ModelJob& job)
+{
+	const Clock::time_point start = Clock::now();
+	const char* outputFile = job.asset.output.c_str();
+	const ParsedModel& model = job.model;
+
+	// the scene is only needed for mesh processing, every mesh is in the cache by now
+	const u32 meshCount = job.scene->mNumMeshes;
+	std::vector<u32> meshMaterials(meshCount);
+	for (u32 i = 0; i < meshCount; ++i)
+	{
+		meshMaterials[i] = job.scene->mMeshes[i]->mMaterialIndex;
+	}
+	job.importer.reset();
+	job.scene = nullptr;
+
+	if (job.failed)
+	{
+		G_ERROR("Skipping {}, not every texture and mesh could be processed", outputFile);
+		++context.failedCount;
+		return;
+	}
+
 	G_INFO("Parsing successful. Begin writing to: {}", outputFile);
-	WriteModelFile(result, materials, outputFile);
-	G_INFO("Writing complete. Exiting.");
+
+	// sections are written as they are produced, the section table goes last and the header is patched to it
+	assets::FileWriter writer(outputFile);
+	if (!writer.IsOpen())
+	{
+		G_ERROR("Cannot open output file: {}", outputFile);
+		++context.failedCount;
+		return;
+	}
+
+	writer.Write(scene::model::Header{});
+	writer.Write(model.id);
+
+	std::vector<scene::model::SectionEntry> sections;
+
+	auto copyBlob = [&](assets::AssetCache::BlobType type, u64 hash)
+	{
+		if (writer.WriteFileContents(context.cache.GetBlobPath(type, hash)) == 0)
+		{
+			G_ERROR("Cannot read cache entry {}", context.cache.GetBlobPath(type, hash));
+			return false;
+		}
+
+		return true;
+	};
+
+	{
+		auto section = BeginSection(writer, scene::model::SectionType::Textures, static_cast<u32>(model.textures.size()), SelectCompression(scene::model::SectionType::Textures, context.compress));
+		for (const ParsedTexture& texture : model.textures)
+		{
+			if (!copyBlob(assets::AssetCache::BlobType::Texture, texture.hash))
+			{
+				++context.failedCount;
+				return;
+			}
+		}
+		EndSection(writer, section, sections);
+	}
+
+	{
+		// materials with identical content share their id, one of them is enough
+		std::vector<const ParsedMaterial*> uniqueMaterials;
+		for (const auto& entry : job.materials)
+		{
+			auto sameID = std::find_if(uniqueMaterials.begin(), uniqueMaterials.end(), [&entry](const ParsedMaterial* other) { return other->id == entry.second.id; });
+			if (sameID == uniqueMaterials.end())
+			{
+				uniqueMaterials.push_back(&entry.second);
+			}
+		}
+
+		auto section = BeginSection(writer, scene::model::SectionType::Materials, static_cast<u32>(uniqueMaterials.size()), SelectCompression(scene::model::SectionType::Materials, context.compress));
+		for (const ParsedMaterial* material : uniqueMaterials)
+		{
+			WriteMaterial(*material, writer);
+		}
+		EndSection(writer, section, sections);
+	}
+
+	{
+		auto section = BeginSection(writer, scene::model::SectionType::Meshes, meshCount, SelectCompression(scene::model::SectionType::Meshes, context.compress));
+		for (u32 i = 0; i < meshCount; ++i)
+		{
+			if (!copyBlob(assets::AssetCache::BlobType::Mesh, job.meshHashes[i]))
+			{
+				++context.failedCount;
+				return;
+			}
+
+			writer.Write(job.materials[meshMaterials[i]].id);
+		}
+		EndSection(writer, section, sections);
+	}
+
+	scene::model::Header header{};
+	header.sectionTableOffset = writer.GetOffset();
+
+	writer.Write(static_cast<u32>(sections.size()));
+	for (const scene::model::SectionEntry& section : sections)
+	{
+		writer.Write(section);
+	}
+	writer.Patch(0, header);
+
+	const u64 fileSize = writer.GetOffset();
+	if (!writer.Close())
+	{
+		G_ERROR("Failed to write {}", outputFile);
+		++context.failedCount;
+		return;
+	}
+
+	for (const ParsedTexture& texture : model.textures)
+	{
+		job.sources.push_back(texture.file);
+	}
+	for (const auto& entry : model.pathIndices)
+	{
+		if (entry.first != model.textures[entry.second].file)
+		{
+			job.sources.push_back(entry.first);
+		}
+	}
+	context.cache.WriteManifest(outputFile, context.outputHash, job.sources);
+
+	for (const scene::model::SectionEntry& section : sections)
+	{
+		context.sectionBytes[static_cast<u32>(section.type)] += section.size;
+		context.sectionUncompressedBytes[static_cast<u32>(section.type)] += section.uncompressedSize;
+	}
+
+	context.Record(Stage::Write, start, fileSize);
+	G_INFO("Writing {} complete, {} MB", outputFile, fileSize / gold::memory::MB);
+}
+
+void assets::ProcessModelAssets(const std::vector<ModelAsset>& models, const char* cacheDirectory, u32 threadCount, bool compress)
+{
+	const Clock::time_point start = Clock::now();
+
+	gold::ThreadPool pool(threadCount);
+	BatchContext context(pool, cacheDirectory);
+
+	// everything that changes the output for the same sources
+	{
+		const u32 settings[] = { kProcessingVersion, scene::model::kVersion, kMaxLods, kAssimpFlags };
+		context.settingsHash = util::Hash64(settings, sizeof(settings));
+		context.settingsHash = util::Hash64(&kMaxLodError, sizeof(kMaxLodError), context.settingsHash);
+
+		context.compress = compress;
+		context.outputHash = util::Hash64(&compress, sizeof(compress), context.settingsHash);
+	}
+
+	G_INFO("Processing {} models on {} threads", models.size(), pool.GetThreadCount());
+
+	// per model: import -> one task per mesh and texture not cached yet -> write. Drain before the jobs go away
+	std::vector<std::unique_ptr<ModelJob>> jobs;
+	jobs.reserve(models.size());
+	for (const ModelAsset& asset : models)
+	{
+		jobs.push_back(std::make_unique<ModelJob>());
+		jobs.back()->asset = asset;
+	}
+
+	for (auto& job : jobs)
+	{
+		pool.Submit([&context, job = job.get()]() { ImportModel(context, *job); });
+	}
+	pool.Wait();
+
+	const f64 seconds = std::chrono::duration<f64>(Clock::now() - start).count();
+
+	G_INFO("Stage      count   total ms     avg ms    items/s       MB/s");
+	for (u8 i = 0; i < static_cast<u8>(Stage::Count); ++i)
+	{
+		const StageStatistics& stage = context.stages[i];
+		const u32 count = stage.count;
+		const f64 totalMilliseconds = stage.nanoseconds / 1e6;
+		const f64 megabytes = static_cast<f64>(stage.bytes) / gold::memory::MB;
+
+		G_INFO("{:<8} {:>7} {:>10.2f} {:>10.2f} {:>10.2f} {:>10.2f}", kStageNames[i], count, totalMilliseconds, count > 0 ? totalMilliseconds / count : 0.0,
+			count / seconds, megabytes / seconds);
+	}
+
+	G_INFO("Section    in memory MB    on disk MB    ratio");
+	for (u32 i = 0; i < 3; ++i)
+	{
+		static constexpr const char* kSectionNames[] = { "textures", "materials", "meshes" };
+
+		const f64 uncompressed = static_cast<f64>(context.sectionUncompressedBytes[i]) / gold::memory::MB;
+		const f64 onDisk = static_cast<f64>(context.sectionBytes[i]) / gold::memory::MB;
+		G_INFO("{:<10} {:>13.2f} {:>13.2f} {:>8.3f}", kSectionNames[i], uncompressed, onDisk, uncompressed > 0.0 ? onDisk / uncompressed : 1.0);
+	}
+
+	G_INFO("Finished in {:.2f}ms. {} models up to date, {} failed. {} textures and meshes processed, {} reused from the cache, {} tasks stolen",
+		seconds * 1000.0, context.upToDateCount.load(), context.failedCount.load(), context.processedCount.load(), context.reusedCount.load(), pool.GetStolenTaskCount());
+}
+
+void assets::ProcessModelAsset(const char* inputFile, const char* outputFile, const char* cacheDirectory)
+{
+	ProcessModelAssets({ { inputFile, outputFile } }, cacheDirectory, 0, true);
 }
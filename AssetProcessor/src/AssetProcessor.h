@@ -1,4 +1,19 @@
+#pragma once
+
+#include <core/Core.h>
+
 namespace assets
 {
-	void ProcessModelAsset(const char* inputFile, const char* outputFile);
-}
\ No newline at end of file
+	struct ModelAsset
+	{
+		std::string input;
+		std::string output;
+	};
+
+	// unchanged textures and meshes are reused from cacheDirectory, an unchanged model is not imported at all
+	void ProcessModelAsset(const char* inputFile, const char* outputFile, const char* cacheDirectory);
+
+	// processes every model on a pool of threadCount workers (0 picks one per core). Without compress every
+	// section is stored as is
+	void ProcessModelAssets(const std::vector<ModelAsset>& models, const char* cacheDirectory, u32 threadCount, bool compress);
+}
@@ -0,0 +1,208 @@
+#include "FileWriter.h"
+
+#include <core/Logging.h>
+#include <memory/BlockCompression.h>
+
+using namespace assets;
+
+FileWriter::FileWriter(const std::string& fileName, u64 chunkSize)
+	: mStream(fileName, std::ios::out | std::ios::binary | std::ios::trunc)
+	, mChunk(chunkSize)
+{
+	DEBUG_ASSERT(chunkSize > 0, "chunk size must be greater than 0");
+}
+
+FileWriter::~FileWriter()
+{
+	Close();
+}
+
+void FileWriter::Flush()
+{
+	if (mChunkOffset == 0)
+	{
+		return;
+	}
+
+	mStream.write(reinterpret_cast<const char*>(mChunk.data()), mChunkOffset);
+	mFlushedBytes += mChunkOffset;
+	mChunkOffset = 0;
+}
+
+void FileWriter::Write(const void* data, u64 size)
+{
+	DEBUG_ASSERT(IsOpen(), "Writing to a closed file!");
+
+	if (!mCompressing)
+	{
+		WriteToFile(data, size);
+		return;
+	}
+
+	const u8* bytes = static_cast<const u8*>(data);
+	while (size > 0)
+	{
+		const u64 count = std::min<u64>(size, mBlock.size() - mBlockOffset);
+		memcpy(mBlock.data() + mBlockOffset, bytes, count);
+		mBlockOffset += count;
+		bytes += count;
+		size -= count;
+
+		if (mBlockOffset == mBlock.size())
+		{
+			CompressBlock();
+		}
+	}
+}
+
+void FileWriter::WriteToFile(const void* data, u64 size)
+{
+	if (mChunkOffset + size > mChunk.size())
+	{
+		Flush();
+	}
+
+	// anything larger than a chunk goes straight to the file instead of being staged
+	if (size > mChunk.size())
+	{
+		mStream.write(static_cast<const char*>(data), size);
+		mFlushedBytes += size;
+		return;
+	}
+
+	memcpy(mChunk.data() + mChunkOffset, data, size);
+	mChunkOffset += size;
+}
+
+void FileWriter::BeginBlocks(u32 blockSize)
+{
+	DEBUG_ASSERT(!mCompressing, "Block stream already open!");
+	DEBUG_ASSERT(blockSize > 0, "block size must be greater than 0");
+
+	mCompressing = true;
+	mBlock.resize(blockSize);
+	mCompressedBlock.resize(blockSize);
+	mBlockSizes.clear();
+	mBlockOffset = 0;
+	mBlockStatistics = {};
+}
+
+FileWriter::BlockStatistics FileWriter::EndBlocks()
+{
+	DEBUG_ASSERT(mCompressing, "No block stream open!");
+
+	if (mBlockOffset > 0)
+	{
+		CompressBlock();
+	}
+
+	mCompressing = false;
+	WriteToFile(mBlockSizes.data(), mBlockSizes.size() * sizeof(u32));
+
+	return mBlockStatistics;
+}
+
+void FileWriter::CompressBlock()
+{
+	namespace compression = gold::compression;
+
+	// a block only counts as compressed when it shrinks, capacity one short of its size enforces that
+	u64 size = compression::CompressBlock(mBlock.data(), mBlockOffset, mCompressedBlock.data(), mBlockOffset - 1);
+	if (size > 0)
+	{
+		WriteToFile(mCompressedBlock.data(), size);
+		mBlockSizes.push_back(static_cast<u32>(size));
+	}
+	else
+	{
+		WriteToFile(mBlock.data(), mBlockOffset);
+		mBlockSizes.push_back(static_cast<u32>(mBlockOffset) | compression::kStoredBlock);
+		++mBlockStatistics.storedBlocks;
+	}
+
+	++mBlockStatistics.blockCount;
+	mBlockStatistics.uncompressedBytes += mBlockOffset;
+	mBlockOffset = 0;
+}
+
+void FileWriter::Patch(u64 offset, const void* data, u64 size)
+{
+	DEBUG_ASSERT(!mCompressing, "Patching inside a block stream!");
+	DEBUG_ASSERT(offset + size <= GetOffset(), "Patching past the end of the file!");
+
+	// still staged, nothing to seek
+	if (offset >= mFlushedBytes)
+	{
+		memcpy(mChunk.data() + (offset - mFlushedBytes), data, size);
+		return;
+	}
+
+	Flush();
+
+	mStream.seekp(offset);
+	mStream.write(static_cast<const char*>(data), size);
+	mStream.seekp(0, std::ios::end);
+}
+
+u64 FileWriter::WriteFileContents(const std::string& fileName)
+{
+	std::ifstream source(fileName, std::ios::in | std::ios::binary);
+	if (!source)
+	{
+		return 0;
+	}
+
+	// stage straight into the chunk (or the open block) so nothing beyond it is ever allocated
+	u64 copied = 0;
+	while (source && mCompressing)
+	{
+		source.read(reinterpret_cast<char*>(mBlock.data() + mBlockOffset), mBlock.size() - mBlockOffset);
+
+		const u64 read = static_cast<u64>(source.gcount());
+		mBlockOffset += read;
+		copied += read;
+
+		if (mBlockOffset == mBlock.size())
+		{
+			CompressBlock();
+		}
+	}
+
+	while (source)
+	{
+		if (mChunkOffset == mChunk.size())
+		{
+			Flush();
+		}
+
+		source.read(reinterpret_cast<char*>(mChunk.data() + mChunkOffset), mChunk.size() - mChunkOffset);
+
+		const u64 read = static_cast<u64>(source.gcount());
+		mChunkOffset += read;
+		copied += read;
+	}
+
+	return copied;
+}
+
+bool FileWriter::Close()
+{
+	if (!IsOpen())
+	{
+		return false;
+	}
+
+	// a block stream still open here means writing was abandoned, the file is incomplete either way
+	mCompressing = false;
+	Flush();
+
+	const bool succeeded = mStream.good();
+	mStream.close();
+
+	if (!succeeded)
+	{
+		G_ERROR("Failed writing to file");
+	}
+
+	return succeeded;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <core/Core.h>
+#include <memory/Utils.h>
+
+#include <fstream>
+
+namespace assets
+{
+	// Binary file writer staging output in a fixed size chunk, so memory use does not grow with the file.
+	// Mirrors gold::BinaryWriter, offsets are absolute positions in the file
+	class FileWriter
+	{
+	public:
+		static constexpr u64 kDefaultChunkSize = 4 * gold::memory::MB;
+
+		struct BlockStatistics
+		{
+			u64 uncompressedBytes = 0;
+			u32 blockCount = 0;
+			u32 storedBlocks = 0;
+		};
+
+	private:
+		std::ofstream mStream;
+		std::vector<u8> mChunk;
+
+		u64 mChunkOffset = 0;
+		u64 mFlushedBytes = 0;
+
+		// block compression, only while a block stream is open
+		bool mCompressing = false;
+		std::vector<u8> mBlock;
+		std::vector<u8> mCompressedBlock;
+		std::vector<u32> mBlockSizes;
+		u64 mBlockOffset = 0;
+		BlockStatistics mBlockStatistics;
+
+		void Flush();
+		void WriteToFile(const void* data, u64 size);
+		void CompressBlock();
+
+	public:
+		explicit FileWriter(const std::string& fileName, u64 chunkSize = kDefaultChunkSize);
+		~FileWriter();
+
+		FileWriter(const FileWriter&) = delete;
+		FileWriter& operator=(const FileWriter&) = delete;
+
+		bool IsOpen() const { return mStream.is_open(); }
+
+		// in the file, data still waiting in an open block is not counted
+		u64 GetOffset() const { return mFlushedBytes + mChunkOffset; }
+
+		template<typename T>
+		void Write(const T& data)
+		{
+			Write(&data, sizeof(T));
+		}
+
+		void Write(const void* data, u64 size);
+
+		// everything written until EndBlocks is split into blockSize blocks, compressed one by one and followed by the
+		// block size table. Blocks that do not shrink are stored, see gold::compression for the layout
+		void BeginBlocks(u32 blockSize);
+		BlockStatistics EndBlocks();
+
+		// overwrites bytes written earlier, for offsets that are only known once later data is out
+		template<typename T>
+		void Patch(u64 offset, const T& data)
+		{
+			Patch(offset, &data, sizeof(T));
+		}
+
+		void Patch(u64 offset, const void* data, u64 size);
+
+		// appends another file chunk by chunk, returns the bytes copied or 0 when it cannot be read
+		u64 WriteFileContents(const std::string& fileName);
+
+		// flushes the last chunk, returns false if any write failed
+		bool Close();
+	};
+}
@@ -0,0 +1,482 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace assets;
+
+static constexpr u32 kInvalidTriangle = ~0u;
+
+// Forsyth scoring parameters, the cache simulated while optimizing is an LRU of this size
+static constexpr u32 kOptimizeCacheSize = 32;
+static constexpr f32 kCacheDecayPower = 1.5f;
+static constexpr f32 kLastTriangleScore = 0.75f;
+static constexpr f32 kValenceBoostScale = 2.0f;
+static constexpr f32 kValenceBoostPower = 0.5f;
+
+// scores for valences above this are close enough to zero that they share the last entry
+static constexpr u32 kMaxScoredValence = 64;
+
+static constexpr u32 kCacheLineSize = 64;
+static constexpr u32 kFetchCacheLines = 64;
+
+struct ScoreTables
+{
+	std::array<f32, kOptimizeCacheSize> cache{};
+	std::array<f32, kMaxScoredValence + 1> valence{};
+};
+
+static const ScoreTables& GetScoreTables()
+{
+	static const ScoreTables tables = []()
+	{
+		ScoreTables result;
+		for (u32 i = 0; i < kOptimizeCacheSize; ++i)
+		{
+			if (i < 3)
+			{
+				// the last triangle's vertices score the same no matter their order, otherwise the same
+				// triangle would be preferred over and over
+				result.cache[i] = kLastTriangleScore;
+			}
+			else
+			{
+				const f32 scale = 1.0f / (kOptimizeCacheSize - 3);
+				result.cache[i] = std::pow(1.0f - (i - 3) * scale, kCacheDecayPower);
+			}
+		}
+
+		result.valence[0] = 0.0f;
+		for (u32 i = 1; i <= kMaxScoredValence; ++i)
+		{
+			// boost vertices with few triangles left so they get finished off instead of left as stragglers
+			result.valence[i] = kValenceBoostScale * std::pow(static_cast<f32>(i), -kValenceBoostPower);
+		}
+		return result;
+	}();
+
+	return tables;
+}
+
+static f32 VertexScore(i32 cachePosition, u32 remainingValence)
+{
+	if (remainingValence == 0)
+	{
+		return -1.0f;
+	}
+
+	const ScoreTables& tables = GetScoreTables();
+
+	f32 score = cachePosition >= 0 ? tables.cache[cachePosition] : 0.0f;
+	score += tables.valence[std::min(remainingValence, kMaxScoredValence)];
+	return score;
+}
+
+static u32 CountReferencedVertices(const std::vector<u32>& indices, u32 vertexCount)
+{
+	std::vector<u8> referenced(vertexCount, 0);
+	u32 result = 0;
+	for (u32 index : indices)
+	{
+		result += referenced[index] == 0;
+		referenced[index] = 1;
+	}
+	return result;
+}
+
+VertexCacheStatistics assets::AnalyzeVertexCache(const std::vector<u32>& indices, u32 vertexCount, u32 cacheSize)
+{
+	VertexCacheStatistics result;
+	if (indices.empty())
+	{
+		return result;
+	}
+
+	// FIFO cache, a vertex is resident while fewer than cacheSize misses happened since it was loaded
+	std::vector<u32> cacheTimestamps(vertexCount, 0);
+	u32 timestamp = cacheSize + 1;
+
+	for (u32 index : indices)
+	{
+		if (timestamp - cacheTimestamps[index] > cacheSize)
+		{
+			cacheTimestamps[index] = timestamp++;
+			++result.vertexTransforms;
+		}
+	}
+
+	const u32 triangleCount = static_cast<u32>(indices.size() / 3);
+	result.acmr = static_cast<f32>(result.vertexTransforms) / triangleCount;
+	result.atvr = static_cast<f32>(result.vertexTransforms) / CountReferencedVertices(indices, vertexCount);
+	return result;
+}
+
+VertexFetchStatistics assets::AnalyzeVertexFetch(const std::vector<u32>& indices, u32 vertexCount, u32 vertexSize)
+{
+	VertexFetchStatistics result;
+	if (indices.empty() || vertexSize == 0)
+	{
+		return result;
+	}
+
+	const u64 lineCount = (static_cast<u64>(vertexCount) * vertexSize + kCacheLineSize - 1) / kCacheLineSize;
+	std::vector<u32> lineTimestamps(lineCount, 0);
+	u32 timestamp = kFetchCacheLines + 1;
+
+	for (u32 index : indices)
+	{
+		const u64 start = static_cast<u64>(index) * vertexSize;
+		const u64 end = start + vertexSize;
+
+		for (u64 line = start / kCacheLineSize; line <= (end - 1) / kCacheLineSize; ++line)
+		{
+			if (timestamp - lineTimestamps[line] > kFetchCacheLines)
+			{
+				lineTimestamps[line] = timestamp++;
+				result.bytesFetched += kCacheLineSize;
+			}
+		}
+	}
+
+	const u64 referencedBytes = static_cast<u64>(CountReferencedVertices(indices, vertexCount)) * vertexSize;
+	result.overfetch = static_cast<f32>(static_cast<f64>(result.bytesFetched) / referencedBytes);
+	return result;
+}
+
+void assets::OptimizeVertexCache(std::vector<u32>& indices, u32 vertexCount)
+{
+	const u32 triangleCount = static_cast<u32>(indices.size() / 3);
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// vertex -> triangle adjacency, entries of emitted triangles are swapped out of each vertex's live range
+	std::vector<u32> liveTriangles(vertexCount, 0);
+	for (u32 index : indices)
+	{
+		++liveTriangles[index];
+	}
+
+	std::vector<u32> adjacencyOffsets(vertexCount, 0);
+	for (u32 v = 1; v < vertexCount; ++v)
+	{
+		adjacencyOffsets[v] = adjacencyOffsets[v - 1] + liveTriangles[v - 1];
+	}
+
+	std::vector<u32> adjacency(indices.size());
+	{
+		std::vector<u32> fill = adjacencyOffsets;
+		for (u32 t = 0; t < triangleCount; ++t)
+		{
+			adjacency[fill[indices[t * 3 + 0]]++] = t;
+			adjacency[fill[indices[t * 3 + 1]]++] = t;
+			adjacency[fill[indices[t * 3 + 2]]++] = t;
+		}
+	}
+
+	std::vector<f32> vertexScores(vertexCount);
+	for (u32 v = 0; v < vertexCount; ++v)
+	{
+		vertexScores[v] = VertexScore(-1, liveTriangles[v]);
+	}
+
+	std::vector<f32> triangleScores(triangleCount);
+	std::vector<u8> emitted(triangleCount, 0);
+
+	u32 bestTriangle = 0;
+	for (u32 t = 0; t < triangleCount; ++t)
+	{
+		triangleScores[t] = vertexScores[indices[t * 3 + 0]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+		if (triangleScores[t] > triangleScores[bestTriangle])
+		{
+			bestTriangle = t;
+		}
+	}
+
+	std::array<u32, kOptimizeCacheSize + 3> cache{};
+	std::array<u32, kOptimizeCacheSize + 3> nextCache{};
+	u32 cacheCount = 0;
+
+	std::vector<u32> result;
+	result.reserve(indices.size());
+
+	// fallback when nothing in the cache has triangles left, emitted triangles are never revisited
+	u32 inputCursor = 0;
+
+	while (bestTriangle != kInvalidTriangle)
+	{
+		const u32 a = indices[bestTriangle * 3 + 0];
+		const u32 b = indices[bestTriangle * 3 + 1];
+		const u32 c = indices[bestTriangle * 3 + 2];
+
+		result.push_back(a);
+		result.push_back(b);
+		result.push_back(c);
+		emitted[bestTriangle] = 1;
+
+		// emitted vertices move to the front, everything else shifts back
+		u32 nextCount = 0;
+		nextCache[nextCount++] = a;
+		nextCache[nextCount++] = b;
+		nextCache[nextCount++] = c;
+		for (u32 i = 0; i < cacheCount; ++i)
+		{
+			const u32 v = cache[i];
+			if (v != a && v != b && v != c)
+			{
+				nextCache[nextCount++] = v;
+			}
+		}
+
+		for (u32 v : { a, b, c })
+		{
+			u32* begin = adjacency.data() + adjacencyOffsets[v];
+			u32* end = begin + liveTriangles[v];
+			u32* found = std::find(begin, end, bestTriangle);
+			DEBUG_ASSERT(found != end, "Triangle is missing from its vertex adjacency!");
+
+			std::swap(*found, *(end - 1));
+			--liveTriangles[v];
+		}
+
+		// rescore everything that was or is in the cache, vertices past the cache size just fell out
+		for (u32 i = 0; i < nextCount; ++i)
+		{
+			const u32 v = nextCache[i];
+			const i32 cachePosition = i < kOptimizeCacheSize ? static_cast<i32>(i) : -1;
+
+			const f32 score = VertexScore(cachePosition, liveTriangles[v]);
+			const f32 delta = score - vertexScores[v];
+			vertexScores[v] = score;
+
+			const u32* begin = adjacency.data() + adjacencyOffsets[v];
+			for (const u32* t = begin; t != begin + liveTriangles[v]; ++t)
+			{
+				triangleScores[*t] += delta;
+			}
+		}
+
+		bestTriangle = kInvalidTriangle;
+		f32 bestScore = 0.0f;
+		for (u32 i = 0; i < nextCount; ++i)
+		{
+			const u32 v = nextCache[i];
+			const u32* begin = adjacency.data() + adjacencyOffsets[v];
+			for (const u32* t = begin; t != begin + liveTriangles[v]; ++t)
+			{
+				if (bestTriangle == kInvalidTriangle || triangleScores[*t] > bestScore)
+				{
+					bestTriangle = *t;
+					bestScore = triangleScores[*t];
+				}
+			}
+		}
+
+		cacheCount = std::min(nextCount, kOptimizeCacheSize);
+		std::copy(nextCache.begin(), nextCache.begin() + cacheCount, cache.begin());
+
+		if (bestTriangle == kInvalidTriangle)
+		{
+			while (inputCursor < triangleCount && emitted[inputCursor])
+			{
+				++inputCursor;
+			}
+
+			if (inputCursor < triangleCount)
+			{
+				bestTriangle = inputCursor;
+			}
+		}
+	}
+
+	DEBUG_ASSERT(result.size() == indices.size(), "Vertex cache optimization dropped triangles!");
+	indices = std::move(result);
+}
+
+// clusters follow Sander et al. "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw"
+static std::vector<u32> FindClusterStarts(const std::vector<u32>& indices, u32 vertexCount, f32 threshold)
+{
+	const u32 triangleCount = static_cast<u32>(indices.size() / 3);
+
+	std::vector<u32> cacheTimestamps(vertexCount, 0);
+	u32 timestamp = kAnalyzeCacheSize + 1;
+
+	auto countMisses = [&cacheTimestamps, &timestamp, &indices](u32 triangle)
+	{
+		u32 misses = 0;
+		for (u32 k = 0; k < 3; ++k)
+		{
+			const u32 v = indices[triangle * 3 + k];
+			if (timestamp - cacheTimestamps[v] > kAnalyzeCacheSize)
+			{
+				cacheTimestamps[v] = timestamp++;
+				++misses;
+			}
+		}
+		return misses;
+	};
+
+	auto flushCache = [&timestamp]()
+	{
+		timestamp += kAnalyzeCacheSize + 1;
+	};
+
+	std::vector<u32> hardStarts;
+	for (u32 t = 0; t < triangleCount; ++t)
+	{
+		if (countMisses(t) == 3)
+		{
+			hardStarts.push_back(t);
+		}
+	}
+
+	// first triangle always misses everything
+	DEBUG_ASSERT(!hardStarts.empty() && hardStarts[0] == 0, "");
+	hardStarts.push_back(triangleCount);
+
+	std::vector<u32> result;
+	for (u32 i = 0; i + 1 < hardStarts.size(); ++i)
+	{
+		const u32 start = hardStarts[i];
+		const u32 end = hardStarts[i + 1];
+
+		flushCache();
+		u32 clusterMisses = 0;
+		for (u32 t = start; t < end; ++t)
+		{
+			clusterMisses += countMisses(t);
+		}
+		const f32 clusterACMR = static_cast<f32>(clusterMisses) / (end - start);
+
+		result.push_back(start);
+
+		flushCache();
+		u32 subStart = start;
+		u32 subMisses = 0;
+		for (u32 t = start; t < end; ++t)
+		{
+			subMisses += countMisses(t);
+
+			if (t + 1 < end && static_cast<f32>(subMisses) / (t + 1 - subStart) <= clusterACMR * threshold)
+			{
+				subStart = t + 1;
+				subMisses = 0;
+				result.push_back(subStart);
+				flushCache();
+			}
+		}
+	}
+
+	return result;
+}
+
+void assets::OptimizeOverdraw(std::vector<u32>& indices, const std::vector<glm::vec3>& positions, f32 threshold)
+{
+	const u32 triangleCount = static_cast<u32>(indices.size() / 3);
+	const u32 vertexCount = static_cast<u32>(positions.size());
+	if (triangleCount < 2)
+	{
+		return;
+	}
+
+	std::vector<u32> clusterStarts = FindClusterStarts(indices, vertexCount, threshold);
+	const u32 clusterCount = static_cast<u32>(clusterStarts.size());
+	if (clusterCount < 2)
+	{
+		return;
+	}
+	clusterStarts.push_back(triangleCount);
+
+	struct Cluster
+	{
+		u32 start{};
+		u32 end{};
+		glm::vec3 centroid{};
+		glm::vec3 normal{};
+		f32 sortKey{};
+	};
+
+	std::vector<Cluster> clusters(clusterCount);
+	glm::vec3 meshCentroid{};
+	f32 meshArea = 0.0f;
+
+	for (u32 i = 0; i < clusterCount; ++i)
+	{
+		Cluster& cluster = clusters[i];
+		cluster.start = clusterStarts[i];
+		cluster.end = clusterStarts[i + 1];
+
+		f32 clusterArea = 0.0f;
+		for (u32 t = cluster.start; t < cluster.end; ++t)
+		{
+			const glm::vec3& p0 = positions[indices[t * 3 + 0]];
+			const glm::vec3& p1 = positions[indices[t * 3 + 1]];
+			const glm::vec3& p2 = positions[indices[t * 3 + 2]];
+
+			// cross product length is twice the area, the factor cancels out in the weighting
+			const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+			const f32 area = std::sqrt(glm::dot(normal, normal));
+
+			cluster.centroid += (p0 + p1 + p2) * (area / 3.0f);
+			cluster.normal += normal;
+			clusterArea += area;
+		}
+
+		meshCentroid += cluster.centroid;
+		meshArea += clusterArea;
+
+		cluster.centroid = clusterArea > 0.0f ? cluster.centroid / clusterArea : positions[indices[cluster.start * 3]];
+	}
+
+	meshCentroid = meshArea > 0.0f ? meshCentroid / meshArea : glm::vec3{};
+
+	for (Cluster& cluster : clusters)
+	{
+		const f32 normalLength = std::sqrt(glm::dot(cluster.normal, cluster.normal));
+		cluster.sortKey = normalLength > 0.0f ? glm::dot(cluster.centroid - meshCentroid, cluster.normal / normalLength) : 0.0f;
+	}
+
+	// clusters facing away from the center are the most likely to occlude the rest, draw them first
+	std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& lhs, const Cluster& rhs)
+	{
+		return lhs.sortKey > rhs.sortKey;
+	});
+
+	std::vector<u32> result;
+	result.reserve(indices.size());
+	for (const Cluster& cluster : clusters)
+	{
+		result.insert(result.end(), indices.begin() + cluster.start * 3, indices.begin() + cluster.end * 3);
+	}
+
+	// splitting can still cost more cache misses than we are willing to trade, keep the input order then
+	const f32 inputACMR = AnalyzeVertexCache(indices, vertexCount).acmr;
+	const f32 resultACMR = AnalyzeVertexCache(result, vertexCount).acmr;
+	if (resultACMR <= inputACMR * threshold)
+	{
+		indices = std::move(result);
+	}
+}
+
+u32 assets::OptimizeVertexFetch(std::vector<u32>& indices, u32 vertexCount, std::vector<u32>& remap)
+{
+	remap.assign(vertexCount, kUnusedVertex);
+
+	u32 nextVertex = 0;
+	for (u32& index : indices)
+	{
+		if (remap[index] == kUnusedVertex)
+		{
+			remap[index] = nextVertex++;
+		}
+		index = remap[index];
+	}
+
+	return nextVertex;
+}
+
+graphics::IndexFormat assets::SelectIndexFormat(u32 vertexCount)
+{
+	return vertexCount <= std::numeric_limits<u16>::max() + 1u ? graphics::IndexFormat::U16 : graphics::IndexFormat::U32;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <core/Core.h>
+#include <graphics/RenderTypes.h>
+
+namespace assets
+{
+	// FIFO size used when reporting statistics, roughly what current hardware post-transform caches behave like
+	static constexpr u32 kAnalyzeCacheSize = 16;
+
+	struct VertexCacheStatistics
+	{
+		u32 vertexTransforms{};
+
+		// average cache miss ratio, transformed vertices per triangle (0.5 best, 3.0 worst)
+		f32 acmr{};
+		// average transformed to vertex ratio, transformed vertices per referenced vertex (1.0 best)
+		f32 atvr{};
+	};
+
+	struct VertexFetchStatistics
+	{
+		u64 bytesFetched{};
+
+		// bytes fetched per byte of referenced vertex data (1.0 best)
+		f32 overfetch{};
+	};
+
+	VertexCacheStatistics AnalyzeVertexCache(const std::vector<u32>& indices, u32 vertexCount, u32 cacheSize = kAnalyzeCacheSize);
+	VertexFetchStatistics AnalyzeVertexFetch(const std::vector<u32>& indices, u32 vertexCount, u32 vertexSize);
+
+	// reorders triangles for post-transform cache hits (Forsyth, linear speed vertex cache optimization)
+	void OptimizeVertexCache(std::vector<u32>& indices, u32 vertexCount);
+
+	// reorders clusters of a cache optimized index buffer so outward facing clusters are drawn first.
+	// Clusters are only split where it costs at most threshold times the current ACMR
+	void OptimizeOverdraw(std::vector<u32>& indices, const std::vector<glm::vec3>& positions, f32 threshold = 1.05f);
+
+	// renumbers vertices in first use order so vertex fetch walks the buffer sequentially. remap[old] gives the new
+	// index or kUnusedVertex for vertices no triangle references. Returns the number of vertices that remain
+	static constexpr u32 kUnusedVertex = ~0u;
+	u32 OptimizeVertexFetch(std::vector<u32>& indices, u32 vertexCount, std::vector<u32>& remap);
+
+	// smallest index format able to address vertexCount vertices
+	graphics::IndexFormat SelectIndexFormat(u32 vertexCount);
+}
@@ -0,0 +1,533 @@
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_set>
+
+using namespace assets;
+
+// border planes are weighted up so open edges (windows, cut off geometry) keep their silhouette
+static constexpr f64 kBorderWeight = 10.0;
+
+// triangles whose normal turns by more than ~75 degrees reject the collapse
+static constexpr f32 kFlipThreshold = 0.25f;
+
+// a level that removes less than this fraction of the previous one is not worth keeping
+static constexpr f32 kMinLodReduction = 0.1f;
+
+struct Quadric
+{
+	f64 a00{}, a11{}, a22{};
+	f64 a01{}, a02{}, a12{};
+	f64 b0{}, b1{}, b2{};
+	f64 c{};
+	f64 weight{};
+
+	static Quadric FromPlane(const glm::vec3& normal, f32 distance, f64 weight)
+	{
+		const f64 a = normal.x;
+		const f64 b = normal.y;
+		const f64 d = normal.z;
+		const f64 e = distance;
+
+		Quadric result;
+		result.a00 = weight * a * a;
+		result.a11 = weight * b * b;
+		result.a22 = weight * d * d;
+		result.a01 = weight * a * b;
+		result.a02 = weight * a * d;
+		result.a12 = weight * b * d;
+		result.b0 = weight * a * e;
+		result.b1 = weight * b * e;
+		result.b2 = weight * d * e;
+		result.c = weight * e * e;
+		result.weight = weight;
+		return result;
+	}
+
+	Quadric& operator+=(const Quadric& other)
+	{
+		a00 += other.a00; a11 += other.a11; a22 += other.a22;
+		a01 += other.a01; a02 += other.a02; a12 += other.a12;
+		b0 += other.b0; b1 += other.b1; b2 += other.b2;
+		c += other.c;
+		weight += other.weight;
+		return *this;
+	}
+
+	// weighted mean squared distance of p to the accumulated planes
+	f64 Error(const glm::vec3& p) const
+	{
+		const f64 x = p.x;
+		const f64 y = p.y;
+		const f64 z = p.z;
+
+		const f64 result = a00 * x * x + a11 * y * y + a22 * z * z
+						 + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+						 + 2.0 * (b0 * x + b1 * y + b2 * z)
+						 + c;
+
+		return weight > 0.0 ? std::abs(result) / weight : 0.0;
+	}
+};
+
+enum class VertexKind : u8
+{
+	Manifold,	// free to collapse along any edge
+	Border,		// only collapses along open edges
+	Locked,		// uv/normal seams and non manifold vertices never move
+};
+
+static u64 EdgeKey(u32 a, u32 b)
+{
+	return (static_cast<u64>(a) << 32) | b;
+}
+
+class Simplifier
+{
+private:
+	std::vector<glm::vec3> mPositions;
+	std::vector<u32> mIndices;
+
+	// vertex -> first vertex with the same position, edges are matched through this so seams are not open
+	std::vector<u32> mCanonical;
+	std::vector<VertexKind> mKinds;
+	std::vector<Quadric> mQuadrics;
+
+	// squared, in normalized units
+	f64 mError = 0.0;
+
+	struct Collapse
+	{
+		u32 from{};
+		u32 to{};
+		f64 cost{};
+	};
+
+	void BuildCanonical()
+	{
+		struct PositionHash
+		{
+			size_t operator()(const glm::vec3& p) const
+			{
+				u32 bits[3];
+				memcpy(bits, &p, sizeof(bits));
+				return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+			}
+		};
+		struct PositionEqual
+		{
+			bool operator()(const glm::vec3& lhs, const glm::vec3& rhs) const
+			{
+				return lhs.x == rhs.x && lhs.y == rhs.y && lhs.z == rhs.z;
+			}
+		};
+
+		std::unordered_map<glm::vec3, u32, PositionHash, PositionEqual> firstVertex;
+		firstVertex.reserve(mPositions.size());
+
+		mCanonical.resize(mPositions.size());
+		for (u32 v = 0; v < mPositions.size(); ++v)
+		{
+			mCanonical[v] = firstVertex.emplace(mPositions[v], v).first->second;
+		}
+	}
+
+	void ClassifyVertices()
+	{
+		const u32 vertexCount = static_cast<u32>(mPositions.size());
+		mKinds.assign(vertexCount, VertexKind::Manifold);
+
+		std::vector<u32> siblings(vertexCount, 0);
+		for (u32 v = 0; v < vertexCount; ++v)
+		{
+			++siblings[mCanonical[v]];
+		}
+
+		std::unordered_map<u64, u32> edgeCounts;
+		ForEachEdge([this, &edgeCounts](u32 a, u32 b)
+		{
+			++edgeCounts[EdgeKey(mCanonical[a], mCanonical[b])];
+		});
+
+		ForEachEdge([this, &edgeCounts](u32 a, u32 b)
+		{
+			const u32 count = edgeCounts[EdgeKey(mCanonical[a], mCanonical[b])];
+			const auto reverse = edgeCounts.find(EdgeKey(mCanonical[b], mCanonical[a]));
+			const u32 reverseCount = reverse != edgeCounts.end() ? reverse->second : 0;
+
+			if (count > 1 || reverseCount > 1)
+			{
+				mKinds[a] = VertexKind::Locked;
+				mKinds[b] = VertexKind::Locked;
+			}
+			else if (reverseCount == 0)
+			{
+				for (u32 v : { a, b })
+				{
+					if (mKinds[v] == VertexKind::Manifold)
+					{
+						mKinds[v] = VertexKind::Border;
+					}
+				}
+			}
+		});
+
+		for (u32 v = 0; v < vertexCount; ++v)
+		{
+			if (siblings[mCanonical[v]] > 1)
+			{
+				mKinds[v] = VertexKind::Locked;
+			}
+		}
+	}
+
+	void BuildQuadrics()
+	{
+		mQuadrics.assign(mPositions.size(), Quadric{});
+
+		for (u32 t = 0; t < mIndices.size() / 3; ++t)
+		{
+			const u32 i0 = mIndices[t * 3 + 0];
+			const u32 i1 = mIndices[t * 3 + 1];
+			const u32 i2 = mIndices[t * 3 + 2];
+
+			const glm::vec3 cross = glm::cross(mPositions[i1] - mPositions[i0], mPositions[i2] - mPositions[i0]);
+			const f32 length = std::sqrt(glm::dot(cross, cross));
+			if (length <= 0.0f)
+			{
+				continue;
+			}
+
+			const glm::vec3 normal = cross / length;
+			const Quadric plane = Quadric::FromPlane(normal, -glm::dot(normal, mPositions[i0]), length * 0.5);
+			mQuadrics[i0] += plane;
+			mQuadrics[i1] += plane;
+			mQuadrics[i2] += plane;
+		}
+
+		// a plane through each open edge, perpendicular to its triangle
+		std::unordered_set<u64> edges;
+		ForEachEdge([this, &edges](u32 a, u32 b)
+		{
+			edges.insert(EdgeKey(mCanonical[a], mCanonical[b]));
+		});
+
+		for (u32 t = 0; t < mIndices.size() / 3; ++t)
+		{
+			const u32 tri[3] = { mIndices[t * 3 + 0], mIndices[t * 3 + 1], mIndices[t * 3 + 2] };
+			const glm::vec3 cross = glm::cross(mPositions[tri[1]] - mPositions[tri[0]], mPositions[tri[2]] - mPositions[tri[0]]);
+
+			for (u32 k = 0; k < 3; ++k)
+			{
+				const u32 a = tri[k];
+				const u32 b = tri[(k + 1) % 3];
+				if (edges.count(EdgeKey(mCanonical[b], mCanonical[a])))
+				{
+					continue;
+				}
+
+				const glm::vec3 edge = mPositions[b] - mPositions[a];
+				const glm::vec3 edgeNormal = glm::cross(edge, cross);
+				const f32 length = std::sqrt(glm::dot(edgeNormal, edgeNormal));
+				if (length <= 0.0f)
+				{
+					continue;
+				}
+
+				const glm::vec3 normal = edgeNormal / length;
+				const Quadric plane = Quadric::FromPlane(normal, -glm::dot(normal, mPositions[a]), glm::dot(edge, edge) * kBorderWeight);
+				mQuadrics[a] += plane;
+				mQuadrics[b] += plane;
+			}
+		}
+	}
+
+	template<typename Function>
+	void ForEachEdge(Function&& function) const
+	{
+		for (u32 t = 0; t < mIndices.size() / 3; ++t)
+		{
+			function(mIndices[t * 3 + 0], mIndices[t * 3 + 1]);
+			function(mIndices[t * 3 + 1], mIndices[t * 3 + 2]);
+			function(mIndices[t * 3 + 2], mIndices[t * 3 + 0]);
+		}
+	}
+
+	bool CanCollapse(u32 from, u32 to, const std::unordered_set<u64>& edges) const
+	{
+		switch (mKinds[from])
+		{
+		case VertexKind::Manifold:
+			return true;
+		case VertexKind::Border:
+			// stay on the border: the edge has to be open itself and the target a border vertex as well
+			return mKinds[to] != VertexKind::Manifold &&
+				(!edges.count(EdgeKey(mCanonical[to], mCanonical[from])) || !edges.count(EdgeKey(mCanonical[from], mCanonical[to])));
+		case VertexKind::Locked:
+			return false;
+		}
+
+		return false;
+	}
+
+	bool FlipsTriangle(u32 from, u32 to, const std::vector<u32>& adjacencyOffsets, const std::vector<u32>& adjacency) const
+	{
+		const glm::vec3& target = mPositions[to];
+
+		for (u32 i = adjacencyOffsets[from]; i < adjacencyOffsets[from + 1]; ++i)
+		{
+			const u32 t = adjacency[i];
+			const u32 tri[3] = { mIndices[t * 3 + 0], mIndices[t * 3 + 1], mIndices[t * 3 + 2] };
+
+			// triangles on the collapsed edge disappear
+			if (tri[0] == to || tri[1] == to || tri[2] == to)
+			{
+				continue;
+			}
+
+			glm::vec3 p[3] = { mPositions[tri[0]], mPositions[tri[1]], mPositions[tri[2]] };
+			const glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+
+			for (u32 k = 0; k < 3; ++k)
+			{
+				if (tri[k] == from)
+				{
+					p[k] = target;
+				}
+			}
+			const glm::vec3 after = glm::cross(p[1] - p[0], p[2] - p[0]);
+
+			const f32 lengths = std::sqrt(glm::dot(before, before) * glm::dot(after, after));
+			if (glm::dot(before, after) <= kFlipThreshold * lengths)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	// one round of independent collapses, cheapest first. Returns false once nothing below maxError can collapse
+	bool CollapsePass(u32 targetTriangleCount, f64 maxError)
+	{
+		const u32 vertexCount = static_cast<u32>(mPositions.size());
+		const u32 triangleCount = static_cast<u32>(mIndices.size() / 3);
+
+		std::unordered_set<u64> edges;
+		edges.reserve(mIndices.size());
+		ForEachEdge([this, &edges](u32 a, u32 b)
+		{
+			edges.insert(EdgeKey(mCanonical[a], mCanonical[b]));
+		});
+
+		std::vector<Collapse> candidates;
+		candidates.reserve(mIndices.size());
+		ForEachEdge([this, &edges, &candidates](u32 a, u32 b)
+		{
+			// interior edges show up once per direction, only evaluate them once
+			if (a > b && edges.count(EdgeKey(mCanonical[b], mCanonical[a])))
+			{
+				return;
+			}
+
+			Quadric combined = mQuadrics[a];
+			combined += mQuadrics[b];
+
+			Collapse best{ a, b, std::numeric_limits<f64>::max() };
+			if (CanCollapse(a, b, edges))
+			{
+				best.cost = combined.Error(mPositions[b]);
+			}
+			if (CanCollapse(b, a, edges))
+			{
+				const f64 cost = combined.Error(mPositions[a]);
+				if (cost < best.cost)
+				{
+					best = { b, a, cost };
+				}
+			}
+
+			if (best.cost != std::numeric_limits<f64>::max())
+			{
+				candidates.push_back(best);
+			}
+		});
+
+		std::sort(candidates.begin(), candidates.end(), [](const Collapse& lhs, const Collapse& rhs)
+		{
+			return lhs.cost < rhs.cost;
+		});
+
+		std::vector<u32> adjacencyOffsets(vertexCount + 1, 0);
+		for (u32 index : mIndices)
+		{
+			++adjacencyOffsets[index + 1];
+		}
+		for (u32 v = 0; v < vertexCount; ++v)
+		{
+			adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+		}
+
+		std::vector<u32> adjacency(mIndices.size());
+		{
+			std::vector<u32> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (u32 i = 0; i < mIndices.size(); ++i)
+			{
+				adjacency[fill[mIndices[i]]++] = i / 3;
+			}
+		}
+
+		std::vector<u32> remap(vertexCount);
+		for (u32 v = 0; v < vertexCount; ++v)
+		{
+			remap[v] = v;
+		}
+
+		// every vertex around a collapse stays put for the rest of the pass, so the flip tests stay valid
+		std::vector<u8> touched(vertexCount, 0);
+
+		// each interior collapse removes two triangles, border collapses one
+		const u32 trianglesToRemove = triangleCount - targetTriangleCount;
+		u32 trianglesRemoved = 0;
+		u32 collapses = 0;
+
+		for (const Collapse& collapse : candidates)
+		{
+			if (collapse.cost > maxError)
+			{
+				break;
+			}
+
+			if (touched[collapse.from] || touched[collapse.to])
+			{
+				continue;
+			}
+
+			if (FlipsTriangle(collapse.from, collapse.to, adjacencyOffsets, adjacency))
+			{
+				continue;
+			}
+
+			remap[collapse.from] = collapse.to;
+			mQuadrics[collapse.to] += mQuadrics[collapse.from];
+			mError = std::max(mError, collapse.cost);
+
+			for (u32 i = adjacencyOffsets[collapse.from]; i < adjacencyOffsets[collapse.from + 1]; ++i)
+			{
+				const u32 t = adjacency[i];
+				touched[mIndices[t * 3 + 0]] = 1;
+				touched[mIndices[t * 3 + 1]] = 1;
+				touched[mIndices[t * 3 + 2]] = 1;
+			}
+
+			++collapses;
+			trianglesRemoved += mKinds[collapse.from] == VertexKind::Border ? 1 : 2;
+			if (trianglesRemoved >= trianglesToRemove)
+			{
+				break;
+			}
+		}
+
+		if (collapses == 0)
+		{
+			return false;
+		}
+
+		u32 writeIndex = 0;
+		for (u32 t = 0; t < triangleCount; ++t)
+		{
+			const u32 a = remap[mIndices[t * 3 + 0]];
+			const u32 b = remap[mIndices[t * 3 + 1]];
+			const u32 c = remap[mIndices[t * 3 + 2]];
+
+			if (a != b && b != c && c != a)
+			{
+				mIndices[writeIndex++] = a;
+				mIndices[writeIndex++] = b;
+				mIndices[writeIndex++] = c;
+			}
+		}
+		mIndices.resize(writeIndex);
+
+		return true;
+	}
+
+public:
+	Simplifier(const std::vector<u32>& indices, const std::vector<glm::vec3>& positions)
+		: mIndices(indices)
+	{
+		// work in units of the bounds diagonal so errors are comparable between meshes
+		glm::vec3 aabbMin(std::numeric_limits<f32>::max());
+		glm::vec3 aabbMax(std::numeric_limits<f32>::lowest());
+		for (const glm::vec3& p : positions)
+		{
+			aabbMin = glm::min(aabbMin, p);
+			aabbMax = glm::max(aabbMax, p);
+		}
+
+		const glm::vec3 extent = aabbMax - aabbMin;
+		const f32 diagonal = std::sqrt(glm::dot(extent, extent));
+		const f32 scale = diagonal > 0.0f ? 1.0f / diagonal : 1.0f;
+
+		mPositions.reserve(positions.size());
+		for (const glm::vec3& p : positions)
+		{
+			mPositions.push_back((p - aabbMin) * scale);
+		}
+
+		BuildCanonical();
+		ClassifyVertices();
+		BuildQuadrics();
+	}
+
+	void Simplify(u32 targetTriangleCount, f32 maxError)
+	{
+		const f64 maxErrorSquared = static_cast<f64>(maxError) * maxError;
+		while (mIndices.size() / 3 > targetTriangleCount)
+		{
+			if (!CollapsePass(targetTriangleCount, maxErrorSquared))
+			{
+				break;
+			}
+		}
+	}
+
+	const std::vector<u32>& GetIndices() const { return mIndices; }
+	f32 GetError() const { return static_cast<f32>(std::sqrt(mError)); }
+};
+
+std::vector<SimplifiedLod> assets::GenerateLods(const std::vector<u32>& indices, const std::vector<glm::vec3>& positions, u32 maxLods, f32 maxError)
+{
+	std::vector<SimplifiedLod> result;
+	if (indices.empty())
+	{
+		return result;
+	}
+
+	// one simplifier for the whole chain, quadrics keep accumulating so errors are measured against the source
+	Simplifier simplifier(indices, positions);
+
+	u32 previousCount = static_cast<u32>(indices.size() / 3);
+	for (u32 lod = 0; lod < maxLods; ++lod)
+	{
+		simplifier.Simplify(previousCount / 2, maxError);
+
+		const u32 triangleCount = static_cast<u32>(simplifier.GetIndices().size() / 3);
+		if (triangleCount == 0 || triangleCount > previousCount * (1.0f - kMinLodReduction))
+		{
+			break;
+		}
+
+		SimplifiedLod level;
+		level.indices = simplifier.GetIndices();
+		level.error = simplifier.GetError();
+		OptimizeVertexCache(level.indices, static_cast<u32>(positions.size()));
+
+		result.push_back(std::move(level));
+		previousCount = triangleCount;
+	}
+
+	return result;
+}
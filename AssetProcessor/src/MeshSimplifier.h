@@ -0,0 +1,18 @@
+#pragma once
+
+#include <core/Core.h>
+
+namespace assets
+{
+	struct SimplifiedLod
+	{
+		std::vector<u32> indices;
+
+		// largest deviation from the source surface, relative to the mesh bounds diagonal
+		f32 error{};
+	};
+
+	// quadric error metric simplification (Garland & Heckbert), up to maxLods levels of half the triangles each.
+	// Every level indexes the source vertex buffer
+	std::vector<SimplifiedLod> GenerateLods(const std::vector<u32>& indices, const std::vector<glm::vec3>& positions, u32 maxLods, f32 maxError);
+}
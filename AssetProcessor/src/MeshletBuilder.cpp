@@ -0,0 +1,171 @@
+#include "MeshletBuilder.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace assets;
+
+// cones wider than this (every normal within ~84 degrees of the axis) are hardly ever entirely back facing,
+// they are stored as never culled so the runtime test can skip them outright
+static constexpr f32 kMinConeDot = 0.1f;
+
+static void ComputeBounds(graphics::Meshlet& meshlet, const std::vector<u32>& indices, const std::vector<glm::vec3>& positions)
+{
+	constexpr f32 fMax = std::numeric_limits<f32>::max();
+	constexpr f32 fLowest = std::numeric_limits<f32>::lowest();
+
+	glm::vec3 min{ fMax, fMax, fMax };
+	glm::vec3 max{ fLowest, fLowest, fLowest };
+
+	const u32 end = meshlet.indexOffset + meshlet.indexCount;
+	for (u32 i = meshlet.indexOffset; i < end; ++i)
+	{
+		min = glm::min(min, positions[indices[i]]);
+		max = glm::max(max, positions[indices[i]]);
+	}
+
+	// the aabb center is within a few percent of the smallest enclosing sphere for the shapes clusters take
+	meshlet.center = (min + max) * 0.5f;
+	meshlet.radius = 0.0f;
+	for (u32 i = meshlet.indexOffset; i < end; ++i)
+	{
+		meshlet.radius = std::max(meshlet.radius, glm::distance(meshlet.center, positions[indices[i]]));
+	}
+
+	// unit face normals, degenerate triangles face nowhere and are left out
+	std::vector<glm::vec3> normals;
+	normals.reserve(meshlet.indexCount / 3);
+
+	glm::vec3 axis{ 0.0f };
+	for (u32 i = meshlet.indexOffset; i < end; i += 3)
+	{
+		const glm::vec3& a = positions[indices[i + 0]];
+		const glm::vec3& b = positions[indices[i + 1]];
+		const glm::vec3& c = positions[indices[i + 2]];
+
+		const glm::vec3 normal = glm::cross(b - a, c - a);
+		const f32 length = glm::length(normal);
+		if (length <= std::numeric_limits<f32>::min())
+		{
+			continue;
+		}
+
+		normals.push_back(normal / length);
+		axis += normals.back();
+	}
+
+	meshlet.coneAxis = { 0, 0, 1 };
+	meshlet.coneCutoff = 1.0f;
+
+	const f32 axisLength = glm::length(axis);
+	if (normals.empty() || axisLength <= std::numeric_limits<f32>::epsilon())
+	{
+		return;
+	}
+	axis /= axisLength;
+
+	f32 minDot = 1.0f;
+	for (const glm::vec3& normal : normals)
+	{
+		minDot = std::min(minDot, glm::dot(normal, axis));
+	}
+
+	if (minDot <= kMinConeDot)
+	{
+		return;
+	}
+
+	// sine of the half angle, see graphics::Meshlet for the test it feeds
+	meshlet.coneAxis = axis;
+	meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+}
+
+std::vector<graphics::Meshlet> assets::BuildMeshlets(const std::vector<u32>& indices, const std::vector<glm::vec3>& positions, u32 maxVertices, u32 maxTriangles)
+{
+	DEBUG_ASSERT(indices.size() % 3 == 0, "Meshlets need a triangle list!");
+	DEBUG_ASSERT(maxVertices >= 3 && maxTriangles >= 1, "Meshlet limits too small!");
+
+	std::vector<graphics::Meshlet> result;
+
+	// which meshlet last referenced each vertex, one based so zero means none yet
+	std::vector<u32> lastMeshlet(positions.size(), 0);
+
+	graphics::Meshlet current;
+	u32 currentVertices = 0;
+
+	auto finish = [&]()
+	{
+		ComputeBounds(current, indices, positions);
+		result.push_back(current);
+
+		current = graphics::Meshlet{};
+		current.indexOffset = result.back().indexOffset + result.back().indexCount;
+		currentVertices = 0;
+	};
+
+	for (u32 i = 0; i < indices.size(); i += 3)
+	{
+		const u32 stamp = static_cast<u32>(result.size()) + 1;
+
+		u32 added = 0;
+		for (u32 k = 0; k < 3; ++k)
+		{
+			// repeated vertices within the triangle only count once
+			const u32 vertex = indices[i + k];
+			const bool repeated = (k > 0 && indices[i] == vertex) || (k > 1 && indices[i + 1] == vertex);
+			added += lastMeshlet[vertex] != stamp && !repeated ? 1 : 0;
+		}
+
+		if (currentVertices + added > maxVertices || current.indexCount / 3 + 1 > maxTriangles)
+		{
+			finish();
+		}
+
+		const u32 newStamp = static_cast<u32>(result.size()) + 1;
+		for (u32 k = 0; k < 3; ++k)
+		{
+			const u32 vertex = indices[i + k];
+			if (lastMeshlet[vertex] != newStamp)
+			{
+				lastMeshlet[vertex] = newStamp;
+				++currentVertices;
+			}
+		}
+
+		current.indexCount += 3;
+	}
+
+	if (current.indexCount > 0)
+	{
+		finish();
+	}
+
+	return result;
+}
+
+MeshletStatistics assets::AnalyzeMeshlets(const std::vector<graphics::Meshlet>& meshlets, const std::vector<u32>& indices)
+{
+	MeshletStatistics result;
+	result.meshletCount = static_cast<u32>(meshlets.size());
+	if (meshlets.empty())
+	{
+		return result;
+	}
+
+	u64 vertices = 0;
+	u64 triangles = 0;
+	std::vector<u32> unique;
+	for (const graphics::Meshlet& meshlet : meshlets)
+	{
+		unique.assign(indices.begin() + meshlet.indexOffset, indices.begin() + meshlet.indexOffset + meshlet.indexCount);
+		std::sort(unique.begin(), unique.end());
+
+		vertices += std::unique(unique.begin(), unique.end()) - unique.begin();
+		triangles += meshlet.indexCount / 3;
+		result.coneCount += meshlet.coneCutoff < 1.0f ? 1 : 0;
+	}
+
+	result.averageVertices = static_cast<f32>(vertices) / meshlets.size();
+	result.averageTriangles = static_cast<f32>(triangles) / meshlets.size();
+	return result;
+}
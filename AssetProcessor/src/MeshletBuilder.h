@@ -0,0 +1,25 @@
+#pragma once
+
+#include <core/Core.h>
+#include <graphics/Meshlet.h>
+
+namespace assets
+{
+	struct MeshletStatistics
+	{
+		u32 meshletCount{};
+
+		f32 averageVertices{};
+		f32 averageTriangles{};
+
+		// clusters the cone test is able to reject at all, coneCutoff below 1
+		u32 coneCount{};
+	};
+
+	// splits an optimized index buffer into contiguous clusters of at most maxVertices vertices and maxTriangles
+	// triangles, keeping the draw order
+	std::vector<graphics::Meshlet> BuildMeshlets(const std::vector<u32>& indices, const std::vector<glm::vec3>& positions,
+		u32 maxVertices = graphics::kMeshletMaxVertices, u32 maxTriangles = graphics::kMeshletMaxTriangles);
+
+	MeshletStatistics AnalyzeMeshlets(const std::vector<graphics::Meshlet>& meshlets, const std::vector<u32>& indices);
+}
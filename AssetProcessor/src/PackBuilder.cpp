@@ -0,0 +1,129 @@
+#include "PackBuilder.h"
+#include "FileWriter.h"
+
+#include <core/Logging.h>
+#include <memory/PackFile.h>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+
+using namespace assets;
+namespace fs = std::filesystem;
+
+// read by the AssetProcessor only, or editor state
+static constexpr const char* kSkippedExtensions[] = { ".gltf", ".glb", ".bin", ".obj", ".mtl", ".fbx", ".ini", ".gpak" };
+
+struct PackedFile
+{
+	fs::path source;
+	std::string path;
+	u64 hash{};
+	u64 size{};
+};
+
+static bool IsSkipped(const fs::path& file)
+{
+	std::string extension = file.extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+	return std::find_if(std::begin(kSkippedExtensions), std::end(kSkippedExtensions), [&extension](const char* other) { return extension == other; }) != std::end(kSkippedExtensions);
+}
+
+static void WritePadding(FileWriter& writer, u64 alignment)
+{
+	static constexpr u8 kZeros[256] = {};
+
+	u64 padding = (alignment - writer.GetOffset() % alignment) % alignment;
+	while (padding > 0)
+	{
+		const u64 count = std::min<u64>(padding, sizeof(kZeros));
+		writer.Write(kZeros, count);
+		padding -= count;
+	}
+}
+
+bool assets::BuildPack(const std::string& directory, const std::string& output)
+{
+	using Clock = std::chrono::steady_clock;
+	const Clock::time_point start = Clock::now();
+
+	std::vector<PackedFile> files;
+	for (const fs::directory_entry& entry : fs::recursive_directory_iterator(directory))
+	{
+		if (!entry.is_regular_file() || IsSkipped(entry.path()))
+		{
+			continue;
+		}
+
+		PackedFile file;
+		file.source = entry.path();
+		file.path = gold::pack::NormalizePath(fs::relative(entry.path(), directory).generic_string());
+		file.hash = gold::pack::HashPath(file.path);
+		file.size = static_cast<u64>(entry.file_size());
+		files.push_back(std::move(file));
+	}
+
+	// the table of contents is searched by hash, equal hashes are told apart by their path
+	std::sort(files.begin(), files.end(), [](const PackedFile& a, const PackedFile& b) { return a.hash != b.hash ? a.hash < b.hash : a.path < b.path; });
+
+	FileWriter writer(output);
+	if (!writer.IsOpen())
+	{
+		G_ERROR("Cannot open output file: {}", output);
+		return false;
+	}
+
+	writer.Write(gold::pack::Header{});
+
+	std::vector<gold::pack::TocEntry> entries;
+	entries.reserve(files.size());
+	std::string paths;
+
+	u64 dataBytes = 0;
+	for (const PackedFile& file : files)
+	{
+		WritePadding(writer, gold::pack::kAlignment);
+
+		gold::pack::TocEntry entry;
+		entry.pathHash = file.hash;
+		entry.offset = writer.GetOffset();
+		entry.size = file.size > 0 ? writer.WriteFileContents(file.source.string()) : 0;
+		entry.pathOffset = static_cast<u32>(paths.size());
+		entry.pathLength = static_cast<u32>(file.path.size());
+
+		if (entry.size != file.size)
+		{
+			G_ERROR("Cannot read {}", file.source.string());
+			return false;
+		}
+
+		paths += file.path;
+		dataBytes += entry.size;
+		entries.push_back(entry);
+	}
+
+	WritePadding(writer, gold::pack::kAlignment);
+
+	gold::pack::Header header;
+	header.entryCount = static_cast<u32>(entries.size());
+	header.tocOffset = writer.GetOffset();
+	writer.Write(entries.data(), entries.size() * sizeof(gold::pack::TocEntry));
+
+	header.pathsOffset = writer.GetOffset();
+	writer.Write(paths.data(), paths.size());
+	writer.Patch(0, header);
+
+	const u64 packSize = writer.GetOffset();
+	if (!writer.Close())
+	{
+		G_ERROR("Failed to write {}", output);
+		return false;
+	}
+
+	G_INFO("Packed {} files into {} in {:.2f}ms: {} MB of data, {} MB with alignment and table of contents", entries.size(), output,
+		std::chrono::duration<f64, std::milli>(Clock::now() - start).count(), dataBytes / gold::memory::MB, packSize / gold::memory::MB);
+
+	return true;
+}
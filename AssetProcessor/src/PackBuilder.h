@@ -0,0 +1,10 @@
+#pragma once
+
+#include <core/Core.h>
+
+namespace assets
+{
+	// packs every runtime file under directory into one archive (see memory/PackFile.h), model sources are skipped
+	// since their processed .gmdl is what the runtime loads. Returns false when the archive could not be written
+	bool BuildPack(const std::string& directory, const std::string& output);
+}
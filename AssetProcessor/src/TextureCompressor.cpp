@@ -0,0 +1,546 @@
+#include "TextureCompressor.h"
+
+#include <core/ThreadPool.h>
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define ASSETS_USE_SSE 1
+#include <emmintrin.h>
+#endif
+
+using namespace assets;
+using namespace graphics;
+
+// range fit along the principal axis for every format, BC7 only uses mode 6
+
+using Block = u8[16][4];
+using FloatBlock = float[16][4];
+
+static constexpr u32 kBlockRowsPerTask = 8;
+
+// 4x4 texels as rgba, edges clamp for textures that are not a multiple of 4
+static void LoadBlock(const MipLevel& level, u16 channels, u32 blockX, u32 blockY, Block& block)
+{
+	for (u32 y = 0; y < 4; ++y)
+	{
+		const u32 sy = std::min(blockY * 4 + y, static_cast<u32>(level.height) - 1);
+		for (u32 x = 0; x < 4; ++x)
+		{
+			const u32 sx = std::min(blockX * 4 + x, static_cast<u32>(level.width) - 1);
+			const u8* src = level.data.data() + (static_cast<u64>(sy) * level.width + sx) * channels;
+			u8* dst = block[y * 4 + x];
+
+			switch (channels)
+			{
+			case 1: dst[0] = src[0]; dst[1] = src[0]; dst[2] = src[0]; dst[3] = 255;	break;
+			case 2: dst[0] = src[0]; dst[1] = src[0]; dst[2] = src[0]; dst[3] = src[1]; break;
+			case 3: dst[0] = src[0]; dst[1] = src[1]; dst[2] = src[2]; dst[3] = 255;	break;
+			default: memcpy(dst, src, 4);												break;
+			}
+		}
+	}
+}
+
+static u32 SquaredError(const float a[4], const float b[4])
+{
+#if defined(ASSETS_USE_SSE)
+	__m128 d = _mm_sub_ps(_mm_loadu_ps(a), _mm_loadu_ps(b));
+	d = _mm_mul_ps(d, d);
+	__m128 sum = _mm_add_ps(d, _mm_movehl_ps(d, d));
+	sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+	return static_cast<u32>(_mm_cvtss_f32(sum));
+#else
+	float sum = 0.0f;
+	for (u32 c = 0; c < 4; ++c)
+	{
+		sum += (a[c] - b[c]) * (a[c] - b[c]);
+	}
+	return static_cast<u32>(sum);
+#endif
+}
+
+static u32 BestIndex(const float pixel[4], const float palette[][4], u32 paletteSize)
+{
+	u32 best = 0;
+	u32 bestError = std::numeric_limits<u32>::max();
+	for (u32 i = 0; i < paletteSize; ++i)
+	{
+		const u32 error = SquaredError(pixel, palette[i]);
+		if (error < bestError)
+		{
+			bestError = error;
+			best = i;
+		}
+	}
+
+	return best;
+}
+
+static void MinMax(const u8 values[16], u8& outMin, u8& outMax)
+{
+#if defined(ASSETS_USE_SSE)
+	__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values));
+	__m128i lo = _mm_min_epu8(v, _mm_srli_si128(v, 8));
+	__m128i hi = _mm_max_epu8(v, _mm_srli_si128(v, 8));
+	lo = _mm_min_epu8(lo, _mm_srli_si128(lo, 4));
+	hi = _mm_max_epu8(hi, _mm_srli_si128(hi, 4));
+	lo = _mm_min_epu8(lo, _mm_srli_si128(lo, 2));
+	hi = _mm_max_epu8(hi, _mm_srli_si128(hi, 2));
+	lo = _mm_min_epu8(lo, _mm_srli_si128(lo, 1));
+	hi = _mm_max_epu8(hi, _mm_srli_si128(hi, 1));
+	outMin = static_cast<u8>(_mm_cvtsi128_si32(lo) & 0xFF);
+	outMax = static_cast<u8>(_mm_cvtsi128_si32(hi) & 0xFF);
+#else
+	outMin = *std::min_element(values, values + 16);
+	outMax = *std::max_element(values, values + 16);
+#endif
+}
+
+// endpoints are the extreme projections of the block onto its principal axis
+static void FitLine(const FloatBlock& pixels, u32 channels, float e0[4], float e1[4])
+{
+	float mean[4]{};
+	for (u32 i = 0; i < 16; ++i)
+	{
+		for (u32 c = 0; c < channels; ++c)
+		{
+			mean[c] += pixels[i][c] / 16.0f;
+		}
+	}
+
+	float covariance[4][4]{};
+	for (u32 i = 0; i < 16; ++i)
+	{
+		for (u32 a = 0; a < channels; ++a)
+		{
+			for (u32 b = 0; b < channels; ++b)
+			{
+				covariance[a][b] += (pixels[i][a] - mean[a]) * (pixels[i][b] - mean[b]);
+			}
+		}
+	}
+
+	// power iteration, a handful of steps is plenty for a 4x4 block
+	float axis[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	for (u32 iteration = 0; iteration < 8; ++iteration)
+	{
+		float next[4]{};
+		float largest = 0.0f;
+		for (u32 a = 0; a < channels; ++a)
+		{
+			for (u32 b = 0; b < channels; ++b)
+			{
+				next[a] += covariance[a][b] * axis[b];
+			}
+			largest = std::max(largest, std::abs(next[a]));
+		}
+
+		if (largest <= 0.0f)
+		{
+			break;
+		}
+
+		for (u32 c = 0; c < channels; ++c)
+		{
+			axis[c] = next[c] / largest;
+		}
+	}
+
+	float length = 0.0f;
+	for (u32 c = 0; c < channels; ++c)
+	{
+		length += axis[c] * axis[c];
+	}
+	length = std::sqrt(length);
+
+	float tMin = 0.0f;
+	float tMax = 0.0f;
+	if (length > 0.0f)
+	{
+		for (u32 c = 0; c < channels; ++c)
+		{
+			axis[c] /= length;
+		}
+
+		tMin = std::numeric_limits<float>::max();
+		tMax = std::numeric_limits<float>::lowest();
+		for (u32 i = 0; i < 16; ++i)
+		{
+			float t = 0.0f;
+			for (u32 c = 0; c < channels; ++c)
+			{
+				t += (pixels[i][c] - mean[c]) * axis[c];
+			}
+			tMin = std::min(tMin, t);
+			tMax = std::max(tMax, t);
+		}
+	}
+
+	for (u32 c = 0; c < 4; ++c)
+	{
+		e0[c] = c < channels ? std::clamp(mean[c] + axis[c] * tMin, 0.0f, 255.0f) : 0.0f;
+		e1[c] = c < channels ? std::clamp(mean[c] + axis[c] * tMax, 0.0f, 255.0f) : 0.0f;
+	}
+}
+
+static u16 To565(const float color[4])
+{
+	const u32 r = static_cast<u32>(std::lround(color[0] * 31.0f / 255.0f));
+	const u32 g = static_cast<u32>(std::lround(color[1] * 63.0f / 255.0f));
+	const u32 b = static_cast<u32>(std::lround(color[2] * 31.0f / 255.0f));
+	return static_cast<u16>((r << 11) | (g << 5) | b);
+}
+
+static void From565(u16 value, float color[4])
+{
+	const u32 r = (value >> 11) & 31;
+	const u32 g = (value >> 5) & 63;
+	const u32 b = value & 31;
+	color[0] = static_cast<float>((r << 3) | (r >> 2));
+	color[1] = static_cast<float>((g << 2) | (g >> 4));
+	color[2] = static_cast<float>((b << 3) | (b >> 2));
+	color[3] = 0.0f;
+}
+
+static void EncodeBC1(const Block& block, u8* out)
+{
+	FloatBlock pixels;
+	for (u32 i = 0; i < 16; ++i)
+	{
+		pixels[i][0] = block[i][0];
+		pixels[i][1] = block[i][1];
+		pixels[i][2] = block[i][2];
+		pixels[i][3] = 0.0f;
+	}
+
+	float e0[4];
+	float e1[4];
+	FitLine(pixels, 3, e0, e1);
+
+	u16 c0 = To565(e1);
+	u16 c1 = To565(e0);
+	// c0 > c1 selects the opaque 4 color mode
+	if (c0 < c1)
+	{
+		std::swap(c0, c1);
+	}
+
+	u32 indices = 0;
+	if (c0 != c1)
+	{
+		float palette[4][4];
+		From565(c0, palette[0]);
+		From565(c1, palette[1]);
+		for (u32 c = 0; c < 3; ++c)
+		{
+			palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+			palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+		}
+		palette[2][3] = 0.0f;
+		palette[3][3] = 0.0f;
+
+		for (u32 i = 0; i < 16; ++i)
+		{
+			indices |= BestIndex(pixels[i], palette, 4) << (i * 2);
+		}
+	}
+
+	memcpy(out + 0, &c0, sizeof(u16));
+	memcpy(out + 2, &c1, sizeof(u16));
+	memcpy(out + 4, &indices, sizeof(u32));
+}
+
+static void EncodeBC4(const u8 values[16], u8* out)
+{
+	u8 minValue;
+	u8 maxValue;
+	MinMax(values, minValue, maxValue);
+
+	// a0 > a1 selects the 8 value ramp: a0, a1, then 6 interpolated steps from a0 towards a1
+	out[0] = maxValue;
+	out[1] = minValue;
+
+	u64 indices = 0;
+	if (maxValue != minValue)
+	{
+		const float range = static_cast<float>(maxValue - minValue);
+		for (u32 i = 0; i < 16; ++i)
+		{
+			const u32 step = static_cast<u32>(std::lround((values[i] - minValue) * 7.0f / range));
+
+			u64 index;
+			if (step == 7)		index = 0;
+			else if (step == 0) index = 1;
+			else				index = 8 - step;
+
+			indices |= index << (i * 3);
+		}
+	}
+
+	for (u32 i = 0; i < 6; ++i)
+	{
+		out[2 + i] = static_cast<u8>(indices >> (i * 8));
+	}
+}
+
+static void EncodeBC3(const Block& block, u8* out)
+{
+	u8 alpha[16];
+	for (u32 i = 0; i < 16; ++i)
+	{
+		alpha[i] = block[i][3];
+	}
+
+	EncodeBC4(alpha, out);
+	EncodeBC1(block, out + 8);
+}
+
+static void EncodeBC5(const Block& block, u8* out)
+{
+	u8 red[16];
+	u8 green[16];
+	for (u32 i = 0; i < 16; ++i)
+	{
+		red[i] = block[i][0];
+		green[i] = block[i][1];
+	}
+
+	EncodeBC4(red, out);
+	EncodeBC4(green, out + 8);
+}
+
+struct BitWriter
+{
+	u8* mData;
+	u32 mPosition = 0;
+
+	void Write(u32 value, u32 bits)
+	{
+		for (u32 i = 0; i < bits; ++i)
+		{
+			if ((value >> i) & 1)
+			{
+				mData[mPosition >> 3] |= static_cast<u8>(1 << (mPosition & 7));
+			}
+			++mPosition;
+		}
+	}
+};
+
+static void EncodeBC7(const Block& block, u8* out)
+{
+	static constexpr u32 kWeights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	FloatBlock pixels;
+	for (u32 i = 0; i < 16; ++i)
+	{
+		for (u32 c = 0; c < 4; ++c)
+		{
+			pixels[i][c] = block[i][c];
+		}
+	}
+
+	float e0[4];
+	float e1[4];
+	FitLine(pixels, 4, e0, e1);
+
+	// 7 bit endpoints with a shared low bit (p-bit) per endpoint, keep whichever p-bit fits best
+	auto quantize = [](const float endpoint[4], u32 quantized[4], u32& pBit)
+	{
+		u32 bestError = std::numeric_limits<u32>::max();
+		for (u32 p = 0; p < 2; ++p)
+		{
+			u32 candidate[4];
+			float error = 0.0f;
+			for (u32 c = 0; c < 4; ++c)
+			{
+				candidate[c] = static_cast<u32>(std::clamp(std::lround((endpoint[c] - p) / 2.0f), 0l, 127l));
+				const float reconstructed = static_cast<float>((candidate[c] << 1) | p);
+				error += (reconstructed - endpoint[c]) * (reconstructed - endpoint[c]);
+			}
+
+			if (static_cast<u32>(error) < bestError)
+			{
+				bestError = static_cast<u32>(error);
+				pBit = p;
+				memcpy(quantized, candidate, sizeof(candidate));
+			}
+		}
+	};
+
+	u32 q0[4];
+	u32 q1[4];
+	u32 p0 = 0;
+	u32 p1 = 0;
+	quantize(e0, q0, p0);
+	quantize(e1, q1, p1);
+
+	float palette[16][4];
+	for (u32 i = 0; i < 16; ++i)
+	{
+		for (u32 c = 0; c < 4; ++c)
+		{
+			const u32 a = (q0[c] << 1) | p0;
+			const u32 b = (q1[c] << 1) | p1;
+			palette[i][c] = static_cast<float>(((64 - kWeights[i]) * a + kWeights[i] * b + 32) >> 6);
+		}
+	}
+
+	u32 indices[16];
+	for (u32 i = 0; i < 16; ++i)
+	{
+		indices[i] = BestIndex(pixels[i], palette, 16);
+	}
+
+	// the anchor index drops its top bit, flip the line so it is always clear
+	if (indices[0] & 8)
+	{
+		std::swap(q0, q1);
+		std::swap(p0, p1);
+		for (u32 i = 0; i < 16; ++i)
+		{
+			indices[i] = 15 - indices[i];
+		}
+	}
+
+	memset(out, 0, 16);
+	BitWriter writer{ out };
+	writer.Write(1 << 6, 7); // mode 6
+	for (u32 c = 0; c < 4; ++c)
+	{
+		writer.Write(q0[c], 7);
+		writer.Write(q1[c], 7);
+	}
+	writer.Write(p0, 1);
+	writer.Write(p1, 1);
+
+	writer.Write(indices[0], 3);
+	for (u32 i = 1; i < 16; ++i)
+	{
+		writer.Write(indices[i], 4);
+	}
+}
+
+static void EncodeBlock(TextureFormat format, const Block& block, u8* out)
+{
+	switch (format)
+	{
+	case TextureFormat::BC1_RGBA:
+	case TextureFormat::BC1_RGBA_SRGB:
+		EncodeBC1(block, out);
+		return;
+
+	case TextureFormat::BC3_RGBA:
+	case TextureFormat::BC3_RGBA_SRGB:
+		EncodeBC3(block, out);
+		return;
+
+	case TextureFormat::BC4_R:
+	{
+		// mirrors material_sampling.glslh, which reads g and falls back to r
+		u8 values[16];
+		for (u32 i = 0; i < 16; ++i)
+		{
+			values[i] = block[i][1] > 0 ? block[i][1] : block[i][0];
+		}
+		EncodeBC4(values, out);
+		return;
+	}
+
+	case TextureFormat::BC5_RG:
+		EncodeBC5(block, out);
+		return;
+
+	case TextureFormat::BC7_RGBA:
+	case TextureFormat::BC7_RGBA_SRGB:
+		EncodeBC7(block, out);
+		return;
+
+	default:
+		break;
+	}
+
+	DEBUG_ASSERT(false, "Unsupported compression format!");
+}
+
+TextureFormat assets::SelectCompressedFormat(const MipChain& chain, TextureUsage usage)
+{
+	switch (usage)
+	{
+	case TextureUsage::Color:
+	{
+		const MipLevel& base = chain.levels[0];
+		if (chain.channels == 2 || chain.channels == 4)
+		{
+			for (u64 i = chain.channels - 1; i < base.data.size(); i += chain.channels)
+			{
+				if (base.data[i] < 255)
+				{
+					return TextureFormat::BC7_RGBA;
+				}
+			}
+		}
+		return TextureFormat::BC1_RGBA;
+	}
+
+	case TextureUsage::Normal:
+		return chain.channels >= 3 ? TextureFormat::BC5_RG : TextureFormat::BC4_R;
+
+	case TextureUsage::Data:
+		return TextureFormat::BC4_R;
+	}
+
+	return TextureFormat::INVALID;
+}
+
+CompressedTexture assets::CompressMipChain(const MipChain& chain, TextureFormat format, gold::ThreadPool& pool)
+{
+	DEBUG_ASSERT(IsCompressedFormat(format), "Target format must be block compressed!");
+
+	CompressedTexture result;
+	result.format = format;
+	result.width = chain.levels[0].width;
+	result.height = chain.levels[0].height;
+
+	const u32 blockSize = GetTextureDataSize(format, 4, 4);
+
+	// size every level up front, workers write straight into their own rows
+	result.levels.resize(chain.levels.size());
+	for (u64 i = 0; i < chain.levels.size(); ++i)
+	{
+		result.levels[i].resize(GetTextureDataSize(format, chain.levels[i].width, chain.levels[i].height));
+	}
+
+	// several textures may compress at once (batch mode), only wait on this one
+	gold::TaskGroup tasks(pool);
+	for (u64 i = 0; i < chain.levels.size(); ++i)
+	{
+		const MipLevel& level = chain.levels[i];
+		u8* out = result.levels[i].data();
+
+		const u32 blocksX = (level.width + 3) / 4;
+		const u32 blocksY = (level.height + 3) / 4;
+
+		for (u32 firstRow = 0; firstRow < blocksY; firstRow += kBlockRowsPerTask)
+		{
+			const u32 lastRow = std::min(firstRow + kBlockRowsPerTask, blocksY);
+			tasks.Submit([&level, out, format, blockSize, blocksX, firstRow, lastRow, channels = chain.channels]()
+			{
+				Block block;
+				for (u32 y = firstRow; y < lastRow; ++y)
+				{
+					for (u32 x = 0; x < blocksX; ++x)
+					{
+						LoadBlock(level, channels, x, y, block);
+						EncodeBlock(format, block, out + (static_cast<u64>(y) * blocksX + x) * blockSize);
+					}
+				}
+			});
+		}
+	}
+	tasks.Wait();
+
+	return result;
+}
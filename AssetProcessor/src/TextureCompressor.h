@@ -0,0 +1,33 @@
+#pragma once
+
+#include <core/Core.h>
+#include <graphics/RenderTypes.h>
+
+#include "TextureProcessor.h"
+
+namespace gold
+{
+	class ThreadPool;
+}
+
+namespace assets
+{
+	struct CompressedTexture
+	{
+		graphics::TextureFormat format = graphics::TextureFormat::INVALID;
+		u16 width{};
+		u16 height{};
+
+		// one entry per mip level, level 0 first
+		std::vector<std::vector<u8>> levels;
+	};
+
+	// albedo: BC7 when any texel has alpha, BC1 otherwise
+	// normal: BC5 (xy, z is reconstructed in the shader)
+	// data:   BC4
+	graphics::TextureFormat SelectCompressedFormat(const MipChain& chain, TextureUsage usage);
+
+	// block compresses every level of the chain, blocks are encoded as tasks of pool. Safe to call from a task of
+	// the same pool, the wait helps with the pool's work
+	CompressedTexture CompressMipChain(const MipChain& chain, graphics::TextureFormat format, gold::ThreadPool& pool);
+}
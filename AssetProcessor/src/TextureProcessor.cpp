@@ -0,0 +1,238 @@
+#include "TextureProcessor.h"
+
+#include <graphics/Texture.h>
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define ASSETS_USE_SSE 1
+#include <xmmintrin.h>
+#endif
+
+using namespace assets;
+
+// every level is filtered in float from the previous one, texels are padded to 4 channels for SSE
+struct Texel
+{
+	float v[4];
+};
+
+static const std::array<float, 256>& SRGBToLinearTable()
+{
+	static const std::array<float, 256> table = []()
+	{
+		std::array<float, 256> result{};
+		for (u32 i = 0; i < 256; ++i)
+		{
+			float c = i / 255.0f;
+			result[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+		}
+		return result;
+	}();
+
+	return table;
+}
+
+static constexpr u32 kLinearToSRGBTableSize = 4096;
+static const std::array<u8, kLinearToSRGBTableSize>& LinearToSRGBTable()
+{
+	static const std::array<u8, kLinearToSRGBTableSize> table = []()
+	{
+		std::array<u8, kLinearToSRGBTableSize> result{};
+		for (u32 i = 0; i < kLinearToSRGBTableSize; ++i)
+		{
+			float l = i / static_cast<float>(kLinearToSRGBTableSize - 1);
+			float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+			result[i] = static_cast<u8>(std::lround(std::clamp(c, 0.0f, 1.0f) * 255.0f));
+		}
+		return result;
+	}();
+
+	return table;
+}
+
+static bool IsGammaChannel(TextureUsage usage, u16 channel, u16 channels)
+{
+	if (usage != TextureUsage::Color)
+	{
+		return false;
+	}
+
+	// grey + alpha keeps alpha in channel 1
+	if (channels == 2)
+	{
+		return channel == 0;
+	}
+
+	return channel < 3;
+}
+
+static TextureUsage ResolveUsage(TextureUsage usage, u16 channels)
+{
+	// a normal needs at least xyz to be renormalized
+	if (usage == TextureUsage::Normal && channels < 3)
+	{
+		return TextureUsage::Data;
+	}
+
+	return usage;
+}
+
+static std::vector<Texel> DecodeTexels(const u8* data, u32 texelCount, u16 channels, TextureUsage usage)
+{
+	const auto& toLinear = SRGBToLinearTable();
+
+	std::vector<Texel> result(texelCount, Texel{ { 0.0f, 0.0f, 0.0f, 1.0f } });
+	for (u32 i = 0; i < texelCount; ++i)
+	{
+		const u8* src = data + static_cast<u64>(i) * channels;
+		for (u16 c = 0; c < channels; ++c)
+		{
+			if (IsGammaChannel(usage, c, channels))
+			{
+				result[i].v[c] = toLinear[src[c]];
+			}
+			else if (usage == TextureUsage::Normal && c < 3)
+			{
+				result[i].v[c] = src[c] / 255.0f * 2.0f - 1.0f;
+			}
+			else
+			{
+				result[i].v[c] = src[c] / 255.0f;
+			}
+		}
+	}
+
+	return result;
+}
+
+static void EncodeTexels(const std::vector<Texel>& texels, u16 channels, TextureUsage usage, std::vector<u8>& out)
+{
+	const auto& toSRGB = LinearToSRGBTable();
+
+	auto quantize = [](float value)
+	{
+		return static_cast<u8>(std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+	};
+
+	out.resize(texels.size() * channels);
+	for (u64 i = 0; i < texels.size(); ++i)
+	{
+		u8* dst = out.data() + i * channels;
+		for (u16 c = 0; c < channels; ++c)
+		{
+			const float value = texels[i].v[c];
+			if (IsGammaChannel(usage, c, channels))
+			{
+				const float index = std::clamp(value, 0.0f, 1.0f) * (kLinearToSRGBTableSize - 1);
+				dst[c] = toSRGB[static_cast<u32>(index + 0.5f)];
+			}
+			else if (usage == TextureUsage::Normal && c < 3)
+			{
+				dst[c] = quantize(value * 0.5f + 0.5f);
+			}
+			else
+			{
+				dst[c] = quantize(value);
+			}
+		}
+	}
+}
+
+static void Renormalize(Texel& texel)
+{
+	const float length = std::sqrt(texel.v[0] * texel.v[0] + texel.v[1] * texel.v[1] + texel.v[2] * texel.v[2]);
+	if (length > 1e-6f)
+	{
+		texel.v[0] /= length;
+		texel.v[1] /= length;
+		texel.v[2] /= length;
+	}
+	else
+	{
+		// opposing normals cancelled out, fall back to the surface normal
+		texel.v[0] = 0.0f;
+		texel.v[1] = 0.0f;
+		texel.v[2] = 1.0f;
+	}
+}
+
+// 2x2 box filter, odd edges clamp to the last row/column
+static std::vector<Texel> Downsample(const std::vector<Texel>& src, u32 srcWidth, u32 srcHeight, u32 dstWidth, u32 dstHeight, TextureUsage usage)
+{
+	std::vector<Texel> result(static_cast<u64>(dstWidth) * dstHeight);
+
+	for (u32 y = 0; y < dstHeight; ++y)
+	{
+		const u32 y0 = std::min(y * 2, srcHeight - 1);
+		const u32 y1 = std::min(y * 2 + 1, srcHeight - 1);
+
+		const Texel* row0 = src.data() + static_cast<u64>(y0) * srcWidth;
+		const Texel* row1 = src.data() + static_cast<u64>(y1) * srcWidth;
+		Texel* dst = result.data() + static_cast<u64>(y) * dstWidth;
+
+		for (u32 x = 0; x < dstWidth; ++x)
+		{
+			const u32 x0 = std::min(x * 2, srcWidth - 1);
+			const u32 x1 = std::min(x * 2 + 1, srcWidth - 1);
+
+#if defined(ASSETS_USE_SSE)
+			__m128 sum = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(row0[x0].v), _mm_loadu_ps(row0[x1].v)),
+									_mm_add_ps(_mm_loadu_ps(row1[x0].v), _mm_loadu_ps(row1[x1].v)));
+			_mm_storeu_ps(dst[x].v, _mm_mul_ps(sum, _mm_set1_ps(0.25f)));
+#else
+			for (u32 c = 0; c < 4; ++c)
+			{
+				dst[x].v[c] = (row0[x0].v[c] + row0[x1].v[c] + row1[x0].v[c] + row1[x1].v[c]) * 0.25f;
+			}
+#endif
+
+			if (usage == TextureUsage::Normal)
+			{
+				Renormalize(dst[x]);
+			}
+		}
+	}
+
+	return result;
+}
+
+MipChain assets::GenerateMipChain(const graphics::Texture2D& texture, TextureUsage usage)
+{
+	MipChain result;
+	result.channels = texture.GetChannels();
+
+	u32 width = texture.GetWidth();
+	u32 height = texture.GetHeight();
+	DEBUG_ASSERT(texture.GetData() && width > 0 && height > 0, "Cannot build mips for an empty texture!");
+
+	usage = ResolveUsage(usage, result.channels);
+
+	// level 0 is passed through untouched
+	MipLevel& base = result.levels.emplace_back();
+	base.width = static_cast<u16>(width);
+	base.height = static_cast<u16>(height);
+	base.data.resize(texture.GetDataSize());
+	memcpy(base.data.data(), texture.GetData(), texture.GetDataSize());
+
+	std::vector<Texel> texels = DecodeTexels(base.data.data(), width * height, result.channels, usage);
+
+	while (width > 1 || height > 1)
+	{
+		const u32 nextWidth = std::max(width >> 1, 1u);
+		const u32 nextHeight = std::max(height >> 1, 1u);
+
+		texels = Downsample(texels, width, height, nextWidth, nextHeight, usage);
+
+		MipLevel& level = result.levels.emplace_back();
+		level.width = static_cast<u16>(nextWidth);
+		level.height = static_cast<u16>(nextHeight);
+		EncodeTexels(texels, result.channels, usage, level.data);
+
+		width = nextWidth;
+		height = nextHeight;
+	}
+
+	return result;
+}
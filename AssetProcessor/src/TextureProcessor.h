@@ -0,0 +1,36 @@
+#pragma once
+
+#include <core/Core.h>
+
+namespace graphics
+{
+	class Texture2D;
+}
+
+namespace assets
+{
+	// decides how texels are filtered when building mips
+	enum class TextureUsage : u8
+	{
+		Color,	// sRGB encoded rgb, linear alpha
+		Normal, // tangent space normal, renormalized per level
+		Data,	// linear values (metallic, roughness, masks)
+	};
+
+	struct MipLevel
+	{
+		u16 width{};
+		u16 height{};
+		std::vector<u8> data;
+	};
+
+	struct MipChain
+	{
+		u16 channels{};
+
+		// levels[0] is the source image, each following level halves the previous down to 1x1
+		std::vector<MipLevel> levels;
+	};
+
+	MipChain GenerateMipChain(const graphics::Texture2D& texture, TextureUsage usage);
+}
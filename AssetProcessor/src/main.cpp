@@ -3,38 +3,195 @@
 #include <core/Core.h>
 #include <core/Logging.h>
 #include "AssetProcessor.h"
+#include "PackBuilder.h"
 
+#include <algorithm>
+#include <cctype>
 #include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+static constexpr const char* kUsage =
+	"Usage: ./AssetProcessor \"inputFile\" \"outputFile\" [\"cacheDirectory\"]\n"
+	"       ./AssetProcessor --batch \"inputDirectory|manifest.txt\" \"outputDirectory\" [--threads N] [--cache \"cacheDirectory\"] [--store]\n"
+	"       ./AssetProcessor --pack \"contentDirectory\" \"archive.gpak\"";
+
+static constexpr const char* kModelExtensions[] = { ".gltf", ".glb", ".obj", ".fbx" };
+
+static void CreateParentDirectory(const std::string& output)
+{
+	std::string file(output);
+	std::replace(file.begin(), file.end(), '\\', '/');
+
+	const size_t separator = file.find_last_of('/');
+	if (separator == std::string::npos)
+	{
+		return;
+	}
+
+	std::string filepath = file.substr(0, separator);
+	if (!fs::is_directory(filepath))
+	{
+		fs::create_directories(filepath);
+	}
+}
+
+static bool IsModelFile(const fs::path& file)
+{
+	std::string extension = file.extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+	return std::find_if(std::begin(kModelExtensions), std::end(kModelExtensions), [&extension](const char* other) { return extension == other; }) != std::end(kModelExtensions);
+}
+
+// every model under input, mirrored into output with the .gmdl extension
+static std::vector<assets::ModelAsset> FindModelsInDirectory(const fs::path& input, const fs::path& output)
+{
+	std::vector<assets::ModelAsset> result;
+	for (const fs::directory_entry& entry : fs::recursive_directory_iterator(input))
+	{
+		if (entry.is_regular_file() && IsModelFile(entry.path()))
+		{
+			fs::path target = output / fs::relative(entry.path(), input);
+			target.replace_extension(".gmdl");
+			result.push_back({ entry.path().generic_string(), target.generic_string() });
+		}
+	}
+
+	// directory iteration order is unspecified, keep runs comparable
+	std::sort(result.begin(), result.end(), [](const assets::ModelAsset& a, const assets::ModelAsset& b) { return a.input < b.input; });
+	return result;
+}
+
+// one "inputFile outputFile" pair per line, outputs relative to output. Empty lines and lines starting with # are skipped
+static std::vector<assets::ModelAsset> ReadManifest(const fs::path& manifest, const fs::path& output)
+{
+	std::vector<assets::ModelAsset> result;
+
+	std::ifstream stream(manifest);
+	std::string line;
+	while (std::getline(stream, line))
+	{
+		std::istringstream fields(line);
+		std::string input;
+		std::string target;
+		if (!(fields >> input) || input[0] == '#')
+		{
+			continue;
+		}
+
+		if (!(fields >> target))
+		{
+			G_WARN("Ignoring manifest line without an output: {}", line);
+			continue;
+		}
+
+		result.push_back({ input, (output / target).generic_string() });
+	}
+
+	return result;
+}
+
+static int RunBatch(int argc, const char** argv)
+{
+	if (argc < 4)
+	{
+		G_ERROR("Incorrect parameters.\n{}", kUsage);
+		return 0;
+	}
+
+	const fs::path input = argv[2];
+	const fs::path output = argv[3];
+	const char* cache = "AssetCache";
+	u32 threadCount = 0;
+	bool compress = true;
+
+	for (int i = 4; i < argc; ++i)
+	{
+		const std::string option = argv[i];
+		if (option == "--threads" && i + 1 < argc)
+		{
+			threadCount = static_cast<u32>(std::max(0, std::atoi(argv[++i])));
+		}
+		else if (option == "--cache" && i + 1 < argc)
+		{
+			cache = argv[++i];
+		}
+		else if (option == "--store")
+		{
+			compress = false;
+		}
+		else
+		{
+			G_ERROR("Unknown option: {}\n{}", option, kUsage);
+			return 0;
+		}
+	}
+
+	if (!fs::exists(input))
+	{
+		G_ERROR("Cannot find input: {}", input.string());
+		return 0;
+	}
+
+	std::vector<assets::ModelAsset> models = fs::is_directory(input) ? FindModelsInDirectory(input, output) : ReadManifest(input, output);
+	if (models.empty())
+	{
+		G_ERROR("No models found in {}", input.string());
+		return 0;
+	}
+
+	for (const assets::ModelAsset& model : models)
+	{
+		CreateParentDirectory(model.output);
+	}
+
+	assets::ProcessModelAssets(models, cache, threadCount, compress);
+	return 0;
+}
 
 int main(int argc, const char** argv)
 {
 	Singletons::Get()->Register<gold::Logging>([]() { return std::make_shared<gold::Logging>(); });
-	UNUSED_VAR(argc);
 
-	if (argc != 3)
+	if (argc > 1 && std::string(argv[1]) == "--batch")
+	{
+		return RunBatch(argc, argv);
+	}
+
+	if (argc > 1 && std::string(argv[1]) == "--pack")
+	{
+		if (argc != 4 || !fs::is_directory(argv[2]))
+		{
+			G_ERROR("Incorrect parameters.\n{}", kUsage);
+			return 0;
+		}
+
+		CreateParentDirectory(argv[3]);
+		assets::BuildPack(argv[2], argv[3]);
+		return 0;
+	}
+
+	if (argc != 3 && argc != 4)
 	{
-		G_ERROR("Incorrect parameters.\nUsage: ./AssetProcessor \"inputFile\" \"outputFile\"");
+		G_ERROR("Incorrect parameters.\n{}", kUsage);
 		return 0;
 	}
 
 	const char* input = argv[1];
 	const char* output = argv[2];
+	const char* cache = argc == 4 ? argv[3] : "AssetCache";
 
-	if (!std::filesystem::exists(input))
+	if (!fs::exists(input))
 	{
 		G_ERROR("Cannot find input file: {}", input);
 		return 0;
 	}
 
-	std::string file(output);
-	std::replace(file.begin(), file.end(), '\\', '/');
-	std::string filepath = file.substr(0, file.find_last_of('/'));
-
-	if (!std::filesystem::is_directory(filepath))
-	{
-		std::filesystem::create_directories(filepath);
-	}
+	CreateParentDirectory(output);
 
-	assets::ProcessModelAsset(input, output);
+	assets::ProcessModelAsset(input, output, cache);
 	return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,214 @@
+#include "Benchmarks.h"
+
+#include <core/Logging.h>
+#include <graphics/AABBCulling.h>
+#include <graphics/AABBTree.h>
+
+#include <cmath>
+#include <random>
+
+static constexpr u32 kRepeats = 5;
+
+// boxes scattered through a cube of this half size around the camera, roughly a tenth end up visible
+static constexpr f32 kSceneExtent = 500.0f;
+static constexpr f32 kMaxBoxExtent = 5.0f;
+static constexpr f32 kTreeMargin = 0.5f;
+
+// about a point light's reach in a scene of this size
+static constexpr f32 kSphereRadius = 40.0f;
+static constexpr u32 kQueries = 100;
+
+// boxes moved per frame and how far along each axis at most, those moving further than kTreeMargin leave their
+// fattened box and touch the tree
+static constexpr u32 kMovedPercent = 10;
+static constexpr f32 kMoveDistance = 1.0f;
+
+struct Ray
+{
+	glm::vec3 origin;
+	glm::vec3 direction;
+};
+
+static void RunTreeComparison(const glm::mat4& viewProj, u32 boxCount)
+{
+	std::mt19937 random(boxCount);
+	std::uniform_real_distribution<f32> position(-kSceneExtent, kSceneExtent);
+	std::uniform_real_distribution<f32> extent(0.1f, kMaxBoxExtent);
+	std::uniform_real_distribution<f32> unit(-1.0f, 1.0f);
+
+	std::vector<AABB> boxes(boxCount);
+	for (AABB& box : boxes)
+	{
+		const glm::vec3 center(position(random), position(random), position(random));
+		const glm::vec3 halfSize(extent(random), extent(random), extent(random));
+		box = { center - halfSize, center + halfSize };
+	}
+
+	graphics::AABBTree tree(kTreeMargin);
+	std::vector<u32> proxies(boxCount);
+
+	const f64 build = bench::Measure(kRepeats, [&]()
+	{
+		tree.Clear();
+		for (u32 i = 0; i < boxCount; ++i)
+		{
+			proxies[i] = tree.CreateProxy(boxes[i], i);
+		}
+	});
+
+	// the same boxes move back and forth, every repeat does the same work
+	std::vector<u32> moved;
+	std::vector<glm::vec3> offsets;
+	for (u32 i = 0; i < boxCount; i += 100 / kMovedPercent)
+	{
+		moved.push_back(i);
+		offsets.push_back(glm::vec3(unit(random), unit(random), unit(random)) * kMoveDistance);
+	}
+
+	f32 direction = 1.0f;
+	u32 reinserted = 0;
+	const f64 update = bench::Measure(kRepeats, [&]()
+	{
+		reinserted = 0;
+		for (u32 i = 0; i < moved.size(); ++i)
+		{
+			AABB& box = boxes[moved[i]];
+			box.min += offsets[i] * direction;
+			box.max += offsets[i] * direction;
+			reinserted += tree.MoveProxy(proxies[moved[i]], box) ? 1 : 0;
+		}
+		direction = -direction;
+	});
+
+	// frustum, the tree reports fattened boxes and the exact test runs on those only
+	const graphics::CullFrustum frustum(viewProj);
+
+	u32 linearVisible = 0;
+	const f64 linearFrustum = bench::Measure(kRepeats, [&]()
+	{
+		linearVisible = 0;
+		for (const AABB& box : boxes)
+		{
+			linearVisible += graphics::IsAABBVisible(frustum, box) ? 1 : 0;
+		}
+	});
+
+	graphics::AABBSet set;
+	for (const AABB& box : boxes)
+	{
+		set.Add(box);
+	}
+	graphics::VisibilityBits bits;
+	const f64 batchedFrustum = bench::Measure(kRepeats, [&]() { graphics::CullAABBs(frustum, set, bits); });
+
+	u32 treeVisible = 0;
+	const f64 treeFrustum = bench::Measure(kRepeats, [&]()
+	{
+		treeVisible = 0;
+		tree.QueryFrustum(frustum, [&](u32 index)
+		{
+			treeVisible += graphics::IsAABBVisible(frustum, boxes[index]) ? 1 : 0;
+		});
+	});
+
+	// spheres and rays
+	std::vector<glm::vec3> centers(kQueries);
+	std::vector<Ray> rays(kQueries);
+	for (u32 i = 0; i < kQueries; ++i)
+	{
+		centers[i] = glm::vec3(position(random), position(random), position(random));
+		rays[i] = { glm::vec3(position(random), position(random), position(random)), glm::normalize(glm::vec3(unit(random), unit(random), unit(random))) };
+	}
+
+	u32 linearSphereHits = 0;
+	const f64 linearSphere = bench::Measure(kRepeats, [&]()
+	{
+		linearSphereHits = 0;
+		for (const glm::vec3& center : centers)
+		{
+			for (const AABB& box : boxes)
+			{
+				linearSphereHits += graphics::AABBTree::OverlapsSphere(box, center, kSphereRadius) ? 1 : 0;
+			}
+		}
+	});
+
+	u32 treeSphereHits = 0;
+	const f64 treeSphere = bench::Measure(kRepeats, [&]()
+	{
+		treeSphereHits = 0;
+		for (const glm::vec3& center : centers)
+		{
+			tree.QuerySphere(center, kSphereRadius, [&](u32 index)
+			{
+				treeSphereHits += graphics::AABBTree::OverlapsSphere(boxes[index], center, kSphereRadius) ? 1 : 0;
+			});
+		}
+	});
+
+	const f32 rayLength = 4.0f * kSceneExtent;
+
+	f64 linearRayDistance = 0.0;
+	const f64 linearRay = bench::Measure(kRepeats, [&]()
+	{
+		linearRayDistance = 0.0;
+		for (const Ray& ray : rays)
+		{
+			const glm::vec3 inverseDirection = 1.0f / ray.direction;
+
+			f32 closest = rayLength;
+			for (const AABB& box : boxes)
+			{
+				f32 distance;
+				if (graphics::AABBTree::IntersectRay(box, ray.origin, inverseDirection, closest, distance))
+				{
+					closest = distance;
+				}
+			}
+			linearRayDistance += closest;
+		}
+	});
+
+	f64 treeRayDistance = 0.0;
+	const f64 treeRay = bench::Measure(kRepeats, [&]()
+	{
+		treeRayDistance = 0.0;
+		for (const Ray& ray : rays)
+		{
+			const glm::vec3 inverseDirection = 1.0f / ray.direction;
+
+			f32 closest = rayLength;
+			tree.RayCast(ray.origin, ray.direction, rayLength, [&](u32 index, f32 maxDistance)
+			{
+				f32 distance;
+				if (graphics::AABBTree::IntersectRay(boxes[index], ray.origin, inverseDirection, maxDistance, distance))
+				{
+					closest = std::min(closest, distance);
+					return distance;
+				}
+				return maxDistance;
+			});
+			treeRayDistance += closest;
+		}
+	});
+
+	const bool differs = linearVisible != treeVisible || linearSphereHits != treeSphereHits || std::abs(linearRayDistance - treeRayDistance) > 0.01;
+
+	G_INFO("{} boxes, tree height {}{}:", boxCount, tree.GetHeight(), differs ? " (RESULTS DIFFER)" : "");
+	G_INFO("  build {:.3f}ms, moving {} boxes {:.3f}ms ({} left their fattened box)", build, moved.size(), update, reinserted);
+	G_INFO("  frustum, {} visible: linear {:.3f}ms, CullAABBs {:.3f}ms, tree {:.3f}ms ({:.2f}x linear)",
+		linearVisible, linearFrustum, batchedFrustum, treeFrustum, linearFrustum / treeFrustum);
+	G_INFO("  {} spheres, {} hits: linear {:.3f}ms, tree {:.3f}ms ({:.2f}x)", kQueries, linearSphereHits, linearSphere, treeSphere, linearSphere / treeSphere);
+	G_INFO("  {} rays, closest hit: linear {:.3f}ms, tree {:.3f}ms ({:.2f}x)", kQueries, linearRay, treeRay, linearRay / treeRay);
+}
+
+void bench::RunBVHBenchmark()
+{
+	const glm::mat4 proj = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, kSceneExtent);
+	const glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+	for (u32 boxCount : { 1000u, 10000u, 100000u })
+	{
+		RunTreeComparison(proj * view, boxCount);
+	}
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <core/Core.h>
+
+#include <chrono>
+
+namespace bench
+{
+	using Clock = std::chrono::steady_clock;
+
+	// fastest of repeats runs in milliseconds, the first run warms caches and threads up and is not counted
+	template<typename Function>
+	f64 Measure(u32 repeats, Function&& function)
+	{
+		function();
+
+		f64 best = std::numeric_limits<f64>::max();
+		for (u32 i = 0; i < repeats; ++i)
+		{
+			const Clock::time_point start = Clock::now();
+			function();
+			best = std::min(best, std::chrono::duration<f64, std::milli>(Clock::now() - start).count());
+		}
+		return best;
+	}
+
+	void RunJobBenchmark();
+	void RunCullingBenchmark();
+	void RunBVHBenchmark();
+}
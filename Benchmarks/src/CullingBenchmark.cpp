@@ -0,0 +1,91 @@
+#include "Benchmarks.h"
+
+#include <core/Logging.h>
+#include <core/ThreadPool.h>
+#include <graphics/AABBCulling.h>
+
+#include <random>
+
+static constexpr u32 kRepeats = 5;
+
+// boxes scattered through a cube of this half size around the camera, roughly a tenth end up visible
+static constexpr f32 kSceneExtent = 500.0f;
+static constexpr f32 kMaxBoxExtent = 5.0f;
+
+static void RunCullingComparison(gold::ThreadPool& pool, const glm::mat4& viewProj, u32 boxCount)
+{
+	std::mt19937 random(boxCount);
+	std::uniform_real_distribution<f32> position(-kSceneExtent, kSceneExtent);
+	std::uniform_real_distribution<f32> extent(0.1f, kMaxBoxExtent);
+
+	std::vector<AABB> boxes(boxCount);
+	graphics::AABBSet set;
+	for (AABB& box : boxes)
+	{
+		const glm::vec3 center(position(random), position(random), position(random));
+		const glm::vec3 halfSize(extent(random), extent(random), extent(random));
+		box = { center - halfSize, center + halfSize };
+		set.Add(box);
+	}
+
+	std::vector<u8> visible(boxCount);
+
+	// what culling used to cost, the frustum rebuilt for every object
+	const f64 perObject = bench::Measure(kRepeats, [&]()
+	{
+		const glm::mat4 viewProjInv = glm::inverse(viewProj);
+		const glm::mat4 viewProjTrans = glm::transpose(viewProj);
+		for (u32 i = 0; i < boxCount; ++i)
+		{
+			visible[i] = FrustumCuller::FrustumCulled(viewProjInv, viewProjTrans, boxes[i]) ? 0 : 1;
+		}
+	});
+
+	const graphics::CullFrustum frustum(viewProj);
+	const f64 scalar = bench::Measure(kRepeats, [&]()
+	{
+		for (u32 i = 0; i < boxCount; ++i)
+		{
+			visible[i] = graphics::IsAABBVisible(frustum, boxes[i]) ? 1 : 0;
+		}
+	});
+
+	graphics::VisibilityBits bits;
+	const f64 batched = bench::Measure(kRepeats, [&]() { graphics::CullAABBs(frustum, set, bits); });
+	const f64 parallel = bench::Measure(kRepeats, [&]() { graphics::CullAABBs(frustum, set, bits, &pool); });
+
+	u32 mismatches = 0;
+	for (u32 i = 0; i < boxCount; ++i)
+	{
+		mismatches += (visible[i] != 0) != bits.Test(i) ? 1 : 0;
+	}
+
+	const auto perBox = [boxCount](f64 ms) { return ms * 1000000.0 / boxCount; };
+
+	G_INFO("{} boxes, {} visible{}:", boxCount, bits.CountSet(), mismatches ? " (RESULTS DIFFER)" : "");
+	G_INFO("  FrustumCulled per object {:.3f}ms ({:.2f}ns per box)", perObject, perBox(perObject));
+	G_INFO("  scalar, frustum once {:.3f}ms ({:.2f}ns per box)", scalar, perBox(scalar));
+	G_INFO("  CullAABBs {:.3f}ms ({:.2f}ns per box, {:.2f}x)", batched, perBox(batched), perObject / batched);
+	G_INFO("  CullAABBs on {} workers {:.3f}ms ({:.2f}ns per box, {:.2f}x)", pool.GetThreadCount(), parallel, perBox(parallel), perObject / parallel);
+}
+
+void bench::RunCullingBenchmark()
+{
+#if defined(__AVX__)
+	G_INFO("AVX batches");
+#elif defined(_M_X64) || defined(__SSE2__)
+	G_INFO("SSE batches");
+#else
+	G_INFO("Scalar batches");
+#endif
+
+	gold::ThreadPool pool;
+
+	const glm::mat4 proj = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, kSceneExtent);
+	const glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+	for (u32 boxCount : { 10000u, 100000u, 1000000u })
+	{
+		RunCullingComparison(pool, proj * view, boxCount);
+	}
+}
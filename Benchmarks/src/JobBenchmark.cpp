@@ -0,0 +1,197 @@
+#include "Benchmarks.h"
+
+#include <core/Logging.h>
+#include <core/ThreadPool.h>
+
+#include <cmath>
+#include <future>
+#include <thread>
+
+static constexpr u32 kRepeats = 10;
+
+// arithmetic per item, enough that a range is compute bound rather than memory bound
+static constexpr u32 kWorkIterations = 32;
+
+// items per job for the fine grained runs, about the size of a frame job
+static constexpr u32 kItemsPerJob = 256;
+
+static constexpr u32 kEmptyJobs = 2000;
+
+// long enough that running one inline would show up as a stalled frame
+static constexpr auto kLongJobDuration = std::chrono::milliseconds(20);
+
+static f32 Work(u32 item)
+{
+	f32 x = static_cast<f32>(item);
+	for (u32 i = 0; i < kWorkIterations; ++i)
+	{
+		x = std::sqrt(x * 1.0001f + 1.0f);
+	}
+	return x;
+}
+
+static void WorkRange(std::vector<f32>& output, u32 first, u32 last)
+{
+	for (u32 i = first; i < last; ++i)
+	{
+		output[i] = Work(i);
+	}
+}
+
+static void RunRangeComparison(gold::ThreadPool& pool, u32 itemCount)
+{
+	std::vector<f32> output(itemCount);
+
+	const f64 serial = bench::Measure(kRepeats, [&]() { WorkRange(output, 0, itemCount); });
+
+	const f64 parallelFor = bench::Measure(kRepeats, [&]()
+	{
+		pool.ParallelFor(0, itemCount, [&output](u32 first, u32 last) { WorkRange(output, first, last); });
+	});
+
+	// what std::async code usually does, one evenly sized chunk per hardware thread
+	const u32 chunkCount = pool.GetThreadCount() + 1;
+	const f64 asyncChunks = bench::Measure(kRepeats, [&]()
+	{
+		std::vector<std::future<void>> futures;
+		for (u32 chunk = 0; chunk < chunkCount; ++chunk)
+		{
+			const u32 first = static_cast<u32>(static_cast<u64>(itemCount) * chunk / chunkCount);
+			const u32 last = static_cast<u32>(static_cast<u64>(itemCount) * (chunk + 1) / chunkCount);
+			futures.push_back(std::async(std::launch::async, [&output, first, last]() { WorkRange(output, first, last); }));
+		}
+
+		for (auto& future : futures)
+		{
+			future.wait();
+		}
+	});
+
+	// one job per kItemsPerJob items, the overhead per job shows
+	const f64 submitJobs = bench::Measure(kRepeats, [&]()
+	{
+		gold::JobCounter counter;
+		for (u32 first = 0; first < itemCount; first += kItemsPerJob)
+		{
+			const u32 last = std::min(first + kItemsPerJob, itemCount);
+			pool.Submit([&output, first, last]() { WorkRange(output, first, last); }, counter);
+		}
+		pool.Wait(counter);
+	});
+
+	const f64 asyncJobs = bench::Measure(kRepeats, [&]()
+	{
+		std::vector<std::future<void>> futures;
+		for (u32 first = 0; first < itemCount; first += kItemsPerJob)
+		{
+			const u32 last = std::min(first + kItemsPerJob, itemCount);
+			futures.push_back(std::async(std::launch::async, [&output, first, last]() { WorkRange(output, first, last); }));
+		}
+
+		for (auto& future : futures)
+		{
+			future.wait();
+		}
+	});
+
+	G_INFO("{} items:", itemCount);
+	G_INFO("  serial {:.3f}ms", serial);
+	G_INFO("  ParallelFor {:.3f}ms ({:.2f}x), std::async per thread {:.3f}ms ({:.2f}x)", parallelFor, serial / parallelFor, asyncChunks, serial / asyncChunks);
+	G_INFO("  Submit per {} items {:.3f}ms ({:.2f}x), std::async per {} items {:.3f}ms ({:.2f}x)",
+		kItemsPerJob, submitJobs, serial / submitJobs, kItemsPerJob, asyncJobs, serial / asyncJobs);
+}
+
+static void RunOverheadComparison(gold::ThreadPool& pool)
+{
+	std::atomic<u32> sink = 0;
+
+	const f64 submit = bench::Measure(kRepeats, [&]()
+	{
+		gold::JobCounter counter;
+		for (u32 i = 0; i < kEmptyJobs; ++i)
+		{
+			pool.Submit([&sink]() { ++sink; }, counter);
+		}
+		pool.Wait(counter);
+	});
+
+	const f64 async = bench::Measure(kRepeats, [&]()
+	{
+		std::vector<std::future<void>> futures;
+		futures.reserve(kEmptyJobs);
+		for (u32 i = 0; i < kEmptyJobs; ++i)
+		{
+			futures.push_back(std::async(std::launch::async, [&sink]() { ++sink; }));
+		}
+
+		for (auto& future : futures)
+		{
+			future.wait();
+		}
+	});
+
+	G_INFO("{} empty jobs:", kEmptyJobs);
+	G_INFO("  Submit {:.3f}us per job, std::async {:.3f}us per job", submit * 1000.0 / kEmptyJobs, async * 1000.0 / kEmptyJobs);
+}
+
+// long jobs show up while a ParallelFor waits on its last range, the waiting thread must leave them to the workers
+static void RunForeignJobCheck(gold::ThreadPool& pool)
+{
+	const std::thread::id caller = std::this_thread::get_id();
+	std::atomic<u32> ranInline = 0;
+
+	gold::JobCounter longJobs;
+	const auto submitLongJobs = [&]()
+	{
+		for (u32 i = 0; i < 4 * pool.GetThreadCount(); ++i)
+		{
+			pool.Submit([caller, &ranInline]()
+			{
+				ranInline += std::this_thread::get_id() == caller ? 1 : 0;
+				std::this_thread::sleep_for(kLongJobDuration);
+			}, longJobs);
+		}
+	};
+
+	// the calling thread runs the first range and is done long before the worker running the second one
+	const bench::Clock::time_point start = bench::Clock::now();
+	pool.ParallelFor(0, 2, [&](u32 first, u32)
+	{
+		if (first == 0)
+		{
+			submitLongJobs();
+		}
+		std::this_thread::sleep_for(first == 0 ? kLongJobDuration / 10 : kLongJobDuration);
+	}, 1);
+	const f64 parallelFor = std::chrono::duration<f64, std::milli>(bench::Clock::now() - start).count();
+	const u32 ranDuringFor = ranInline;
+
+	// waiting on them is fine to run them
+	pool.Wait(longJobs);
+
+	G_INFO("ParallelFor of {}ms with long jobs queued {:.3f}ms, {} of them run by the waiting thread{}",
+		kLongJobDuration.count(), parallelFor, ranDuringFor, ranDuringFor > 0 ? " (FAILED)" : "");
+}
+
+void bench::RunJobBenchmark()
+{
+	gold::ThreadPool pool;
+	G_INFO("{} workers", pool.GetThreadCount());
+
+	const Clock::time_point start = Clock::now();
+
+	for (u32 itemCount : { 1000u, 100000u, 1000000u })
+	{
+		RunRangeComparison(pool, itemCount);
+	}
+	RunOverheadComparison(pool);
+	RunForeignJobCheck(pool);
+
+	const f64 elapsedNS = std::chrono::duration<f64, std::nano>(Clock::now() - start).count();
+	const auto statistics = pool.GetWorkerStatistics();
+	for (size_t i = 0; i < statistics.size(); ++i)
+	{
+		G_INFO("Worker {}: busy {:.1f}%, asleep {:.1f}%, {} jobs ({} stolen)", i,
+			statistics[i].busyNS * 100.0 / elapsedNS, statistics[i].sleepNS * 100.0 / elapsedNS, statistics[i].executedJobs, statistics[i].stolenJobs);
+	}
+}
@@ -0,0 +1,39 @@
+#include "Benchmarks.h"
+
+#include <core/Logging.h>
+
+struct Benchmark
+{
+	const char* name;
+	void (*run)();
+};
+
+static const Benchmark kBenchmarks[] =
+{
+	{ "jobs", &bench::RunJobBenchmark },
+	{ "culling", &bench::RunCullingBenchmark },
+	{ "bvh", &bench::RunBVHBenchmark },
+};
+
+// runs every benchmark, or only the ones named on the command line
+int main(int argc, const char** argv)
+{
+	Singletons::Get()->Register<gold::Logging>([]() { return std::make_shared<gold::Logging>(); });
+
+	for (const Benchmark& benchmark : kBenchmarks)
+	{
+		bool selected = argc == 1;
+		for (int i = 1; i < argc; ++i)
+		{
+			selected |= std::string(argv[i]) == benchmark.name;
+		}
+
+		if (selected)
+		{
+			G_INFO("Running benchmark: {}", benchmark.name);
+			benchmark.run();
+		}
+	}
+
+	return 0;
+}
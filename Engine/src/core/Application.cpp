@@ -4,6 +4,9 @@
 #include "graphics/FrameDecoder.h"
 #include "graphics/FrameEncoder.h"
 #include "graphics/RenderCommands.h"
+#include "graphics/UploadQueue.h"
+#include "graphics/TextureResidency.h"
+#include "core/ThreadPool.h"
 
 using namespace gold;
 
@@ -43,6 +46,8 @@ void Application::UpdateThread()
 	f32 step = 1.0f / 30.f;
 	UNUSED_VAR(step); // TODO (danielg): for when putting physics back in
 
+	auto residency = Singletons::Get()->Resolve<TextureResidency>();
+
 	uint32_t prevTime = mPlatform->GetElapsedTimeMS();
 	while (mRunning)
 	{
@@ -55,6 +60,9 @@ void Application::UpdateThread()
 		Update(frameTime, *mEncoders.Get());
 		mEncoders.Get()->End();
 
+		// after the client reported this frame's texture footprints
+		residency->Update();
+
 		mTime += frameTime;
 		{
 			std::unique_lock lock(mSwapMutex);
@@ -74,6 +82,8 @@ void Application::RenderThread()
 	mRenderer = std::unique_ptr<graphics::Renderer>();
 	mRenderer->Init(mPlatform->GetWindowHandle());
 
+	auto uploadQueue = Singletons::Get()->Resolve<UploadQueue>();
+
 	while (mRunning)
 	{
 		gold::FrameEncoder* readEncoder = nullptr;
@@ -101,6 +111,7 @@ void Application::RenderThread()
 		mRenderer->ClearBackBuffer();
 
 		mRenderer->BeginFrame();
+		uploadQueue->Drain(*mRenderer, mRenderResources);
 		if(reader.HasData())
 		{
 			gold::FrameDecoder::Decode(*mRenderer, mRenderResources, reader);
@@ -117,7 +128,15 @@ Application::Application(ApplicationConfig&& config)
 	, mTime(0)
 	, mRunning(false)
 {
+	// short, cpu bound jobs for per frame work. Long blocking work (file decoding) keeps a pool of its own
+	Singletons::Get()->Register<ThreadPool>([]() { return std::make_shared<ThreadPool>(); });
+
+	// any thread can queue uploads, the render thread drains them within a budget every frame
+	Singletons::Get()->Register<UploadQueue>([this]() { return std::make_shared<UploadQueue>(mRenderResources); });
 
+	// resolved out here, generators run under the singleton lock
+	auto uploadQueue = Singletons::Get()->Resolve<UploadQueue>();
+	Singletons::Get()->Register<TextureResidency>([uploadQueue]() { return std::make_shared<TextureResidency>(*uploadQueue); });
 }
 
 Application::~Application()
@@ -0,0 +1,154 @@
+#include "FileWatcher.h"
+
+#include "Logging.h"
+
+#include <filesystem>
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+using namespace gold;
+
+#if defined(__linux__)
+
+FileWatcher::FileWatcher()
+	: mDescriptor(inotify_init1(IN_NONBLOCK | IN_CLOEXEC))
+{
+	if (mDescriptor < 0)
+	{
+		G_ENGINE_WARN("Could not initialize inotify, file changes will not be picked up");
+	}
+}
+
+FileWatcher::~FileWatcher()
+{
+	if (mDescriptor >= 0)
+	{
+		close(mDescriptor);
+	}
+}
+
+bool FileWatcher::Watch(const std::string& filepath)
+{
+	if (mDescriptor < 0)
+	{
+		return false;
+	}
+
+	const std::filesystem::path path(filepath);
+	std::string directory = path.parent_path().string();
+	if (directory.empty())
+	{
+		directory = ".";
+	}
+
+	const std::string key = directory + '/' + path.filename().string();
+	if (mFiles.find(key) != mFiles.end())
+	{
+		return true;
+	}
+
+	// watching the same directory again hands back the same descriptor
+	const int watch = inotify_add_watch(mDescriptor, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+	if (watch < 0)
+	{
+		return false;
+	}
+
+	mDirectories[watch] = directory;
+	mFiles[key] = filepath;
+	return true;
+}
+
+std::vector<std::string> FileWatcher::Poll()
+{
+	std::vector<std::string> result;
+	if (mDescriptor < 0)
+	{
+		return result;
+	}
+
+	std::unordered_set<std::string> changed;
+
+	alignas(inotify_event) char buffer[16 * 1024];
+	ssize_t length = 0;
+	while ((length = read(mDescriptor, buffer, sizeof(buffer))) > 0)
+	{
+		for (ssize_t offset = 0; offset < length;)
+		{
+			const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+			offset += sizeof(inotify_event) + event->len;
+
+			// dropped events, anything could have changed
+			if (event->mask & IN_Q_OVERFLOW)
+			{
+				for (const auto& [key, file] : mFiles)
+				{
+					changed.insert(file);
+				}
+				continue;
+			}
+
+			auto directory = mDirectories.find(event->wd);
+			if (event->len == 0 || directory == mDirectories.end())
+			{
+				continue;
+			}
+
+			auto file = mFiles.find(directory->second + '/' + event->name);
+			if (file != mFiles.end())
+			{
+				changed.insert(file->second);
+			}
+		}
+	}
+
+	result.assign(changed.begin(), changed.end());
+	return result;
+}
+
+#else
+
+FileWatcher::FileWatcher()
+{
+
+}
+
+FileWatcher::~FileWatcher()
+{
+
+}
+
+bool FileWatcher::Watch(const std::string& filepath)
+{
+	std::error_code error;
+	const auto time = std::filesystem::last_write_time(filepath, error);
+	if (error)
+	{
+		return false;
+	}
+
+	mFiles.emplace(filepath, time);
+	return true;
+}
+
+std::vector<std::string> FileWatcher::Poll()
+{
+	std::vector<std::string> result;
+	for (auto& [file, time] : mFiles)
+	{
+		std::error_code error;
+		const auto current = std::filesystem::last_write_time(file, error);
+		if (!error && current != time)
+		{
+			time = current;
+			result.push_back(file);
+		}
+	}
+
+	return result;
+}
+
+#endif
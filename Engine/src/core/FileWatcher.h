@@ -0,0 +1,40 @@
+#pragma once
+
+#include "Core.h"
+
+#include <unordered_set>
+
+#if !defined(__linux__)
+#include <filesystem>
+#endif
+
+namespace gold
+{
+	// reports changes to files on disk, inotify on linux and modification times elsewhere. Not thread safe
+	class FileWatcher
+	{
+	private:
+#if defined(__linux__)
+		int mDescriptor = -1;
+
+		// watch descriptor -> directory as passed in, and "directory/name" -> the path Watch was given
+		std::unordered_map<int, std::string> mDirectories;
+		std::unordered_map<std::string, std::string> mFiles;
+#else
+		std::unordered_map<std::string, std::filesystem::file_time_type> mFiles;
+#endif
+
+	public:
+		FileWatcher();
+		~FileWatcher();
+
+		FileWatcher(const FileWatcher&) = delete;
+		FileWatcher& operator=(const FileWatcher&) = delete;
+
+		// returns false when the file's directory cannot be watched. Watching a file twice is a no op
+		bool Watch(const std::string& filepath);
+
+		// files written since the last call, each at most once and as passed to Watch. Never blocks
+		std::vector<std::string> Poll();
+	};
+}
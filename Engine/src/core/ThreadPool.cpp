@@ -0,0 +1,516 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+
+using namespace gold;
+
+using Clock = std::chrono::steady_clock;
+
+// lets Submit find the calling worker's own deque
+static thread_local const ThreadPool* kCurrentPool = nullptr;
+static thread_local u32 kCurrentWorker = 0;
+
+// index used for threads outside the pool
+static constexpr u32 kNoWorker = ~0u;
+
+static constexpr i64 kInitialDequeCapacity = 256;
+
+// a helping wait that finds nothing to run yields this many times before it starts sleeping between attempts
+static constexpr u32 kWaitSpins = 64;
+static constexpr auto kWaitSleep = std::chrono::microseconds(50);
+
+// ParallelFor with an automatic grain splits down to about this many ranges per thread
+static constexpr u32 kRangesPerThread = 8;
+
+static u64 ElapsedNS(Clock::time_point start)
+{
+	return static_cast<u64>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+}
+
+// xorshift, picks where a thief starts looking so they don't all hammer the same victim
+static u32 NextVictim(u32 count)
+{
+	static thread_local u32 state = static_cast<u32>(std::hash<std::thread::id>{}(std::this_thread::get_id())) | 1;
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state % count;
+}
+
+namespace gold
+{
+	struct PoolJob
+	{
+		ThreadPool::Task mTask;
+		JobCounter* mCounter = nullptr;
+	};
+
+	// Chase-Lev deque, memory orderings from Le et al. 2013. Replaced rings stay alive, a thief may still read one
+	class JobDeque
+	{
+	private:
+		struct Ring
+		{
+			i64 mMask;
+			std::unique_ptr<std::atomic<PoolJob*>[]> mSlots;
+
+			explicit Ring(i64 capacity)
+				: mMask(capacity - 1)
+				, mSlots(new std::atomic<PoolJob*>[capacity])
+			{
+			}
+
+			i64 GetCapacity() const { return mMask + 1; }
+			PoolJob* Get(i64 index) const { return mSlots[index & mMask].load(std::memory_order_relaxed); }
+			void Put(i64 index, PoolJob* job) { mSlots[index & mMask].store(job, std::memory_order_relaxed); }
+		};
+
+		alignas(64) std::atomic<i64> mTop = 0;
+		alignas(64) std::atomic<i64> mBottom = 0;
+		std::atomic<Ring*> mRing;
+
+		// owner only, the current ring and every one it replaced
+		std::vector<std::unique_ptr<Ring>> mRings;
+
+	public:
+		JobDeque()
+		{
+			mRings.push_back(std::make_unique<Ring>(kInitialDequeCapacity));
+			mRing = mRings.back().get();
+		}
+
+		// owner only
+		void Push(PoolJob* job)
+		{
+			const i64 bottom = mBottom.load(std::memory_order_relaxed);
+			const i64 top = mTop.load(std::memory_order_acquire);
+			Ring* ring = mRing.load(std::memory_order_relaxed);
+
+			if (bottom - top > ring->GetCapacity() - 1)
+			{
+				mRings.push_back(std::make_unique<Ring>(ring->GetCapacity() * 2));
+				Ring* grown = mRings.back().get();
+				for (i64 i = top; i < bottom; ++i)
+				{
+					grown->Put(i, ring->Get(i));
+				}
+
+				mRing.store(grown, std::memory_order_release);
+				ring = grown;
+			}
+
+			ring->Put(bottom, job);
+			std::atomic_thread_fence(std::memory_order_release);
+			mBottom.store(bottom + 1, std::memory_order_relaxed);
+		}
+
+		// owner only
+		PoolJob* Pop()
+		{
+			const i64 bottom = mBottom.load(std::memory_order_relaxed) - 1;
+			Ring* ring = mRing.load(std::memory_order_relaxed);
+			mBottom.store(bottom, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			i64 top = mTop.load(std::memory_order_relaxed);
+
+			if (top > bottom)
+			{
+				mBottom.store(bottom + 1, std::memory_order_relaxed);
+				return nullptr;
+			}
+
+			PoolJob* job = ring->Get(bottom);
+			if (top == bottom)
+			{
+				// the last job, whoever moves top first gets it
+				if (!mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				{
+					job = nullptr;
+				}
+				mBottom.store(bottom + 1, std::memory_order_relaxed);
+			}
+			return job;
+		}
+
+		// any thread, returns null when empty or when it lost a race for the top job
+		PoolJob* Steal()
+		{
+			i64 top = mTop.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			const i64 bottom = mBottom.load(std::memory_order_acquire);
+
+			if (top >= bottom)
+			{
+				return nullptr;
+			}
+
+			PoolJob* job = mRing.load(std::memory_order_acquire)->Get(top);
+			if (!mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			{
+				return nullptr;
+			}
+			return job;
+		}
+
+		bool IsEmpty() const
+		{
+			return mBottom.load(std::memory_order_relaxed) <= mTop.load(std::memory_order_relaxed);
+		}
+	};
+}
+
+// written by its own thread only, read by GetWorkerStatistics
+struct alignas(64) ThreadPool::Worker
+{
+	JobDeque mJobs;
+
+	std::atomic<u64> mExecutedJobs = 0;
+	std::atomic<u64> mStolenJobs = 0;
+	std::atomic<u64> mBusyNS = 0;
+	std::atomic<u64> mSleepNS = 0;
+};
+
+ThreadPool::ThreadPool(u32 threadCount)
+{
+	if (threadCount == 0)
+	{
+		u32 hardwareThreads = std::thread::hardware_concurrency();
+		threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+
+	// every deque exists before the first worker starts stealing
+	mWorkers.reserve(threadCount);
+	for (u32 i = 0; i < threadCount; ++i)
+	{
+		mWorkers.push_back(std::make_unique<Worker>());
+	}
+
+	mThreads.reserve(threadCount);
+	for (u32 i = 0; i < threadCount; ++i)
+	{
+		mThreads.emplace_back(&ThreadPool::WorkerLoop, this, i);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::scoped_lock lock(mMutex);
+		mStopping = true;
+	}
+	mCondition.notify_all();
+
+	for (auto& thread : mThreads)
+	{
+		thread.join();
+	}
+
+	DEBUG_ASSERT(mActiveJobs == 0, "Thread pool destroyed with jobs still waiting on a dependency!");
+}
+
+void ThreadPool::Push(PoolJob* job)
+{
+	// counted before the job becomes visible, a worker that sees the count may spin briefly until it shows up
+	// but never goes to sleep on a queued job
+	++mQueuedJobs;
+
+	if (kCurrentPool == this)
+	{
+		mWorkers[kCurrentWorker]->mJobs.Push(job);
+	}
+	else
+	{
+		std::scoped_lock lock(mInjectedMutex);
+		mInjected.push_back(job);
+	}
+
+	// a worker bumps mSleepingWorkers before checking mQueuedJobs under mMutex, so one of us sees the other
+	if (mSleepingWorkers > 0)
+	{
+		{
+			std::scoped_lock lock(mMutex);
+		}
+		mCondition.notify_one();
+	}
+}
+
+void ThreadPool::Submit(Task&& task)
+{
+	DEBUG_ASSERT(!mStopping, "Submitting work to a stopped thread pool!");
+
+	++mActiveJobs;
+	Push(new PoolJob{ std::move(task), nullptr });
+}
+
+void ThreadPool::Submit(Task&& task, JobCounter& counter)
+{
+	DEBUG_ASSERT(!mStopping, "Submitting work to a stopped thread pool!");
+
+	++mActiveJobs;
+	++counter.mPending;
+	Push(new PoolJob{ std::move(task), &counter });
+}
+
+void ThreadPool::Submit(Task&& task, JobCounter& counter, JobCounter& dependency)
+{
+	DEBUG_ASSERT(!mStopping, "Submitting work to a stopped thread pool!");
+	DEBUG_ASSERT(&counter != &dependency, "A job can not depend on its own counter!");
+
+	++mActiveJobs;
+	++counter.mPending;
+	PoolJob* job = new PoolJob{ std::move(task), &counter };
+
+	{
+		std::scoped_lock lock(dependency.mMutex);
+		if (dependency.mPending > 0)
+		{
+			dependency.mDeferred.push_back(job);
+			return;
+		}
+	}
+
+	Push(job);
+}
+
+void ThreadPool::Finish(JobCounter& counter)
+{
+	++counter.mFinishing;
+
+	if (--counter.mPending == 0)
+	{
+		std::vector<PoolJob*> released;
+		{
+			std::scoped_lock lock(counter.mMutex);
+			released.swap(counter.mDeferred);
+		}
+
+		for (PoolJob* job : released)
+		{
+			Push(job);
+		}
+	}
+
+	// last touch, a waiter may destroy the counter right after this
+	--counter.mFinishing;
+}
+
+void ThreadPool::Execute(PoolJob* job, u32 index)
+{
+	job->mTask();
+
+	JobCounter* counter = job->mCounter;
+	delete job;
+
+	if (counter)
+	{
+		Finish(*counter);
+	}
+
+	if (index != kNoWorker)
+	{
+		mWorkers[index]->mExecutedJobs.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	if (--mActiveJobs == 0)
+	{
+		{
+			std::scoped_lock lock(mMutex);
+		}
+		mIdleCondition.notify_all();
+	}
+}
+
+PoolJob* ThreadPool::FindJob(u32 index, const JobCounter* waiting)
+{
+	PoolJob* job = nullptr;
+	if (index != kNoWorker)
+	{
+		job = mWorkers[index]->mJobs.Pop();
+	}
+
+	if (!job)
+	{
+		std::scoped_lock lock(mInjectedMutex);
+		if (index != kNoWorker)
+		{
+			if (!mInjected.empty())
+			{
+				job = mInjected.front();
+				mInjected.pop_front();
+			}
+		}
+		else
+		{
+			// a frame waiting on its own jobs must not pick up someone's long running one
+			auto found = std::find_if(mInjected.begin(), mInjected.end(), [waiting](const PoolJob* queued) { return queued->mCounter == waiting; });
+			if (found != mInjected.end())
+			{
+				job = *found;
+				mInjected.erase(found);
+			}
+		}
+	}
+
+	// jobs in a deque can only be told apart once taken, outside threads leave them to the workers
+	if (!job && index != kNoWorker)
+	{
+		const u32 workerCount = static_cast<u32>(mWorkers.size());
+		const u32 start = NextVictim(workerCount);
+		for (u32 i = 0; i < workerCount && !job; ++i)
+		{
+			const u32 victim = (start + i) % workerCount;
+			if (victim != index)
+			{
+				job = mWorkers[victim]->mJobs.Steal();
+			}
+		}
+
+		if (job)
+		{
+			mWorkers[index]->mStolenJobs.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	if (job)
+	{
+		--mQueuedJobs;
+	}
+	return job;
+}
+
+void ThreadPool::Wait()
+{
+	DEBUG_ASSERT(kCurrentPool != this, "Waiting on a pool from one of its own tasks!");
+
+	std::unique_lock lock(mMutex);
+	mIdleCondition.wait(lock, [this]() { return mActiveJobs == 0; });
+}
+
+void ThreadPool::Wait(const JobCounter& counter)
+{
+	const u32 index = kCurrentPool == this ? kCurrentWorker : kNoWorker;
+
+	u32 idleSpins = 0;
+	while (!counter.IsDone())
+	{
+		if (PoolJob* job = FindJob(index, &counter))
+		{
+			Execute(job, index);
+			idleSpins = 0;
+			continue;
+		}
+
+		// the counter's last jobs are running elsewhere, back off so a long wait does not hold on to a core
+		if (++idleSpins < kWaitSpins)
+		{
+			std::this_thread::yield();
+		}
+		else
+		{
+			std::this_thread::sleep_for(kWaitSleep);
+		}
+	}
+}
+
+bool ThreadPool::IsLocalQueueEmpty() const
+{
+	// outside the pool there is no deque of our own, nothing queued anywhere means every split was picked up
+	return kCurrentPool == this ? mWorkers[kCurrentWorker]->mJobs.IsEmpty() : mQueuedJobs == 0;
+}
+
+void ThreadPool::RunRange(u32 begin, u32 end, const RangeTask& body, u32 grain, JobCounter& counter)
+{
+	// lazy binary splitting, the upper half is only split off once the previous split has been stolen
+	while (end - begin > grain && IsLocalQueueEmpty())
+	{
+		const u32 middle = begin + (end - begin) / 2;
+		Submit([this, middle, end, &body, grain, &counter]() { RunRange(middle, end, body, grain, counter); }, counter);
+		end = middle;
+	}
+
+	body(begin, end);
+}
+
+void ThreadPool::ParallelFor(u32 begin, u32 end, const RangeTask& body, u32 minGrain)
+{
+	if (begin >= end)
+	{
+		return;
+	}
+
+	if (minGrain == 0)
+	{
+		minGrain = std::max((end - begin) / (kRangesPerThread * (GetThreadCount() + 1)), 1u);
+	}
+
+	JobCounter counter;
+	RunRange(begin, end, body, minGrain, counter);
+	Wait(counter);
+}
+
+u64 ThreadPool::GetStolenTaskCount() const
+{
+	u64 result = 0;
+	for (const auto& worker : mWorkers)
+	{
+		result += worker->mStolenJobs.load(std::memory_order_relaxed);
+	}
+	return result;
+}
+
+std::vector<ThreadPool::WorkerStatistics> ThreadPool::GetWorkerStatistics() const
+{
+	std::vector<WorkerStatistics> result(mWorkers.size());
+	for (size_t i = 0; i < mWorkers.size(); ++i)
+	{
+		result[i].executedJobs = mWorkers[i]->mExecutedJobs.load(std::memory_order_relaxed);
+		result[i].stolenJobs = mWorkers[i]->mStolenJobs.load(std::memory_order_relaxed);
+		result[i].busyNS = mWorkers[i]->mBusyNS.load(std::memory_order_relaxed);
+		result[i].sleepNS = mWorkers[i]->mSleepNS.load(std::memory_order_relaxed);
+	}
+	return result;
+}
+
+void ThreadPool::WorkerLoop(u32 index)
+{
+	kCurrentPool = this;
+	kCurrentWorker = index;
+
+	Worker& worker = *mWorkers[index];
+	while (true)
+	{
+		if (PoolJob* job = FindJob(index))
+		{
+			const Clock::time_point start = Clock::now();
+			Execute(job, index);
+			worker.mBusyNS.fetch_add(ElapsedNS(start), std::memory_order_relaxed);
+			continue;
+		}
+
+		const Clock::time_point start = Clock::now();
+		{
+			std::unique_lock lock(mMutex);
+			++mSleepingWorkers;
+			mCondition.wait(lock, [this]() { return mStopping || mQueuedJobs > 0; });
+			--mSleepingWorkers;
+
+			// drain remaining work before shutting down so no task is silently dropped
+			if (mStopping && mQueuedJobs == 0)
+			{
+				return;
+			}
+		}
+		worker.mSleepNS.fetch_add(ElapsedNS(start), std::memory_order_relaxed);
+	}
+}
+
+void TaskGroup::Submit(ThreadPool::Task&& task)
+{
+	mPool.Submit(std::move(task), mCounter);
+}
+
+void TaskGroup::Wait()
+{
+	mPool.Wait(mCounter);
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include "Core.h"
+
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <deque>
+#include <condition_variable>
+
+namespace gold
+{
+	class ThreadPool;
+	struct PoolJob;
+
+	// counts the unfinished jobs submitted against it. Jobs can also depend on a counter, they are held back until
+	// it reaches zero. A counter must outlive every job that references it, Wait on it before it goes away
+	class JobCounter
+	{
+	private:
+		friend class ThreadPool;
+
+		std::atomic<u32> mPending = 0;
+
+		// jobs in the middle of finishing against the counter, it is only done once they are all out
+		std::atomic<u32> mFinishing = 0;
+
+		// jobs depending on this counter, guarded by mMutex
+		std::mutex mMutex;
+		std::vector<PoolJob*> mDeferred;
+
+	public:
+		JobCounter() = default;
+
+		JobCounter(const JobCounter&) = delete;
+		JobCounter& operator=(const JobCounter&) = delete;
+
+		bool IsDone() const { return mPending == 0 && mFinishing == 0; }
+	};
+
+	// Fixed size pool of worker threads with work stealing. Used for coarse, independent work (file decoding,
+	// asset processing) as well as fine grained per frame jobs, tasks may submit more tasks and wait on them
+	class ThreadPool
+	{
+	public:
+		using Task = std::function<void()>;
+
+		// body(first, last) runs over [first, last)
+		using RangeTask = std::function<void(u32, u32)>;
+
+		struct WorkerStatistics
+		{
+			u64 executedJobs = 0;
+
+			// jobs taken from another worker's queue
+			u64 stolenJobs = 0;
+
+			// running jobs and asleep waiting for some, the rest of the time went into looking for work
+			u64 busyNS = 0;
+			u64 sleepNS = 0;
+		};
+
+	private:
+		// every worker owns a lock free deque, threads outside the pool go through a locked injection queue
+		struct Worker;
+
+		std::vector<std::unique_ptr<Worker>> mWorkers;
+		std::vector<std::thread> mThreads;
+
+		std::mutex mInjectedMutex;
+		std::deque<PoolJob*> mInjected;
+
+		std::mutex mMutex;
+		std::condition_variable mCondition;
+		std::condition_variable mIdleCondition;
+
+		// sitting in any queue, workers sleep while this is 0
+		std::atomic<u32> mQueuedJobs = 0;
+		std::atomic<u32> mSleepingWorkers = 0;
+
+		// submitted and not finished yet, including jobs held back by a dependency
+		std::atomic<u32> mActiveJobs = 0;
+
+		std::atomic<bool> mStopping = false;
+
+		void WorkerLoop(u32 index);
+
+		// threads outside the pool only take injected jobs of the counter they wait on
+		PoolJob* FindJob(u32 index, const JobCounter* waiting = nullptr);
+		void Push(PoolJob* job);
+		void Execute(PoolJob* job, u32 index);
+		void Finish(JobCounter& counter);
+
+		bool IsLocalQueueEmpty() const;
+		void RunRange(u32 begin, u32 end, const RangeTask& body, u32 grain, JobCounter& counter);
+
+	public:
+		// threadCount of 0 uses hardware_concurrency - 1 (minimum 1)
+		explicit ThreadPool(u32 threadCount = 0);
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		void Submit(Task&& task);
+
+		// counter counts the job until it has finished running
+		void Submit(Task&& task, JobCounter& counter);
+
+		// as above, the job is only queued once dependency reaches zero
+		void Submit(Task&& task, JobCounter& counter, JobCounter& dependency);
+
+		// blocks until every submitted task has finished running, do not call from a task
+		void Wait();
+
+		// runs other jobs of the pool until counter is done, fine to call from anywhere including a task. Threads
+		// outside the pool only help with the counter's own jobs
+		void Wait(const JobCounter& counter);
+
+		// splits [begin, end) over the pool down to minGrain indices and returns once all of it ran.
+		// minGrain of 0 picks one from the range size and thread count
+		void ParallelFor(u32 begin, u32 end, const RangeTask& body, u32 minGrain = 0);
+
+		u32 GetThreadCount() const { return static_cast<u32>(mWorkers.size()); }
+
+		// tasks a worker took from another worker's queue
+		u64 GetStolenTaskCount() const;
+
+		// running totals since the pool started, one entry per worker
+		std::vector<WorkerStatistics> GetWorkerStatistics() const;
+	};
+
+	// tracks a subset of the tasks submitted to a pool, callers sharing a pool only wait on their own work
+	class TaskGroup
+	{
+	private:
+		ThreadPool& mPool;
+		JobCounter mCounter;
+
+	public:
+		explicit TaskGroup(ThreadPool& pool)
+			: mPool(pool)
+		{
+		}
+
+		~TaskGroup() { Wait(); }
+
+		TaskGroup(const TaskGroup&) = delete;
+		TaskGroup& operator=(const TaskGroup&) = delete;
+
+		void Submit(ThreadPool::Task&& task);
+
+		// helps out with the pool's work meanwhile, fine to call from a task of the same pool
+		void Wait();
+	};
+}
@@ -1,9 +1,16 @@
 #include "Util.h"
 
 #include "Core.h"
+#include "VirtualFileSystem.h"
 
 std::string util::LoadStringFromFile(const std::string& filename)
 {
+	gold::FileView packed;
+	if (gold::vfs::Find(filename, packed))
+	{
+		return std::string(reinterpret_cast<const char*>(packed.data), packed.size);
+	}
+
 	std::ifstream f(filename);
 	std::string str;
 
@@ -35,3 +42,15 @@ uint32_t util::Hash(const void* data, size_t n, uint32_t hash)
 	}
 	return hash;
 }
+
+uint64_t util::Hash64(const void* data, size_t n, uint64_t hash)
+{
+	const uint64_t prime = 1099511628211ull;
+
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	for (size_t i = 0; i < n; i++)
+	{
+		hash = (hash ^ bytes[i]) * prime;
+	}
+	return hash;
+}
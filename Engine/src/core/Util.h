@@ -4,6 +4,10 @@
 #include <sstream>
 #include <functional>
 
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
 namespace core
 {
 	class Scene;
@@ -18,6 +22,30 @@ namespace util
 
 	uint32_t Hash(const void* data, size_t n, uint32_t hash = 2166136261u);
 
+	// 64 bit FNV-1a, pass the previous result as hash to continue over more data
+	uint64_t Hash64(const void* data, size_t n, uint64_t hash = 14695981039346656037ull);
+
+	// index of the lowest set bit, value must not be 0
+	inline uint32_t CountTrailingZeros(uint64_t value)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward64(&index, value);
+		return static_cast<uint32_t>(index);
+#else
+		return static_cast<uint32_t>(__builtin_ctzll(value));
+#endif
+	}
+
+	inline uint32_t PopCount(uint64_t value)
+	{
+#if defined(_MSC_VER)
+		return static_cast<uint32_t>(__popcnt64(value));
+#else
+		return static_cast<uint32_t>(__builtin_popcountll(value));
+#endif
+	}
+
 	struct Finally
 	{
 		std::function<void()> mAction;
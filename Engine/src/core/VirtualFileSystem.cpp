@@ -0,0 +1,75 @@
+#include "VirtualFileSystem.h"
+
+#include "Logging.h"
+#include "memory/Utils.h"
+
+#include <fstream>
+#include <shared_mutex>
+
+using namespace gold;
+
+// written while mounting, read from the update thread and every decode worker
+static std::shared_mutex kMountMutex;
+static std::vector<std::unique_ptr<PackFile>> kMountedPacks;
+
+bool vfs::Mount(const std::string& packPath)
+{
+	auto pack = std::make_unique<PackFile>();
+	if (!pack->Open(packPath))
+	{
+		return false;
+	}
+
+	G_ENGINE_INFO("Mounted {}: {} files, {} MB", packPath, pack->GetEntryCount(), pack->GetSize() / memory::MB);
+
+	std::unique_lock lock(kMountMutex);
+	kMountedPacks.insert(kMountedPacks.begin(), std::move(pack));
+	return true;
+}
+
+void vfs::UnmountAll()
+{
+	std::unique_lock lock(kMountMutex);
+	kMountedPacks.clear();
+}
+
+bool vfs::Find(const std::string& path, FileView& result)
+{
+	std::shared_lock lock(kMountMutex);
+	if (kMountedPacks.empty())
+	{
+		return false;
+	}
+
+	const std::string normalized = pack::NormalizePath(path);
+	for (const auto& pack : kMountedPacks)
+	{
+		if (pack->Find(normalized, result))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool vfs::ReadFile(const std::string& path, std::vector<u8>& result)
+{
+	FileView view;
+	if (Find(path, view))
+	{
+		result.assign(view.data, view.data + view.size);
+		return true;
+	}
+
+	std::ifstream stream(path, std::ios::in | std::ios::binary | std::ios::ate);
+	if (!stream)
+	{
+		return false;
+	}
+
+	result.resize(static_cast<u64>(stream.tellg()));
+	stream.seekg(0);
+	stream.read(reinterpret_cast<char*>(result.data()), result.size());
+	return static_cast<bool>(stream);
+}
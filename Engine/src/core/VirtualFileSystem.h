@@ -0,0 +1,19 @@
+#pragma once
+
+#include "Core.h"
+#include "memory/PackFile.h"
+
+// Resolves content paths through mounted archives before falling back to loose files, so shipping
+// content is one mapping instead of an open/stat/read per file. Mount at startup, before any loading starts
+namespace gold::vfs
+{
+	// archives mounted later are searched first, returns false when the archive cannot be opened
+	bool Mount(const std::string& packPath);
+	void UnmountAll();
+
+	// mounted archives only. The view stays valid until UnmountAll
+	bool Find(const std::string& path, FileView& result);
+
+	// mounted archives first, then the file on disk. Returns false when neither has it
+	bool ReadFile(const std::string& path, std::vector<u8>& result);
+}
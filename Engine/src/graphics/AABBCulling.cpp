@@ -0,0 +1,360 @@
+#include "AABBCulling.h"
+
+#include "core/ThreadPool.h"
+
+// eight boxes at a time with AVX, four with SSE, same result as the scalar path
+#if defined(__AVX__)
+#define AABB_CULLING_USE_AVX 1
+#include <immintrin.h>
+#elif defined(_M_X64) || defined(__SSE2__)
+#define AABB_CULLING_USE_SSE 1
+#include <emmintrin.h>
+#endif
+
+using namespace graphics;
+
+STATIC_ASSERT(64 % AABBSet::kBatch == 0, "A batch must not straddle two visibility words!");
+
+static constexpr f32 kMax = std::numeric_limits<f32>::max();
+static constexpr f32 kLowest = std::numeric_limits<f32>::lowest();
+
+void AABBSet::Clear()
+{
+	mCount = 0;
+	mMinX.clear();
+	mMinY.clear();
+	mMinZ.clear();
+	mMaxX.clear();
+	mMaxY.clear();
+	mMaxZ.clear();
+}
+
+void AABBSet::Resize(u32 count)
+{
+	const u32 padded = (count + kBatch - 1) / kBatch * kBatch;
+	mMinX.resize(padded);
+	mMinY.resize(padded);
+	mMinZ.resize(padded);
+	mMaxX.resize(padded);
+	mMaxY.resize(padded);
+	mMaxZ.resize(padded);
+
+	// new boxes and padding start out inverted, outside every frustum
+	for (u32 i = std::min(count, mCount); i < padded; ++i)
+	{
+		mMinX[i] = mMinY[i] = mMinZ[i] = kMax;
+		mMaxX[i] = mMaxY[i] = mMaxZ[i] = kLowest;
+	}
+
+	mCount = count;
+}
+
+u32 AABBSet::Add(const AABB& aabb)
+{
+	const u32 index = mCount;
+	Resize(mCount + 1);
+	Set(index, aabb);
+	return index;
+}
+
+void AABBSet::Set(u32 index, const AABB& aabb)
+{
+	DEBUG_ASSERT(index < mCount, "Box index out of range!");
+
+	if (aabb.min.x > aabb.max.x || aabb.min.y > aabb.max.y || aabb.min.z > aabb.max.z)
+	{
+		mMinX[index] = mMinY[index] = mMinZ[index] = kLowest;
+		mMaxX[index] = mMaxY[index] = mMaxZ[index] = kMax;
+		return;
+	}
+
+	mMinX[index] = aabb.min.x;
+	mMinY[index] = aabb.min.y;
+	mMinZ[index] = aabb.min.z;
+	mMaxX[index] = aabb.max.x;
+	mMaxY[index] = aabb.max.y;
+	mMaxZ[index] = aabb.max.z;
+}
+
+void AABBSet::SetEmpty(u32 index)
+{
+	DEBUG_ASSERT(index < mCount, "Box index out of range!");
+
+	mMinX[index] = mMinY[index] = mMinZ[index] = kMax;
+	mMaxX[index] = mMaxY[index] = mMaxZ[index] = kLowest;
+}
+
+AABB AABBSet::Get(u32 index) const
+{
+	DEBUG_ASSERT(index < mCount, "Box index out of range!");
+	return { { mMinX[index], mMinY[index], mMinZ[index] }, { mMaxX[index], mMaxY[index], mMaxZ[index] } };
+}
+
+void VisibilityBits::Reset(u32 count)
+{
+	mCount = count;
+	mWords.assign((count + 63) / 64, 0);
+}
+
+u32 VisibilityBits::CountSet() const
+{
+	u32 result = 0;
+	for (u64 word : mWords)
+	{
+		result += util::PopCount(word);
+	}
+	return result;
+}
+
+CullFrustum::CullFrustum(const glm::mat4& viewProj)
+{
+	const glm::mat4 rows = glm::transpose(viewProj);
+	mPlanes =
+	{
+		rows[3] + rows[0],
+		rows[3] - rows[0],
+		rows[3] + rows[1],
+		rows[3] - rows[1],
+		rows[3] + rows[2],
+		rows[3] - rows[2],
+	};
+
+	mBounds.min = glm::vec3(kMax);
+	mBounds.max = glm::vec3(kLowest);
+
+	const glm::mat4 viewProjInv = glm::inverse(viewProj);
+	for (f32 z : { -1.0f, 1.0f })
+	{
+		for (f32 y : { -1.0f, 1.0f })
+		{
+			for (f32 x : { -1.0f, 1.0f })
+			{
+				const glm::vec4 corner = viewProjInv * glm::vec4(x, y, z, 1.0f);
+				const glm::vec3 world = glm::vec3(corner) / corner.w;
+
+				mBounds.min = glm::min(mBounds.min, world);
+				mBounds.max = glm::max(mBounds.max, world);
+			}
+		}
+	}
+}
+
+// the box fields each plane reads, the corner furthest along its normal
+struct PlaneCorners
+{
+	std::array<const f32*, 6> mX;
+	std::array<const f32*, 6> mY;
+	std::array<const f32*, 6> mZ;
+
+	PlaneCorners(const CullFrustum& frustum, const AABBSet& boxes)
+	{
+		for (u32 i = 0; i < 6; ++i)
+		{
+			const glm::vec4& plane = frustum.mPlanes[i];
+			mX[i] = plane.x >= 0.0f ? boxes.mMaxX.data() : boxes.mMinX.data();
+			mY[i] = plane.y >= 0.0f ? boxes.mMaxY.data() : boxes.mMinY.data();
+			mZ[i] = plane.z >= 0.0f ? boxes.mMaxZ.data() : boxes.mMinZ.data();
+		}
+	}
+};
+
+static bool IsVisible(const CullFrustum& frustum, const glm::vec3& min, const glm::vec3& max)
+{
+	for (const glm::vec4& plane : frustum.mPlanes)
+	{
+		const f32 x = plane.x >= 0.0f ? max.x : min.x;
+		const f32 y = plane.y >= 0.0f ? max.y : min.y;
+		const f32 z = plane.z >= 0.0f ? max.z : min.z;
+
+		if ((plane.x * x + plane.y * y) + (plane.z * z + plane.w) < 0.0f)
+		{
+			return false;
+		}
+	}
+
+	const AABB& bounds = frustum.mBounds;
+	return !(bounds.min.x > max.x || bounds.min.y > max.y || bounds.min.z > max.z ||
+			 bounds.max.x < min.x || bounds.max.y < min.y || bounds.max.z < min.z);
+}
+
+#if defined(AABB_CULLING_USE_SSE)
+// four boxes starting at base, bit n set when box base + n is visible
+static u32 CullQuad(const CullFrustum& frustum, const PlaneCorners& corners, const AABBSet& boxes, u32 base)
+{
+	__m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+	for (u32 i = 0; i < 6; ++i)
+	{
+		const glm::vec4& plane = frustum.mPlanes[i];
+		const __m128 xy = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), _mm_loadu_ps(corners.mX[i] + base)),
+									 _mm_mul_ps(_mm_set1_ps(plane.y), _mm_loadu_ps(corners.mY[i] + base)));
+		const __m128 zw = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.z), _mm_loadu_ps(corners.mZ[i] + base)), _mm_set1_ps(plane.w));
+
+		// not less than rather than greater equal, so a NaN stays visible like in the scalar test
+		visible = _mm_and_ps(visible, _mm_cmpnlt_ps(_mm_add_ps(xy, zw), _mm_setzero_ps()));
+	}
+
+	const AABB& bounds = frustum.mBounds;
+	visible = _mm_and_ps(visible, _mm_cmpngt_ps(_mm_set1_ps(bounds.min.x), _mm_loadu_ps(&boxes.mMaxX[base])));
+	visible = _mm_and_ps(visible, _mm_cmpngt_ps(_mm_set1_ps(bounds.min.y), _mm_loadu_ps(&boxes.mMaxY[base])));
+	visible = _mm_and_ps(visible, _mm_cmpngt_ps(_mm_set1_ps(bounds.min.z), _mm_loadu_ps(&boxes.mMaxZ[base])));
+	visible = _mm_and_ps(visible, _mm_cmpnlt_ps(_mm_set1_ps(bounds.max.x), _mm_loadu_ps(&boxes.mMinX[base])));
+	visible = _mm_and_ps(visible, _mm_cmpnlt_ps(_mm_set1_ps(bounds.max.y), _mm_loadu_ps(&boxes.mMinY[base])));
+	visible = _mm_and_ps(visible, _mm_cmpnlt_ps(_mm_set1_ps(bounds.max.z), _mm_loadu_ps(&boxes.mMinZ[base])));
+
+	return static_cast<u32>(_mm_movemask_ps(visible));
+}
+#endif
+
+// kBatch boxes starting at base, bit n set when box base + n is visible
+static u32 CullBatch(const CullFrustum& frustum, const PlaneCorners& corners, const AABBSet& boxes, u32 base)
+{
+#if defined(AABB_CULLING_USE_AVX)
+	__m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+	for (u32 i = 0; i < 6; ++i)
+	{
+		const glm::vec4& plane = frustum.mPlanes[i];
+		const __m256 xy = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.x), _mm256_loadu_ps(corners.mX[i] + base)),
+										_mm256_mul_ps(_mm256_set1_ps(plane.y), _mm256_loadu_ps(corners.mY[i] + base)));
+		const __m256 zw = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.z), _mm256_loadu_ps(corners.mZ[i] + base)), _mm256_set1_ps(plane.w));
+
+		// not less than rather than greater equal, so a NaN stays visible like in the scalar test
+		visible = _mm256_and_ps(visible, _mm256_cmp_ps(_mm256_add_ps(xy, zw), _mm256_setzero_ps(), _CMP_NLT_UQ));
+	}
+
+	const AABB& bounds = frustum.mBounds;
+	visible = _mm256_and_ps(visible, _mm256_cmp_ps(_mm256_set1_ps(bounds.min.x), _mm256_loadu_ps(&boxes.mMaxX[base]), _CMP_NGT_UQ));
+	visible = _mm256_and_ps(visible, _mm256_cmp_ps(_mm256_set1_ps(bounds.min.y), _mm256_loadu_ps(&boxes.mMaxY[base]), _CMP_NGT_UQ));
+	visible = _mm256_and_ps(visible, _mm256_cmp_ps(_mm256_set1_ps(bounds.min.z), _mm256_loadu_ps(&boxes.mMaxZ[base]), _CMP_NGT_UQ));
+	visible = _mm256_and_ps(visible, _mm256_cmp_ps(_mm256_set1_ps(bounds.max.x), _mm256_loadu_ps(&boxes.mMinX[base]), _CMP_NLT_UQ));
+	visible = _mm256_and_ps(visible, _mm256_cmp_ps(_mm256_set1_ps(bounds.max.y), _mm256_loadu_ps(&boxes.mMinY[base]), _CMP_NLT_UQ));
+	visible = _mm256_and_ps(visible, _mm256_cmp_ps(_mm256_set1_ps(bounds.max.z), _mm256_loadu_ps(&boxes.mMinZ[base]), _CMP_NLT_UQ));
+
+	return static_cast<u32>(_mm256_movemask_ps(visible));
+#elif defined(AABB_CULLING_USE_SSE)
+	return CullQuad(frustum, corners, boxes, base) | (CullQuad(frustum, corners, boxes, base + 4) << 4);
+#else
+	UNUSED_VAR(corners);
+
+	u32 result = 0;
+	for (u32 i = 0; i < AABBSet::kBatch; ++i)
+	{
+		const u32 index = base + i;
+		const glm::vec3 min(boxes.mMinX[index], boxes.mMinY[index], boxes.mMinZ[index]);
+		const glm::vec3 max(boxes.mMaxX[index], boxes.mMaxY[index], boxes.mMaxZ[index]);
+		result |= IsVisible(frustum, min, max) ? 1u << i : 0u;
+	}
+	return result;
+#endif
+}
+
+// fills visibility words [firstWord, lastWord), 64 boxes each
+static void CullWords(const CullFrustum& frustum, const AABBSet& boxes, u32 firstWord, u32 lastWord, u64* words)
+{
+	const PlaneCorners corners(frustum, boxes);
+	const u32 padded = static_cast<u32>(boxes.mMinX.size());
+
+	for (u32 word = firstWord; word < lastWord; ++word)
+	{
+		const u32 first = word * 64;
+		const u32 last = std::min(first + 64, padded);
+
+		u64 bits = 0;
+		for (u32 base = first; base < last; base += AABBSet::kBatch)
+		{
+			bits |= static_cast<u64>(CullBatch(frustum, corners, boxes, base)) << (base - first);
+		}
+		words[word] = bits;
+	}
+}
+
+AABB graphics::TransformAABB(const AABB& aabb, const glm::mat4& transform)
+{
+	// the transformed center plus the extent along each axis every rotated half extent adds up to
+	const glm::vec3 center = (aabb.min + aabb.max) * 0.5f;
+	const glm::vec3 extent = (aabb.max - aabb.min) * 0.5f;
+
+	const glm::vec3 worldCenter = glm::vec3(transform * glm::vec4(center, 1.0f));
+	const glm::vec3 worldExtent = glm::abs(glm::vec3(transform[0])) * extent.x
+								+ glm::abs(glm::vec3(transform[1])) * extent.y
+								+ glm::abs(glm::vec3(transform[2])) * extent.z;
+
+	return { worldCenter - worldExtent, worldCenter + worldExtent };
+}
+
+bool graphics::IsAABBVisible(const CullFrustum& frustum, const AABB& aabb)
+{
+	return IsVisible(frustum, aabb.min, aabb.max);
+}
+
+FrustumTest graphics::ClassifyAABB(const CullFrustum& frustum, const AABB& aabb)
+{
+	if (!IsVisible(frustum, aabb.min, aabb.max))
+	{
+		return FrustumTest::OUTSIDE;
+	}
+
+	// the corner nearest along each normal decides whether the box reaches behind the plane
+	for (const glm::vec4& plane : frustum.mPlanes)
+	{
+		const f32 x = plane.x >= 0.0f ? aabb.min.x : aabb.max.x;
+		const f32 y = plane.y >= 0.0f ? aabb.min.y : aabb.max.y;
+		const f32 z = plane.z >= 0.0f ? aabb.min.z : aabb.max.z;
+
+		if ((plane.x * x + plane.y * y) + (plane.z * z + plane.w) < 0.0f)
+		{
+			return FrustumTest::INTERSECTS;
+		}
+	}
+
+	return FrustumTest::INSIDE;
+}
+
+void graphics::CullAABBs(const CullFrustum& frustum, const AABBSet& boxes, VisibilityBits& visible)
+{
+	CullAABBs(frustum, boxes, visible, nullptr);
+}
+
+void graphics::CullAABBs(const CullFrustum& frustum, const AABBSet& boxes, VisibilityBits& visible, gold::ThreadPool* pool)
+{
+	visible.Reset(boxes.mCount);
+
+	const u32 wordCount = visible.GetWordCount();
+	u64* words = visible.GetWords();
+
+	// tasks own whole words, no two of them write the same one
+	if (pool && boxes.mCount > kAABBsPerTask)
+	{
+		pool->ParallelFor(0, wordCount, [&frustum, &boxes, words](u32 first, u32 last)
+		{
+			CullWords(frustum, boxes, first, last, words);
+		}, kAABBsPerTask / 64);
+	}
+	else
+	{
+		CullWords(frustum, boxes, 0, wordCount, words);
+	}
+
+	// padding is inverted and never visible, masked anyway so nothing past the count can show up
+	if (boxes.mCount % 64 != 0)
+	{
+		words[wordCount - 1] &= (1ull << (boxes.mCount % 64)) - 1;
+	}
+}
+
+void graphics::CullAABBRange(const CullFrustum& frustum, const AABBSet& boxes, u32 first, u32 last, VisibilityBits& visible)
+{
+	DEBUG_ASSERT(last <= boxes.mCount && visible.GetCount() == boxes.mCount, "Range outside the set or bits not reset!");
+
+	const PlaneCorners corners(frustum, boxes);
+	u64* words = visible.GetWords();
+
+	for (u32 base = first / AABBSet::kBatch * AABBSet::kBatch; base < last; base += AABBSet::kBatch)
+	{
+		// the batch may reach outside the range at either end, those bits belong to other callers
+		const u32 low = std::max(first, base) - base;
+		const u32 high = std::min(last, base + AABBSet::kBatch) - base;
+		const u32 mask = ((1u << high) - 1) & ~((1u << low) - 1);
+
+		words[base / 64] |= static_cast<u64>(CullBatch(frustum, corners, boxes, base) & mask) << (base % 64);
+	}
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "core/Core.h"
+#include "core/Util.h"
+
+#include "FrustumCuller.h"
+
+namespace gold
+{
+	class ThreadPool;
+}
+
+namespace graphics
+{
+	// world space boxes, one array per field so kBatch boxes are tested at once. Padded with inverted boxes
+	struct AABBSet
+	{
+		static constexpr u32 kBatch = 8;
+
+		u32 mCount = 0;
+		std::vector<f32> mMinX, mMinY, mMinZ;
+		std::vector<f32> mMaxX, mMaxY, mMaxZ;
+
+		void Clear();
+		void Resize(u32 count);
+
+		// returns the index of the box. Inverted boxes (min > max) are stored as covering everything, an object
+		// with broken bounds is drawn rather than lost
+		u32 Add(const AABB& aabb);
+		void Set(u32 index, const AABB& aabb);
+
+		// stores an inverted box like the padding, for entries without bounds that no view should see
+		void SetEmpty(u32 index);
+
+		AABB Get(u32 index) const;
+	};
+
+	// one bit per object of a view, set when visible
+	class VisibilityBits
+	{
+	private:
+		std::vector<u64> mWords;
+		u32 mCount = 0;
+
+	public:
+		// resizes and clears every bit
+		void Reset(u32 count);
+
+		u32 GetCount() const { return mCount; }
+		u32 GetWordCount() const { return static_cast<u32>(mWords.size()); }
+
+		u64* GetWords() { return mWords.data(); }
+		const u64* GetWords() const { return mWords.data(); }
+
+		void Set(u32 index) { mWords[index / 64] |= 1ull << (index % 64); }
+		bool Test(u32 index) const { return (mWords[index / 64] >> (index % 64)) & 1; }
+
+		u32 CountSet() const;
+
+		// calls function(index) for every set bit in ascending order
+		template<typename Function>
+		void ForEachSet(Function&& function) const
+		{
+			for (u32 word = 0; word < mWords.size(); ++word)
+			{
+				u64 bits = mWords[word];
+				while (bits)
+				{
+					function(word * 64 + util::CountTrailingZeros(bits));
+					bits &= bits - 1;
+				}
+			}
+		}
+	};
+
+	// what a view needs to cull boxes, built once per view
+	struct CullFrustum
+	{
+		// as the view projection gives them, not normalized. A box is outside a plane when its corner furthest
+		// along the plane normal is behind it
+		std::array<glm::vec4, 6> mPlanes{};
+
+		// world space box around the frustum corners, boxes entirely to one side of it are outside as well. This
+		// catches large boxes near the frustum edges that no single plane rejects
+		AABB mBounds{};
+
+		CullFrustum() = default;
+		explicit CullFrustum(const glm::mat4& viewProj);
+	};
+
+	// box around aabb moved by an affine transform, the same as transforming its eight corners. An inverted box
+	// stays inverted
+	AABB TransformAABB(const AABB& aabb, const glm::mat4& transform);
+
+	// same test as FrustumCuller::FrustumCulled
+	bool IsAABBVisible(const CullFrustum& frustum, const AABB& aabb);
+
+	// OUTSIDE exactly when IsAABBVisible fails, INSIDE when the whole box is in front of every plane
+	enum class FrustumTest : u8 { OUTSIDE, INTERSECTS, INSIDE };
+	FrustumTest ClassifyAABB(const CullFrustum& frustum, const AABB& aabb);
+
+	// sets the bit of every box of boxes that is inside or intersecting the frustum, visible is reset to the box count
+	void CullAABBs(const CullFrustum& frustum, const AABBSet& boxes, VisibilityBits& visible);
+
+	// as above, spread over pool in ranges of at least kAABBsPerTask boxes. A null pool culls on the calling thread
+	static constexpr u32 kAABBsPerTask = 4096;
+	void CullAABBs(const CullFrustum& frustum, const AABBSet& boxes, VisibilityBits& visible, gold::ThreadPool* pool);
+
+	// sets the bits of the visible boxes in [first, last) and leaves every other bit alone, visible must already
+	// be reset to the box count. For culling parts of a set, ranges do not need to line up with batches
+	void CullAABBRange(const CullFrustum& frustum, const AABBSet& boxes, u32 first, u32 last, VisibilityBits& visible);
+}
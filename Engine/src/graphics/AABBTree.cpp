@@ -0,0 +1,323 @@
+#include "AABBTree.h"
+
+using namespace graphics;
+
+static AABB Combine(const AABB& a, const AABB& b)
+{
+	return { glm::min(a.min, b.min), glm::max(a.max, b.max) };
+}
+
+static bool Contains(const AABB& outer, const AABB& inner)
+{
+	return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y && outer.min.z <= inner.min.z &&
+		   outer.max.x >= inner.max.x && outer.max.y >= inner.max.y && outer.max.z >= inner.max.z;
+}
+
+static f32 SurfaceArea(const AABB& aabb)
+{
+	const glm::vec3 size = aabb.max - aabb.min;
+	return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+AABBTree::AABBTree(f32 margin)
+	: mMargin(margin)
+{
+}
+
+u32 AABBTree::AllocateNode()
+{
+	if (mFreeList == kNullNode)
+	{
+		mNodes.emplace_back();
+		return static_cast<u32>(mNodes.size() - 1);
+	}
+
+	const u32 node = mFreeList;
+	mFreeList = mNodes[node].parent;
+	mNodes[node] = Node{};
+	return node;
+}
+
+void AABBTree::FreeNode(u32 node)
+{
+	mNodes[node].parent = mFreeList;
+	mNodes[node].height = -1;
+	mFreeList = node;
+}
+
+AABB AABBTree::Fatten(const AABB& aabb) const
+{
+	return { aabb.min - glm::vec3(mMargin), aabb.max + glm::vec3(mMargin) };
+}
+
+u32 AABBTree::CreateProxy(const AABB& aabb, u32 userData)
+{
+	const u32 proxy = AllocateNode();
+
+	Node& node = mNodes[proxy];
+	node.aabb = Fatten(aabb);
+	node.userData = userData;
+	node.height = 0;
+
+	InsertLeaf(proxy);
+	++mProxyCount;
+
+	return proxy;
+}
+
+void AABBTree::DestroyProxy(u32 proxy)
+{
+	DEBUG_ASSERT(proxy < mNodes.size() && mNodes[proxy].IsLeaf() && mNodes[proxy].height == 0, "Not a proxy of this tree!");
+
+	RemoveLeaf(proxy);
+	FreeNode(proxy);
+	--mProxyCount;
+}
+
+bool AABBTree::MoveProxy(u32 proxy, const AABB& aabb)
+{
+	DEBUG_ASSERT(proxy < mNodes.size() && mNodes[proxy].IsLeaf() && mNodes[proxy].height == 0, "Not a proxy of this tree!");
+
+	// a box that shrank a lot is refit as well, a loose leaf makes every query above it visit more nodes
+	const AABB fat = Fatten(aabb);
+	const AABB& current = mNodes[proxy].aabb;
+	if (Contains(current, aabb) && SurfaceArea(current) <= 4.0f * SurfaceArea(fat))
+	{
+		return false;
+	}
+
+	const u32 parent = mNodes[proxy].parent;
+	if (parent != kNullNode && Contains(mNodes[parent].aabb, fat))
+	{
+		// still inside the parent, the structure stays as it is and only the boxes above shrink
+		mNodes[proxy].aabb = fat;
+		Refit(parent);
+		return true;
+	}
+
+	RemoveLeaf(proxy);
+	mNodes[proxy].aabb = fat;
+	InsertLeaf(proxy);
+	return true;
+}
+
+void AABBTree::Clear()
+{
+	mNodes.clear();
+	mRoot = kNullNode;
+	mFreeList = kNullNode;
+	mProxyCount = 0;
+}
+
+void AABBTree::InsertLeaf(u32 leaf)
+{
+	if (mRoot == kNullNode)
+	{
+		mRoot = leaf;
+		mNodes[leaf].parent = kNullNode;
+		return;
+	}
+
+	// walk down towards the sibling that adds the least surface area
+	const AABB leafAABB = mNodes[leaf].aabb;
+
+	u32 index = mRoot;
+	while (!mNodes[index].IsLeaf())
+	{
+		const Node& node = mNodes[index];
+
+		const f32 area = SurfaceArea(node.aabb);
+		const f32 combinedArea = SurfaceArea(Combine(node.aabb, leafAABB));
+
+		// a new parent for this node and the leaf
+		const f32 cost = 2.0f * combinedArea;
+
+		const f32 inheritanceCost = 2.0f * (combinedArea - area);
+
+		const auto descendCost = [this, &leafAABB, inheritanceCost](u32 child)
+		{
+			const Node& childNode = mNodes[child];
+			const f32 combined = SurfaceArea(Combine(leafAABB, childNode.aabb));
+			return (childNode.IsLeaf() ? combined : combined - SurfaceArea(childNode.aabb)) + inheritanceCost;
+		};
+
+		const f32 cost1 = descendCost(node.child1);
+		const f32 cost2 = descendCost(node.child2);
+
+		if (cost < cost1 && cost < cost2)
+		{
+			break;
+		}
+
+		index = cost1 < cost2 ? node.child1 : node.child2;
+	}
+
+	const u32 sibling = index;
+	const u32 oldParent = mNodes[sibling].parent;
+
+	const u32 newParent = AllocateNode();
+	mNodes[newParent].parent = oldParent;
+	mNodes[newParent].aabb = Combine(leafAABB, mNodes[sibling].aabb);
+	mNodes[newParent].height = mNodes[sibling].height + 1;
+	mNodes[newParent].child1 = sibling;
+	mNodes[newParent].child2 = leaf;
+
+	if (oldParent != kNullNode)
+	{
+		(mNodes[oldParent].child1 == sibling ? mNodes[oldParent].child1 : mNodes[oldParent].child2) = newParent;
+	}
+	else
+	{
+		mRoot = newParent;
+	}
+
+	mNodes[sibling].parent = newParent;
+	mNodes[leaf].parent = newParent;
+
+	Refit(newParent);
+}
+
+void AABBTree::RemoveLeaf(u32 leaf)
+{
+	if (leaf == mRoot)
+	{
+		mRoot = kNullNode;
+		return;
+	}
+
+	const u32 parent = mNodes[leaf].parent;
+	const u32 grandParent = mNodes[parent].parent;
+	const u32 sibling = mNodes[parent].child1 == leaf ? mNodes[parent].child2 : mNodes[parent].child1;
+
+	// the sibling takes the parent's place
+	FreeNode(parent);
+	mNodes[sibling].parent = grandParent;
+
+	if (grandParent == kNullNode)
+	{
+		mRoot = sibling;
+		return;
+	}
+
+	(mNodes[grandParent].child1 == parent ? mNodes[grandParent].child1 : mNodes[grandParent].child2) = sibling;
+	Refit(grandParent);
+}
+
+void AABBTree::Refit(u32 node)
+{
+	u32 index = node;
+	while (index != kNullNode)
+	{
+		index = Balance(index);
+
+		Node& current = mNodes[index];
+		const Node& child1 = mNodes[current.child1];
+		const Node& child2 = mNodes[current.child2];
+
+		current.height = 1 + std::max(child1.height, child2.height);
+		current.aabb = Combine(child1.aabb, child2.aabb);
+
+		index = current.parent;
+	}
+}
+
+u32 AABBTree::Balance(u32 indexA)
+{
+	Node& a = mNodes[indexA];
+	if (a.IsLeaf() || a.height < 2)
+	{
+		return indexA;
+	}
+
+	const u32 indexB = a.child1;
+	const u32 indexC = a.child2;
+	Node& b = mNodes[indexB];
+	Node& c = mNodes[indexC];
+
+	const i32 balance = c.height - b.height;
+
+	// the taller child replaces a, a takes the shorter grandchild
+	const auto rotateUp = [this, indexA, &a](u32 indexUp, Node& up, u32& aSlot, Node& kept)
+	{
+		const u32 indexF = up.child1;
+		const u32 indexG = up.child2;
+		Node& f = mNodes[indexF];
+		Node& g = mNodes[indexG];
+
+		up.child1 = indexA;
+		up.parent = a.parent;
+		a.parent = indexUp;
+
+		if (up.parent != kNullNode)
+		{
+			Node& parent = mNodes[up.parent];
+			(parent.child1 == indexA ? parent.child1 : parent.child2) = indexUp;
+		}
+		else
+		{
+			mRoot = indexUp;
+		}
+
+		const bool fTaller = f.height > g.height;
+		const u32 indexTall = fTaller ? indexF : indexG;
+		const u32 indexShort = fTaller ? indexG : indexF;
+		Node& tall = mNodes[indexTall];
+		Node& shortNode = mNodes[indexShort];
+
+		up.child2 = indexTall;
+		aSlot = indexShort;
+		shortNode.parent = indexA;
+
+		a.aabb = Combine(kept.aabb, shortNode.aabb);
+		up.aabb = Combine(a.aabb, tall.aabb);
+
+		a.height = 1 + std::max(kept.height, shortNode.height);
+		up.height = 1 + std::max(a.height, tall.height);
+	};
+
+	if (balance > 1)
+	{
+		rotateUp(indexC, c, a.child2, b);
+		return indexC;
+	}
+
+	if (balance < -1)
+	{
+		rotateUp(indexB, b, a.child1, c);
+		return indexB;
+	}
+
+	return indexA;
+}
+
+bool AABBTree::OverlapsAABB(const AABB& a, const AABB& b)
+{
+	return a.min.x <= b.max.x && a.min.y <= b.max.y && a.min.z <= b.max.z &&
+		   a.max.x >= b.min.x && a.max.y >= b.min.y && a.max.z >= b.min.z;
+}
+
+bool AABBTree::OverlapsSphere(const AABB& aabb, const glm::vec3& center, f32 radius)
+{
+	const glm::vec3 closest = glm::clamp(center, aabb.min, aabb.max);
+	const glm::vec3 offset = closest - center;
+	return glm::dot(offset, offset) <= radius * radius;
+}
+
+bool AABBTree::IntersectRay(const AABB& aabb, const glm::vec3& origin, const glm::vec3& inverseDirection, f32 maxDistance, f32& distance)
+{
+	// an axis the ray runs parallel to gives infinite distances, which the min and max sort out. The NaN of a
+	// ray starting exactly on such a slab is dropped by std::min and std::max keeping their first argument
+	f32 enter = 0.0f;
+	f32 exit = maxDistance;
+	for (u32 axis = 0; axis < 3; ++axis)
+	{
+		const f32 t1 = (aabb.min[axis] - origin[axis]) * inverseDirection[axis];
+		const f32 t2 = (aabb.max[axis] - origin[axis]) * inverseDirection[axis];
+
+		enter = std::max(enter, std::min(t1, t2));
+		exit = std::min(exit, std::max(t1, t2));
+	}
+
+	distance = enter;
+	return enter <= exit;
+}
@@ -0,0 +1,252 @@
+#pragma once
+
+#include "core/Core.h"
+
+#include "AABBCulling.h"
+
+namespace graphics
+{
+	// dynamic bounding volume hierarchy, leaves are fattened by a margin so small moves leave the tree alone
+	class AABBTree
+	{
+	public:
+		static constexpr u32 kNullNode = ~0u;
+
+	private:
+		struct Node
+		{
+			AABB aabb{};
+
+			// next free node while on the free list
+			u32 parent = kNullNode;
+
+			u32 child1 = kNullNode;
+			u32 child2 = kNullNode;
+
+			// leaves are 0, free nodes -1
+			i32 height = -1;
+
+			u32 userData = 0;
+
+			bool IsLeaf() const { return child1 == kNullNode; }
+		};
+
+		// the balance keeps the height around 1.44 log2 of the leaf count, far below this for any scene
+		static constexpr u32 kStackSize = 128;
+
+		std::vector<Node> mNodes;
+		u32 mRoot = kNullNode;
+		u32 mFreeList = kNullNode;
+		u32 mProxyCount = 0;
+
+		f32 mMargin;
+
+		u32 AllocateNode();
+		void FreeNode(u32 node);
+
+		void InsertLeaf(u32 leaf);
+		void RemoveLeaf(u32 leaf);
+
+		// rotates the taller grandchild up when the children of node differ in height by more than one, returns
+		// the node now in its place
+		u32 Balance(u32 node);
+
+		// recomputes boxes and heights from node up to the root
+		void Refit(u32 node);
+
+		AABB Fatten(const AABB& aabb) const;
+
+	public:
+		// margin is added on every side of a leaf's box
+		explicit AABBTree(f32 margin = 0.1f);
+
+		// returns the proxy of the new leaf, stable until it is destroyed
+		u32 CreateProxy(const AABB& aabb, u32 userData);
+		void DestroyProxy(u32 proxy);
+
+		// returns whether the tree changed, false when aabb still fits the fattened box
+		bool MoveProxy(u32 proxy, const AABB& aabb);
+
+		u32 GetUserData(u32 proxy) const { return mNodes[proxy].userData; }
+		void SetUserData(u32 proxy, u32 userData) { mNodes[proxy].userData = userData; }
+
+		const AABB& GetFatAABB(u32 proxy) const { return mNodes[proxy].aabb; }
+
+		u32 GetProxyCount() const { return mProxyCount; }
+		i32 GetHeight() const { return mRoot == kNullNode ? 0 : mNodes[mRoot].height; }
+
+		void Clear();
+
+		// every query reports the userData of the leaves whose fattened box passes the test, callers test the
+		// exact bounds themselves when they need to
+		template<typename Function>
+		void QueryAABB(const AABB& aabb, Function&& function) const
+		{
+			Traverse([&aabb](const AABB& box) { return OverlapsAABB(box, aabb); }, function);
+		}
+
+		template<typename Function>
+		void QuerySphere(const glm::vec3& center, f32 radius, Function&& function) const
+		{
+			Traverse([&center, radius](const AABB& box) { return OverlapsSphere(box, center, radius); }, function);
+		}
+
+		// subtrees entirely inside the frustum are reported without testing the leaves below
+		template<typename Function>
+		void QueryFrustum(const CullFrustum& frustum, Function&& function) const
+		{
+			if (mRoot == kNullNode)
+			{
+				return;
+			}
+
+			u32 stack[kStackSize];
+			u32 count = 0;
+			stack[count++] = mRoot;
+
+			while (count > 0)
+			{
+				const u32 index = stack[--count];
+				const Node& node = mNodes[index];
+
+				const FrustumTest test = ClassifyAABB(frustum, node.aabb);
+				if (test == FrustumTest::OUTSIDE)
+				{
+					continue;
+				}
+
+				if (test == FrustumTest::INSIDE)
+				{
+					ForEachLeaf(index, function);
+				}
+				else if (node.IsLeaf())
+				{
+					function(node.userData);
+				}
+				else
+				{
+					DEBUG_ASSERT(count + 2 <= kStackSize, "AABBTree query stack overflow!");
+					stack[count++] = node.child2;
+					stack[count++] = node.child1;
+				}
+			}
+		}
+
+		// function(userData, maxDistance) returns the new maximum distance: the hit distance to only look for
+		// closer leaves, maxDistance to keep going or 0 to stop. Nearer children are visited first
+		template<typename Function>
+		void RayCast(const glm::vec3& origin, const glm::vec3& direction, f32 maxDistance, Function&& function) const
+		{
+			if (mRoot == kNullNode)
+			{
+				return;
+			}
+
+			const glm::vec3 inverseDirection = 1.0f / direction;
+
+			u32 stack[kStackSize];
+			u32 count = 0;
+			stack[count++] = mRoot;
+
+			while (count > 0 && maxDistance > 0.0f)
+			{
+				const Node& node = mNodes[stack[--count]];
+
+				f32 distance;
+				if (!IntersectRay(node.aabb, origin, inverseDirection, maxDistance, distance))
+				{
+					continue;
+				}
+
+				if (node.IsLeaf())
+				{
+					maxDistance = std::min(maxDistance, function(node.userData, maxDistance));
+					continue;
+				}
+
+				f32 distance1 = 0.0f, distance2 = 0.0f;
+				const bool hit1 = IntersectRay(mNodes[node.child1].aabb, origin, inverseDirection, maxDistance, distance1);
+				const bool hit2 = IntersectRay(mNodes[node.child2].aabb, origin, inverseDirection, maxDistance, distance2);
+
+				// the nearer child goes on top
+				DEBUG_ASSERT(count + 2 <= kStackSize, "AABBTree query stack overflow!");
+				if (hit1 && hit2)
+				{
+					stack[count++] = distance1 <= distance2 ? node.child2 : node.child1;
+					stack[count++] = distance1 <= distance2 ? node.child1 : node.child2;
+				}
+				else if (hit1)
+				{
+					stack[count++] = node.child1;
+				}
+				else if (hit2)
+				{
+					stack[count++] = node.child2;
+				}
+			}
+		}
+
+		static bool OverlapsAABB(const AABB& a, const AABB& b);
+		static bool OverlapsSphere(const AABB& aabb, const glm::vec3& center, f32 radius);
+
+		// slab test, distance is where the ray enters the box (0 when it starts inside)
+		static bool IntersectRay(const AABB& aabb, const glm::vec3& origin, const glm::vec3& inverseDirection, f32 maxDistance, f32& distance);
+
+	private:
+		template<typename Overlaps, typename Function>
+		void Traverse(Overlaps&& overlaps, Function& function) const
+		{
+			if (mRoot == kNullNode)
+			{
+				return;
+			}
+
+			u32 stack[kStackSize];
+			u32 count = 0;
+			stack[count++] = mRoot;
+
+			while (count > 0)
+			{
+				const Node& node = mNodes[stack[--count]];
+				if (!overlaps(node.aabb))
+				{
+					continue;
+				}
+
+				if (node.IsLeaf())
+				{
+					function(node.userData);
+				}
+				else
+				{
+					DEBUG_ASSERT(count + 2 <= kStackSize, "AABBTree query stack overflow!");
+					stack[count++] = node.child2;
+					stack[count++] = node.child1;
+				}
+			}
+		}
+
+		template<typename Function>
+		void ForEachLeaf(u32 root, Function& function) const
+		{
+			u32 stack[kStackSize];
+			u32 count = 0;
+			stack[count++] = root;
+
+			while (count > 0)
+			{
+				const Node& node = mNodes[stack[--count]];
+				if (node.IsLeaf())
+				{
+					function(node.userData);
+				}
+				else
+				{
+					DEBUG_ASSERT(count + 2 <= kStackSize, "AABBTree query stack overflow!");
+					stack[count++] = node.child2;
+					stack[count++] = node.child1;
+				}
+			}
+		}
+	};
+}
@@ -0,0 +1,368 @@
+#include "ClusterCulling.h"
+
+#include "core/ThreadPool.h"
+
+#include <cmath>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define CULLING_USE_SSE 1
+#include <emmintrin.h>
+#endif
+
+using namespace graphics;
+
+// largest to smallest axis scale still treated as uniform, beyond that the cone test is skipped
+static constexpr f32 kUniformScaleTolerance = 1.01f;
+
+// set bits of a batch mask
+static constexpr u8 kLaneCounts[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+STATIC_ASSERT(ClusterSet::kBatch == 4, "Lane counts assume four clusters per batch!");
+
+ClusterSet::ClusterSet(const Meshlet* meshlets, u32 count)
+	: mCount(count)
+{
+	const u32 padded = (count + kBatch - 1) / kBatch * kBatch;
+
+	// padding faces nowhere and is masked out anyway
+	mCenterX.assign(padded, 0.0f);
+	mCenterY.assign(padded, 0.0f);
+	mCenterZ.assign(padded, 0.0f);
+	mRadius.assign(padded, 0.0f);
+	mAxisX.assign(padded, 0.0f);
+	mAxisY.assign(padded, 0.0f);
+	mAxisZ.assign(padded, 0.0f);
+	mCutoff.assign(padded, 1.0f);
+	mIndexOffset.assign(padded, 0);
+	mIndexCount.assign(padded, 0);
+
+	for (u32 i = 0; i < count; ++i)
+	{
+		const Meshlet& meshlet = meshlets[i];
+		mCenterX[i] = meshlet.center.x;
+		mCenterY[i] = meshlet.center.y;
+		mCenterZ[i] = meshlet.center.z;
+		mRadius[i] = meshlet.radius;
+		mAxisX[i] = meshlet.coneAxis.x;
+		mAxisY[i] = meshlet.coneAxis.y;
+		mAxisZ[i] = meshlet.coneAxis.z;
+		mCutoff[i] = meshlet.coneCutoff;
+		mIndexOffset[i] = meshlet.indexOffset;
+		mIndexCount[i] = meshlet.indexCount;
+	}
+}
+
+ClusterView::ClusterView(const glm::mat4& viewProj, CullFace cullFace)
+	: mCullFace(cullFace)
+{
+	const glm::mat4 rows = glm::transpose(viewProj);
+	mPlanes =
+	{
+		rows[3] + rows[0],
+		rows[3] - rows[0],
+		rows[3] + rows[1],
+		rows[3] - rows[1],
+		rows[3] + rows[2],
+		rows[3] - rows[2],
+	};
+
+	for (glm::vec4& plane : mPlanes)
+	{
+		plane /= glm::length(glm::vec3(plane));
+	}
+
+	// the eye is (0, 0, 1, 0) in clip space taken back to world space, orthographic projections give a direction
+	const glm::vec4 eye = glm::inverse(viewProj) * glm::vec4(0, 0, 1, 0);
+	const f32 length = glm::length(glm::vec3(eye));
+	if (std::abs(eye.w) > length * 1e-6f)
+	{
+		mEye = glm::vec4(glm::vec3(eye) / eye.w, 1.0f);
+	}
+	else
+	{
+		mEye = glm::vec4(glm::vec3(eye) / length, 0.0f);
+	}
+}
+
+ClusterCullStatistics& ClusterCullStatistics::operator+=(const ClusterCullStatistics& other)
+{
+	objects += other.objects;
+	clusters += other.clusters;
+	frustumCulled += other.frustumCulled;
+	coneCulled += other.coneCulled;
+	ranges += other.ranges;
+	triangles += other.triangles;
+	visibleTriangles += other.visibleTriangles;
+	return *this;
+}
+
+// the view moved into the mesh space of one object, clusters are tested without transforming them
+struct ObjectView
+{
+	// mesh space planes, distances still in world units
+	std::array<glm::vec4, 6> mPlanes{};
+
+	// largest axis scale, takes mesh space radii to world units
+	f32 mScale = 1.0f;
+
+	bool mCone = false;
+	bool mOrthographic = false;
+
+	// mesh space eye, or the unit view direction when orthographic
+	glm::vec3 mEye{};
+
+	// 1 when back faces are culled, -1 for front faces. Mirroring transforms swap the two
+	f32 mSign = 1.0f;
+};
+
+static ObjectView MakeObjectView(const ClusterView& view, const glm::mat4& transform)
+{
+	ObjectView result;
+
+	const glm::mat4 transposed = glm::transpose(transform);
+	for (u32 i = 0; i < 6; ++i)
+	{
+		result.mPlanes[i] = transposed * view.mPlanes[i];
+	}
+
+	const glm::mat3 basis(transform);
+	const glm::vec3 scales{ glm::length(basis[0]), glm::length(basis[1]), glm::length(basis[2]) };
+	const f32 minScale = std::min(scales.x, std::min(scales.y, scales.z));
+	result.mScale = std::max(scales.x, std::max(scales.y, scales.z));
+
+	// cone angles only survive rotations and uniform scales
+	result.mCone = view.mCullFace != CullFace::DISABLED && minScale > 0.0f && result.mScale <= minScale * kUniformScaleTolerance;
+	if (!result.mCone)
+	{
+		return result;
+	}
+
+	const glm::vec4 eye = glm::inverse(transform) * view.mEye;
+	result.mOrthographic = view.mEye.w == 0.0f;
+	result.mEye = result.mOrthographic ? glm::normalize(glm::vec3(eye)) : glm::vec3(eye);
+
+	result.mSign = view.mCullFace == CullFace::BACK ? 1.0f : -1.0f;
+	if (glm::determinant(basis) < 0.0f)
+	{
+		result.mSign = -result.mSign;
+	}
+
+	return result;
+}
+
+// visible clusters of the batch at base as a bit mask, frustumMask gets the ones inside the frustum
+static u32 CullBatch(const ClusterSet& set, u32 base, const ObjectView& object, u32& frustumMask)
+{
+#if defined(CULLING_USE_SSE)
+	const __m128 cx = _mm_loadu_ps(&set.mCenterX[base]);
+	const __m128 cy = _mm_loadu_ps(&set.mCenterY[base]);
+	const __m128 cz = _mm_loadu_ps(&set.mCenterZ[base]);
+	const __m128 radius = _mm_loadu_ps(&set.mRadius[base]);
+
+	const __m128 threshold = _mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(radius, _mm_set1_ps(object.mScale)));
+
+	__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+	for (const glm::vec4& plane : object.mPlanes)
+	{
+		__m128 distance = _mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(plane.x)), _mm_set1_ps(plane.w));
+		distance = _mm_add_ps(distance, _mm_mul_ps(cy, _mm_set1_ps(plane.y)));
+		distance = _mm_add_ps(distance, _mm_mul_ps(cz, _mm_set1_ps(plane.z)));
+		inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, threshold));
+	}
+
+	frustumMask = static_cast<u32>(_mm_movemask_ps(inside));
+	if (!object.mCone || !frustumMask)
+	{
+		return frustumMask;
+	}
+
+	const __m128 ax = _mm_loadu_ps(&set.mAxisX[base]);
+	const __m128 ay = _mm_loadu_ps(&set.mAxisY[base]);
+	const __m128 az = _mm_loadu_ps(&set.mAxisZ[base]);
+	const __m128 cutoff = _mm_loadu_ps(&set.mCutoff[base]);
+	const __m128 sign = _mm_set1_ps(object.mSign);
+
+	__m128 facingAway;
+	if (object.mOrthographic)
+	{
+		__m128 dot = _mm_mul_ps(ax, _mm_set1_ps(object.mEye.x));
+		dot = _mm_add_ps(dot, _mm_mul_ps(ay, _mm_set1_ps(object.mEye.y)));
+		dot = _mm_add_ps(dot, _mm_mul_ps(az, _mm_set1_ps(object.mEye.z)));
+		facingAway = _mm_cmpge_ps(_mm_mul_ps(dot, sign), cutoff);
+	}
+	else
+	{
+		const __m128 vx = _mm_sub_ps(cx, _mm_set1_ps(object.mEye.x));
+		const __m128 vy = _mm_sub_ps(cy, _mm_set1_ps(object.mEye.y));
+		const __m128 vz = _mm_sub_ps(cz, _mm_set1_ps(object.mEye.z));
+
+		const __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz)));
+
+		__m128 dot = _mm_mul_ps(vx, ax);
+		dot = _mm_add_ps(dot, _mm_mul_ps(vy, ay));
+		dot = _mm_add_ps(dot, _mm_mul_ps(vz, az));
+
+		const __m128 bound = _mm_add_ps(_mm_mul_ps(cutoff, length), _mm_mul_ps(radius, _mm_add_ps(_mm_set1_ps(1.0f), cutoff)));
+		facingAway = _mm_cmpge_ps(_mm_mul_ps(dot, sign), bound);
+	}
+
+	return static_cast<u32>(_mm_movemask_ps(_mm_andnot_ps(facingAway, inside)));
+#else
+	u32 result = 0;
+	frustumMask = 0;
+	for (u32 lane = 0; lane < ClusterSet::kBatch; ++lane)
+	{
+		const u32 i = base + lane;
+		const glm::vec3 center{ set.mCenterX[i], set.mCenterY[i], set.mCenterZ[i] };
+		const f32 radius = set.mRadius[i];
+
+		bool inside = true;
+		for (const glm::vec4& plane : object.mPlanes)
+		{
+			inside = inside && glm::dot(glm::vec3(plane), center) + plane.w >= -radius * object.mScale;
+		}
+
+		if (!inside)
+		{
+			continue;
+		}
+		frustumMask |= 1u << lane;
+
+		if (object.mCone)
+		{
+			const glm::vec3 axis{ set.mAxisX[i], set.mAxisY[i], set.mAxisZ[i] };
+			const f32 cutoff = set.mCutoff[i];
+
+			bool facingAway = false;
+			if (object.mOrthographic)
+			{
+				facingAway = glm::dot(object.mEye, axis) * object.mSign >= cutoff;
+			}
+			else
+			{
+				const glm::vec3 toCenter = center - object.mEye;
+				facingAway = glm::dot(toCenter, axis) * object.mSign >= cutoff * glm::length(toCenter) + radius * (1.0f + cutoff);
+			}
+
+			if (facingAway)
+			{
+				continue;
+			}
+		}
+
+		result |= 1u << lane;
+	}
+	return result;
+#endif
+}
+
+void graphics::CullClusters(const ClusterView& view, ClusterCullJob& job)
+{
+	DEBUG_ASSERT(job.mClusters, "Cluster cull job without clusters!");
+
+	const ClusterSet& set = *job.mClusters;
+	const ObjectView object = MakeObjectView(view, job.mTransform);
+
+	job.mRanges.clear();
+	job.mStatistics = {};
+	job.mStatistics.objects = 1;
+	job.mStatistics.clusters = set.mCount;
+
+	IndexRange current{};
+	for (u32 base = 0; base < set.mCount; base += ClusterSet::kBatch)
+	{
+		// the padding of the last batch never counts
+		const u32 lanes = std::min(set.mCount - base, ClusterSet::kBatch);
+		const u32 valid = (1u << lanes) - 1;
+
+		u32 frustumMask = 0;
+		const u32 visible = CullBatch(set, base, object, frustumMask) & valid;
+		frustumMask &= valid;
+
+		job.mStatistics.frustumCulled += lanes - kLaneCounts[frustumMask];
+		job.mStatistics.coneCulled += kLaneCounts[frustumMask & ~visible];
+
+		for (u32 lane = 0; lane < lanes; ++lane)
+		{
+			const u32 i = base + lane;
+			job.mStatistics.triangles += set.mIndexCount[i] / 3;
+
+			if (!(visible & (1u << lane)))
+			{
+				continue;
+			}
+
+			job.mStatistics.visibleTriangles += set.mIndexCount[i] / 3;
+
+			// clusters are contiguous in the index buffer, neighbours merge into one range
+			if (current.mCount > 0 && current.mOffset + current.mCount == set.mIndexOffset[i])
+			{
+				current.mCount += set.mIndexCount[i];
+				continue;
+			}
+
+			if (current.mCount > 0)
+			{
+				job.mRanges.push_back(current);
+			}
+			current = { set.mIndexOffset[i], set.mIndexCount[i] };
+		}
+	}
+
+	if (current.mCount > 0)
+	{
+		job.mRanges.push_back(current);
+	}
+
+	job.mStatistics.ranges = static_cast<u32>(job.mRanges.size());
+}
+
+ClusterCullStatistics graphics::CullClusters(const ClusterView& view, std::vector<ClusterCullJob>& jobs, gold::ThreadPool* pool)
+{
+	// consecutive jobs share a task until it holds kClustersPerTask clusters
+	std::vector<std::pair<u32, u32>> tasks;
+	u32 clusters = 0;
+	for (u32 i = 0; i < jobs.size(); ++i)
+	{
+		if (tasks.empty() || clusters >= kClustersPerTask)
+		{
+			tasks.push_back({ i, i });
+			clusters = 0;
+		}
+
+		tasks.back().second = i + 1;
+		clusters += jobs[i].mClusters->mCount;
+	}
+
+	auto cull = [&view, &jobs](std::pair<u32, u32> task)
+	{
+		for (u32 i = task.first; i < task.second; ++i)
+		{
+			CullClusters(view, jobs[i]);
+		}
+	};
+
+	if (pool && tasks.size() > 1)
+	{
+		pool->ParallelFor(0, static_cast<u32>(tasks.size()), [&cull, &tasks](u32 first, u32 last)
+		{
+			for (u32 i = first; i < last; ++i)
+			{
+				cull(tasks[i]);
+			}
+		}, 1);
+	}
+	else
+	{
+		for (const auto& task : tasks)
+		{
+			cull(task);
+		}
+	}
+
+	ClusterCullStatistics result;
+	for (const ClusterCullJob& job : jobs)
+	{
+		result += job.mStatistics;
+	}
+	return result;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "core/Core.h"
+
+#include "Meshlet.h"
+#include "RenderTypes.h"
+
+namespace gold
+{
+	class ThreadPool;
+}
+
+namespace graphics
+{
+	// meshlets of one mesh, one array per field. Padded to a multiple of kBatch, padding is never visible
+	struct ClusterSet
+	{
+		static constexpr u32 kBatch = 4;
+
+		u32 mCount = 0;
+
+		// mesh space bounds, see graphics::Meshlet
+		std::vector<f32> mCenterX, mCenterY, mCenterZ, mRadius;
+		std::vector<f32> mAxisX, mAxisY, mAxisZ, mCutoff;
+
+		std::vector<u32> mIndexOffset, mIndexCount;
+
+		ClusterSet() = default;
+		ClusterSet(const Meshlet* meshlets, u32 count);
+	};
+
+	// what a view needs to cull clusters, built once per view
+	struct ClusterView
+	{
+		// world space, normalized so plane distances are in world units
+		std::array<glm::vec4, 6> mPlanes{};
+
+		// w = 1 the eye position, w = 0 the view direction of an orthographic projection
+		glm::vec4 mEye{ 0, 0, 0, 1 };
+
+		// the faces the pass culls, clusters facing that way as a whole are skipped. DISABLED turns the cone test off
+		CullFace mCullFace = CullFace::BACK;
+
+		ClusterView() = default;
+		ClusterView(const glm::mat4& viewProj, CullFace cullFace);
+	};
+
+	struct ClusterCullStatistics
+	{
+		u32 objects = 0;
+		u32 clusters = 0;
+
+		u32 frustumCulled = 0;
+		u32 coneCulled = 0;
+
+		// after merging neighbouring visible clusters
+		u32 ranges = 0;
+
+		u64 triangles = 0;
+		u64 visibleTriangles = 0;
+
+		ClusterCullStatistics& operator+=(const ClusterCullStatistics& other);
+	};
+
+	// one object of a view, transform takes mesh space to world space
+	struct ClusterCullJob
+	{
+		const ClusterSet* mClusters = nullptr;
+		glm::mat4 mTransform{ 1.0f };
+
+		// filled by CullClusters, visible index ranges in draw order, empty when nothing is visible
+		std::vector<IndexRange> mRanges;
+		ClusterCullStatistics mStatistics;
+	};
+
+	// culls the clusters of one object, neighbouring visible clusters come out as one range
+	void CullClusters(const ClusterView& view, ClusterCullJob& job);
+
+	// culls every job, spread over pool in tasks of roughly kClustersPerTask clusters. The calling thread helps
+	// with them, a null pool culls everything on the calling thread. Returns the statistics of all jobs
+	static constexpr u32 kClustersPerTask = 2048;
+	ClusterCullStatistics CullClusters(const ClusterView& view, std::vector<ClusterCullJob>& jobs, gold::ThreadPool* pool);
+}
@@ -0,0 +1,247 @@
+#include "DDS.h"
+
+using namespace graphics;
+
+static constexpr u32 kFlagCaps			= 0x1;
+static constexpr u32 kFlagHeight		= 0x2;
+static constexpr u32 kFlagWidth			= 0x4;
+static constexpr u32 kFlagPixelFormat	= 0x1000;
+static constexpr u32 kFlagMipMapCount	= 0x20000;
+static constexpr u32 kFlagLinearSize	= 0x80000;
+
+static constexpr u32 kPixelFormatFourCC = 0x4;
+
+static constexpr u32 kCapsComplex		= 0x8;
+static constexpr u32 kCapsTexture		= 0x1000;
+static constexpr u32 kCapsMipMap		= 0x400000;
+
+static constexpr u32 kDimensionTexture2D = 3;
+
+static constexpr u32 MakeFourCC(char a, char b, char c, char d)
+{
+	return static_cast<u32>(a) | (static_cast<u32>(b) << 8) | (static_cast<u32>(c) << 16) | (static_cast<u32>(d) << 24);
+}
+
+// subset of DXGI_FORMAT
+enum DXGIFormat : u32
+{
+	DXGI_FORMAT_UNKNOWN				= 0,
+	DXGI_FORMAT_R8G8B8A8_UNORM		= 28,
+	DXGI_FORMAT_R8G8B8A8_UNORM_SRGB	= 29,
+	DXGI_FORMAT_R8_UNORM			= 61,
+	DXGI_FORMAT_BC1_UNORM			= 71,
+	DXGI_FORMAT_BC1_UNORM_SRGB		= 72,
+	DXGI_FORMAT_BC3_UNORM			= 77,
+	DXGI_FORMAT_BC3_UNORM_SRGB		= 78,
+	DXGI_FORMAT_BC4_UNORM			= 80,
+	DXGI_FORMAT_BC5_UNORM			= 83,
+	DXGI_FORMAT_BC7_UNORM			= 98,
+	DXGI_FORMAT_BC7_UNORM_SRGB		= 99,
+};
+
+static TextureFormat FromDXGI(u32 format)
+{
+	switch (format)
+	{
+	case DXGI_FORMAT_R8G8B8A8_UNORM:		return TextureFormat::RGBA_U8;
+	case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:	return TextureFormat::RGBA_U8_SRGB;
+	case DXGI_FORMAT_R8_UNORM:				return TextureFormat::R_U8;
+	case DXGI_FORMAT_BC1_UNORM:				return TextureFormat::BC1_RGBA;
+	case DXGI_FORMAT_BC1_UNORM_SRGB:		return TextureFormat::BC1_RGBA_SRGB;
+	case DXGI_FORMAT_BC3_UNORM:				return TextureFormat::BC3_RGBA;
+	case DXGI_FORMAT_BC3_UNORM_SRGB:		return TextureFormat::BC3_RGBA_SRGB;
+	case DXGI_FORMAT_BC4_UNORM:				return TextureFormat::BC4_R;
+	case DXGI_FORMAT_BC5_UNORM:				return TextureFormat::BC5_RG;
+	case DXGI_FORMAT_BC7_UNORM:				return TextureFormat::BC7_RGBA;
+	case DXGI_FORMAT_BC7_UNORM_SRGB:		return TextureFormat::BC7_RGBA_SRGB;
+	}
+
+	return TextureFormat::INVALID;
+}
+
+static u32 ToDXGI(TextureFormat format)
+{
+	switch (format)
+	{
+	case TextureFormat::RGBA_U8:		return DXGI_FORMAT_R8G8B8A8_UNORM;
+	case TextureFormat::RGBA_U8_SRGB:	return DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+	case TextureFormat::R_U8:			return DXGI_FORMAT_R8_UNORM;
+	case TextureFormat::BC1_RGBA:		return DXGI_FORMAT_BC1_UNORM;
+	case TextureFormat::BC1_RGBA_SRGB:	return DXGI_FORMAT_BC1_UNORM_SRGB;
+	case TextureFormat::BC3_RGBA:		return DXGI_FORMAT_BC3_UNORM;
+	case TextureFormat::BC3_RGBA_SRGB:	return DXGI_FORMAT_BC3_UNORM_SRGB;
+	case TextureFormat::BC4_R:			return DXGI_FORMAT_BC4_UNORM;
+	case TextureFormat::BC5_RG:			return DXGI_FORMAT_BC5_UNORM;
+	case TextureFormat::BC7_RGBA:		return DXGI_FORMAT_BC7_UNORM;
+	case TextureFormat::BC7_RGBA_SRGB:	return DXGI_FORMAT_BC7_UNORM_SRGB;
+	default: break;
+	}
+
+	DEBUG_ASSERT(false, "Texture format cannot be stored as dds!");
+	return DXGI_FORMAT_UNKNOWN;
+}
+
+// legacy files without the DX10 extension header
+static TextureFormat FromFourCC(u32 fourCC)
+{
+	switch (fourCC)
+	{
+	case MakeFourCC('D', 'X', 'T', '1'): return TextureFormat::BC1_RGBA;
+	case MakeFourCC('D', 'X', 'T', '5'): return TextureFormat::BC3_RGBA;
+	case MakeFourCC('A', 'T', 'I', '1'):
+	case MakeFourCC('B', 'C', '4', 'U'): return TextureFormat::BC4_R;
+	case MakeFourCC('A', 'T', 'I', '2'):
+	case MakeFourCC('B', 'C', '5', 'U'): return TextureFormat::BC5_RG;
+	}
+
+	return TextureFormat::INVALID;
+}
+
+bool dds::Parse(const void* buffer, u64 size, Image& result)
+{
+	const u8* bytes = static_cast<const u8*>(buffer);
+	u64 offset = 0;
+
+	if (size < sizeof(u32) + sizeof(Header))
+	{
+		return false;
+	}
+
+	u32 magic;
+	memcpy(&magic, bytes, sizeof(u32));
+	offset += sizeof(u32);
+	if (magic != kMagic)
+	{
+		return false;
+	}
+
+	Header header;
+	memcpy(&header, bytes + offset, sizeof(Header));
+	offset += sizeof(Header);
+	if (header.size != sizeof(Header) || !(header.pixelFormat.flags & kPixelFormatFourCC))
+	{
+		return false;
+	}
+
+	if (header.pixelFormat.fourCC == MakeFourCC('D', 'X', '1', '0'))
+	{
+		if (size < offset + sizeof(HeaderDX10))
+		{
+			return false;
+		}
+
+		HeaderDX10 dx10;
+		memcpy(&dx10, bytes + offset, sizeof(HeaderDX10));
+		offset += sizeof(HeaderDX10);
+
+		if (dx10.resourceDimension != kDimensionTexture2D || dx10.arraySize > 1)
+		{
+			return false;
+		}
+		result.format = FromDXGI(dx10.dxgiFormat);
+	}
+	else
+	{
+		result.format = FromFourCC(header.pixelFormat.fourCC);
+	}
+
+	if (result.format == TextureFormat::INVALID)
+	{
+		return false;
+	}
+
+	result.width = header.width;
+	result.height = header.height;
+	result.mipCount = (header.flags & kFlagMipMapCount) ? std::max(header.mipMapCount, 1u) : 1u;
+
+	if (result.width == 0 || result.height == 0)
+	{
+		return false;
+	}
+
+	// a full chain ends at 1x1, a file claiming more levels than floor(log2(max(w, h))) + 1 is broken
+	u32 maxMipCount = 1;
+	for (u32 extent = std::max(result.width, result.height); extent > 1; extent >>= 1)
+	{
+		++maxMipCount;
+	}
+
+	if (result.mipCount > maxMipCount)
+	{
+		return false;
+	}
+
+	u64 expectedSize = 0;
+	for (u32 level = 0; level < result.mipCount; ++level)
+	{
+		expectedSize += GetTextureDataSize(result.format, std::max(result.width >> level, 1u), std::max(result.height >> level, 1u));
+	}
+
+	if (size < offset + expectedSize)
+	{
+		return false;
+	}
+
+	result.data = bytes + offset;
+	result.dataSize = expectedSize;
+
+	return true;
+}
+
+void dds::Write(TextureFormat format, u32 width, u32 height, const std::vector<std::vector<u8>>& levels, std::vector<u8>& out)
+{
+	DEBUG_ASSERT(!levels.empty(), "Cannot write a dds file without data!");
+
+	Header header;
+	header.flags = kFlagCaps | kFlagHeight | kFlagWidth | kFlagPixelFormat | kFlagMipMapCount;
+	header.height = height;
+	header.width = width;
+	header.mipMapCount = static_cast<u32>(levels.size());
+	header.caps = kCapsTexture;
+	if (levels.size() > 1)
+	{
+		header.caps |= kCapsComplex | kCapsMipMap;
+	}
+
+	if (IsCompressedFormat(format))
+	{
+		header.flags |= kFlagLinearSize;
+		header.pitchOrLinearSize = GetTextureDataSize(format, width, height);
+	}
+	else
+	{
+		header.pitchOrLinearSize = GetTextureDataSize(format, width, 1);
+	}
+
+	header.pixelFormat.flags = kPixelFormatFourCC;
+	header.pixelFormat.fourCC = MakeFourCC('D', 'X', '1', '0');
+
+	HeaderDX10 dx10;
+	dx10.dxgiFormat = ToDXGI(format);
+	dx10.resourceDimension = kDimensionTexture2D;
+	dx10.arraySize = 1;
+
+	u64 dataSize = 0;
+	for (const auto& level : levels)
+	{
+		dataSize += level.size();
+	}
+
+	const u64 start = out.size();
+	out.resize(start + sizeof(u32) + sizeof(Header) + sizeof(HeaderDX10) + dataSize);
+
+	u8* dst = out.data() + start;
+	memcpy(dst, &kMagic, sizeof(u32));
+	dst += sizeof(u32);
+	memcpy(dst, &header, sizeof(Header));
+	dst += sizeof(Header);
+	memcpy(dst, &dx10, sizeof(HeaderDX10));
+	dst += sizeof(HeaderDX10);
+
+	for (u32 i = 0; i < levels.size(); ++i)
+	{
+		DEBUG_ASSERT(levels[i].size() == GetTextureDataSize(format, std::max(width >> i, 1u), std::max(height >> i, 1u)), "Mip level size does not match its format!");
+		memcpy(dst, levels[i].data(), levels[i].size());
+		dst += levels[i].size();
+	}
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "core/Core.h"
+#include "RenderTypes.h"
+
+// Minimal DDS container support. Only 2D textures with an optional mip chain are handled,
+// pixel data is stored exactly as the GPU consumes it so loading never decodes anything
+namespace graphics::dds
+{
+	constexpr u32 kMagic = 0x20534444; // "DDS "
+
+	struct PixelFormat
+	{
+		u32 size = sizeof(PixelFormat);
+		u32 flags = 0;
+		u32 fourCC = 0;
+		u32 rgbBitCount = 0;
+		u32 rBitMask = 0;
+		u32 gBitMask = 0;
+		u32 bBitMask = 0;
+		u32 aBitMask = 0;
+	};
+
+	struct Header
+	{
+		u32 size = sizeof(Header);
+		u32 flags = 0;
+		u32 height = 0;
+		u32 width = 0;
+		u32 pitchOrLinearSize = 0;
+		u32 depth = 0;
+		u32 mipMapCount = 0;
+		u32 reserved1[11]{};
+		PixelFormat pixelFormat{};
+		u32 caps = 0;
+		u32 caps2 = 0;
+		u32 caps3 = 0;
+		u32 caps4 = 0;
+		u32 reserved2 = 0;
+	};
+
+	struct HeaderDX10
+	{
+		u32 dxgiFormat = 0;
+		u32 resourceDimension = 0;
+		u32 miscFlag = 0;
+		u32 arraySize = 0;
+		u32 miscFlags2 = 0;
+	};
+
+	STATIC_ASSERT(sizeof(PixelFormat) == 32, "DDS pixel format size mismatch!");
+	STATIC_ASSERT(sizeof(Header) == 124, "DDS header size mismatch!");
+	STATIC_ASSERT(sizeof(HeaderDX10) == 20, "DDS DX10 header size mismatch!");
+
+	struct Image
+	{
+		u32 width = 0;
+		u32 height = 0;
+		TextureFormat format = TextureFormat::INVALID;
+		u32 mipCount = 0;
+
+		// all mip levels back to back, level 0 first. Points into the parsed buffer
+		const u8* data = nullptr;
+		u64 dataSize = 0;
+	};
+
+	// returns false when the buffer is not a supported dds file
+	bool Parse(const void* buffer, u64 size, Image& result);
+
+	// appends a complete dds file to out, levels must be in the given format with level 0 first
+	void Write(TextureFormat format, u32 width, u32 height, const std::vector<std::vector<u8>>& levels, std::vector<u8>& out);
+}
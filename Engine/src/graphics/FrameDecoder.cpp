@@ -27,6 +27,13 @@ static TextureDescription2D ReadCreateTexture2D(BinaryReader& reader)
 	desc.mWrap = reader.Read<TextureWrap>();
 	desc.mFilter = reader.Read<TextureFilter>();
 	desc.mMipmaps = reader.Read<bool>();
+	desc.mMips.resize(reader.Read<u8>());
+	for (auto& mip : desc.mMips)
+	{
+		Memory mem = reader.Read<Memory>();
+		mip.mData = mem.data;
+		mip.mDataSize = mem.size;
+	}
 	desc.mBorderColor = reader.Read<glm::vec4>();
 
 	return desc;
@@ -477,10 +484,33 @@ void FrameDecoder::Decode(Renderer& renderer, ServerResources& resources, Binary
 
 			RenderState state = ReadRenderState(reader, resources);
 
+			// still in the upload queue, pending buffer updates carry over to the next draw
+			if (!IsValid(serverHandle))
+			{
+				break;
+			}
+
 			std::function<void()> preAction = generatePreDrawFunction();
 			renderer.DrawMesh(serverHandle, state, preAction);
 			break;
 		}
+		case RenderCommand::DrawMeshRanges:
+		{
+			MeshHandle clientHandle = reader.Read<MeshHandle>();
+			MeshHandle serverHandle = resources.get(clientHandle);
+
+			RenderState state = ReadRenderState(reader, resources);
+			Memory ranges = reader.Read<Memory>();
+
+			if (!IsValid(serverHandle))
+			{
+				break;
+			}
+
+			std::function<void()> preAction = generatePreDrawFunction();
+			renderer.DrawMeshRanges(serverHandle, state, static_cast<const IndexRange*>(ranges.data), ranges.size / sizeof(IndexRange), preAction);
+			break;
+		}
 		case RenderCommand::DrawMeshInstanced:
 		{
 			DEBUG_ASSERT(false, "Not implemented!");
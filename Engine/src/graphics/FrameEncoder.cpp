@@ -6,6 +6,14 @@ using namespace graphics;
 using namespace gold;
 using namespace gold::memory;
 
+// copy into the frame allocator
+static Memory FrameMemory(const void* data, u32 size, LinearAllocator& allocator)
+{
+	void* frameData = allocator.Allocate(size);
+	memcpy(frameData, data, size);
+	return Memory{ frameData, size };
+}
+
 static void WriteCreateTexture2D(const TextureDescription2D& desc, BinaryWriter& writer, LinearAllocator& allocator)
 {
 	writer.Write(desc.mNameHash);
@@ -14,9 +22,7 @@ static void WriteCreateTexture2D(const TextureDescription2D& desc, BinaryWriter&
 	writer.Write(desc.mDataSize);
 	if (desc.mDataSize > 0)
 	{
-		void* data = allocator.Allocate(desc.mDataSize);
-		memcpy(data, desc.mData, desc.mDataSize);
-		writer.Write(Memory{data, desc.mDataSize});
+		writer.Write(FrameMemory(desc.mData, desc.mDataSize, allocator));
 	}
 
 	writer.Write(desc.mFormat);
@@ -24,6 +30,11 @@ static void WriteCreateTexture2D(const TextureDescription2D& desc, BinaryWriter&
 	writer.Write(desc.mFilter);
 	
 	writer.Write(desc.mMipmaps);
+	writer.Write(static_cast<u8>(desc.mMips.size()));
+	for (const auto& mip : desc.mMips)
+	{
+		writer.Write(FrameMemory(mip.mData, mip.mDataSize, allocator));
+	}
 	writer.Write(desc.mBorderColor);
 }
 
@@ -596,6 +607,22 @@ void FrameEncoder::DrawMesh(const MeshHandle handle, const RenderState& state)
 	WriteRenderState(state, mWriter);
 }
 
+void FrameEncoder::DrawMeshRanges(const MeshHandle handle, const RenderState& state, const IndexRange* ranges, u32 count)
+{
+	DEBUG_ASSERT(mRecording, "");
+
+	if (!count)
+	{
+		return;
+	}
+
+	mWriter.Write(RenderCommand::DrawMeshRanges);
+	mWriter.Write(handle);
+
+	WriteRenderState(state, mWriter);
+	mWriter.Write(FrameMemory(ranges, count * sizeof(IndexRange), *mAllocator));
+}
+
 void FrameEncoder::DispatchCompute(const RenderState& state, u16 groupsX, u16 groupsY, u16 groupsZ)
 {
 	DEBUG_ASSERT(mRecording, "");
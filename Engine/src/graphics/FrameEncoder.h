@@ -24,6 +24,9 @@ namespace gold
 		u8 mNextPass{};
 
 	public:
+		// frames recorded after this one before the render thread is guaranteed to be done decoding it
+		static constexpr u32 kFrameLatency = 2;
+
 		FrameEncoder(ClientResources& resources, u64 virtualCommandListSize);
 
 		~FrameEncoder();
@@ -70,6 +73,8 @@ namespace gold
 		void DestroyFrameBuffer(graphics::FrameBufferHandle handle);
 
 		void DrawMesh(const graphics::MeshHandle mesh, const graphics::RenderState& state);
+		// draws only the given runs of the mesh's indices in one call, ranges are copied into the frame
+		void DrawMeshRanges(const graphics::MeshHandle mesh, const graphics::RenderState& state, const graphics::IndexRange* ranges, u32 count);
 
 		void DispatchCompute(const graphics::RenderState& state, u16 groupsX, u16 groupsY, u16 groupsZ);
 
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "core/Core.h"
+#include "FrustumCuller.h"
+
+namespace graphics
+{
+	// a view that picks levels of detail: camera, shadow page, voxelization axis...
+	struct LodView
+	{
+		glm::mat4 mViewProj{};
+		f32 mViewportHeight{};
+
+		// levels added on top of the selected one, passes that need less detail bias towards coarser levels
+		u8 mBias = 0;
+	};
+
+	class LodSelector
+	{
+	public:
+		// largest on screen error, in pixels, a level of detail may introduce
+		static constexpr f32 kMaxPixelError = 1.0f;
+
+		// world units to pixels along the view's y axis at point. w is 1 for orthographic views, clamping it
+		// keeps views from inside the bounds at full detail
+		static f32 GetPixelsPerUnit(const LodView& view, const glm::vec3& point)
+		{
+			constexpr f32 kMinW = 1e-4f;
+			const glm::vec4 clip = view.mViewProj * glm::vec4(point, 1.0f);
+			const glm::vec3 yAxis = { view.mViewProj[0][1], view.mViewProj[1][1], view.mViewProj[2][1] };
+			return std::sqrt(glm::dot(yAxis, yAxis)) / std::max(clip.w, kMinW) * view.mViewportHeight * 0.5f;
+		}
+
+		// pixels the bounds diagonal covers, an upper bound for what a texture mapped once across the surface needs
+		static f32 GetScreenFootprint(const LodView& view, const AABB& aabb)
+		{
+			const glm::vec3 extent = aabb.max - aabb.min;
+			return std::sqrt(glm::dot(extent, extent)) * GetPixelsPerUnit(view, (aabb.min + aabb.max) * 0.5f);
+		}
+
+		// lodCount includes level 0, lodError(lod) is relative to the bounds diagonal and grows with the level.
+		// Works for perspective and orthographic views
+		template<typename ErrorFunc>
+		static u8 SelectLod(const LodView& view, const AABB& aabb, u8 lodCount, ErrorFunc&& lodError)
+		{
+			if (lodCount <= 1)
+			{
+				return 0;
+			}
+
+			const glm::vec3 center = (aabb.min + aabb.max) * 0.5f;
+			const glm::vec3 extent = aabb.max - aabb.min;
+			const f32 diagonal = std::sqrt(glm::dot(extent, extent));
+
+			const f32 pixelsPerUnit = GetPixelsPerUnit(view, center);
+
+			u8 lod = 0;
+			while (lod + 1 < lodCount && lodError(lod + 1) * diagonal * pixelsPerUnit <= kMaxPixelError)
+			{
+				++lod;
+			}
+
+			return static_cast<u8>(std::min<u32>(lod + view.mBias, lodCount - 1));
+		}
+	};
+}
@@ -29,7 +29,7 @@ public:
 		return result;
 	}
 
-	void UpdateMaterial(graphics::MaterialHandle handle, graphics::Material& material)
+	void UpdateMaterial(graphics::MaterialHandle handle, const graphics::Material& material)
 	{
 		mDirty = true;
 		mMaterials[handle.idx] = material;
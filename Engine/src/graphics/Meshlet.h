@@ -0,0 +1,27 @@
+#pragma once
+
+#include "core/Core.h"
+
+namespace graphics
+{
+	// cluster limits, small enough that a cluster's triangles mostly face the same way and its bounds stay tight
+	constexpr u32 kMeshletMaxVertices = 64;
+	constexpr u32 kMeshletMaxTriangles = 124;
+
+	// a run of triangles in the mesh's index buffer, bounds in mesh space. The cluster faces away from e when
+	// dot(center - e, coneAxis) >= coneCutoff * |center - e| + radius * (1 + coneCutoff)
+	struct Meshlet
+	{
+		glm::vec3 center{};
+		f32 radius = 0;
+
+		glm::vec3 coneAxis{ 0, 0, 1 };
+		f32 coneCutoff = 1;
+
+		// in indices of level 0
+		u32 indexOffset = 0;
+		u32 indexCount = 0;
+	};
+
+	STATIC_ASSERT(sizeof(Meshlet) == 40, "Meshlet size mismatch!");
+}
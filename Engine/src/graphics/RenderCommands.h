@@ -37,6 +37,7 @@ namespace gold
 		CreateMesh, //e, d
 
 		DrawMesh,			//e, d
+		DrawMeshRanges,		//e, d
 		DrawMeshInstanced,
 		DispatchCompute, //e, d
 
@@ -2,6 +2,65 @@
 
 #include "Texture.h"
 
+bool graphics::IsCompressedFormat(TextureFormat format)
+{
+	switch (format)
+	{
+	case TextureFormat::BC1_RGBA:
+	case TextureFormat::BC1_RGBA_SRGB:
+	case TextureFormat::BC3_RGBA:
+	case TextureFormat::BC3_RGBA_SRGB:
+	case TextureFormat::BC4_R:
+	case TextureFormat::BC5_RG:
+	case TextureFormat::BC7_RGBA:
+	case TextureFormat::BC7_RGBA_SRGB:
+		return true;
+	default:
+		return false;
+	}
+}
+
+u32 graphics::GetTextureDataSize(TextureFormat format, u32 width, u32 height)
+{
+	const u32 blocks = ((width + 3) / 4) * ((height + 3) / 4);
+
+	switch (format)
+	{
+	case TextureFormat::R_U8:
+	case TextureFormat::R_U8NORM:		return width * height;
+	case TextureFormat::R_U16:			return width * height * 2;
+	case TextureFormat::R_U32:
+	case TextureFormat::R_FLOAT:		return width * height * 4;
+
+	case TextureFormat::RGB_U8:
+	case TextureFormat::RGB_U8_SRGB:	return width * height * 3;
+	case TextureFormat::RGB_HALF:		return width * height * 6;
+	case TextureFormat::RGB_FLOAT:		return width * height * 12;
+
+	case TextureFormat::RGBA_U8:
+	case TextureFormat::RGBA_U8_SRGB:	return width * height * 4;
+	case TextureFormat::RGBA_HALF:		return width * height * 8;
+	case TextureFormat::RGBA_FLOAT:		return width * height * 16;
+
+	case TextureFormat::DEPTH:			return width * height * 4;
+
+	case TextureFormat::BC1_RGBA:
+	case TextureFormat::BC1_RGBA_SRGB:
+	case TextureFormat::BC4_R:			return blocks * 8;
+
+	case TextureFormat::BC3_RGBA:
+	case TextureFormat::BC3_RGBA_SRGB:
+	case TextureFormat::BC5_RG:
+	case TextureFormat::BC7_RGBA:
+	case TextureFormat::BC7_RGBA_SRGB:	return blocks * 16;
+
+	case TextureFormat::INVALID:		break;
+	}
+
+	DEBUG_ASSERT(false, "Unsupported texture format!");
+	return 0;
+}
+
 graphics::TextureDescription2D::TextureDescription2D(const Texture2D& tex, bool mipmaps)
 {
 	mNameHash = tex.GetNameHash();
@@ -11,6 +70,12 @@ graphics::TextureDescription2D::TextureDescription2D(const Texture2D& tex, bool
 	mHeight = tex.GetHeight();
 	mFormat = tex.GetFormat();
 	mMipmaps = mipmaps;
+
+	// textures that carry their own mip chain (dds) are uploaded as is
+	for (u8 level = 1; level < tex.GetMipCount(); ++level)
+	{
+		mMips.push_back({ tex.GetMipData(level), tex.GetMipDataSize(level) });
+	}
 }
 
 graphics::TextureDescription3D::TextureDescription3D(const std::vector<Texture2D>& data, bool mipmaps)
@@ -106,8 +106,23 @@ namespace graphics
 		RGBA_FLOAT,
 
 		DEPTH,
+
+		// block compressed, 4x4 texel blocks
+		BC1_RGBA,
+		BC1_RGBA_SRGB,
+		BC3_RGBA,
+		BC3_RGBA_SRGB,
+		BC4_R,
+		BC5_RG,
+		BC7_RGBA,
+		BC7_RGBA_SRGB,
 	};
 
+	bool IsCompressedFormat(TextureFormat format);
+
+	// size in bytes of a single width x height image (one mip level)
+	u32 GetTextureDataSize(TextureFormat format, u32 width, u32 height);
+
 	enum class CubemapFace : u8
 	{
 		POSITIVE_X = 0,
@@ -158,6 +173,11 @@ namespace graphics
 		FLOATx2,
 		FLOATx3,
 		FLOATx4,
+
+		// normalized integers, read by shaders as floats in [0, 1] (unsigned) or [-1, 1] (signed)
+		UNORM16x4,
+		SNORM16x2,
+		SNORM8x2,
 	};
 
 	enum class IndexFormat : u8
@@ -166,6 +186,13 @@ namespace graphics
 		U32
 	};
 
+	// a run of a mesh's indices, in indices rather than bytes
+	struct IndexRange
+	{
+		u32 mOffset = 0;
+		u32 mCount = 0;
+	};
+
 	enum class ClearColor : u8 { YES, NO };
 	enum class ClearDepth : u8 { YES, NO };
 
@@ -273,10 +300,20 @@ namespace graphics
 
 		bool mMipmaps = false;
 
+		// optional precomputed mip levels 1..n, mData is always level 0. No mips are generated when given
+		struct Mip
+		{
+			const void* mData = nullptr;
+			u32 mDataSize = 0;
+		};
+		std::vector<Mip> mMips;
+
 		glm::vec4 mBorderColor{ 0 };
 
 		TextureDescription2D() = default;
 		TextureDescription2D(const class Texture2D& tex, bool mipmaps);
+
+		bool HasMipmaps() const { return mMipmaps || !mMips.empty(); }
 	};
 
 	struct TextureDescription3D
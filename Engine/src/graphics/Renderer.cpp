@@ -110,6 +110,11 @@ struct DrawCall
 	MeshHandle mMesh{};
 	u32 mInstanceCount = 0;
 	VertexBufferHandle mInstanceData = { 0 };
+
+	// into drawRanges, no ranges draws every index of the mesh
+	u32 mRangeStart = 0;
+	u32 mRangeCount = 0;
+
 	std::function<void()> mPreAction;
 };
 
@@ -127,6 +132,9 @@ struct DeleteCommand
 
 	Type mType = Type::INVALID;
 	u32 mHandle;
+
+	// meshes only
+	bool mVertexBuffers = true;
 };
 
 enum class TextureType
@@ -177,6 +185,7 @@ static std::unordered_map<MeshHandle, Mesh> meshes;
 static std::unordered_map<TextureHandle, TextureDesc> textureDescriptions;
 
 static std::vector<DrawCall> drawCalls{};
+static std::vector<IndexRange> drawRanges{};
 static std::vector<DeleteCommand> deletions{};
 
 static std::array<u32, std::numeric_limits<u8>::max()> renderPassTimerQueries{};
@@ -260,6 +269,16 @@ static void GatherShaderBindings(GLuint program, Shader& result)
 	}
 }
 
+// S3TC is an extension and not part of the generated glad loader
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT		0x83F1
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT		0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT	0x8C4D
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT	0x8C4F
+#endif
+
 static auto FilterToGL(TextureFilter filter, GLenum& minFilter, GLenum& magFilter, bool mipmaps)
 {
 	switch (filter)
@@ -407,6 +426,15 @@ static auto FormatToInternalGL(TextureFormat format)
 	case graphics::TextureFormat::RGBA_FLOAT:	return GL_RGBA32F;
 
 	case graphics::TextureFormat::DEPTH:		return GL_DEPTH_COMPONENT24;
+
+	case graphics::TextureFormat::BC1_RGBA:		 return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+	case graphics::TextureFormat::BC1_RGBA_SRGB: return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT;
+	case graphics::TextureFormat::BC3_RGBA:		 return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	case graphics::TextureFormat::BC3_RGBA_SRGB: return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
+	case graphics::TextureFormat::BC4_R:		 return GL_COMPRESSED_RED_RGTC1;
+	case graphics::TextureFormat::BC5_RG:		 return GL_COMPRESSED_RG_RGTC2;
+	case graphics::TextureFormat::BC7_RGBA:		 return GL_COMPRESSED_RGBA_BPTC_UNORM;
+	case graphics::TextureFormat::BC7_RGBA_SRGB: return GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM;
 	}
 
 	DEBUG_ASSERT(false, "Unsupported Texture Format");
@@ -576,6 +604,7 @@ void Renderer::BeginFrame()
 	ImGui::NewFrame();
 
 	drawCalls.clear();
+	drawRanges.clear();
 	renderPasses.clear();
 	deletions.clear();
 }
@@ -884,6 +913,11 @@ void Renderer::EndFrame()
 		return GL_INVALID_ENUM;
 	};
 
+	// scratch for multi draws, reused across draw calls
+	std::vector<GLsizei> rangeCounts;
+	std::vector<const void*> rangeOffsets;
+	std::vector<GLint> rangeBaseVertices;
+
 	auto drawCallSingle = [&](const DrawCall& draw, GLenum primitive)
 	{
 		const Mesh& mesh = meshes[draw.mMesh];
@@ -894,7 +928,23 @@ void Renderer::EndFrame()
 		}
 		
 
-		if (mesh.mIndices.idx)
+		if (mesh.mIndices.idx && draw.mRangeCount)
+		{
+			GLenum indexFormat = mesh.mIndexFormat == IndexFormat::U16 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+			const u32 indexSize = mesh.mIndexFormat == IndexFormat::U16 ? sizeof(u16) : sizeof(u32);
+
+			rangeCounts.clear();
+			rangeOffsets.clear();
+			rangeBaseVertices.assign(draw.mRangeCount, static_cast<GLint>(mesh.mIndexStart));
+			for (u32 i = draw.mRangeStart; i < draw.mRangeStart + draw.mRangeCount; ++i)
+			{
+				rangeCounts.push_back(static_cast<GLsizei>(drawRanges[i].mCount));
+				rangeOffsets.push_back(reinterpret_cast<const void*>(static_cast<uintptr_t>(drawRanges[i].mOffset) * indexSize));
+			}
+
+			glMultiDrawElementsBaseVertex(primitive, rangeCounts.data(), indexFormat, rangeOffsets.data(), static_cast<GLsizei>(draw.mRangeCount), rangeBaseVertices.data());
+		}
+		else if (mesh.mIndices.idx)
 		{
 			GLenum indexFormat = mesh.mIndexFormat == IndexFormat::U16 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
 			glDrawElementsBaseVertex(primitive, mesh.mIndexCount, indexFormat, 0, static_cast<GLint>(mesh.mIndexStart));
@@ -1065,13 +1115,16 @@ void Renderer::EndFrame()
 			break;
 		case DeleteCommand::Type::Mesh:
 			Mesh& mesh = meshes[{del.mHandle}];
-			if (mesh.mPositions.idx)	glDeleteBuffers(1, &mesh.mPositions.idx);
-			if (mesh.mNormals.idx)		glDeleteBuffers(1, &mesh.mNormals.idx);
-			if (mesh.mTexCoords0.idx)	glDeleteBuffers(1, &mesh.mTexCoords0.idx);
-			if (mesh.mTexCoords1.idx)	glDeleteBuffers(1, &mesh.mTexCoords1.idx);
-			if (mesh.mColors.idx)		glDeleteBuffers(1, &mesh.mColors.idx);
-			if (mesh.mJoints.idx)		glDeleteBuffers(1, &mesh.mJoints.idx);
-			if (mesh.mWeights.idx)		glDeleteBuffers(1, &mesh.mWeights.idx);
+			if (del.mVertexBuffers)
+			{
+				if (mesh.mPositions.idx)	glDeleteBuffers(1, &mesh.mPositions.idx);
+				if (mesh.mNormals.idx)		glDeleteBuffers(1, &mesh.mNormals.idx);
+				if (mesh.mTexCoords0.idx)	glDeleteBuffers(1, &mesh.mTexCoords0.idx);
+				if (mesh.mTexCoords1.idx)	glDeleteBuffers(1, &mesh.mTexCoords1.idx);
+				if (mesh.mColors.idx)		glDeleteBuffers(1, &mesh.mColors.idx);
+				if (mesh.mJoints.idx)		glDeleteBuffers(1, &mesh.mJoints.idx);
+				if (mesh.mWeights.idx)		glDeleteBuffers(1, &mesh.mWeights.idx);
+			}
 			if (mesh.mIndices.idx)		glDeleteBuffers(1, &mesh.mIndices.idx);
 
 			MeshHandle handle = { mesh.mID };
@@ -1272,18 +1325,31 @@ TextureHandle Renderer::CreateTexture2D(const TextureDescription2D& desc)
 
 	GLenum min;
 	GLenum mag;
-	FilterToGL(desc.mFilter, min, mag, desc.mMipmaps);
+	const bool compressed = IsCompressedFormat(desc.mFormat);
+
+	// compressed formats cannot be rendered to, so mips have to come with the data
+	const bool generateMipmaps = desc.mMipmaps && desc.mMips.empty() && !compressed;
+	DEBUG_ASSERT(!(compressed && desc.mMipmaps && desc.mMips.empty()), "Compressed textures need precomputed mips, uploading a single level");
+
+	FilterToGL(desc.mFilter, min, mag, generateMipmaps || !desc.mMips.empty());
 
 	GLenum wrap = WrapToGL(desc.mWrap);
 
-	GLenum channels;
-	GLenum type;
-	TypeToGL(desc.mFormat, channels, type);
+	GLenum channels = GL_INVALID_ENUM;
+	GLenum type = GL_INVALID_ENUM;
+	if (!compressed)
+	{
+		TypeToGL(desc.mFormat, channels, type);
+	}
 
 	GLenum internal = FormatToInternalGL(desc.mFormat);
 
 	int mipmapLevels = 1;
-	if (desc.mMipmaps)
+	if (!desc.mMips.empty())
+	{
+		mipmapLevels = 1 + static_cast<int>(desc.mMips.size());
+	}
+	else if (generateMipmaps)
 	{
 		float log = glm::log2((float)glm::max(desc.mWidth, desc.mHeight));
 		mipmapLevels = 1 + static_cast<int>(glm::floor(log));
@@ -1292,12 +1358,36 @@ TextureHandle Renderer::CreateTexture2D(const TextureDescription2D& desc)
 	GLuint texture;
 	glCreateTextures(GL_TEXTURE_2D, 1, &texture);
 	glTextureStorage2D(texture, mipmapLevels, internal, desc.mWidth, desc.mHeight);
+
+	auto uploadLevel = [&](GLint level, const void* data, u32 dataSize)
+	{
+		const GLsizei width = glm::max(desc.mWidth >> level, 1u);
+		const GLsizei height = glm::max(desc.mHeight >> level, 1u);
+		if (compressed)
+		{
+			glCompressedTextureSubImage2D(texture, level, 0, 0, width, height, internal, static_cast<GLsizei>(dataSize), data);
+		}
+		else
+		{
+			glTextureSubImage2D(texture, level, 0, 0, width, height, channels, type, data);
+		}
+	};
+
+	// tightly packed rows, small mips of 1 and 3 channel textures are not 4 byte aligned
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 	if (desc.mData && desc.mDataSize)
 	{
-		glTextureSubImage2D(texture, 0, 0, 0, desc.mWidth, desc.mHeight, channels, type, desc.mData);
+		uploadLevel(0, desc.mData, desc.mDataSize);
 	}
 
-	if (desc.mMipmaps)
+	if (!desc.mMips.empty())
+	{
+		for (u32 i = 0; i < desc.mMips.size(); ++i)
+		{
+			uploadLevel(static_cast<GLint>(i + 1), desc.mMips[i].mData, desc.mMips[i].mDataSize);
+		}
+	}
+	else if (generateMipmaps)
 	{
 		glGenerateTextureMipmap(texture);
 	}
@@ -1700,8 +1790,9 @@ void Renderer::DestroyShader(ShaderHandle shader)
 
 MeshHandle Renderer::CreateMesh(const MeshDescription& desc)
 {
-	auto vertexFormatGL = [](VertexFormat format, GLenum& type, GLint& components)
+	auto vertexFormatGL = [](VertexFormat format, GLenum& type, GLint& components, GLboolean& normalized)
 	{
+		normalized = GL_FALSE;
 		switch( format ) 
 		{
 		case VertexFormat::U8x3:
@@ -1744,6 +1835,21 @@ MeshHandle Renderer::CreateMesh(const MeshDescription& desc)
    			type = GL_FLOAT;
    			components = 4;
    			break;
+		case VertexFormat::UNORM16x4:
+			type = GL_UNSIGNED_SHORT;
+			components = 4;
+			normalized = GL_TRUE;
+			break;
+		case VertexFormat::SNORM16x2:
+			type = GL_SHORT;
+			components = 2;
+			normalized = GL_TRUE;
+			break;
+		case VertexFormat::SNORM8x2:
+			type = GL_BYTE;
+			components = 2;
+			normalized = GL_TRUE;
+			break;
 		}
 	};
 
@@ -1751,7 +1857,8 @@ MeshHandle Renderer::CreateMesh(const MeshDescription& desc)
 	{
 		GLenum type;
 		GLint components;
-		vertexFormatGL(format, type, components);
+		GLboolean normalized;
+		vertexFormatGL(format, type, components, normalized);
 
 		glEnableVertexAttribArray(index);
 
@@ -1761,7 +1868,7 @@ MeshHandle Renderer::CreateMesh(const MeshDescription& desc)
 		}
 		else
 		{
-			GLboolean normalized = (index == VERTEX_ATTR_WEIGHTS);
+			normalized = normalized || (index == VERTEX_ATTR_WEIGHTS);
 			glVertexAttribPointer(index, components, type, normalized, stride, reinterpret_cast<void*>((u64)offset));
 		}
 	};
@@ -1923,11 +2030,12 @@ MeshHandle Renderer::CreateMesh(const MeshDescription& desc)
 	return { mesh.mID };
 }
 
-void Renderer::DestroyMesh(const MeshHandle mesh)
+void Renderer::DestroyMesh(const MeshHandle mesh, bool vertexBuffers)
 {
 	DeleteCommand command;
 	command.mType = DeleteCommand::Type::Mesh;
 	command.mHandle = mesh.idx;
+	command.mVertexBuffers = vertexBuffers;
 
 	deletions.push_back(command);
 }
@@ -1948,6 +2056,27 @@ void Renderer::DrawMesh(MeshHandle mesh, const RenderState& state, std::function
 	drawCalls.push_back(draw);
 }
 
+void Renderer::DrawMeshRanges(MeshHandle mesh, const RenderState& state, const IndexRange* ranges, u32 count, std::function<void()> preAction)
+{
+	DEBUG_ASSERT(buildingFrame, "Cannot submit draw if a frame is not in flight");
+	DEBUG_ASSERT(state.mRenderPass != std::numeric_limits<u8>::max(), "Invalid render pass");
+	DEBUG_ASSERT(state.mShader.idx, "invalid shader!");
+
+	if (!count) return;
+
+	DrawCall draw;
+	draw.mMesh = mesh;
+	draw.mState = state;
+	draw.mInstanceCount = 0;
+	draw.mInstanceData = { 0 };
+	draw.mRangeStart = static_cast<u32>(drawRanges.size());
+	draw.mRangeCount = count;
+	draw.mPreAction = preAction;
+
+	drawRanges.insert(drawRanges.end(), ranges, ranges + count);
+	drawCalls.push_back(draw);
+}
+
 void Renderer::DrawMeshInstanced(MeshHandle mesh, const RenderState& state, VertexBufferHandle data, u32 instanceCount, std::function<void()> preAction)
 {
 	DEBUG_ASSERT(buildingFrame, "Cannot submit draw if a frame is not in flight");
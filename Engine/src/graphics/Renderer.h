@@ -63,9 +63,12 @@ namespace graphics
 
 		// meshes //////////////////////////////////////////////
 		MeshHandle CreateMesh(const MeshDescription& description);
-		void DestroyMesh(MeshHandle mesh);
+		// levels of detail share the vertex buffers of their first level, only the mesh owning them releases them
+		void DestroyMesh(MeshHandle mesh, bool vertexBuffers = true);
 
 		void DrawMesh(MeshHandle mesh, const RenderState& state, std::function<void()> preAction = nullptr);
+		// one multi draw over the index ranges, ranges are copied
+		void DrawMeshRanges(MeshHandle mesh, const RenderState& state, const IndexRange* ranges, u32 count, std::function<void()> preAction = nullptr);
 		void DrawMeshInstanced(MeshHandle mesh, const RenderState& state, VertexBufferHandle instanceData, uint32_t instanceCount, std::function<void()> preAction = nullptr);
 
 		void DispatchCompute(const RenderState& state, uint16_t groupsX, uint16_t groupsY, uint16_t groupsZ, std::function<void()> preAction = nullptr);
@@ -1,6 +1,12 @@
 #include "Texture.h"
 
 #include "core/Util.h"
+#include "core/VirtualFileSystem.h"
+#include "DDS.h"
+#include "TextureCache.h"
+#include "memory/MappedFile.h"
+
+#include <chrono>
 
 #pragma warning(push, 0)
 #define STB_IMAGE_IMPLEMENTATION
@@ -24,40 +30,137 @@ Texture2D::Texture2D(const std::string& filepath)
 {
 	std::string extension = filepath.substr(filepath.find_last_of('.'), filepath.size());
 
+	// packed files are decoded straight out of the archive mapping
+	gold::FileView packed;
+	const bool isPacked = gold::vfs::Find(filepath, packed);
+
 	if (extension == ".dds")
 	{
-		DEBUG_ASSERT(false, "DDS currently unsupported!");
-		// TODO (danielg: DDS support here
-		
-		//dds_image* image = dds_load_from_file(filepath.c_str());
-		//
-		//mCompressedLoad = true;
-		//
-		//mWidth = image->header.width;
-		//mHeight = image->header.height;
-		//mChannels = 4;
-
-		//// we don't care about the image struct self, but we care about the data
-		//mData = image->pixels;
-		//free(image);
+		std::vector<u8> file;
+		if (!isPacked)
+		{
+			if (!gold::vfs::ReadFile(filepath, file))
+			{
+				return;
+			}
+
+			packed = { file.data(), file.size() };
+		}
+
+		if (!LoadDDS(packed.data, packed.size))
+		{
+			DEBUG_ASSERT(false, "Unsupported dds file: {}", filepath);
+		}
 	}
 	else
 	{
-		int w;
-		int h; 
-		int c;
-		mData = stbi_load(filepath.c_str(), &w, &h, &c, STBI_default);
+		// archives have no write time to validate against, only loose files use the decoded cache
+		if (!isPacked && LoadCached(filepath))
+		{
+			return;
+		}
+
+		auto start = std::chrono::steady_clock::now();
+
+		int w = 0;
+		int h = 0; 
+		int c = 0;
+		mData = isPacked ? stbi_load_from_memory(packed.data, static_cast<int>(packed.size), &w, &h, &c, STBI_default)
+						 : stbi_load(filepath.c_str(), &w, &h, &c, STBI_default);
+		if (!mData)
+		{
+			// callers check GetData() to detect a failed decode
+			return;
+		}
+
 		mWidth = static_cast<u16>(w);
 		mHeight = static_cast<u16>(h);
 		mChannels = static_cast<u16>(c);
 
 		mNameHash = util::Hash(mData, w * h * c);
+
+		if (!isPacked)
+		{
+			texture_cache::Header header;
+			header.width = mWidth;
+			header.height = mHeight;
+			header.channels = mChannels;
+			header.nameHash = mNameHash;
+			header.dataSize = GetDataSize();
+
+			const f64 milliseconds = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+			texture_cache::Store(filepath, header, mData, milliseconds);
+		}
+	}
+}
+
+Texture2D::Texture2D(const void* ddsData, u64 ddsSize)
+{
+	if (!LoadDDS(ddsData, ddsSize))
+	{
+		DEBUG_ASSERT(false, "Unsupported dds data!");
 	}
 }
 
+bool Texture2D::LoadDDS(const void* data, u64 size)
+{
+	dds::Image image;
+	if (!dds::Parse(data, size, image))
+	{
+		return false;
+	}
+
+	mCompressedLoad = true;
+
+	mWidth = static_cast<u16>(image.width);
+	mHeight = static_cast<u16>(image.height);
+	mFormat = image.format;
+	mMipCount = static_cast<u8>(image.mipCount);
+
+	switch (mFormat)
+	{
+	case TextureFormat::R_U8:
+	case TextureFormat::BC4_R:	mChannels = 1; break;
+	case TextureFormat::BC5_RG:	mChannels = 2; break;
+	default:					mChannels = 4; break;
+	}
+
+	mData = malloc(image.dataSize);
+	memcpy(mData, image.data, image.dataSize);
+
+	mNameHash = util::Hash(mData, GetDataSize());
+
+	return true;
+}
+
+bool Texture2D::LoadCached(const std::string& filepath)
+{
+	texture_cache::Entry entry;
+	if (!texture_cache::Find(filepath, entry))
+	{
+		return false;
+	}
+
+	mWidth = static_cast<u16>(entry.header.width);
+	mHeight = static_cast<u16>(entry.header.height);
+	mChannels = static_cast<u16>(entry.header.channels);
+	mNameHash = entry.header.nameHash;
+
+	// read only pages, nothing downstream writes through mData
+	mData = const_cast<u8*>(entry.data);
+	mMapping = std::move(entry.mapping);
+
+	return true;
+}
+
 Texture2D::~Texture2D()
 {
 	// this is probably not needed?
+	if (mMapping)
+	{
+		return;
+	}
+
 	if (mCompressedLoad)
 	{
 		free(mData);
@@ -96,11 +199,47 @@ const void* Texture2D::GetData() const
 
 u32 Texture2D::GetDataSize() const
 {
-	return sizeof(uint8_t) * mChannels * mWidth * mHeight;
+	return GetMipDataSize(0);
+}
+
+u8 Texture2D::GetMipCount() const
+{
+	return mMipCount;
+}
+
+const void* Texture2D::GetMipData(u8 level) const
+{
+	DEBUG_ASSERT(level < mMipCount, "Mip level out of range!");
+
+	const u8* data = static_cast<const u8*>(mData);
+	for (u8 i = 0; i < level; ++i)
+	{
+		data += GetMipDataSize(i);
+	}
+
+	return data;
+}
+
+u32 Texture2D::GetMipDataSize(u8 level) const
+{
+	const u32 width = std::max(mWidth >> level, 1);
+	const u32 height = std::max(mHeight >> level, 1);
+
+	if (mFormat != TextureFormat::INVALID)
+	{
+		return GetTextureDataSize(mFormat, width, height);
+	}
+
+	return sizeof(uint8_t) * mChannels * width * height;
 }
 
 TextureFormat Texture2D::GetFormat() const
 {
+	if (mFormat != TextureFormat::INVALID)
+	{
+		return mFormat;
+	}
+
 	switch(mChannels)
 	{
 	case 1: return TextureFormat::R_U8;
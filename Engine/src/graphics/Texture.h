@@ -3,6 +3,11 @@
 #include "core/Core.h"
 #include "RenderTypes.h"
 
+namespace gold
+{
+	class MappedFile;
+}
+
 namespace graphics
 {
 	class Texture2D
@@ -15,6 +20,9 @@ namespace graphics
 
 		Texture2D(const std::string& filepath);
 
+		// from a dds file already in memory, the data is copied
+		Texture2D(const void* ddsData, u64 ddsSize);
+
 		~Texture2D();
 
 		u16 GetWidth() const;
@@ -31,10 +39,22 @@ namespace graphics
 
 		u32 GetDataSize() const;
 
+		// dds textures can carry their own mip chain, stored back to back after level 0
+		u8 GetMipCount() const;
+
+		const void* GetMipData(u8 level) const;
+
+		u32 GetMipDataSize(u8 level) const;
+
 		bool operator==(const Texture2D& other) const { return mNameHash == other.mNameHash; }
 
 	private:
 
+		bool LoadDDS(const void* data, u64 size);
+
+		// decoded pixels from an earlier run, see TextureCache.h
+		bool LoadCached(const std::string& filepath);
+
 		u32 mNameHash = 0;
 
 		bool mCompressedLoad = false;
@@ -44,6 +64,13 @@ namespace graphics
 
 		u16 mChannels = 0;
 
+		// only set for dds loads, otherwise derived from the channel count
+		graphics::TextureFormat mFormat = graphics::TextureFormat::INVALID;
+		u8 mMipCount = 1;
+
 		void* mData = 0;
+
+		// set for cached loads, mData points into the mapping and is never freed
+		std::shared_ptr<gold::MappedFile> mMapping;
 	};
 }
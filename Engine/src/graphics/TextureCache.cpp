@@ -0,0 +1,150 @@
+#include "TextureCache.h"
+
+#include "core/Logging.h"
+#include "core/Util.h"
+#include "memory/MappedFile.h"
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+
+using namespace graphics;
+namespace fs = std::filesystem;
+
+using Clock = std::chrono::steady_clock;
+
+// the directory is only written before loading starts, the statistics from every decode worker
+static std::string kDirectory = "TextureCache";
+static std::mutex kStatisticsMutex;
+static texture_cache::Statistics kStatistics;
+
+// tells concurrent writers of the same entry apart
+static std::atomic<u32> kPartialCounter = 0;
+
+static bool GetSourceStamp(const std::string& source, u64& size, i64& time)
+{
+	std::error_code error;
+	size = static_cast<u64>(fs::file_size(source, error));
+	if (error)
+	{
+		return false;
+	}
+
+	time = static_cast<i64>(fs::last_write_time(source, error).time_since_epoch().count());
+	return !error;
+}
+
+static fs::path GetEntryPath(const std::string& source)
+{
+	const std::string absolute = fs::absolute(source).lexically_normal().generic_string();
+	return fs::path(kDirectory) / fmt::format("{:016x}.bin", util::Hash64(absolute.data(), absolute.size()));
+}
+
+void texture_cache::SetDirectory(const std::string& directory)
+{
+	kDirectory = directory;
+}
+
+bool texture_cache::Find(const std::string& source, Entry& result)
+{
+	if (kDirectory.empty())
+	{
+		return false;
+	}
+
+	Clock::time_point start = Clock::now();
+
+	u64 sourceSize = 0;
+	i64 sourceTime = 0;
+	if (!GetSourceStamp(source, sourceSize, sourceTime))
+	{
+		return false;
+	}
+
+	auto mapping = std::make_shared<gold::MappedFile>();
+	if (!mapping->Open(GetEntryPath(source).string()) || mapping->GetSize() < sizeof(Header))
+	{
+		return false;
+	}
+
+	Header header;
+	memcpy(&header, mapping->GetData(), sizeof(Header));
+
+	const bool valid = header.magic == kMagic && header.version == kVersion &&
+		header.sourceSize == sourceSize && header.sourceTime == sourceTime &&
+		header.dataSize == static_cast<u64>(header.width) * header.height * header.channels &&
+		mapping->GetSize() - sizeof(Header) >= header.dataSize;
+
+	if (!valid)
+	{
+		return false;
+	}
+
+	result.header = header;
+	result.data = mapping->GetData() + sizeof(Header);
+	result.mapping = std::move(mapping);
+
+	const f64 milliseconds = std::chrono::duration<f64, std::milli>(Clock::now() - start).count();
+
+	std::scoped_lock lock(kStatisticsMutex);
+	++kStatistics.hits;
+	kStatistics.hitMilliseconds += milliseconds;
+	kStatistics.mappedBytes += header.dataSize;
+	return true;
+}
+
+bool texture_cache::Store(const std::string& source, Header header, const void* data, f64 milliseconds)
+{
+	{
+		std::scoped_lock lock(kStatisticsMutex);
+		++kStatistics.misses;
+		kStatistics.missMilliseconds += milliseconds;
+	}
+
+	if (kDirectory.empty() || !GetSourceStamp(source, header.sourceSize, header.sourceTime))
+	{
+		return false;
+	}
+
+	header.magic = kMagic;
+	header.version = kVersion;
+
+	std::error_code error;
+	fs::create_directories(kDirectory, error);
+
+	// written next to the entry and renamed once complete, an interrupted write never leaves a partial entry behind
+	const fs::path path = GetEntryPath(source);
+	const fs::path partialPath = path.string() + fmt::format(".{}.partial", kPartialCounter++);
+
+	{
+		std::ofstream stream(partialPath, std::ios::out | std::ios::binary | std::ios::trunc);
+		stream.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+		stream.write(static_cast<const char*>(data), static_cast<std::streamsize>(header.dataSize));
+
+		if (!stream)
+		{
+			stream.close();
+			fs::remove(partialPath, error);
+			G_ENGINE_WARN("Could not write texture cache entry for {}", source);
+			return false;
+		}
+	}
+
+	// replacing an entry that is still mapped fails on windows, the next start decodes once more
+	fs::rename(partialPath, path, error);
+	if (error)
+	{
+		fs::remove(partialPath, error);
+		return false;
+	}
+
+	return true;
+}
+
+texture_cache::Statistics texture_cache::GetStatistics()
+{
+	std::scoped_lock lock(kStatisticsMutex);
+	return kStatistics;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "core/Core.h"
+
+namespace gold
+{
+	class MappedFile;
+}
+
+// decoded pixels of loose image files, validated with the size and write time of their source
+namespace graphics::texture_cache
+{
+	constexpr u32 kMagic = 0x58544347; // "GCTX"
+
+	// bump when the layout changes, older entries are decoded and written again
+	constexpr u32 kVersion = 1;
+
+	// pixel data follows the header, level 0 only, rows tightly packed
+	struct Header
+	{
+		u32 magic = kMagic;
+		u32 version = kVersion;
+
+		u64 sourceSize = 0;
+		i64 sourceTime = 0;
+
+		u32 width = 0;
+		u32 height = 0;
+		u32 channels = 0;
+
+		// the pixel hash the decode would have computed, saves hashing the whole image again
+		u32 nameHash = 0;
+
+		u64 dataSize = 0;
+	};
+
+	// keeps the pixels 16 byte aligned in the mapping
+	STATIC_ASSERT(sizeof(Header) % 16 == 0, "Texture cache header breaks pixel alignment!");
+
+	struct Entry
+	{
+		Header header{};
+
+		// header.dataSize bytes, valid as long as mapping lives
+		const u8* data = nullptr;
+		std::shared_ptr<gold::MappedFile> mapping;
+	};
+
+	struct Statistics
+	{
+		// entries mapped, and the time spent checking and mapping them
+		u32 hits = 0;
+		f64 hitMilliseconds = 0;
+
+		// sources decoded, and the time spent decoding and storing them
+		u32 misses = 0;
+		f64 missMilliseconds = 0;
+
+		u64 mappedBytes = 0;
+	};
+
+	// entries live under directory, an empty one turns the cache off. Set it before any loading starts
+	void SetDirectory(const std::string& directory);
+
+	// any thread. False when source has no entry or changed since the entry was written
+	bool Find(const std::string& source, Entry& result);
+
+	// any thread. Writes the decoded pixels of source, stamped with its current size and write time.
+	// milliseconds is what the decode took, counted as a miss whether the entry could be written or not
+	bool Store(const std::string& source, Header header, const void* data, f64 milliseconds);
+
+	Statistics GetStatistics();
+}
@@ -0,0 +1,339 @@
+#include "TextureResidency.h"
+
+using namespace graphics;
+using namespace gold;
+
+// recorded into a batch that is not submitted yet
+static constexpr UploadTicket kUnsubmitted = std::numeric_limits<UploadTicket>::max();
+
+TextureResidency::TextureResidency(UploadQueue& queue)
+	: mQueue(queue)
+{
+
+}
+
+TextureResidency::Entry TextureResidency::MakeEntry(const TextureDescription2D& desc, UploadOwner owner) const
+{
+	Entry entry;
+	entry.mDesc = desc;
+	entry.mOwner = std::move(owner);
+	entry.mStreamed = !desc.mMips.empty();
+	entry.mLevelCount = static_cast<u8>(desc.mMips.size() + 1);
+
+	entry.mChainBytes.resize(entry.mLevelCount);
+	u64 bytes = 0;
+	for (i32 level = entry.mLevelCount - 1; level >= 0; --level)
+	{
+		bytes += level == 0 ? desc.mDataSize : desc.mMips[level - 1].mDataSize;
+		entry.mChainBytes[level] = bytes;
+	}
+
+	if (!entry.mStreamed)
+	{
+		// mips generated on upload add another third
+		if (desc.mMipmaps)
+		{
+			entry.mChainBytes[0] += desc.mDataSize / 3;
+		}
+		return entry;
+	}
+
+	// the first level that fits kResidentSize, or the coarsest there is
+	const u32 size = std::max(desc.mWidth, desc.mHeight);
+	u8 level = 0;
+	while (level + 1 < entry.mLevelCount && (size >> level) > kResidentSize)
+	{
+		++level;
+	}
+
+	entry.mMinimumLevel = level;
+	entry.mResidentLevel = level;
+	entry.mWantedLevel = level;
+	return entry;
+}
+
+TextureDescription2D TextureResidency::GetChainDescription(const Entry& entry, u8 level) const
+{
+	TextureDescription2D result = entry.mDesc;
+	if (level == 0)
+	{
+		return result;
+	}
+
+	const TextureDescription2D::Mip& base = entry.mDesc.mMips[level - 1];
+	result.mWidth = std::max(entry.mDesc.mWidth >> level, 1u);
+	result.mHeight = std::max(entry.mDesc.mHeight >> level, 1u);
+	result.mData = base.mData;
+	result.mDataSize = base.mDataSize;
+	result.mMips.assign(entry.mDesc.mMips.begin() + level, entry.mDesc.mMips.end());
+
+	// the rest of the chain is there already
+	result.mMipmaps = false;
+	return result;
+}
+
+void TextureResidency::Upload(TextureHandle handle, Entry& entry, u8 level, UploadBatch& batch)
+{
+	if (level < entry.mResidentLevel)
+	{
+		++mStatistics.loadedLevels;
+	}
+	else
+	{
+		++mStatistics.evictedLevels;
+	}
+
+	mStatistics.residentBytes -= entry.mChainBytes[entry.mResidentLevel];
+	mStatistics.residentBytes += entry.mChainBytes[level];
+	entry.mResidentLevel = level;
+
+	batch.UpdateTexture2D(handle, GetChainDescription(entry, level), entry.mOwner);
+	entry.mPending = kUnsubmitted;
+	mQueued.push_back(&entry);
+}
+
+void TextureResidency::Submit(UploadBatch&& batch)
+{
+	if (batch.IsEmpty())
+	{
+		return;
+	}
+
+	const UploadTicket ticket = mQueue.Submit(std::move(batch));
+	for (Entry* entry : mQueued)
+	{
+		entry->mPending = ticket;
+	}
+	mQueued.clear();
+}
+
+bool TextureResidency::MakeRoom(u64 bytes, const Entry* loading, UploadBatch& batch)
+{
+	while (mStatistics.residentBytes + bytes > mBudget)
+	{
+		if (mQueued.size() >= kMaxRequestsPerFrame)
+		{
+			return false;
+		}
+
+		// least recently used first, larger chains first between textures last used in the same frame
+		TextureHandle victimHandle{};
+		Entry* victim = nullptr;
+		for (auto& [handle, entry] : mEntries)
+		{
+			if (!entry.mStreamed || entry.mPending || &entry == loading || entry.mResidentLevel >= entry.mMinimumLevel)
+			{
+				continue;
+			}
+
+			const bool seen = entry.mLastUsedFrame == mFrame;
+			if (loading && seen && entry.mResidentLevel >= entry.mWantedLevel)
+			{
+				continue;
+			}
+
+			const bool older = !victim ||
+				entry.mLastUsedFrame < victim->mLastUsedFrame ||
+				(entry.mLastUsedFrame == victim->mLastUsedFrame && entry.mChainBytes[entry.mResidentLevel] > victim->mChainBytes[victim->mResidentLevel]);
+
+			if (older)
+			{
+				victimHandle = { handle };
+				victim = &entry;
+			}
+		}
+
+		if (!victim)
+		{
+			return false;
+		}
+
+		Upload(victimHandle, *victim, victim->mResidentLevel + 1, batch);
+	}
+
+	return true;
+}
+
+TextureHandle TextureResidency::CreateTexture2D(const TextureDescription2D& desc, UploadOwner owner)
+{
+	Entry entry = MakeEntry(desc, std::move(owner));
+
+	// submitted under the lock so it is ordered before any level change of the texture
+	std::scoped_lock lock(mMutex);
+
+	UploadBatch batch = mQueue.CreateBatch();
+	const TextureHandle handle = batch.CreateTexture2D(GetChainDescription(entry, entry.mResidentLevel), entry.mOwner);
+	entry.mPending = mQueue.Submit(std::move(batch));
+
+	mStatistics.residentBytes += entry.mChainBytes[entry.mResidentLevel];
+	mStatistics.pinnedBytes += entry.mStreamed ? 0 : entry.mChainBytes[0];
+	mStatistics.streamedCount += entry.mStreamed ? 1 : 0;
+
+	mEntries[handle.idx] = std::move(entry);
+	return handle;
+}
+
+UploadTicket TextureResidency::UpdateTexture2D(TextureHandle handle, const TextureDescription2D& desc, UploadOwner owner)
+{
+	DEBUG_ASSERT(IsValid(handle), "Invalid texture handle!");
+
+	Entry entry = MakeEntry(desc, std::move(owner));
+
+	std::scoped_lock lock(mMutex);
+
+	auto found = mEntries.find(handle.idx);
+	if (found != mEntries.end())
+	{
+		const Entry& previous = found->second;
+		mStatistics.residentBytes -= previous.mChainBytes[previous.mResidentLevel];
+		mStatistics.pinnedBytes -= previous.mStreamed ? 0 : previous.mChainBytes[0];
+		mStatistics.streamedCount -= previous.mStreamed ? 1 : 0;
+	}
+
+	UploadBatch batch = mQueue.CreateBatch();
+	batch.UpdateTexture2D(handle, GetChainDescription(entry, entry.mResidentLevel), entry.mOwner);
+	entry.mPending = mQueue.Submit(std::move(batch));
+
+	mStatistics.residentBytes += entry.mChainBytes[entry.mResidentLevel];
+	mStatistics.pinnedBytes += entry.mStreamed ? 0 : entry.mChainBytes[0];
+	mStatistics.streamedCount += entry.mStreamed ? 1 : 0;
+
+	const UploadTicket ticket = entry.mPending;
+	mEntries[handle.idx] = std::move(entry);
+	return ticket;
+}
+
+void TextureResidency::DestroyTexture(TextureHandle handle)
+{
+	DEBUG_ASSERT(IsValid(handle), "Invalid texture handle!");
+
+	std::scoped_lock lock(mMutex);
+
+	auto found = mEntries.find(handle.idx);
+	if (found != mEntries.end())
+	{
+		const Entry& entry = found->second;
+		mStatistics.residentBytes -= entry.mChainBytes[entry.mResidentLevel];
+		mStatistics.pinnedBytes -= entry.mStreamed ? 0 : entry.mChainBytes[0];
+		mStatistics.streamedCount -= entry.mStreamed ? 1 : 0;
+
+		mQueued.erase(std::remove(mQueued.begin(), mQueued.end(), &entry), mQueued.end());
+		mEntries.erase(found);
+	}
+
+	// ordered after any level change already queued for the texture, those go up before it is released
+	UploadBatch batch = mQueue.CreateBatch();
+	batch.DestroyTexture(handle);
+	mQueue.Submit(std::move(batch));
+}
+
+void TextureResidency::Request(TextureHandle handle, f32 pixels)
+{
+	std::scoped_lock lock(mMutex);
+
+	auto found = mEntries.find(handle.idx);
+	if (found == mEntries.end() || !found->second.mStreamed)
+	{
+		return;
+	}
+
+	Entry& entry = found->second;
+	if (entry.mLastUsedFrame != mFrame)
+	{
+		entry.mLastUsedFrame = mFrame;
+		entry.mFootprint = 0;
+	}
+	entry.mFootprint = std::max(entry.mFootprint, pixels);
+}
+
+void TextureResidency::Update()
+{
+	std::scoped_lock lock(mMutex);
+
+	std::vector<std::pair<TextureHandle, Entry*>> loads;
+	u32 pending = 0;
+	for (auto& [handle, entry] : mEntries)
+	{
+		if (entry.mPending && mQueue.IsComplete(entry.mPending))
+		{
+			entry.mPending = 0;
+		}
+		pending += entry.mPending ? 1 : 0;
+
+		if (!entry.mStreamed || entry.mLastUsedFrame != mFrame)
+		{
+			continue;
+		}
+
+		// the coarsest level that still has a texel for every pixel
+		const u32 size = std::max(entry.mDesc.mWidth, entry.mDesc.mHeight);
+		u8 wanted = 0;
+		while (wanted < entry.mMinimumLevel && static_cast<f32>(size >> (wanted + 1)) >= entry.mFootprint)
+		{
+			++wanted;
+		}
+		entry.mWantedLevel = wanted;
+
+		if (wanted < entry.mResidentLevel && !entry.mPending)
+		{
+			loads.push_back({ { handle }, &entry });
+		}
+	}
+
+	// furthest from what they want first, then whatever covers the most pixels
+	std::sort(loads.begin(), loads.end(), [](const auto& lhs, const auto& rhs)
+	{
+		const u8 lhsMissing = lhs.second->mResidentLevel - lhs.second->mWantedLevel;
+		const u8 rhsMissing = rhs.second->mResidentLevel - rhs.second->mWantedLevel;
+		return lhsMissing != rhsMissing ? lhsMissing > rhsMissing : lhs.second->mFootprint > rhs.second->mFootprint;
+	});
+
+	UploadBatch batch = mQueue.CreateBatch();
+
+	// a lowered budget gives memory back even when nothing new is needed
+	MakeRoom(0, nullptr, batch);
+
+	// one level per texture and frame, the footprint is looked at again before going finer
+	for (auto& [handle, entry] : loads)
+	{
+		if (mQueued.size() >= kMaxRequestsPerFrame)
+		{
+			break;
+		}
+
+		const u8 level = entry->mResidentLevel - 1;
+		if (!MakeRoom(entry->mChainBytes[level] - entry->mChainBytes[entry->mResidentLevel], entry, batch))
+		{
+			break;
+		}
+
+		Upload(handle, *entry, level, batch);
+	}
+
+	mStatistics.pendingRequests = pending + static_cast<u32>(mQueued.size());
+	Submit(std::move(batch));
+
+	++mFrame;
+}
+
+void TextureResidency::SetBudget(u64 bytes)
+{
+	std::scoped_lock lock(mMutex);
+	mBudget = bytes;
+}
+
+u64 TextureResidency::GetBudget() const
+{
+	std::scoped_lock lock(mMutex);
+	return mBudget;
+}
+
+ResidencyStatistics TextureResidency::GetStatistics() const
+{
+	std::scoped_lock lock(mMutex);
+
+	ResidencyStatistics result = mStatistics;
+	result.budgetBytes = mBudget;
+	result.textureCount = static_cast<u32>(mEntries.size());
+	return result;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "core/Core.h"
+#include "memory/Utils.h"
+
+#include "RenderTypes.h"
+#include "UploadQueue.h"
+
+#include <mutex>
+
+namespace gold
+{
+	struct ResidencyStatistics
+	{
+		u64 budgetBytes = 0;
+
+		// streamed and pinned textures together
+		u64 residentBytes = 0;
+
+		// textures without a mip chain of their own, always fully resident
+		u64 pinnedBytes = 0;
+
+		u32 textureCount = 0;
+		u32 streamedCount = 0;
+
+		// level changes queued but not uploaded yet
+		u32 pendingRequests = 0;
+
+		// since startup
+		u64 loadedLevels = 0;
+		u64 evictedLevels = 0;
+	};
+
+	// decides which mip levels of each texture live on the GPU. Every change goes through the upload queue
+	// into the same client handle
+	class TextureResidency
+	{
+	public:
+		// levels at or below this size are uploaded right away and never evicted
+		static constexpr u32 kResidentSize = 64;
+
+		// loads and evictions queued per Update, keeps the upload queue short enough to react to the camera
+		static constexpr u32 kMaxRequestsPerFrame = 16;
+
+	private:
+		// desc is level 0, the data has to stay valid as long as owner lives
+		struct Entry
+		{
+			graphics::TextureDescription2D mDesc{};
+			UploadOwner mOwner;
+
+			bool mStreamed = false;
+			u8 mLevelCount = 1;
+			u8 mMinimumLevel = 0;	// coarsest level ever needed, see kResidentSize
+			u8 mResidentLevel = 0;	// finest level on the GPU or on its way there
+			u8 mWantedLevel = 0;
+
+			// bytes of the chain from each level down, mLevelCount entries
+			std::vector<u64> mChainBytes;
+
+			u64 mLastUsedFrame = 0;
+			f32 mFootprint = 0;
+
+			UploadTicket mPending = 0;
+		};
+
+		UploadQueue& mQueue;
+
+		mutable std::mutex mMutex;
+		std::unordered_map<u32, Entry> mEntries;
+		u64 mFrame = 1;
+		u64 mBudget = 512 * memory::MB;
+		ResidencyStatistics mStatistics;
+
+		// entries recorded into the batch being built, they get its ticket once it is submitted
+		std::vector<Entry*> mQueued;
+
+		// the chain from level down, as the upload queue takes it
+		graphics::TextureDescription2D GetChainDescription(const Entry& entry, u8 level) const;
+
+		Entry MakeEntry(const graphics::TextureDescription2D& desc, UploadOwner owner) const;
+
+		void Upload(graphics::TextureHandle handle, Entry& entry, u8 level, UploadBatch& batch);
+		void Submit(UploadBatch&& batch);
+
+		// evicts until bytes more fit into the budget, false when nothing evictable is left
+		bool MakeRoom(u64 bytes, const Entry* loading, UploadBatch& batch);
+
+	public:
+		explicit TextureResidency(UploadQueue& queue);
+
+		TextureResidency(const TextureResidency&) = delete;
+		TextureResidency& operator=(const TextureResidency&) = delete;
+
+		// any thread. Queues the first upload of a texture and manages it from then on. Textures without
+		// mips of their own are uploaded as they are and stay pinned
+		graphics::TextureHandle CreateTexture2D(const graphics::TextureDescription2D& desc, UploadOwner owner = nullptr);
+
+		// any thread. Replaces whatever the handle held (placeholders, hot reloads), residency starts over
+		UploadTicket UpdateTexture2D(graphics::TextureHandle handle, const graphics::TextureDescription2D& desc, UploadOwner owner = nullptr);
+
+		// any thread. Stops managing the texture and queues its release, the caller makes sure no frame still in
+		// flight samples it
+		void DestroyTexture(graphics::TextureHandle handle);
+
+		// update thread, for every texture a view samples. pixels is the footprint along the texture's larger axis
+		// for a texture mapped once across the surface, scale it by the material's uv scale
+		void Request(graphics::TextureHandle handle, f32 pixels);
+
+		// update thread, once per frame after every Request. Queues loads and evictions for the frame's requests
+		void Update();
+
+		void SetBudget(u64 bytes);
+		u64 GetBudget() const;
+
+		ResidencyStatistics GetStatistics() const;
+	};
+}
@@ -0,0 +1,357 @@
+#include "UploadQueue.h"
+
+#include "Renderer.h"
+
+#include <chrono>
+
+using namespace graphics;
+using namespace gold;
+
+using Clock = std::chrono::steady_clock;
+
+// buffers split across frames never go up in slices smaller than this
+static constexpr u64 kMinimumSlice = 1 * memory::MB;
+
+static f64 MillisecondsSince(Clock::time_point start)
+{
+	return std::chrono::duration<f64, std::milli>(Clock::now() - start).count();
+}
+
+static u64 GetTextureBytes(const TextureDescription2D& desc)
+{
+	u64 result = desc.mDataSize;
+	for (const auto& mip : desc.mMips)
+	{
+		result += mip.mDataSize;
+	}
+	return result;
+}
+
+UploadBatch::UploadBatch(ClientResources& resources)
+	: mResources(resources)
+{
+
+}
+
+VertexBufferHandle UploadBatch::CreateVertexBuffer(const void* data, u32 size, UploadOwner owner)
+{
+	Request& request = mRequests.emplace_back();
+	request.mType = RequestType::CreateVertexBuffer;
+	request.mHandle = mResources.CreateVertexBuffer().idx;
+	request.mData = static_cast<const u8*>(data);
+	request.mSize = size;
+	request.mOwner = std::move(owner);
+
+	mBytes += size;
+	return { request.mHandle };
+}
+
+IndexBufferHandle UploadBatch::CreateIndexBuffer(const void* data, u32 size, UploadOwner owner)
+{
+	Request& request = mRequests.emplace_back();
+	request.mType = RequestType::CreateIndexBuffer;
+	request.mHandle = mResources.CreateIndexBuffer().idx;
+	request.mData = static_cast<const u8*>(data);
+	request.mSize = size;
+	request.mOwner = std::move(owner);
+
+	mBytes += size;
+	return { request.mHandle };
+}
+
+MeshHandle UploadBatch::CreateMesh(const MeshDescription& desc)
+{
+	Request& request = mRequests.emplace_back();
+	request.mType = RequestType::CreateMesh;
+	request.mHandle = mResources.CreateMesh().idx;
+	request.mMesh = std::make_unique<MeshDescription>(desc);
+
+	return { request.mHandle };
+}
+
+TextureHandle UploadBatch::CreateTexture2D(const TextureDescription2D& desc, UploadOwner owner)
+{
+	Request& request = mRequests.emplace_back();
+	request.mType = RequestType::CreateTexture2D;
+	request.mHandle = mResources.CreateTexture().idx;
+	request.mTexture = desc;
+	request.mOwner = std::move(owner);
+
+	mBytes += GetTextureBytes(desc);
+	return { request.mHandle };
+}
+
+void UploadBatch::UpdateTexture2D(TextureHandle clientHandle, const TextureDescription2D& desc, UploadOwner owner)
+{
+	DEBUG_ASSERT(IsValid(clientHandle), "Invalid texture handle!");
+
+	Request& request = mRequests.emplace_back();
+	request.mType = RequestType::UpdateTexture2D;
+	request.mHandle = clientHandle.idx;
+	request.mTexture = desc;
+	request.mOwner = std::move(owner);
+
+	mBytes += GetTextureBytes(desc);
+}
+
+void UploadBatch::DestroyMesh(MeshHandle clientHandle, bool vertexBuffers)
+{
+	DEBUG_ASSERT(IsValid(clientHandle), "Invalid mesh handle!");
+
+	Request& request = mRequests.emplace_back();
+	request.mType = RequestType::DestroyMesh;
+	request.mHandle = clientHandle.idx;
+	request.mVertexBuffers = vertexBuffers;
+}
+
+void UploadBatch::DestroyTexture(TextureHandle clientHandle)
+{
+	DEBUG_ASSERT(IsValid(clientHandle), "Invalid texture handle!");
+
+	Request& request = mRequests.emplace_back();
+	request.mType = RequestType::DestroyTexture;
+	request.mHandle = clientHandle.idx;
+}
+
+UploadQueue::UploadQueue(ClientResources& resources)
+	: mClientResources(resources)
+{
+
+}
+
+UploadTicket UploadQueue::Submit(UploadBatch&& batch)
+{
+	DEBUG_ASSERT(&batch.mResources == &mClientResources, "Batch created by another queue!");
+
+	std::scoped_lock lock(mMutex);
+	for (Request& request : batch.mRequests)
+	{
+		request.mTicket = mNextTicket++;
+		mRequests.push(std::move(request));
+	}
+
+	mQueuedBytes += batch.mBytes;
+	batch.mRequests.clear();
+	batch.mBytes = 0;
+
+	return mNextTicket - 1;
+}
+
+UploadStatus UploadQueue::GetStatus(UploadTicket ticket) const
+{
+	return mCompleted.load(std::memory_order_acquire) >= ticket ? UploadStatus::Complete : UploadStatus::Queued;
+}
+
+bool UploadQueue::IsIdle() const
+{
+	std::scoped_lock lock(mMutex);
+	return mCompleted.load(std::memory_order_acquire) + 1 == mNextTicket;
+}
+
+void UploadQueue::SetBudget(const UploadBudget& budget)
+{
+	std::scoped_lock lock(mMutex);
+	mBudget = budget;
+}
+
+UploadBudget UploadQueue::GetBudget() const
+{
+	std::scoped_lock lock(mMutex);
+	return mBudget;
+}
+
+UploadStatistics UploadQueue::GetStatistics() const
+{
+	std::scoped_lock lock(mMutex);
+
+	UploadStatistics result = mStatistics;
+	result.queuedRequests = static_cast<u32>(mNextTicket - 1 - mCompleted.load(std::memory_order_acquire));
+	result.queuedBytes = mQueuedBytes;
+	return result;
+}
+
+// creates the buffer on the first slice, whole buffers that fit the allowance go up in a single call
+template<typename Request, typename Handle, typename Create, typename Update>
+static u64 UploadBufferSlice(Request& request, Handle& serverHandle, u64 allowance, bool& done, Create&& create, Update&& update)
+{
+	const u32 slice = static_cast<u32>(std::min<u64>(request.mSize - request.mUploaded, allowance));
+
+	if (request.mUploaded == 0 && slice == request.mSize)
+	{
+		serverHandle = create(request.mData, request.mSize);
+	}
+	else
+	{
+		if (request.mUploaded == 0)
+		{
+			serverHandle = create(nullptr, request.mSize);
+		}
+		update(serverHandle, request.mData + request.mUploaded, slice, request.mUploaded);
+	}
+
+	request.mUploaded += slice;
+	done = request.mUploaded == request.mSize;
+	return slice;
+}
+
+u64 UploadQueue::Process(Request& request, Renderer& renderer, ServerResources& resources, u64 allowance, bool& done)
+{
+	done = true;
+
+	switch (request.mType)
+	{
+	case UploadBatch::RequestType::CreateVertexBuffer:
+	{
+		VertexBufferHandle& serverHandle = resources.get(VertexBufferHandle{ request.mHandle });
+		return UploadBufferSlice(request, serverHandle, allowance, done,
+			[&renderer](const void* data, u32 size) { return renderer.CreateVertexBuffer(data, size); },
+			[&renderer](VertexBufferHandle handle, const void* data, u32 size, u32 offset) { renderer.UpdateVertexBuffer(handle, data, size, offset); });
+	}
+	case UploadBatch::RequestType::CreateIndexBuffer:
+	{
+		IndexBufferHandle& serverHandle = resources.get(IndexBufferHandle{ request.mHandle });
+		return UploadBufferSlice(request, serverHandle, allowance, done,
+			[&renderer](const void* data, u32 size) { return renderer.CreateIndexBuffer(data, size); },
+			[&renderer](IndexBufferHandle handle, const void* data, u32 size, u32 offset) { renderer.UpdateIndexBuffer(handle, data, size, offset); });
+	}
+	case UploadBatch::RequestType::CreateMesh:
+	{
+		auto remap = [&resources](auto clientHandle)
+		{
+			return clientHandle.idx == 0 ? clientHandle : resources.get(clientHandle);
+		};
+
+		// same translation the frame decoder does, the buffers were uploaded by earlier requests
+		MeshDescription desc = *request.mMesh;
+		desc.mInterlacedBuffer = remap(desc.mInterlacedBuffer);
+		if (!desc.mInterlacedBuffer.idx)
+		{
+			desc.handles.mPositions = remap(desc.handles.mPositions);
+			desc.handles.mNormals = remap(desc.handles.mNormals);
+			desc.handles.mTexCoords0 = remap(desc.handles.mTexCoords0);
+			desc.handles.mTexCoords1 = remap(desc.handles.mTexCoords1);
+			desc.handles.mColors = remap(desc.handles.mColors);
+			desc.handles.mJoints = remap(desc.handles.mJoints);
+			desc.handles.mWeights = remap(desc.handles.mWeights);
+		}
+		desc.mIndices = remap(desc.mIndices);
+
+		resources.get(MeshHandle{ request.mHandle }) = renderer.CreateMesh(desc);
+		return 0;
+	}
+	case UploadBatch::RequestType::CreateTexture2D:
+	{
+		resources.get(TextureHandle{ request.mHandle }) = renderer.CreateTexture2D(request.mTexture);
+		return GetTextureBytes(request.mTexture);
+	}
+	case UploadBatch::RequestType::UpdateTexture2D:
+	{
+		TextureHandle& serverHandle = resources.get(TextureHandle{ request.mHandle });
+
+		// storage is immutable, so swap in a new texture and release the old one
+		TextureHandle newHandle = renderer.CreateTexture2D(request.mTexture);
+		if (IsValid(serverHandle))
+		{
+			renderer.DestroyTexture(serverHandle);
+		}
+		serverHandle = newHandle;
+
+		return GetTextureBytes(request.mTexture);
+	}
+	case UploadBatch::RequestType::DestroyMesh:
+	{
+		MeshHandle& serverHandle = resources.get(MeshHandle{ request.mHandle });
+		if (IsValid(serverHandle))
+		{
+			renderer.DestroyMesh(serverHandle, request.mVertexBuffers);
+		}
+		serverHandle = {};
+		return 0;
+	}
+	case UploadBatch::RequestType::DestroyTexture:
+	{
+		TextureHandle& serverHandle = resources.get(TextureHandle{ request.mHandle });
+		if (IsValid(serverHandle))
+		{
+			renderer.DestroyTexture(serverHandle);
+		}
+		serverHandle = {};
+		return 0;
+	}
+	}
+
+	DEBUG_ASSERT(false, "Invalid upload request!");
+	return 0;
+}
+
+void UploadQueue::Drain(Renderer& renderer, ServerResources& resources)
+{
+	const UploadBudget budget = GetBudget();
+	const Clock::time_point start = Clock::now();
+
+	u64 frameBytes = 0;
+	u32 frameRequests = 0;
+	bool progressed = false;
+	while (true)
+	{
+		if (!mHasCurrent)
+		{
+			std::scoped_lock lock(mMutex);
+			if (mRequests.empty())
+			{
+				break;
+			}
+
+			mCurrent = std::move(mRequests.front());
+			mRequests.pop();
+			mHasCurrent = true;
+		}
+
+		if (progressed && (frameBytes >= budget.bytesPerFrame || MillisecondsSince(start) >= budget.millisecondsPerFrame))
+		{
+			break;
+		}
+		progressed = true;
+
+		const u64 allowance = std::max(budget.bytesPerFrame - std::min(frameBytes, budget.bytesPerFrame), kMinimumSlice);
+
+		bool done = false;
+		frameBytes += Process(mCurrent, renderer, resources, allowance, done);
+
+		if (done)
+		{
+			mCompleted.store(mCurrent.mTicket, std::memory_order_release);
+			mCurrent = {};
+			mHasCurrent = false;
+			++frameRequests;
+		}
+	}
+
+	if (!progressed)
+	{
+		// first idle frame after a burst, a single line instead of one per frame
+		if (mBurstFrames > 0)
+		{
+			G_ENGINE_INFO("Upload queue drained: {} requests, {} MB over {} frames, worst frame {:.2f}ms",
+				mBurstRequests, mBurstBytes / memory::MB, mBurstFrames, mBurstWorstMilliseconds);
+
+			mBurstRequests = 0;
+			mBurstBytes = 0;
+			mBurstFrames = 0;
+			mBurstWorstMilliseconds = 0;
+		}
+		return;
+	}
+
+	const f64 milliseconds = MillisecondsSince(start);
+
+	mBurstRequests += frameRequests;
+	mBurstBytes += frameBytes;
+	++mBurstFrames;
+	mBurstWorstMilliseconds = std::max(mBurstWorstMilliseconds, milliseconds);
+
+	std::scoped_lock lock(mMutex);
+	mQueuedBytes -= std::min(frameBytes, mQueuedBytes);
+	mStatistics.frameBytes = frameBytes;
+	mStatistics.frameMilliseconds = milliseconds;
+}
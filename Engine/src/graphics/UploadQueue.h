@@ -0,0 +1,170 @@
+#pragma once
+
+#include "core/Core.h"
+#include "memory/Utils.h"
+
+#include "RenderTypes.h"
+#include "RenderResources.h"
+
+#include <mutex>
+#include <atomic>
+
+namespace graphics
+{
+	class Renderer;
+}
+
+namespace gold
+{
+	// requests complete in submission order, a ticket is complete once every request up to it is
+	using UploadTicket = u64;
+
+	// keeps whatever a request's data points into alive until the render thread consumed it. Without one
+	// the caller has to keep the data valid until the request's ticket is complete
+	using UploadOwner = std::shared_ptr<const void>;
+
+	enum class UploadStatus : u8
+	{
+		Queued,
+		Complete,
+	};
+
+	// what the render thread may spend on uploads per frame. At least one request (or buffer slice) goes
+	// up every frame, so anything larger than the budget still finishes
+	struct UploadBudget
+	{
+		u64 bytesPerFrame = 32 * memory::MB;
+		f64 millisecondsPerFrame = 4.0;
+	};
+
+	struct UploadStatistics
+	{
+		u32 queuedRequests = 0;
+		u64 queuedBytes = 0;
+
+		// last frame that uploaded anything
+		u64 frameBytes = 0;
+		f64 frameMilliseconds = 0;
+	};
+
+	class UploadBatch
+	{
+	private:
+		friend class UploadQueue;
+
+		enum class RequestType : u8
+		{
+			CreateVertexBuffer,
+			CreateIndexBuffer,
+			CreateMesh,
+			CreateTexture2D,
+			UpdateTexture2D,
+			DestroyMesh,
+			DestroyTexture,
+		};
+
+		struct Request
+		{
+			RequestType mType{};
+			UploadTicket mTicket = 0;
+
+			// client handle, the type follows from mType
+			u32 mHandle = 0;
+
+			// buffers go up in slices, mUploaded is how much of mData already did
+			const u8* mData = nullptr;
+			u32 mSize = 0;
+			u32 mUploaded = 0;
+
+			// boxed, the description has no assignment operator
+			std::unique_ptr<graphics::MeshDescription> mMesh;
+			graphics::TextureDescription2D mTexture{};
+
+			UploadOwner mOwner;
+
+			// DestroyMesh only
+			bool mVertexBuffers = true;
+		};
+
+		ClientResources& mResources;
+		std::vector<Request> mRequests;
+		u64 mBytes = 0;
+
+		explicit UploadBatch(ClientResources& resources);
+
+	public:
+		// the handles are valid right away, the resources behind them exist once the batch is complete.
+		// Meshes may reference buffers from the same or an earlier batch
+		graphics::VertexBufferHandle CreateVertexBuffer(const void* data, u32 size, UploadOwner owner = nullptr);
+		graphics::IndexBufferHandle CreateIndexBuffer(const void* data, u32 size, UploadOwner owner = nullptr);
+		graphics::MeshHandle CreateMesh(const graphics::MeshDescription& desc);
+		graphics::TextureHandle CreateTexture2D(const graphics::TextureDescription2D& desc, UploadOwner owner = nullptr);
+
+		// replaces the storage behind clientHandle, the handle itself stays valid
+		void UpdateTexture2D(graphics::TextureHandle clientHandle, const graphics::TextureDescription2D& desc, UploadOwner owner = nullptr);
+
+		// releases the mesh and the buffers it references once the queue reaches it, without vertexBuffers its vertex
+		// buffers stay for the other meshes drawing them. The caller makes sure no frame still in flight draws it
+		void DestroyMesh(graphics::MeshHandle clientHandle, bool vertexBuffers = true);
+
+		// releases the texture once the queue reaches it. The caller makes sure no frame still in flight samples it
+		void DestroyTexture(graphics::TextureHandle clientHandle);
+
+		bool IsEmpty() const { return mRequests.empty(); }
+		u64 GetBytes() const { return mBytes; }
+	};
+
+	// resource creation outside of frames, drained by the render thread in submission order within a budget.
+	// Do not destroy a resource before its ticket is complete
+	class UploadQueue
+	{
+	private:
+		using Request = UploadBatch::Request;
+
+		ClientResources& mClientResources;
+
+		mutable std::mutex mMutex;
+		std::queue<Request> mRequests;
+		UploadTicket mNextTicket = 1;
+		UploadBudget mBudget;
+		u64 mQueuedBytes = 0;
+		UploadStatistics mStatistics;
+
+		std::atomic<UploadTicket> mCompleted = 0;
+
+		// render thread only. The request being worked on, a buffer larger than the budget spans frames
+		Request mCurrent;
+		bool mHasCurrent = false;
+
+		// render thread only, one burst is everything uploaded between two idle frames
+		u32 mBurstRequests = 0;
+		u64 mBurstBytes = 0;
+		u32 mBurstFrames = 0;
+		f64 mBurstWorstMilliseconds = 0;
+
+		u64 Process(Request& request, graphics::Renderer& renderer, ServerResources& resources, u64 allowance, bool& done);
+
+	public:
+		explicit UploadQueue(ClientResources& resources);
+
+		UploadQueue(const UploadQueue&) = delete;
+		UploadQueue& operator=(const UploadQueue&) = delete;
+
+		UploadBatch CreateBatch() { return UploadBatch(mClientResources); }
+
+		// returns the ticket of the batch's last request. Submitting an empty batch returns the latest ticket
+		UploadTicket Submit(UploadBatch&& batch);
+
+		UploadStatus GetStatus(UploadTicket ticket) const;
+		bool IsComplete(UploadTicket ticket) const { return GetStatus(ticket) == UploadStatus::Complete; }
+		bool IsIdle() const;
+
+		void SetBudget(const UploadBudget& budget);
+		UploadBudget GetBudget() const;
+
+		UploadStatistics GetStatistics() const;
+
+		// render thread, between BeginFrame and EndFrame
+		void Drain(graphics::Renderer& renderer, ServerResources& resources);
+	};
+}
@@ -2,6 +2,11 @@
 
 #include "core/Core.h"
 
+#include <glm/gtc/type_precision.hpp>
+
+#include <cstring>
+#include <tuple>
+
 namespace graphics
 {
 	class VertexLayout
@@ -15,6 +20,12 @@ namespace graphics
 			Normal,
 			Color3,
 			Color4,
+
+			// quantized, see VertexQuantization.h for the encoding
+			QuantizedPosition3, // unorm16 xyz relative to the mesh bounds, w is padding
+			OctNormal16,		// octahedral snorm16
+			OctNormal8,			// octahedral snorm8
+			HalfTexcoord2,		// half floats stored as raw bits
 		};
 		class Element
 		{
@@ -42,6 +53,11 @@ namespace graphics
 				case ElementType::Normal:	 return static_cast<uint32_t>(sizeof(glm::vec3));
 				case ElementType::Color3:	 return static_cast<uint32_t>(sizeof(glm::vec3));
 				case ElementType::Color4:	 return static_cast<uint32_t>(sizeof(glm::vec4));
+
+				case ElementType::QuantizedPosition3:	return static_cast<uint32_t>(sizeof(glm::u16vec4));
+				case ElementType::OctNormal16:			return static_cast<uint32_t>(sizeof(glm::i16vec2));
+				case ElementType::OctNormal8:			return static_cast<uint32_t>(sizeof(glm::i8vec2));
+				case ElementType::HalfTexcoord2:		return static_cast<uint32_t>(sizeof(glm::u16vec2));
 				}
 
 				return 0;
@@ -94,6 +110,144 @@ namespace graphics
 		std::vector<Element> mElements;
 	};
 
+	// the type an element is stored as
+	template<VertexLayout::ElementType type>
+	struct VertexElement;
+
+	template<> struct VertexElement<VertexLayout::Position2>			{ using Type = glm::vec2; };
+	template<> struct VertexElement<VertexLayout::Position3>			{ using Type = glm::vec3; };
+	template<> struct VertexElement<VertexLayout::Texcoord2>			{ using Type = glm::vec2; };
+	template<> struct VertexElement<VertexLayout::Normal>				{ using Type = glm::vec3; };
+	template<> struct VertexElement<VertexLayout::Color3>				{ using Type = glm::vec3; };
+	template<> struct VertexElement<VertexLayout::Color4>				{ using Type = glm::vec4; };
+	template<> struct VertexElement<VertexLayout::QuantizedPosition3>	{ using Type = glm::u16vec4; };
+	template<> struct VertexElement<VertexLayout::OctNormal16>			{ using Type = glm::i16vec2; };
+	template<> struct VertexElement<VertexLayout::OctNormal8>			{ using Type = glm::i8vec2; };
+	template<> struct VertexElement<VertexLayout::HalfTexcoord2>		{ using Type = glm::u16vec2; };
+
+	// compile time twin of VertexLayout, ToRuntime gives the VertexLayout model files use
+	template<VertexLayout::ElementType... types>
+	class VertexLayoutT
+	{
+	public:
+		static constexpr u32 kElementCount = static_cast<u32>(sizeof...(types));
+		STATIC_ASSERT(kElementCount > 0, "Empty vertex layout!");
+		STATIC_ASSERT(((sizeof(typename VertexElement<types>::Type) == VertexLayout::Element::SizeOfElement(types)) && ...), "Vertex element type and size disagree!");
+
+		static constexpr std::array<VertexLayout::ElementType, kElementCount> kTypes = { types... };
+		static constexpr u32 kStride = (static_cast<u32>(sizeof(typename VertexElement<types>::Type)) + ...);
+
+		static constexpr std::array<u32, kElementCount> kOffsets = []()
+		{
+			constexpr std::array<u32, kElementCount> sizes = { static_cast<u32>(sizeof(typename VertexElement<types>::Type))... };
+
+			std::array<u32, kElementCount> result{};
+			u32 offset = 0;
+			for (u32 i = 0; i < kElementCount; ++i)
+			{
+				result[i] = offset;
+				offset += sizes[i];
+			}
+			return result;
+		}();
+
+		template<u32 index>
+		using ElementT = std::tuple_element_t<index, std::tuple<typename VertexElement<types>::Type...>>;
+
+		template<VertexLayout::ElementType type>
+		static constexpr u32 IndexOf()
+		{
+			for (u32 i = 0; i < kElementCount; ++i)
+			{
+				if (kTypes[i] == type) return i;
+			}
+			return kElementCount;
+		}
+
+		template<VertexLayout::ElementType type>
+		static constexpr u32 OffsetOf()
+		{
+			STATIC_ASSERT(IndexOf<type>() < kElementCount, "Element is not part of the layout!");
+			return kOffsets[IndexOf<type>()];
+		}
+
+		static VertexLayout ToRuntime()
+		{
+			VertexLayout result;
+			(result.Push<types>(), ...);
+			return result;
+		}
+
+		static bool Matches(const VertexLayout& layout)
+		{
+			if (layout.ElementCount() != kElementCount)
+			{
+				return false;
+			}
+
+			for (u32 i = 0; i < kElementCount; ++i)
+			{
+				if (layout.Resolve(i).GetType() != kTypes[i])
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		// typed access to count interleaved vertices of this layout. A layout with a single element is one
+		// stream of a SoA mesh, so the same writers fill both
+		class View
+		{
+		private:
+			u8* mData = nullptr;
+			u32 mCount = 0;
+
+		public:
+			View(u8* data, u32 count)
+				: mData(data)
+				, mCount(count) {}
+
+			u32 Count() const { return mCount; }
+
+			// every element of one vertex
+			void Write(u32 vertex, const typename VertexElement<types>::Type&... values)
+			{
+				DEBUG_ASSERT(vertex < mCount, "Vertex out of range!");
+
+				u8* data = mData + static_cast<u64>(vertex) * kStride;
+				u32 index = 0;
+				(memcpy(data + kOffsets[index++], &values, sizeof(values)), ...);
+			}
+
+			// element index of vertex i becomes source(i), for all vertices
+			template<u32 index, typename Source>
+			void Fill(Source&& source)
+			{
+				u8* data = mData + kOffsets[index];
+				for (u32 i = 0; i < mCount; ++i, data += kStride)
+				{
+					const ElementT<index> value = source(i);
+					memcpy(data, &value, sizeof(value));
+				}
+			}
+
+			// element index of every vertex from an array of the stored type
+			template<u32 index>
+			void Copy(const ElementT<index>* source)
+			{
+				if constexpr (kElementCount == 1)
+				{
+					memcpy(mData, source, static_cast<u64>(mCount) * kStride);
+				}
+				else
+				{
+					Fill<index>([source](u32 i) { return source[i]; });
+				}
+			}
+		};
+	};
+
 	class Vertex
 	{
 		friend class VertexBuffer;
@@ -129,6 +283,22 @@ namespace graphics
 			{
 				return *reinterpret_cast<glm::vec4*>(attribPtr);
 			}
+			if constexpr (type == VertexLayout::ElementType::QuantizedPosition3)
+			{
+				return *reinterpret_cast<glm::u16vec4*>(attribPtr);
+			}
+			if constexpr (type == VertexLayout::ElementType::OctNormal16)
+			{
+				return *reinterpret_cast<glm::i16vec2*>(attribPtr);
+			}
+			if constexpr (type == VertexLayout::ElementType::OctNormal8)
+			{
+				return *reinterpret_cast<glm::i8vec2*>(attribPtr);
+			}
+			if constexpr (type == VertexLayout::ElementType::HalfTexcoord2)
+			{
+				return *reinterpret_cast<glm::u16vec2*>(attribPtr);
+			}
 ;		}
 
 	private:
@@ -151,6 +321,11 @@ namespace graphics
 			case VertexLayout::ElementType::Color3:	   SetAttrib<glm::vec3>(attribPtr, std::forward<T>(value)); break;
 			case VertexLayout::ElementType::Color4:    SetAttrib<glm::vec4>(attribPtr, std::forward<T>(value)); break;
 
+			case VertexLayout::ElementType::QuantizedPosition3: SetAttrib<glm::u16vec4>(attribPtr, std::forward<T>(value)); break;
+			case VertexLayout::ElementType::OctNormal16:		SetAttrib<glm::i16vec2>(attribPtr, std::forward<T>(value)); break;
+			case VertexLayout::ElementType::OctNormal8:			SetAttrib<glm::i8vec2>(attribPtr, std::forward<T>(value)); break;
+			case VertexLayout::ElementType::HalfTexcoord2:		SetAttrib<glm::u16vec2>(attribPtr, std::forward<T>(value)); break;
+
 			default: DEBUG_ASSERT(false, "Invalid Element Type");
 			}
 		}
@@ -215,13 +390,22 @@ namespace graphics
 		{
 			DEBUG_ASSERT(sizeof...(args) == mLayout.ElementCount(), "parameter count mismatch");
 
-			for (u32 i = 0; i < mLayout.Size(); ++i)
-			{
-				mBuffer.emplace_back(u8(0));
-			}
+			mBuffer.resize(mBuffer.size() + mLayout.Size());
 			Back().SetAttribByIndex(0u, std::forward<Args>(args)...);
 		}
 
+		// appends count zeroed vertices in one step and returns a typed view of them. Layout has to be the
+		// compile time version of this buffer's layout
+		template<typename Layout>
+		typename Layout::View Append(u32 count)
+		{
+			DEBUG_ASSERT(Layout::Matches(mLayout), "Vertex layout mismatch!");
+
+			const u64 offset = mBuffer.size();
+			mBuffer.resize(offset + static_cast<u64>(count) * Layout::kStride);
+			return typename Layout::View(mBuffer.data() + offset, count);
+		}
+
 		Vertex Back()
 		{
 			DEBUG_ASSERT(mBuffer.size() > 0, "Emtpy buffer!");
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "core/Core.h"
+#include "Vertex.h"
+
+#include <glm/gtc/type_precision.hpp>
+#include <glm/gtc/packing.hpp>
+
+// Encodings behind the quantized VertexLayout elements. Shared by the runtime loader and the AssetProcessor
+// so processed model files hold exactly what the GPU consumes, decoded in common/vertex_decoding.glslh
+namespace graphics::quantization
+{
+	// the interleaved 16 byte vertex of every loaded mesh, the same in processed model files and on the GPU
+	using MeshVertexLayout = VertexLayoutT<VertexLayout::QuantizedPosition3, VertexLayout::OctNormal16, VertexLayout::HalfTexcoord2>;
+	STATIC_ASSERT(MeshVertexLayout::kStride == 16, "Mesh vertices are expected to stay 16 bytes!");
+
+	struct PositionBounds
+	{
+		glm::vec3 scale{ 1, 1, 1 };
+		glm::vec3 offset{ 0 };
+	};
+
+	// flat axes keep a unit scale so nothing divides by zero
+	inline PositionBounds ComputePositionBounds(const glm::vec3& aabbMin, const glm::vec3& aabbMax)
+	{
+		const glm::vec3 extent = aabbMax - aabbMin;
+
+		PositionBounds result;
+		result.scale = { extent.x > 0.0f ? extent.x : 1.0f, extent.y > 0.0f ? extent.y : 1.0f, extent.z > 0.0f ? extent.z : 1.0f };
+		result.offset = aabbMin;
+		return result;
+	}
+
+	// QuantizedPosition3, unorm16 xyz relative to the bounds, w is padding
+	inline glm::u16vec4 QuantizePosition(const glm::vec3& position, const PositionBounds& bounds)
+	{
+		constexpr float kUnorm16Max = 65535.0f;
+
+		glm::vec3 normalized = glm::clamp((position - bounds.offset) / bounds.scale, 0.0f, 1.0f);
+		return glm::u16vec4(glm::u16vec3(glm::round(normalized * kUnorm16Max)), 0);
+	}
+
+	// OctNormal16
+	inline glm::i16vec2 EncodeOctahedral16(const glm::vec3& normal)
+	{
+		// project onto the octahedron, then fold the lower hemisphere over the diagonals
+		glm::vec3 n = normal / (std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z));
+		glm::vec2 encoded = { n.x, n.y };
+		if (n.z < 0.0f)
+		{
+			encoded.x = (1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f);
+			encoded.y = (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f);
+		}
+
+		constexpr float kSnorm16Max = 32767.0f;
+		return glm::i16vec2(glm::round(glm::clamp(encoded, -1.0f, 1.0f) * kSnorm16Max));
+	}
+
+	// HalfTexcoord2
+	inline glm::u16vec2 EncodeHalfTexcoord(const glm::vec2& texcoord)
+	{
+		return { glm::packHalf1x16(texcoord.x), glm::packHalf1x16(texcoord.y) };
+	}
+}
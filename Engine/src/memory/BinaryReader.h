@@ -58,6 +58,17 @@ namespace gold
 			return mMemory;
 		}
 
+		// address of the next read, for callers that use the data in place instead of copying it out
+		const u8* GetCurrentData() const
+		{
+			return mMemory + mOffset;
+		}
+
+		bool CanRead(u64 size) const
+		{
+			return size <= mSize - mOffset;
+		}
+
 		void Read(u8* data, u64 size)
 		{
 			DEBUG_ASSERT(size + mOffset <= mSize, "Data overflow!");
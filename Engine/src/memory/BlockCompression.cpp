@@ -0,0 +1,309 @@
+#include "BlockCompression.h"
+
+#include "core/ThreadPool.h"
+
+#include <atomic>
+
+using namespace gold;
+
+// format limits, shared with every other LZ4 block decoder
+static constexpr u32 kMinMatch = 4;
+static constexpr u32 kLastLiterals = 5;    // the block always ends in literals
+static constexpr u32 kMatchSafeDistance = 12; // the last match starts at least this far from the end
+static constexpr u32 kMaxOffset = 65535;
+
+static constexpr u32 kHashBits = 16;
+
+static u32 Load32(const u8* data)
+{
+	u32 result;
+	memcpy(&result, data, sizeof(u32));
+	return result;
+}
+
+static u32 HashSequence(u32 sequence)
+{
+	return (sequence * 2654435761u) >> (32 - kHashBits);
+}
+
+// lengths past what fits in the token continue as a run of 255s and a remainder
+static void WriteLength(u8*& out, u64 length)
+{
+	while (length >= 255)
+	{
+		*out++ = 255;
+		length -= 255;
+	}
+	*out++ = static_cast<u8>(length);
+}
+
+// literalCount literals followed by a match, matchLength 0 is the final literal only sequence
+static bool WriteSequence(u8*& out, const u8* outEnd, const u8* literals, u64 literalCount, u32 offset, u64 matchLength)
+{
+	const u64 worstCase = 1 + literalCount / 255 + 1 + literalCount + 2 + matchLength / 255 + 1;
+	if (worstCase > static_cast<u64>(outEnd - out))
+	{
+		return false;
+	}
+
+	u8* token = out++;
+	*token = static_cast<u8>(std::min<u64>(literalCount, 15) << 4);
+	if (literalCount >= 15)
+	{
+		WriteLength(out, literalCount - 15);
+	}
+
+	if (literalCount > 0)
+	{
+		memcpy(out, literals, literalCount);
+		out += literalCount;
+	}
+
+	if (matchLength == 0)
+	{
+		return true;
+	}
+
+	*out++ = static_cast<u8>(offset & 0xff);
+	*out++ = static_cast<u8>(offset >> 8);
+
+	const u64 extraLength = matchLength - kMinMatch;
+	*token |= static_cast<u8>(std::min<u64>(extraLength, 15));
+	if (extraLength >= 15)
+	{
+		WriteLength(out, extraLength - 15);
+	}
+
+	return true;
+}
+
+u64 compression::CompressBlock(const u8* source, u64 size, u8* destination, u64 capacity)
+{
+	const u8* const end = source + size;
+
+	u8* out = destination;
+	const u8* const outEnd = destination + capacity;
+
+	const u8* anchor = source;
+
+	// greedy matching against the last position each 4 byte sequence was seen at
+	if (size > kMatchSafeDistance)
+	{
+		std::vector<u32> table(1 << kHashBits, 0);
+
+		const u8* const matchLimit = end - kLastLiterals;
+		const u8* const searchLimit = end - kMatchSafeDistance;
+
+		const u8* ip = source;
+		while (ip <= searchLimit)
+		{
+			const u32 sequence = Load32(ip);
+			const u32 hash = HashSequence(sequence);
+
+			const u8* candidate = source + table[hash];
+			table[hash] = static_cast<u32>(ip - source);
+
+			if (candidate >= ip || ip - candidate > kMaxOffset || Load32(candidate) != sequence)
+			{
+				++ip;
+				continue;
+			}
+
+			// grow the match backwards into pending literals, then forwards
+			while (ip > anchor && candidate > source && ip[-1] == candidate[-1])
+			{
+				--ip;
+				--candidate;
+			}
+
+			const u8* matchEnd = ip + kMinMatch;
+			const u8* matchSource = candidate + kMinMatch;
+			while (matchEnd < matchLimit && *matchEnd == *matchSource)
+			{
+				++matchEnd;
+				++matchSource;
+			}
+
+			if (!WriteSequence(out, outEnd, anchor, ip - anchor, static_cast<u32>(ip - candidate), matchEnd - ip))
+			{
+				return 0;
+			}
+
+			ip = matchEnd;
+			anchor = ip;
+
+			// the bytes just skipped are likely to repeat as well
+			table[HashSequence(Load32(ip - 2))] = static_cast<u32>(ip - 2 - source);
+		}
+	}
+
+	if (!WriteSequence(out, outEnd, anchor, end - anchor, 0, 0))
+	{
+		return 0;
+	}
+
+	return static_cast<u64>(out - destination);
+}
+
+bool compression::DecompressBlock(const u8* source, u64 size, u8* destination, u64 destinationSize)
+{
+	const u8* ip = source;
+	const u8* const end = source + size;
+
+	u8* op = destination;
+	u8* const outEnd = destination + destinationSize;
+
+	auto readLength = [&ip, end](u64& length)
+	{
+		u8 byte = 255;
+		while (byte == 255)
+		{
+			if (ip == end)
+			{
+				return false;
+			}
+
+			byte = *ip++;
+			length += byte;
+		}
+		return true;
+	};
+
+	while (ip < end)
+	{
+		const u8 token = *ip++;
+
+		u64 literalCount = token >> 4;
+		if (literalCount == 15 && !readLength(literalCount))
+		{
+			return false;
+		}
+
+		if (literalCount > static_cast<u64>(end - ip) || literalCount > static_cast<u64>(outEnd - op))
+		{
+			return false;
+		}
+
+		if (literalCount > 0)
+		{
+			memcpy(op, ip, literalCount);
+			op += literalCount;
+			ip += literalCount;
+		}
+
+		// the final sequence has no match
+		if (ip == end)
+		{
+			return op == outEnd;
+		}
+
+		if (end - ip < 2)
+		{
+			return false;
+		}
+
+		const u32 offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if (offset == 0 || offset > static_cast<u64>(op - destination))
+		{
+			return false;
+		}
+
+		u64 matchLength = token & 15;
+		if (matchLength == 15 && !readLength(matchLength))
+		{
+			return false;
+		}
+		matchLength += kMinMatch;
+
+		if (matchLength > static_cast<u64>(outEnd - op))
+		{
+			return false;
+		}
+
+		// overlapping matches repeat the last offset bytes, they have to be copied front to back
+		const u8* match = op - offset;
+		if (offset >= matchLength)
+		{
+			memcpy(op, match, matchLength);
+			op += matchLength;
+		}
+		else
+		{
+			for (u64 i = 0; i < matchLength; ++i)
+			{
+				*op++ = *match++;
+			}
+		}
+	}
+
+	return false;
+}
+
+bool compression::DecompressBlocks(const u8* stream, u64 streamSize, u8* destination, u64 uncompressedSize, u32 blockSize, ThreadPool* pool)
+{
+	DEBUG_ASSERT(blockSize > 0, "Block size must be greater than 0");
+
+	const u32 blockCount = GetBlockCount(uncompressedSize, blockSize);
+	const u64 tableSize = static_cast<u64>(blockCount) * sizeof(u32);
+	if (streamSize < tableSize)
+	{
+		return false;
+	}
+
+	// block offsets from the size table, every block can then be decoded on its own
+	const u8* table = stream + streamSize - tableSize;
+	std::vector<u64> offsets(blockCount + 1, 0);
+	for (u32 i = 0; i < blockCount; ++i)
+	{
+		offsets[i + 1] = offsets[i] + (Load32(table + i * sizeof(u32)) & ~kStoredBlock);
+	}
+
+	if (offsets[blockCount] != streamSize - tableSize)
+	{
+		return false;
+	}
+
+	std::atomic<bool> succeeded = true;
+	auto decodeBlock = [&, stream, destination, table](u32 index)
+	{
+		const bool stored = (Load32(table + index * sizeof(u32)) & kStoredBlock) != 0;
+		const u8* source = stream + offsets[index];
+		const u64 sourceSize = offsets[index + 1] - offsets[index];
+
+		const u64 blockOffset = static_cast<u64>(index) * blockSize;
+		const u64 size = std::min<u64>(blockSize, uncompressedSize - blockOffset);
+
+		if (stored)
+		{
+			if (sourceSize != size)
+			{
+				succeeded = false;
+				return;
+			}
+			memcpy(destination + blockOffset, source, size);
+		}
+		else if (!DecompressBlock(source, sourceSize, destination + blockOffset, size))
+		{
+			succeeded = false;
+		}
+	};
+
+	if (!pool || blockCount < 2)
+	{
+		for (u32 i = 0; i < blockCount; ++i)
+		{
+			decodeBlock(i);
+		}
+		return succeeded;
+	}
+
+	TaskGroup tasks(*pool);
+	for (u32 i = 0; i < blockCount; ++i)
+	{
+		tasks.Submit([&decodeBlock, i]() { decodeBlock(i); });
+	}
+	tasks.Wait();
+
+	return succeeded;
+}
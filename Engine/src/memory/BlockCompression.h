@@ -0,0 +1,38 @@
+#pragma once
+
+#include "core/Core.h"
+
+namespace gold
+{
+	class ThreadPool;
+}
+
+// LZ4 block format compression, without frames or checksums. Larger data is split into independently
+// compressed blocks that decode in parallel. A block stream is laid out as:
+//
+//   compressed blocks, back to back
+//   u32 per block, its compressed size with kStoredBlock set when it is stored as is
+//
+// Every block but the last holds exactly blockSize bytes once decompressed
+namespace gold::compression
+{
+	constexpr u32 kDefaultBlockSize = 256 * 1024;
+
+	// blocks that do not shrink are stored instead, decoding them is a plain copy
+	constexpr u32 kStoredBlock = 0x80000000u;
+
+	// worst case compressed size, for incompressible data
+	constexpr u64 CompressBound(u64 size) { return size + size / 255 + 16; }
+
+	constexpr u32 GetBlockCount(u64 uncompressedSize, u32 blockSize) { return static_cast<u32>((uncompressedSize + blockSize - 1) / blockSize); }
+
+	// returns the compressed size, 0 when the result would not fit in capacity
+	u64 CompressBlock(const u8* source, u64 size, u8* destination, u64 capacity);
+
+	// fails on corrupt input instead of reading or writing out of bounds, destinationSize has to match exactly
+	bool DecompressBlock(const u8* source, u64 size, u8* destination, u64 destinationSize);
+
+	// decompresses a whole block stream into destination (uncompressedSize bytes). With a pool every block is its
+	// own task and this waits for them, do not call from a task of the same pool
+	bool DecompressBlocks(const u8* stream, u64 streamSize, u8* destination, u64 uncompressedSize, u32 blockSize, ThreadPool* pool = nullptr);
+}
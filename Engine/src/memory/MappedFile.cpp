@@ -0,0 +1,112 @@
+#include "MappedFile.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif defined (__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else 
+static_assert(false && "Unknown platform for file mapping!");
+#endif
+
+using namespace gold;
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open(const std::string& filepath)
+{
+	DEBUG_ASSERT(!IsOpen(), "File already mapped!");
+
+#if defined(_WIN32)
+	HANDLE file = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER size{};
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping == nullptr)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (data == nullptr)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	mFile = file;
+	mMapping = mapping;
+	mData = static_cast<const u8*>(data);
+	mSize = static_cast<u64>(size.QuadPart);
+#else
+	int file = open(filepath.c_str(), O_RDONLY);
+	if (file < 0)
+	{
+		return false;
+	}
+
+	struct stat info{};
+	if (fstat(file, &info) != 0 || info.st_size == 0)
+	{
+		close(file);
+		return false;
+	}
+
+	void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+
+	// the mapping keeps its own reference to the file
+	close(file);
+
+	if (data == MAP_FAILED)
+	{
+		return false;
+	}
+
+	// the loader walks the file front to back once
+	madvise(data, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+
+	mData = static_cast<const u8*>(data);
+	mSize = static_cast<u64>(info.st_size);
+#endif
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (!IsOpen())
+	{
+		return;
+	}
+
+#if defined(_WIN32)
+	UnmapViewOfFile(mData);
+	CloseHandle(static_cast<HANDLE>(mMapping));
+	CloseHandle(static_cast<HANDLE>(mFile));
+	mFile = nullptr;
+	mMapping = nullptr;
+#else
+	munmap(const_cast<u8*>(mData), static_cast<size_t>(mSize));
+#endif
+
+	mData = nullptr;
+	mSize = 0;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "core/Core.h"
+
+namespace gold
+{
+	// Read only view of a whole file mapped into the address space. Pages are faulted in on first access
+	// and backed by the file itself, so mapped data never has to be copied or freed by the application
+	class MappedFile
+	{
+	private:
+		const u8* mData = nullptr;
+		u64 mSize = 0;
+
+#if defined(_WIN32)
+		void* mFile = nullptr;
+		void* mMapping = nullptr;
+#endif
+
+	public:
+		MappedFile() = default;
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		// returns false when the file does not exist, is empty or cannot be mapped
+		bool Open(const std::string& filepath);
+		void Close();
+
+		bool IsOpen() const { return mData != nullptr; }
+
+		const u8* GetData() const { return mData; }
+		u64 GetSize() const { return mSize; }
+	};
+}
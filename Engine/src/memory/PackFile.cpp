@@ -0,0 +1,110 @@
+#include "PackFile.h"
+
+#include "core/Util.h"
+
+#include <algorithm>
+
+using namespace gold;
+
+std::string pack::NormalizePath(const std::string& path)
+{
+	std::string result;
+	result.reserve(path.size());
+
+	for (char c : path)
+	{
+		if (c == '\\')
+		{
+			c = '/';
+		}
+
+		if (c == '/' && (result.empty() || result.back() == '/'))
+		{
+			continue;
+		}
+
+		result.push_back(c);
+	}
+
+	while (result.compare(0, 2, "./") == 0)
+	{
+		result.erase(0, 2);
+	}
+
+	return result;
+}
+
+u64 pack::HashPath(const std::string& normalizedPath)
+{
+	return util::Hash64(normalizedPath.data(), normalizedPath.size());
+}
+
+bool PackFile::Open(const std::string& filepath)
+{
+	DEBUG_ASSERT(!IsOpen(), "Pack already open!");
+
+	if (!mFile.Open(filepath))
+	{
+		return false;
+	}
+
+	const u8* data = mFile.GetData();
+	const u64 size = mFile.GetSize();
+
+	pack::Header header;
+	if (size < sizeof(header))
+	{
+		mFile.Close();
+		return false;
+	}
+	memcpy(&header, data, sizeof(header));
+
+	const u64 tocSize = static_cast<u64>(header.entryCount) * sizeof(pack::TocEntry);
+	if (header.magic != pack::kMagic || header.version != pack::kVersion ||
+		header.tocOffset > size || tocSize > size - header.tocOffset || header.pathsOffset > size)
+	{
+		mFile.Close();
+		return false;
+	}
+
+	mEntries = reinterpret_cast<const pack::TocEntry*>(data + header.tocOffset);
+	mEntryCount = header.entryCount;
+	mPaths = reinterpret_cast<const char*>(data + header.pathsOffset);
+	mPathsSize = size - header.pathsOffset;
+
+	// validated once here so lookups can trust every entry
+	for (u32 i = 0; i < mEntryCount; ++i)
+	{
+		const pack::TocEntry& entry = mEntries[i];
+		if (entry.offset > size || entry.size > size - entry.offset ||
+			entry.pathOffset > mPathsSize || entry.pathLength > mPathsSize - entry.pathOffset)
+		{
+			mFile.Close();
+			mEntries = nullptr;
+			mEntryCount = 0;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool PackFile::Find(const std::string& normalizedPath, FileView& result) const
+{
+	const u64 hash = pack::HashPath(normalizedPath);
+
+	const pack::TocEntry* end = mEntries + mEntryCount;
+	const pack::TocEntry* entry = std::lower_bound(mEntries, end, hash, [](const pack::TocEntry& a, u64 b) { return a.pathHash < b; });
+
+	for (; entry != end && entry->pathHash == hash; ++entry)
+	{
+		if (normalizedPath.size() == entry->pathLength && normalizedPath.compare(0, entry->pathLength, mPaths + entry->pathOffset, entry->pathLength) == 0)
+		{
+			result.data = mFile.GetData() + entry->offset;
+			result.size = entry->size;
+			return true;
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "core/Core.h"
+#include "MappedFile.h"
+
+// Archives bundling runtime content (shaders, processed models, textures) into one file, written by the
+// AssetProcessor and mapped once at startup:
+//
+//   Header
+//   file data, every entry starting on a kAlignment boundary
+//   TocEntry per file, sorted by path hash, at Header::tocOffset
+//   paths, not terminated, at Header::pathsOffset
+//
+// Paths are relative to the packed directory, '/' separated. Everything is little endian
+namespace gold::pack
+{
+	constexpr u32 kMagic = 0x4b415047; // "GPAK"
+	constexpr u32 kVersion = 1;
+
+	// entries are page aligned, mapped data can be handed out without copying or straddling pages needlessly
+	constexpr u64 kAlignment = 4096;
+
+	struct Header
+	{
+		u32 magic = kMagic;
+		u32 version = kVersion;
+		u32 entryCount = 0;
+		u32 padding = 0;
+		u64 tocOffset = 0;
+		u64 pathsOffset = 0;
+	};
+
+	struct TocEntry
+	{
+		u64 pathHash = 0;
+		u64 offset = 0;
+		u64 size = 0;
+		u32 pathOffset = 0; // relative to Header::pathsOffset
+		u32 pathLength = 0;
+	};
+
+	STATIC_ASSERT(sizeof(Header) == 32, "Pack header size mismatch!");
+	STATIC_ASSERT(sizeof(TocEntry) == 32, "Pack entry size mismatch!");
+
+	// '/' separators, no leading "./" or repeated separators. Both the builder and lookups go through this
+	std::string NormalizePath(const std::string& path);
+
+	u64 HashPath(const std::string& normalizedPath);
+}
+
+namespace gold
+{
+	// read only view into mapped data, valid as long as whatever it was found in
+	struct FileView
+	{
+		const u8* data = nullptr;
+		u64 size = 0;
+	};
+
+	class PackFile
+	{
+	private:
+		MappedFile mFile;
+
+		const pack::TocEntry* mEntries = nullptr;
+		u32 mEntryCount = 0;
+		const char* mPaths = nullptr;
+		u64 mPathsSize = 0;
+
+	public:
+		// returns false when the file is missing, not an archive or its table of contents points outside of it
+		bool Open(const std::string& filepath);
+
+		bool IsOpen() const { return mFile.IsOpen(); }
+		u32 GetEntryCount() const { return mEntryCount; }
+		u64 GetSize() const { return mFile.GetSize(); }
+
+		// binary search on the path hash, the stored path settles collisions
+		bool Find(const std::string& normalizedPath, FileView& result) const;
+	};
+}
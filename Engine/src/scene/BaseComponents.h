@@ -5,6 +5,8 @@
 
 #include "graphics/Renderer.h"
 #include "graphics/Material.h"
+#include "graphics/LodSelector.h"
+#include "graphics/ClusterCulling.h"
 
 struct ChildrenComponent
 {
@@ -21,31 +23,66 @@ struct TagComponent
 	std::string tag;
 };
 
+// only written through the setters so the transform knows it changed
 struct TransformComponent
 {
+private:
+	friend class scene::TransformHierarchy;
+
+	glm::vec3 mPosition{ 0 };
+	glm::vec3 mRotation{};
+	glm::vec3 mScale{ 1,1,1 };
+
+	// set by the setters and by GameObject::SetParent, cleared by the update. New transforms start with both
+	bool mLocalDirty = true;
+	bool mParentChanged = true;
+
+public:
 	glm::vec3 prevPosition{ 0 };
-	glm::vec3 position{ 0 };
 
-	glm::vec3 rotation{};
-	glm::vec3 scale{ 1,1,1 };
+	const glm::vec3& GetPosition() const { return mPosition; }
+	const glm::vec3& GetRotation() const { return mRotation; }
+	const glm::vec3& GetScale() const { return mScale; }
+
+	void SetPosition(const glm::vec3& position) { mPosition = position; mLocalDirty = true; }
+	void SetRotation(const glm::vec3& rotation) { mRotation = rotation; mLocalDirty = true; }
+	void SetScale(const glm::vec3& scale) { mScale = scale; mLocalDirty = true; }
+
+	void MarkParentChanged() { mParentChanged = true; }
 
 	glm::mat4 GetMatrix() const
 	{
-		return glm::translate(position) * glm::toMat4(glm::quat(rotation)) * glm::scale(scale);
+		return glm::translate(mPosition) * glm::toMat4(glm::quat(mRotation)) * glm::scale(mScale);
 	}
 
 	glm::mat4 GetInterpolatedMatrix(float alpha) const
 	{
-		glm::vec3 pos = position;
+		glm::vec3 pos = mPosition;
 		if (glm::dot(prevPosition, prevPosition) > 0)
 		{
-			pos = position * alpha + prevPosition * (1.0f - alpha);
+			pos = mPosition * alpha + prevPosition * (1.0f - alpha);
 		}
 
-		return glm::translate(pos) * glm::toMat4(glm::quat(rotation)) * glm::scale(scale);
+		return glm::translate(pos) * glm::toMat4(glm::quat(mRotation)) * glm::scale(mScale);
 	}
 };
 
+// world matrix as of the last Scene::UpdateTransforms, added to every object with a TransformComponent
+struct WorldTransformComponent
+{
+	glm::mat4 world{ 1.0f };
+};
+
+// world bounds of the RenderComponent as of the last Scene::UpdateTransforms, only recomputed when the world
+// matrix or the mesh bounds change
+struct WorldAABBComponent
+{
+	AABB aabb{};
+
+	// leaf in the scene's AABBTree
+	u32 proxy = graphics::AABBTree::kNullNode;
+};
+
 struct LightComponent
 {
 	enum Type { Directional, Point };
@@ -54,11 +91,6 @@ struct LightComponent
 	glm::vec3 color;
 };
 
-struct NotFrustumCulledComponent
-{
-	u8 flag;
-};
-
 struct DirectionalLightComponent
 {
 	glm::vec4 direction{ 0,0,0,1 }; // xyz, dirty flag
@@ -154,6 +186,40 @@ struct RenderComponent
 	glm::vec3 aabbMin{};
 	glm::vec3 aabbMax{};
 
+	// set whenever aabbMin or aabbMax are written so the world bounds are recomputed, cleared by
+	// Scene::UpdateTransforms
+	bool boundsChanged = true;
+
+	// maps quantized [0, 1] vertex positions back into mesh space
+	glm::vec3 positionScale{ 1, 1, 1 };
+	glm::vec3 positionOffset{ 0 };
+
 	graphics::MeshHandle mesh{};
 	graphics::MaterialHandle material{};
+
+	// coarser levels of detail, index only: each draws the vertex buffer of mesh with its own indices.
+	// error is the simplification error relative to the mesh bounds diagonal
+	struct Lod
+	{
+		graphics::MeshHandle mesh{};
+		f32 error{};
+	};
+	static constexpr u8 kMaxLods = 4;
+	std::array<Lod, kMaxLods> lods{};
+	u8 lodCount = 0; // used entries in lods
+
+	// clusters of level 0 for culling within the mesh, null when the mesh was not processed offline.
+	// Shared since components are copied whenever a reload patches them
+	std::shared_ptr<const graphics::ClusterSet> clusters;
+
+	// level 0 is the full detail mesh
+	graphics::MeshHandle GetLodMesh(u8 lod) const
+	{
+		return lod == 0 ? mesh : lods[lod - 1].mesh;
+	}
+
+	u8 SelectLod(const graphics::LodView& view, const AABB& worldAABB) const
+	{
+		return graphics::LodSelector::SelectLod(view, worldAABB, lodCount + 1, [this](u8 lod) { return lods[lod - 1].error; });
+	}
 };
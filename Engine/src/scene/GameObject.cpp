@@ -1,9 +1,9 @@
 #include "GameObject.h"
 #include "BaseComponents.h"
 
-#include <glm/gtx/transform.hpp>
+#include "graphics/AABBCulling.h"
 
-#include "BaseComponents.h"
+#include <glm/gtx/transform.hpp>
 
 using namespace scene;
 
@@ -52,6 +52,8 @@ void GameObject::RemoveChildren(const std::vector<GameObject>& toRemove)
 
 void GameObject::SetParent(GameObject parent)
 {
+	GetComponent<TransformComponent>().MarkParentChanged();
+
 	if (!parent.IsValid())
 	{
 		if (HasComponent<ParentComponent>())
@@ -147,11 +149,13 @@ void GameObject::_AddChild(GameObject child)
 
 glm::mat4 GameObject::GetWorldSpaceTransform() const
 {
-	const auto& component = mRegistry->get<TransformComponent>(mEntity);
+	// cached by Scene::UpdateTransforms, objects created since then walk up their parents
+	if (const auto* world = mRegistry->try_get<WorldTransformComponent>(mEntity))
+	{
+		return world->world;
+	}
 
-	glm::mat4 result = glm::translate(component.position);
-	result *= glm::toMat4(glm::quat(component.rotation));
-	result *= glm::scale(component.scale);
+	glm::mat4 result = GetComponent<TransformComponent>().GetMatrix();
 
 	if (HasParent())
 	{
@@ -176,43 +180,17 @@ glm::mat4 GameObject::GetInterpolatedWorldSpaceTransform(float alpha) const
 
 AABB GameObject::GetAABB() const
 {
-	glm::vec3 minResult(std::numeric_limits<float>::max());
-	glm::vec3 maxResult(std::numeric_limits<float>::min());
-
-	if (HasComponent<RenderComponent>())
+	// cached by Scene::UpdateTransforms like the world matrix
+	if (const auto* world = mRegistry->try_get<WorldAABBComponent>(mEntity))
 	{
-		const auto& render = GetComponent<RenderComponent>();
-
-		glm::vec3 min = render.aabbMin;
-		glm::vec3 max = render.aabbMax;
-
-		std::array<glm::vec3, 8> box =
-		{
-			glm::vec3{min.x, min.y, min.z},
-			glm::vec3{max.x, min.y, min.z},
-			glm::vec3{max.x, min.y, max.z},
-			glm::vec3{min.x, min.y, max.z},
-
-			glm::vec3{min.x, max.y, min.z},
-			glm::vec3{max.x, max.y, min.z},
-			glm::vec3{max.x, max.y, max.z},
-			glm::vec3{min.x, max.y, max.z},
-		};
-
-		glm::mat4 transform = GetWorldSpaceTransform();
-		for (auto& corner : box)
-		{
-			glm::vec4 result = transform * glm::vec4(corner, 1.0);
-
-			if (result.x < minResult.x) minResult.x = result.x;
-			if (result.y < minResult.y) minResult.y = result.y;
-			if (result.z < minResult.z) minResult.z = result.z;
+		return world->aabb;
+	}
 
-			if (result.x > maxResult.x) maxResult.x = result.x;
-			if (result.y > maxResult.y) maxResult.y = result.y;
-			if (result.z > maxResult.z) maxResult.z = result.z;
-		}
+	if (!HasComponent<RenderComponent>())
+	{
+		return { glm::vec3(std::numeric_limits<float>::max()), glm::vec3(std::numeric_limits<float>::lowest()) };
 	}
 
-	return { minResult, maxResult };
+	const auto& render = GetComponent<RenderComponent>();
+	return graphics::TransformAABB({ render.aabbMin, render.aabbMax }, GetWorldSpaceTransform());
 }
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "core/Core.h"
+
+// Processed model files, written by the AssetProcessor and mapped straight into memory by scene::Loader.
+// Sections are written as they are produced, the table at the end of the file locates them:
+//
+//   Header
+//   AssetID model
+//   sections, in any order
+//   u32 sectionCount + SectionEntry per section, at Header::sectionTableOffset
+//
+// Textures section, per texture:
+//   u32 size + dds file
+// Materials section, per material:
+//   AssetID, then albedo, normal, metallic, roughness each as
+//   u8 hasTexture, then u32 texture index, or the constant (vec4 albedo, f32 metallic/roughness, nothing for normal)
+// Meshes section, per mesh:
+//   AssetID, vec3 aabbMin, vec3 aabbMax
+//   u32 elementCount + VertexLayout::ElementType per element
+//   u32 vertex bytes + vertices (quantized against the aabb, see VertexQuantization.h)
+//   IndexFormat, size_t indexCount + indices
+//   u8 lodCount, per level: f32 error, size_t indexCount + indices
+//   u32 meshletCount + graphics::Meshlet per cluster of level 0 (see Meshlet.h)
+//   AssetID material
+//
+// Sections are either stored as is or split into LZ4 compressed blocks (see memory/BlockCompression.h),
+// the layouts above describe them once decompressed.
+//
+// Everything is tightly packed, little endian
+namespace scene::model
+{
+	constexpr u32 kMagic = 0x4c444d47; // "GMDL"
+
+	// bump whenever the layout above changes, older files have to be reprocessed
+	constexpr u32 kVersion = 4;
+
+	struct Header
+	{
+		u32 magic = kMagic;
+		u32 version = kVersion;
+
+		// back patched once every section is written
+		u64 sectionTableOffset = 0;
+	};
+
+	enum class SectionType : u32
+	{
+		Textures = 0,
+		Materials,
+		Meshes,
+	};
+
+	enum class SectionCompression : u32
+	{
+		Store = 0,
+		BlockLZ4,
+	};
+
+	struct SectionEntry
+	{
+		SectionType type{};
+		u32 count = 0; // textures, materials or meshes in the section
+		u64 offset = 0;
+		u64 size = 0; // in the file
+
+		u64 uncompressedSize = 0;
+		SectionCompression compression = SectionCompression::Store;
+		u32 blockSize = 0; // BlockLZ4 only
+	};
+
+	STATIC_ASSERT(sizeof(Header) == 16, "Model header size mismatch!");
+	STATIC_ASSERT(sizeof(SectionEntry) == 40, "Model section entry size mismatch!");
+
+	constexpr u8 kAssetIDLength = 16;
+}
@@ -52,4 +52,9 @@ void Scene::FlushDestructionQueue()
 
 		mDeferredRemovalQueue.pop();
 	}
-}
\ No newline at end of file
+}
+
+void Scene::UpdateTransforms()
+{
+	mTransforms.Update(mRegistry);
+}
@@ -2,6 +2,7 @@
 
 #include "core/Core.h"
 #include "GameObject.h"
+#include "TransformHierarchy.h"
 
 #include <entt/entt.hpp>
 
@@ -13,6 +14,8 @@ namespace scene
 		entt::registry mRegistry;
 		std::queue<entt::entity> mDeferredRemovalQueue;
 
+		TransformHierarchy mTransforms;
+
 		std::mutex mMutex;
 
 	public:
@@ -25,6 +28,11 @@ namespace scene
 
 		void FlushDestructionQueue();
 
+		// recomputes the world matrices of objects whose transform or parent changed, call once per frame after
+		// the systems that move objects and before anything reads GetWorldSpaceTransform
+		void UpdateTransforms();
+		const TransformHierarchy& GetTransformHierarchy() const { return mTransforms; }
+
 		void ForEach(std::function<void(GameObject)>&& func);
 		void ForEach(std::function<void(const GameObject)>&& func) const;
 
@@ -10,51 +10,163 @@
 #include "graphics/Vertex.h"
 #include "graphics/Texture.h"
 #include "graphics/MaterialManager.h"
+#include "graphics/VertexQuantization.h"
+#include "graphics/DDS.h"
+#include "graphics/UploadQueue.h"
+#include "graphics/TextureCache.h"
+#include "graphics/TextureResidency.h"
+#include "graphics/FrameEncoder.h"
 
-#include <future>
+#include "scene/ModelFormat.h"
+
+#include "core/ThreadPool.h"
+#include "core/FileWatcher.h"
+#include "memory/Utils.h"
+#include "memory/MappedFile.h"
+#include "memory/BlockCompression.h"
+#include "core/VirtualFileSystem.h"
+
+#include <chrono>
 
 using namespace scene;
 
-static void CreateMaterial(const std::string& filepath, unsigned int index, aiMaterial** const materials, gold::FrameEncoder& encoder, RenderComponent& render);
-static void CreateMesh(const aiMesh* mesh, gold::FrameEncoder& encoder, RenderComponent& render);
+static void CreateMaterial(const std::string& filepath, unsigned int index, aiMaterial** const materials, RenderComponent& render);
+static graphics::Material ImportMaterial(const std::string& filepath, unsigned int index, aiMaterial** const materials);
 
 static std::unordered_map<u32, graphics::TextureHandle> kTextureCache;
 
-GameObject Loader::LoadGameObjectFromModel(Scene& scene, gold::FrameEncoder& encoder, const std::string& file)
+using Clock = std::chrono::steady_clock;
+
+enum class TextureUsage : u8
 {
-	constexpr unsigned int assimpFlags = 0	| aiProcess_Triangulate
-											| aiProcess_FlipUVs
-											| aiProcess_ImproveCacheLocality
-											| aiProcess_RemoveRedundantMaterials
-											| aiProcess_JoinIdenticalVertices
-											| aiProcess_SplitLargeMeshes
-											| aiProcess_OptimizeMeshes;
+	Albedo = 0,
+	Normal,
+	Metallic,
+	Roughness,
+};
 
-	Assimp::Importer importer;
-	const aiScene* assimpScene = importer.ReadFile(file, assimpFlags);
-	DEBUG_ASSERT(assimpScene && assimpScene->HasMeshes(), "Failed to load mesh file");
+// written by the decode workers and the update thread
+static std::mutex kLoadMutex;
+static f64 kDecodeMilliseconds = 0;
+static gold::UploadTicket kLoadTicket = 0;
+static std::atomic<u32> kPendingTextureCount = 0;
 
-	std::string filepath = file.substr(0, file.find_last_of('/'));
-	filepath += '/';
+// update thread only
+static bool kLoading = false;
+static u32 kLoadTextureCount = 0;
+static f64 kModelMilliseconds = 0;
+static Clock::time_point kLoadStart{};
 
-	
-	GameObject parentObject = scene.CreateGameObject(assimpScene->mName.C_Str());
-	
+// file decoding blocks for milliseconds at a time, it stays off the frame job pool so a frame waiting on its
+// jobs never ends up running a decode. Partly I/O bound, a quarter of the cores keeps up with the disk
+static gold::ThreadPool& GetDecodePool()
+{
+	static gold::ThreadPool pool(std::max(std::thread::hardware_concurrency() / 4, 2u));
+	return pool;
+}
 
-	for (u32 i = 0; i < assimpScene->mNumMeshes; ++i)
-	{
-		GameObject child = scene.CreateGameObject(assimpScene->mMeshes[i]->mName.C_Str());
-		child.SetParent(parentObject);
-		RenderComponent& render = child.AddComponent<RenderComponent>();
+static f64 MillisecondsSince(Clock::time_point start)
+{
+	return std::chrono::duration<f64, std::milli>(Clock::now() - start).count();
+}
+
+// loading is over once the latest ticket completed
+static gold::UploadTicket TrackUploads(gold::UploadTicket ticket)
+{
+	std::scoped_lock lock(kLoadMutex);
+	kLoadTicket = std::max(kLoadTicket, ticket);
+	return ticket;
+}
+
+static gold::UploadTicket SubmitUploads(gold::UploadQueue& queue, gold::UploadBatch&& uploads)
+{
+	return TrackUploads(queue.Submit(std::move(uploads)));
+}
 
-		CreateMesh(assimpScene->mMeshes[i], encoder, render);
-		CreateMaterial(filepath, assimpScene->mMeshes[i]->mMaterialIndex, assimpScene->mMaterials, encoder, render);
+// the first load after an idle period starts a new set of statistics
+static void BeginLoad(Clock::time_point start)
+{
+	if (kLoading)
+	{
+		return;
 	}
 
-	return parentObject;
+	kLoading = true;
+	kLoadStart = start;
+	kLoadTextureCount = 0;
+	kModelMilliseconds = 0;
+
+	std::scoped_lock lock(kLoadMutex);
+	kDecodeMilliseconds = 0;
 }
 
-static void CreateMesh(const aiMesh* mesh, gold::FrameEncoder& encoder, RenderComponent& render)
+// Hot reload state /////////////////////////////////////////////
+
+struct WatchedMesh
+{
+	GameObject mObject;
+
+	// geometry only, a mesh whose material changed keeps its buffers
+	u64 mHash = 0;
+
+	// assimp material index, processed models resolve materials by id
+	u32 mMaterialIndex = 0;
+};
+
+// update thread only. The scene and the objects created for the model have to outlive it
+struct WatchedModel
+{
+	std::string mFile;
+	Scene* mScene = nullptr;
+	GameObject mParent;
+	bool mProcessed = false;
+
+	// a reload is decoding or its patch waits for uploads, changes in the meantime reload once more afterwards
+	bool mReloading = false;
+	bool mChangedAgain = false;
+
+	// by position in the file
+	std::vector<WatchedMesh> mMeshes;
+
+	// processed models only, asset id and handle by position in the materials section
+	std::vector<std::pair<std::string, graphics::MaterialHandle>> mMaterials;
+
+	// processed models only, the textures created for the model that the current version may sample
+	std::vector<graphics::TextureHandle> mTextures;
+
+	// handles a reload left without a user, the material manager never frees one so later reloads take these first
+	std::vector<graphics::MaterialHandle> mSpareMaterials;
+};
+
+static void WatchModel(WatchedModel&& model);
+static void WatchTexture(const std::string& file, graphics::TextureHandle handle);
+
+// Assimp models ////////////////////////////////////////////////
+
+static constexpr unsigned int kAssimpFlags = 0	| aiProcess_Triangulate
+												| aiProcess_FlipUVs
+												| aiProcess_ImproveCacheLocality
+												| aiProcess_RemoveRedundantMaterials
+												| aiProcess_JoinIdenticalVertices
+												| aiProcess_SplitLargeMeshes
+												| aiProcess_OptimizeMeshes;
+
+// everything a mesh needs before it goes to the upload queue, built without touching any shared state
+// so reloads can import on the decode pool. The buffers are shared with the upload queue
+struct ImportedMesh
+{
+	std::string mName;
+	u32 mMaterialIndex = 0;
+	u64 mHash = 0;
+
+	glm::vec3 mAabbMin{};
+	glm::vec3 mAabbMax{};
+
+	std::shared_ptr<graphics::VertexBuffer> mVertices;
+	std::shared_ptr<std::vector<u32>> mIndices;
+};
+
+static ImportedMesh ImportMesh(const aiMesh* mesh)
 {
 	using namespace graphics;
 
@@ -62,95 +174,241 @@ static void CreateMesh(const aiMesh* mesh, gold::FrameEncoder& encoder, RenderCo
 	DEBUG_ASSERT(mesh->HasNormals(), "Mesh does not have normals!");
 	DEBUG_ASSERT(mesh->HasTextureCoords(0), "Mesh does not have texture coordinates!");
 
-	auto posBuffer = VertexBuffer(std::move(VertexLayout().Push<VertexLayout::Position3>()));
-	auto norBuffer = VertexBuffer(std::move(VertexLayout().Push<VertexLayout::Normal>()));
-	auto texBuffer = VertexBuffer(std::move(VertexLayout().Push<VertexLayout::Texcoord2>()));
-	posBuffer.Reserve(mesh->mNumVertices);
-	norBuffer.Reserve(mesh->mNumVertices);
-	texBuffer.Reserve(mesh->mNumVertices);
+	ImportedMesh result;
+	result.mName = mesh->mName.C_Str();
+	result.mMaterialIndex = mesh->mMaterialIndex;
+
+	// one interleaved stream of 16 bytes per vertex: unorm16 positions in mesh bounds, octahedral normals, half uvs
+	using Layout = quantization::MeshVertexLayout;
+	result.mVertices = std::make_shared<VertexBuffer>(Layout::ToRuntime());
 
-	constexpr float fMin = std::numeric_limits<float>::min();
 	constexpr float fMax = std::numeric_limits<float>::max();
-	render.aabbMin = { fMax,fMax,fMax };
-	render.aabbMax = { fMin, fMin, fMin};
+	constexpr float fLowest = std::numeric_limits<float>::lowest();
+	result.mAabbMin = { fMax, fMax, fMax };
+	result.mAabbMax = { fLowest, fLowest, fLowest };
 
 	for (size_t i = 0; i < mesh->mNumVertices; ++i)
 	{
 		glm::vec3 pos = { mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z };
 
-		if (pos.x < render.aabbMin.x) render.aabbMin.x = pos.x;
-		if (pos.y < render.aabbMin.y) render.aabbMin.y = pos.y;
-		if (pos.z < render.aabbMin.z) render.aabbMin.z = pos.z;
+		result.mAabbMin = glm::min(result.mAabbMin, pos);
+		result.mAabbMax = glm::max(result.mAabbMax, pos);
+	}
 
-		if (pos.x > render.aabbMax.x) render.aabbMax.x = pos.x;
-		if (pos.y > render.aabbMax.y) render.aabbMax.y = pos.y;
-		if (pos.z > render.aabbMax.z) render.aabbMax.z = pos.z;
+	const quantization::PositionBounds bounds = quantization::ComputePositionBounds(result.mAabbMin, result.mAabbMax);
 
-		auto nor = glm::vec3{ mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z };
-		auto tex = glm::vec2{ mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y };
+	Layout::View vertices = result.mVertices->Append<Layout>(mesh->mNumVertices);
+	for (u32 i = 0; i < mesh->mNumVertices; ++i)
+	{
+		glm::vec3 pos = { mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z };
+		glm::vec3 nor = { mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z };
+		glm::vec2 tex = { mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y };
 
-		posBuffer.Emplace(std::move(pos));
-		norBuffer.Emplace(std::move(nor));
-		texBuffer.Emplace(std::move(tex));
+		vertices.Write(i, quantization::QuantizePosition(pos, bounds), quantization::EncodeOctahedral16(nor), quantization::EncodeHalfTexcoord(tex));
 	}
 
-	DEBUG_ASSERT(posBuffer.VertexCount() == mesh->mNumVertices &&
-				 norBuffer.VertexCount() == mesh->mNumVertices &&
-				 texBuffer.VertexCount() == mesh->mNumVertices, "");
+	DEBUG_ASSERT(result.mVertices->VertexCount() == mesh->mNumVertices, "");
 
-	std::vector<u32> indices;
+	result.mIndices = std::make_shared<std::vector<u32>>();
 
-	indices.reserve(mesh->mNumFaces);
+	result.mIndices->reserve(mesh->mNumFaces * 3);
 	for (size_t i = 0; i < mesh->mNumFaces; ++i)
 	{
 		DEBUG_ASSERT(mesh->mFaces[i].mNumIndices == 3, "");
-		indices.push_back(mesh->mFaces[i].mIndices[0]);
-		indices.push_back(mesh->mFaces[i].mIndices[1]);
-		indices.push_back(mesh->mFaces[i].mIndices[2]);
+		result.mIndices->push_back(mesh->mFaces[i].mIndices[0]);
+		result.mIndices->push_back(mesh->mFaces[i].mIndices[1]);
+		result.mIndices->push_back(mesh->mFaces[i].mIndices[2]);
 	}
 
+	// quantized positions are relative to the bounds, so they are part of the geometry
+	const glm::vec3 aabb[] = { result.mAabbMin, result.mAabbMax };
+	result.mHash = util::Hash64(aabb, sizeof(aabb));
+	result.mHash = util::Hash64(result.mVertices->Raw(), result.mVertices->SizeInBytes(), result.mHash);
+	result.mHash = util::Hash64(result.mIndices->data(), result.mIndices->size() * sizeof(u32), result.mHash);
+
+	return result;
+}
+
+static void UploadImportedMesh(const ImportedMesh& mesh, gold::UploadBatch& uploads, RenderComponent& render)
+{
+	using namespace graphics;
+
+	render.aabbMin = mesh.mAabbMin;
+	render.aabbMax = mesh.mAabbMax;
+	render.boundsChanged = true;
+
+	const quantization::PositionBounds bounds = quantization::ComputePositionBounds(render.aabbMin, render.aabbMax);
+	render.positionScale = bounds.scale;
+	render.positionOffset = bounds.offset;
+
 	graphics::MeshDescription desc{};
 
-	desc.handles.mPositions = encoder.CreateVertexBuffer(posBuffer.Raw(), posBuffer.SizeInBytes());
-	desc.handles.mNormals = encoder.CreateVertexBuffer(norBuffer.Raw(), norBuffer.SizeInBytes());
-	desc.handles.mTexCoords0 = encoder.CreateVertexBuffer(texBuffer.Raw(), texBuffer.SizeInBytes());
+	using Layout = quantization::MeshVertexLayout;
+	desc.mInterlacedBuffer = uploads.CreateVertexBuffer(mesh.mVertices->Raw(), mesh.mVertices->SizeInBytes(), mesh.mVertices);
+	desc.mStride = Layout::kStride;
+	desc.offsets.mPositionOffset = Layout::OffsetOf<VertexLayout::QuantizedPosition3>();
+	desc.offsets.mNormalsOffset = Layout::OffsetOf<VertexLayout::OctNormal16>();
+	desc.offsets.mTexCoord0Offset = Layout::OffsetOf<VertexLayout::HalfTexcoord2>();
+
+	desc.mPositionFormat = VertexFormat::UNORM16x4;
+	desc.mNormalsFormat = VertexFormat::SNORM16x2;
+	desc.mTexCoord0Format = VertexFormat::HALFx2;
 
-	desc.mVertexCount = posBuffer.VertexCount();
+	desc.mVertexCount = mesh.mVertices->VertexCount();
 
-	if (indices.size() > 0)
+	if (mesh.mIndices->size() > 0)
 	{
 		desc.mIndicesFormat = IndexFormat::U32;
-		desc.mIndices = encoder.CreateIndexBuffer(indices.data(), static_cast<u32>(indices.size()) * sizeof(u32));
-		desc.mIndexCount = static_cast<uint32_t>(indices.size());
+		desc.mIndices = uploads.CreateIndexBuffer(mesh.mIndices->data(), static_cast<u32>(mesh.mIndices->size()) * sizeof(u32), mesh.mIndices);
+		desc.mIndexCount = static_cast<uint32_t>(mesh.mIndices->size());
 	}
 
-	render.mesh = encoder.CreateMesh(desc);
+	render.mesh = uploads.CreateMesh(desc);
+	render.lodCount = 0;
+	render.clusters = nullptr;
 }
 
-static std::mutex kTextureWriteMutex;
-static graphics::TextureHandle FindOrAddTexture(const std::string& file, gold::FrameEncoder& encoder)
+GameObject Loader::LoadGameObjectFromModel(Scene& scene, const std::string& file)
 {
-	u32 nameHash = util::Hash(file.c_str(), file.size());
-	if (kTextureCache.find(nameHash) == kTextureCache.end())
+	Clock::time_point start = Clock::now();
+	BeginLoad(start);
+
+	Assimp::Importer importer;
+	const aiScene* assimpScene = importer.ReadFile(file, kAssimpFlags);
+	DEBUG_ASSERT(assimpScene && assimpScene->HasMeshes(), "Failed to load mesh file");
+
+	std::string filepath = file.substr(0, file.find_last_of('/'));
+	filepath += '/';
+
+
+	GameObject parentObject = scene.CreateGameObject(assimpScene->mName.C_Str());
+
+	auto uploadQueue = Singletons::Get()->Resolve<gold::UploadQueue>();
+	gold::UploadBatch uploads = uploadQueue->CreateBatch();
+
+	WatchedModel watched;
+	watched.mFile = file;
+	watched.mScene = &scene;
+	watched.mParent = parentObject;
+
+	for (u32 i = 0; i < assimpScene->mNumMeshes; ++i)
+	{
+		const ImportedMesh mesh = ImportMesh(assimpScene->mMeshes[i]);
+
+		GameObject child = scene.CreateGameObject(mesh.mName);
+		child.SetParent(parentObject);
+		RenderComponent& render = child.AddComponent<RenderComponent>();
+
+		UploadImportedMesh(mesh, uploads, render);
+		CreateMaterial(filepath, mesh.mMaterialIndex, assimpScene->mMaterials, render);
+
+		watched.mMeshes.push_back({ child, mesh.mHash, mesh.mMaterialIndex });
+	}
+
+	const u64 queuedBytes = uploads.GetBytes();
+	SubmitUploads(*uploadQueue, std::move(uploads));
+
+	WatchModel(std::move(watched));
+
+	f64 modelMilliseconds = MillisecondsSince(start);
+	kModelMilliseconds += modelMilliseconds;
+
+	G_ENGINE_INFO("Loaded model {} in {:.2f}ms, {} MB of geometry queued, {} textures decoding on {} threads",
+		file, modelMilliseconds, queuedBytes / gold::memory::MB, kPendingTextureCount.load(), GetDecodePool().GetThreadCount());
+
+	return parentObject;
+}
+
+static graphics::TextureHandle CreatePlaceholderTexture(TextureUsage usage, gold::UploadBatch& uploads)
+{
+	// neutral 1x1 values for each slot so the scene renders sensibly before the real data arrives
+	static constexpr std::array<std::array<u8, 4>, 4> kPlaceholderColors = {{
+		{ 255, 255, 255, 255 }, // albedo
+		{ 128, 128, 255, 255 }, // flat tangent space normal
+		{   0,   0,   0, 255 }, // metallic
+		{ 255, 255, 255, 255 }, // roughness
+	}};
+
+	graphics::TextureDescription2D desc{};
+	desc.mWidth = 1;
+	desc.mHeight = 1;
+	desc.mData = kPlaceholderColors[static_cast<u8>(usage)].data();
+	desc.mDataSize = static_cast<u32>(kPlaceholderColors[static_cast<u8>(usage)].size());
+	desc.mFormat = graphics::TextureFormat::RGBA_U8;
+
+	return uploads.CreateTexture2D(desc);
+}
+
+// decodes on the pool and replaces the storage behind handle, which keeps its current contents when decoding fails
+static void DecodeTexture(graphics::TextureHandle handle, const std::string& file)
+{
+	++kPendingTextureCount;
+
+	auto residency = Singletons::Get()->Resolve<gold::TextureResidency>();
+	GetDecodePool().Submit([residency, handle, file]()
 	{
-		graphics::Texture2D texture(file);
-		graphics::TextureDescription2D desc(texture, true);
+		Clock::time_point start = Clock::now();
+
+		auto texture = std::make_shared<graphics::Texture2D>(file);
+
+		f64 decodeMilliseconds = MillisecondsSince(start);
+
+		if (texture->GetData())
+		{
+			// dds files carry a mip chain and are streamed, anything else is generated mips and stays pinned
+			TrackUploads(residency->UpdateTexture2D(handle, graphics::TextureDescription2D(*texture, true), texture));
+		}
+		else
+		{
+			G_ENGINE_ERROR("Failed to decode texture {}, keeping the current contents", file);
+		}
+
 		{
-			std::scoped_lock lock(kTextureWriteMutex);
-			kTextureCache[nameHash] = encoder.CreateTexture2D(desc);
+			std::scoped_lock lock(kLoadMutex);
+			kDecodeMilliseconds += decodeMilliseconds;
 		}
-		
+		--kPendingTextureCount;
+	});
+}
+
+static std::mutex kTextureWriteMutex;
+static graphics::TextureHandle FindOrAddTexture(const std::string& file, TextureUsage usage)
+{
+	u32 nameHash = util::Hash(file.c_str(), file.size());
+
+	std::scoped_lock lock(kTextureWriteMutex);
+	auto found = kTextureCache.find(nameHash);
+	if (found != kTextureCache.end())
+	{
+		return found->second;
 	}
 
-	return kTextureCache.find(nameHash)->second;
+	// the placeholder is queued first, uploads complete in order so the decoded texture replaces it
+	auto uploadQueue = Singletons::Get()->Resolve<gold::UploadQueue>();
+	gold::UploadBatch placeholder = uploadQueue->CreateBatch();
+	graphics::TextureHandle handle = CreatePlaceholderTexture(usage, placeholder);
+	SubmitUploads(*uploadQueue, std::move(placeholder));
+
+	kTextureCache[nameHash] = handle;
+	WatchTexture(file, handle);
+
+	++kLoadTextureCount;
+	DecodeTexture(handle, file);
+
+	return handle;
 }
 
-static void CreateMaterial(const std::string& filepath, unsigned int index, aiMaterial** const materials, gold::FrameEncoder& encoder, RenderComponent& render)
+static void CreateMaterial(const std::string& filepath, unsigned int index, aiMaterial** const materials, RenderComponent& render)
 {
 	auto materialManager = Singletons::Get()->Resolve<MaterialManager>();
 
 	render.material = materialManager->CreateMaterial();
-	auto bufferMaterial = materialManager->GetMaterial(render.material);
+	materialManager->UpdateMaterial(render.material, ImportMaterial(filepath, index, materials));
+}
+
+static graphics::Material ImportMaterial(const std::string& filepath, unsigned int index, aiMaterial** const materials)
+{
+	graphics::Material bufferMaterial{};
 	
 	const auto material = materials[index];
 
@@ -164,7 +422,7 @@ static void CreateMaterial(const std::string& filepath, unsigned int index, aiMa
 		material->GetTexture(aiTextureType_DIFFUSE,0, &albedo) || 
 		material->GetTexture(aiTextureType_AMBIENT, 0, &albedo))
 	{
-		bufferMaterial.mapFlags.x = FindOrAddTexture(filepath + albedo.C_Str(), encoder).idx;
+		bufferMaterial.mapFlags.x = FindOrAddTexture(filepath + albedo.C_Str(), TextureUsage::Albedo).idx;
 	}
 	else
 	{
@@ -178,13 +436,13 @@ static void CreateMaterial(const std::string& filepath, unsigned int index, aiMa
 	// normal
 	if (material->GetTexture(aiTextureType_NORMALS, 0, &normal) == AI_SUCCESS)
 	{
-		bufferMaterial.mapFlags.y = FindOrAddTexture(filepath + normal.C_Str(), encoder).idx;
+		bufferMaterial.mapFlags.y = FindOrAddTexture(filepath + normal.C_Str(), TextureUsage::Normal).idx;
 	}
 
 	// metallic
 	if (material->GetTexture(AI_MATKEY_METALLIC_TEXTURE, &metalic) == AI_SUCCESS)
 	{
-		bufferMaterial.mapFlags.z = FindOrAddTexture(filepath + metalic.C_Str(), encoder).idx;
+		bufferMaterial.mapFlags.z = FindOrAddTexture(filepath + metalic.C_Str(), TextureUsage::Metallic).idx;
 	}
 	else
 	{
@@ -198,7 +456,7 @@ static void CreateMaterial(const std::string& filepath, unsigned int index, aiMa
 	// roughness
 	if (material->GetTexture(AI_MATKEY_ROUGHNESS_TEXTURE, &roughness) == AI_SUCCESS)
 	{
-		bufferMaterial.mapFlags.w = FindOrAddTexture(filepath + roughness.C_Str(), encoder).idx;
+		bufferMaterial.mapFlags.w = FindOrAddTexture(filepath + roughness.C_Str(), TextureUsage::Roughness).idx;
 	}
 	else
 	{
@@ -209,5 +467,1226 @@ static void CreateMaterial(const std::string& filepath, unsigned int index, aiMa
 		}
 	}
 	
-	materialManager->UpdateMaterial(render.material, bufferMaterial);
+	return bufferMaterial;
+}
+
+
+// Processed model files ///////////////////////////////////////
+
+// mapped files stay open until the upload queue consumed every upload that points into them, same for the
+// sections decompressed out of them. Textures keep theirs open for the residency to stream levels from
+struct MappedModel
+{
+	std::unique_ptr<gold::MappedFile> mFile; // not open for packed models, the archive stays mapped anyway
+	std::vector<std::unique_ptr<u8[]>> mSections;
+	gold::UploadTicket mUploads = 0;
+};
+
+static std::vector<std::shared_ptr<MappedModel>> kMappedModels;
+
+// returns the region and moves past it, nullptr when the file is too short
+static const u8* ReadMappedRegion(gold::BinaryReader& reader, u64 size)
+{
+	if (!reader.CanRead(size))
+	{
+		return nullptr;
+	}
+
+	const u8* data = reader.GetCurrentData();
+	reader.Skip(size);
+	return data;
+}
+
+// the texture is described straight from the dds bytes inside the mapping, nothing is decoded or copied.
+// Invalid ones keep TextureFormat::INVALID
+static void ReadMappedTexture(gold::BinaryReader& reader, graphics::TextureDescription2D& desc)
+{
+	using namespace graphics;
+
+	const u32 ddsSize = reader.Read<u32>();
+	const u8* ddsData = ReadMappedRegion(reader, ddsSize);
+
+	dds::Image image;
+	if (!ddsData || !dds::Parse(ddsData, ddsSize, image))
+	{
+		G_ENGINE_ERROR("Invalid texture in processed model file, keeping the material constant");
+		return;
+	}
+
+	desc.mWidth = image.width;
+	desc.mHeight = image.height;
+	desc.mFormat = image.format;
+	desc.mData = image.data;
+	desc.mDataSize = GetTextureDataSize(image.format, image.width, image.height);
+
+	const u8* mip = image.data + desc.mDataSize;
+	for (u32 level = 1; level < image.mipCount; ++level)
+	{
+		const u32 mipSize = GetTextureDataSize(image.format, std::max(image.width >> level, 1u), std::max(image.height >> level, 1u));
+		desc.mMips.push_back({ mip, mipSize });
+		mip += mipSize;
+	}
+}
+
+struct MappedMaterial
+{
+	static constexpr u32 kNoTexture = std::numeric_limits<u32>::max();
+
+	std::string mID;
+	graphics::Material mMaterial{};
+
+	// indices into the textures section in mapFlags order, kNoTexture where the constant is used
+	std::array<u32, 4> mTextures{};
+};
+
+static bool ReadMappedMaterial(gold::BinaryReader& reader, MappedMaterial& result)
+{
+	const u8* id = ReadMappedRegion(reader, model::kAssetIDLength);
+	if (!id)
+	{
+		return false;
+	}
+
+	result.mID.assign(reinterpret_cast<const char*>(id), model::kAssetIDLength);
+	result.mTextures.fill(MappedMaterial::kNoTexture);
+
+	auto readMap = [&reader](u32& texture)
+	{
+		if (!reader.Read<u8>())
+		{
+			return false;
+		}
+
+		texture = reader.Read<u32>();
+		return true;
+	};
+
+	graphics::Material& material = result.mMaterial;
+	if (!readMap(result.mTextures[0])) material.albedo = reader.Read<glm::vec4>();
+	readMap(result.mTextures[1]);
+	if (!readMap(result.mTextures[2])) material.coefficients.x = reader.Read<f32>();
+	if (!readMap(result.mTextures[3])) material.coefficients.y = reader.Read<f32>();
+
+	return true;
+}
+
+// resolve turns a texture index into a handle, an invalid handle keeps the slot empty
+template<typename Resolve>
+static graphics::Material ResolveMappedMaterial(const MappedMaterial& material, Resolve&& resolve)
+{
+	graphics::Material result = material.mMaterial;
+	result.mapFlags.x = resolve(material.mTextures[0]).idx;
+	result.mapFlags.y = resolve(material.mTextures[1]).idx;
+	result.mapFlags.z = resolve(material.mTextures[2]).idx;
+	result.mapFlags.w = resolve(material.mTextures[3]).idx;
+	return result;
+}
+
+// points into the mapping or a decompressed section
+struct MappedMesh
+{
+	// of the asset id, which hashes the mesh contents already
+	u64 mHash = 0;
+	std::string mMaterialID;
+
+	glm::vec3 mAabbMin{};
+	glm::vec3 mAabbMax{};
+
+	const u8* mVertices = nullptr;
+	u32 mVertexBytes = 0;
+
+	// every level of detail draws the same vertex buffer with its own indices, level 0 first
+	struct Level
+	{
+		const u8* mIndices = nullptr;
+		u32 mIndexCount = 0;
+		f32 mError = 0;
+	};
+
+	graphics::IndexFormat mIndexFormat{};
+	std::vector<Level> mLevels;
+
+	// clusters of level 0, unaligned in the mapping
+	const u8* mMeshlets = nullptr;
+	u32 mMeshletCount = 0;
+};
+
+static bool ReadMappedMesh(gold::BinaryReader& reader, MappedMesh& result)
+{
+	using namespace graphics;
+
+	const u8* id = ReadMappedRegion(reader, model::kAssetIDLength);
+	if (!id)
+	{
+		return false;
+	}
+
+	result.mHash = util::Hash64(id, model::kAssetIDLength);
+	result.mAabbMin = reader.Read<glm::vec3>();
+	result.mAabbMax = reader.Read<glm::vec3>();
+
+	// the vertices are handed to the GPU as they are, so they have to be in the runtime layout
+	using Layout = quantization::MeshVertexLayout;
+
+	const u32 elementCount = reader.Read<u32>();
+	if (elementCount != Layout::kElementCount)
+	{
+		G_ENGINE_ERROR("Unexpected vertex layout in processed model file");
+		return false;
+	}
+
+	for (u32 i = 0; i < elementCount; ++i)
+	{
+		if (reader.Read<VertexLayout::ElementType>() != Layout::kTypes[i])
+		{
+			G_ENGINE_ERROR("Unexpected vertex layout in processed model file");
+			return false;
+		}
+	}
+
+	result.mVertexBytes = reader.Read<u32>();
+	result.mVertices = ReadMappedRegion(reader, result.mVertexBytes);
+	if (!result.mVertices)
+	{
+		return false;
+	}
+
+	result.mIndexFormat = reader.Read<IndexFormat>();
+	const u32 indexSize = result.mIndexFormat == IndexFormat::U16 ? sizeof(u16) : sizeof(u32);
+
+	auto readLevel = [&reader, &result, indexSize](f32 error)
+	{
+		const u64 indexCount = reader.Read<size_t>();
+		const u8* indices = ReadMappedRegion(reader, indexCount * indexSize);
+		if (!indices)
+		{
+			return false;
+		}
+
+		result.mLevels.push_back({ indices, static_cast<u32>(indexCount), error });
+		return true;
+	};
+
+	if (!readLevel(0.0f))
+	{
+		return false;
+	}
+
+	const u8 lodCount = reader.Read<u8>();
+	DEBUG_ASSERT(lodCount <= RenderComponent::kMaxLods, "Too many levels of detail!");
+
+	for (u8 i = 0; i < lodCount; ++i)
+	{
+		const f32 error = reader.Read<f32>();
+		if (!readLevel(error))
+		{
+			return false;
+		}
+	}
+
+	result.mMeshletCount = reader.Read<u32>();
+	result.mMeshlets = ReadMappedRegion(reader, result.mMeshletCount * sizeof(graphics::Meshlet));
+	if (!result.mMeshlets)
+	{
+		return false;
+	}
+
+	const u8* materialID = ReadMappedRegion(reader, model::kAssetIDLength);
+	if (!materialID)
+	{
+		return false;
+	}
+
+	result.mMaterialID.assign(reinterpret_cast<const char*>(materialID), model::kAssetIDLength);
+	return true;
+}
+
+static void UploadMappedMesh(const MappedMesh& mesh, gold::UploadBatch& uploads, RenderComponent& render)
+{
+	using namespace graphics;
+
+	render.aabbMin = mesh.mAabbMin;
+	render.aabbMax = mesh.mAabbMax;
+	render.boundsChanged = true;
+
+	const quantization::PositionBounds bounds = quantization::ComputePositionBounds(render.aabbMin, render.aabbMax);
+	render.positionScale = bounds.scale;
+	render.positionOffset = bounds.offset;
+
+	using Layout = quantization::MeshVertexLayout;
+
+	MeshDescription desc{};
+	desc.mInterlacedBuffer = uploads.CreateVertexBuffer(mesh.mVertices, mesh.mVertexBytes);
+	desc.mStride = Layout::kStride;
+	desc.offsets.mPositionOffset = Layout::OffsetOf<VertexLayout::QuantizedPosition3>();
+	desc.offsets.mNormalsOffset = Layout::OffsetOf<VertexLayout::OctNormal16>();
+	desc.offsets.mTexCoord0Offset = Layout::OffsetOf<VertexLayout::HalfTexcoord2>();
+
+	desc.mPositionFormat = VertexFormat::UNORM16x4;
+	desc.mNormalsFormat = VertexFormat::SNORM16x2;
+	desc.mTexCoord0Format = VertexFormat::HALFx2;
+
+	desc.mVertexCount = mesh.mVertexBytes / Layout::kStride;
+
+	desc.mIndicesFormat = mesh.mIndexFormat;
+	const u32 indexSize = desc.mIndicesFormat == IndexFormat::U16 ? sizeof(u16) : sizeof(u32);
+
+	auto createLevel = [&uploads, &desc, indexSize](const MappedMesh::Level& level)
+	{
+		desc.mIndices = uploads.CreateIndexBuffer(level.mIndices, level.mIndexCount * indexSize);
+		desc.mIndexCount = level.mIndexCount;
+		return uploads.CreateMesh(desc);
+	};
+
+	render.mesh = createLevel(mesh.mLevels[0]);
+
+	render.lodCount = 0;
+	for (size_t i = 1; i < mesh.mLevels.size() && render.lodCount < RenderComponent::kMaxLods; ++i)
+	{
+		render.lods[render.lodCount++] = { createLevel(mesh.mLevels[i]), mesh.mLevels[i].mError };
+	}
+
+	render.clusters = nullptr;
+	if (mesh.mMeshletCount > 0)
+	{
+		std::vector<Meshlet> meshlets(mesh.mMeshletCount);
+		memcpy(meshlets.data(), mesh.mMeshlets, mesh.mMeshletCount * sizeof(Meshlet));
+		render.clusters = std::make_shared<ClusterSet>(meshlets.data(), mesh.mMeshletCount);
+	}
+}
+
+struct LoadedSection
+{
+	const u8* mData = nullptr;
+	u64 mSize = 0;
+	u32 mCount = 0;
+};
+
+// lz4 can at most expand 255 to 1, anything claiming more is corrupt and must not size an allocation
+static bool IsValidSection(const gold::FileView& file, const model::SectionEntry& section)
+{
+	using namespace gold::compression;
+
+	if (section.offset > file.size || section.size > file.size - section.offset)
+	{
+		return false;
+	}
+
+	switch (section.compression)
+	{
+	case model::SectionCompression::Store:
+		return section.uncompressedSize == section.size;
+	case model::SectionCompression::BlockLZ4:
+		return section.blockSize > 0 && section.uncompressedSize / 255 <= section.size &&
+			static_cast<u64>(GetBlockCount(section.uncompressedSize, section.blockSize)) * sizeof(u32) <= section.size;
+	default:
+		return false;
+	}
+}
+
+// compressed sections are decompressed on the pool (serially without one), returns false when a section is corrupt
+static bool LoadSections(const gold::FileView& file, const std::vector<model::SectionEntry>& sections, gold::ThreadPool* pool, MappedModel& owner, std::array<LoadedSection, 3>& result)
+{
+	static constexpr const char* kSectionNames[] = { "textures", "materials", "meshes" };
+
+	for (const model::SectionEntry& section : sections)
+	{
+		const u32 type = static_cast<u32>(section.type);
+		if (type >= result.size() || result[type].mData)
+		{
+			continue;
+		}
+
+		if (!IsValidSection(file, section))
+		{
+			return false;
+		}
+
+		LoadedSection& loaded = result[type];
+		loaded.mCount = section.count;
+		loaded.mSize = section.uncompressedSize;
+
+		if (section.compression == model::SectionCompression::Store)
+		{
+			loaded.mData = file.data + section.offset;
+			continue;
+		}
+
+		Clock::time_point start = Clock::now();
+
+		auto data = std::make_unique<u8[]>(section.uncompressedSize);
+		if (!gold::compression::DecompressBlocks(file.data + section.offset, section.size, data.get(), section.uncompressedSize, section.blockSize, pool))
+		{
+			return false;
+		}
+
+		const f64 milliseconds = MillisecondsSince(start);
+		G_ENGINE_INFO("    {}: {} KB -> {} KB decompressed in {:.2f}ms ({:.0f} MB/s)", kSectionNames[type], section.size / gold::memory::KB, section.uncompressedSize / gold::memory::KB,
+			milliseconds, milliseconds > 0.0 ? (section.uncompressedSize / static_cast<f64>(gold::memory::MB)) / (milliseconds / 1000.0) : 0.0);
+
+		loaded.mData = data.get();
+		owner.mSections.push_back(std::move(data));
+	}
+
+	return true;
+}
+
+static gold::BinaryReader GetSectionReader(const LoadedSection& section)
+{
+	// the readers only ever read, the cast is for their interface
+	return gold::BinaryReader(const_cast<u8*>(section.mData), section.mSize);
+}
+
+// a fully parsed file, nothing created yet. Everything points into mOwner
+struct ProcessedModel
+{
+	std::shared_ptr<MappedModel> mOwner = std::make_shared<MappedModel>();
+	bool mPacked = false;
+
+	std::vector<graphics::TextureDescription2D> mTextures;
+	std::vector<MappedMaterial> mMaterials;
+	std::vector<MappedMesh> mMeshes;
+
+	u64 mMappedBytes = 0;
+	u64 mDecompressedBytes = 0;
+};
+
+// touches no shared state, safe on any thread. Logs and returns false when the file is missing,
+// from another version or corrupt
+static bool ReadProcessedModel(const std::string& file, gold::ThreadPool* pool, ProcessedModel& result)
+{
+	// packed models are read straight out of the archive mapping, loose ones get a mapping of their own
+	auto mapped = std::make_unique<gold::MappedFile>();
+	gold::FileView view;
+	result.mPacked = gold::vfs::Find(file, view);
+	if (!result.mPacked)
+	{
+		if (!mapped->Open(file))
+		{
+			G_ENGINE_WARN("Could not map processed model {}", file);
+			return false;
+		}
+
+		view = { mapped->GetData(), mapped->GetSize() };
+	}
+
+	// the readers only ever read, the casts are for their interface
+	gold::BinaryReader reader(const_cast<u8*>(view.data), view.size);
+
+	if (!reader.CanRead(sizeof(model::Header)))
+	{
+		G_ENGINE_ERROR("Processed model {} is too small", file);
+		return false;
+	}
+
+	const model::Header header = reader.Read<model::Header>();
+	if (header.magic != model::kMagic)
+	{
+		G_ENGINE_ERROR("{} is not a processed model file", file);
+		return false;
+	}
+
+	if (header.version != model::kVersion)
+	{
+		G_ENGINE_ERROR("Processed model {} has version {}, expected {}. Run it through the AssetProcessor again", file, header.version, model::kVersion);
+		return false;
+	}
+
+	// section table
+	std::vector<model::SectionEntry> sections;
+	{
+		if (header.sectionTableOffset > view.size - sizeof(u32))
+		{
+			G_ENGINE_ERROR("Processed model {} is truncated", file);
+			return false;
+		}
+
+		gold::BinaryReader tableReader(const_cast<u8*>(view.data) + header.sectionTableOffset, view.size - header.sectionTableOffset);
+		const u32 sectionCount = tableReader.Read<u32>();
+		if (!tableReader.CanRead(static_cast<u64>(sectionCount) * sizeof(model::SectionEntry)))
+		{
+			G_ENGINE_ERROR("Processed model {} is truncated", file);
+			return false;
+		}
+
+		sections.resize(sectionCount);
+		tableReader.Read(reinterpret_cast<u8*>(sections.data()), sectionCount * sizeof(model::SectionEntry));
+	}
+
+	std::array<LoadedSection, 3> loadedSections{};
+	if (!LoadSections(view, sections, pool, *result.mOwner, loadedSections))
+	{
+		G_ENGINE_ERROR("Processed model {} is truncated or corrupt", file);
+		return false;
+	}
+
+	{
+		const LoadedSection& section = loadedSections[static_cast<u32>(model::SectionType::Textures)];
+		gold::BinaryReader sectionReader = GetSectionReader(section);
+
+		result.mTextures.resize(section.mCount);
+		for (graphics::TextureDescription2D& texture : result.mTextures)
+		{
+			ReadMappedTexture(sectionReader, texture);
+		}
+	}
+
+	{
+		const LoadedSection& section = loadedSections[static_cast<u32>(model::SectionType::Materials)];
+		gold::BinaryReader sectionReader = GetSectionReader(section);
+
+		result.mMaterials.resize(section.mCount);
+		for (MappedMaterial& material : result.mMaterials)
+		{
+			if (!ReadMappedMaterial(sectionReader, material))
+			{
+				G_ENGINE_ERROR("Processed model {} is truncated or corrupt", file);
+				return false;
+			}
+		}
+	}
+
+	{
+		const LoadedSection& section = loadedSections[static_cast<u32>(model::SectionType::Meshes)];
+		gold::BinaryReader sectionReader = GetSectionReader(section);
+
+		result.mMeshes.resize(section.mCount);
+		for (MappedMesh& mesh : result.mMeshes)
+		{
+			if (!ReadMappedMesh(sectionReader, mesh))
+			{
+				G_ENGINE_ERROR("Processed model {} is truncated or corrupt", file);
+				return false;
+			}
+		}
+	}
+
+	result.mMappedBytes = view.size;
+	for (const model::SectionEntry& section : sections)
+	{
+		result.mDecompressedBytes += section.compression == model::SectionCompression::Store ? 0 : section.uncompressedSize;
+	}
+
+	result.mOwner->mFile = std::move(mapped);
+	return true;
+}
+
+GameObject Loader::LoadGameObjectFromProcessedModel(Scene& scene, const std::string& file)
+{
+	Clock::time_point start = Clock::now();
+	BeginLoad(start);
+
+	// parsed completely before anything is created, a corrupt file leaves no objects or uploads behind
+	ProcessedModel processed;
+	if (!ReadProcessedModel(file, Singletons::Get()->Resolve<gold::ThreadPool>().get(), processed))
+	{
+		return {};
+	}
+
+	auto uploadQueue = Singletons::Get()->Resolve<gold::UploadQueue>();
+	auto residency = Singletons::Get()->Resolve<gold::TextureResidency>();
+	auto materialManager = Singletons::Get()->Resolve<MaterialManager>();
+
+	// textures before meshes, only their coarse levels go up now
+	std::vector<graphics::TextureHandle> textures;
+	textures.reserve(processed.mTextures.size());
+	for (const graphics::TextureDescription2D& texture : processed.mTextures)
+	{
+		textures.push_back(texture.mFormat != graphics::TextureFormat::INVALID ? residency->CreateTexture2D(texture, processed.mOwner) : graphics::TextureHandle{});
+	}
+
+	gold::UploadBatch uploads = uploadQueue->CreateBatch();
+
+	auto resolve = [&textures](u32 index)
+	{
+		return index < textures.size() ? textures[index] : graphics::TextureHandle{};
+	};
+
+	WatchedModel watched;
+	watched.mFile = file;
+	watched.mScene = &scene;
+	watched.mProcessed = true;
+
+	std::unordered_map<std::string, graphics::MaterialHandle> materials;
+	for (const MappedMaterial& material : processed.mMaterials)
+	{
+		const graphics::MaterialHandle handle = materialManager->CreateMaterial();
+		materialManager->UpdateMaterial(handle, ResolveMappedMaterial(material, resolve));
+
+		materials[material.mID] = handle;
+		watched.mMaterials.push_back({ material.mID, handle });
+	}
+
+	for (const graphics::TextureHandle& texture : textures)
+	{
+		if (IsValid(texture))
+		{
+			watched.mTextures.push_back(texture);
+		}
+	}
+
+	GameObject parentObject = scene.CreateGameObject(file.substr(file.find_last_of('/') + 1));
+	watched.mParent = parentObject;
+
+	for (u32 i = 0; i < processed.mMeshes.size(); ++i)
+	{
+		const MappedMesh& mesh = processed.mMeshes[i];
+
+		GameObject child = scene.CreateGameObject("Mesh " + std::to_string(i));
+		child.SetParent(parentObject);
+		RenderComponent& render = child.AddComponent<RenderComponent>();
+
+		UploadMappedMesh(mesh, uploads, render);
+
+		auto material = materials.find(mesh.mMaterialID);
+		if (material != materials.end())
+		{
+			render.material = material->second;
+		}
+
+		watched.mMeshes.push_back({ child, mesh.mHash });
+	}
+
+	const u64 queuedBytes = uploads.GetBytes();
+
+	processed.mOwner->mUploads = SubmitUploads(*uploadQueue, std::move(uploads));
+	kMappedModels.push_back(processed.mOwner);
+
+	WatchModel(std::move(watched));
+
+	const f64 modelMilliseconds = MillisecondsSince(start);
+	kModelMilliseconds += modelMilliseconds;
+
+	G_ENGINE_INFO("Loaded processed model {} in {:.2f}ms: {} meshes, {} materials, {} textures, {} MB mapped, {} MB decompressed, {} MB of geometry queued for upload",
+		file, modelMilliseconds, processed.mMeshes.size(), materials.size(), textures.size(), processed.mMappedBytes / gold::memory::MB,
+		processed.mDecompressedBytes / gold::memory::MB, queuedBytes / gold::memory::MB);
+
+	return parentObject;
+}
+
+// Hot reload ///////////////////////////////////////////////////
+
+// runs on the update thread except the re-imports, which hand their results back through kReloadResults
+struct ReloadResult
+{
+	u32 mModel = 0;
+	Clock::time_point mStart{};
+	bool mSucceeded = false;
+
+	// assimp models, the importer owns the materials read while applying the result
+	std::unique_ptr<Assimp::Importer> mImporter;
+	std::vector<ImportedMesh> mImported;
+
+	ProcessedModel mProcessed;
+};
+
+struct PatchedRender
+{
+	u32 mMesh = 0; // in ReloadPatch::mMeshes
+	std::string mName;
+	RenderComponent mRender;
+};
+
+struct ReloadPatch
+{
+	u32 mModel = 0;
+	Clock::time_point mStart{};
+	gold::UploadTicket mUploads = 0;
+
+	// the model's meshes after the reload, objects of added meshes are created when the patch applies
+	std::vector<WatchedMesh> mMeshes;
+	std::vector<PatchedRender> mRenders;
+	std::vector<GameObject> mRemoved;
+
+	std::vector<std::pair<graphics::MaterialHandle, graphics::Material>> mMaterials;
+
+	// textures of the previous version no material samples after the patch
+	std::vector<graphics::TextureHandle> mTextures;
+};
+
+struct RetiredResources
+{
+	std::vector<graphics::MeshHandle> mMeshes;
+
+	// levels of detail past the first, they draw the vertex buffer of their first level and leave it to that one
+	std::vector<graphics::MeshHandle> mLevels;
+
+	std::vector<graphics::TextureHandle> mTextures;
+
+	// one more than the frames in flight, the frame being recorded may still reference them
+	u32 mFramesLeft = gold::FrameEncoder::kFrameLatency + 1;
+};
+
+static std::mutex kReloadMutex;
+static std::vector<std::unique_ptr<ReloadResult>> kReloadResults;
+
+// update thread only
+static std::vector<WatchedModel> kWatchedModels;
+static std::unordered_map<std::string, graphics::TextureHandle> kWatchedTextures;
+static std::vector<ReloadPatch> kReloadPatches;
+static std::vector<RetiredResources> kRetiredResources;
+
+static gold::FileWatcher& GetFileWatcher()
+{
+	static gold::FileWatcher watcher;
+	return watcher;
+}
+
+// packed assets cannot change while the archive is mapped, only loose files are watched
+static bool IsPacked(const std::string& file)
+{
+	gold::FileView view;
+	return gold::vfs::Find(file, view);
+}
+
+static void WatchModel(WatchedModel&& model)
+{
+	if (!IsPacked(model.mFile) && GetFileWatcher().Watch(model.mFile))
+	{
+		kWatchedModels.push_back(std::move(model));
+	}
+}
+
+static void WatchTexture(const std::string& file, graphics::TextureHandle handle)
+{
+	if (!IsPacked(file) && GetFileWatcher().Watch(file))
+	{
+		kWatchedTextures[file] = handle;
+	}
+}
+
+static void StartReload(u32 index)
+{
+	WatchedModel& model = kWatchedModels[index];
+	if (model.mReloading)
+	{
+		model.mChangedAgain = true;
+		return;
+	}
+
+	model.mReloading = true;
+	model.mChangedAgain = false;
+
+	GetDecodePool().Submit([index, file = model.mFile, processed = model.mProcessed, start = Clock::now()]()
+	{
+		auto result = std::make_unique<ReloadResult>();
+		result->mModel = index;
+		result->mStart = start;
+
+		if (processed)
+		{
+			// waiting on the sections runs them on this thread too, nothing blocks the pool
+			result->mSucceeded = ReadProcessedModel(file, &GetDecodePool(), result->mProcessed);
+		}
+		else
+		{
+			result->mImporter = std::make_unique<Assimp::Importer>();
+			const aiScene* assimpScene = result->mImporter->ReadFile(file, kAssimpFlags);
+			if (assimpScene && assimpScene->HasMeshes())
+			{
+				for (u32 i = 0; i < assimpScene->mNumMeshes; ++i)
+				{
+					result->mImported.push_back(ImportMesh(assimpScene->mMeshes[i]));
+				}
+				result->mSucceeded = true;
+			}
+		}
+
+		std::scoped_lock lock(kReloadMutex);
+		kReloadResults.push_back(std::move(result));
+	});
+}
+
+static void FinishReload(u32 index)
+{
+	WatchedModel& model = kWatchedModels[index];
+	model.mReloading = false;
+
+	if (model.mChangedAgain)
+	{
+		StartReload(index);
+	}
+}
+
+static graphics::MaterialHandle TakeMaterial(WatchedModel& model)
+{
+	if (model.mSpareMaterials.empty())
+	{
+		return Singletons::Get()->Resolve<MaterialManager>()->CreateMaterial();
+	}
+
+	const graphics::MaterialHandle handle = model.mSpareMaterials.back();
+	model.mSpareMaterials.pop_back();
+	return handle;
+}
+
+static void RetireMeshes(const RenderComponent& render, RetiredResources& retired)
+{
+	if (IsValid(render.mesh))
+	{
+		retired.mMeshes.push_back(render.mesh);
+	}
+
+	for (u8 i = 0; i < render.lodCount; ++i)
+	{
+		retired.mLevels.push_back(render.lods[i].mesh);
+	}
+}
+
+// unchanged meshes are matched by content hash. Returns the previous mesh for every new one, -1 for new objects
+static std::vector<i32> MatchMeshes(const std::vector<WatchedMesh>& previous, const std::vector<u64>& hashes, std::vector<bool>& unchanged)
+{
+	std::vector<i32> result(hashes.size(), -1);
+	std::vector<bool> claimed(previous.size(), false);
+	unchanged.assign(hashes.size(), false);
+
+	std::unordered_multimap<u64, u32> byHash;
+	for (u32 i = 0; i < previous.size(); ++i)
+	{
+		byHash.emplace(previous[i].mHash, i);
+	}
+
+	for (u32 i = 0; i < hashes.size(); ++i)
+	{
+		auto found = byHash.find(hashes[i]);
+		if (found != byHash.end())
+		{
+			result[i] = static_cast<i32>(found->second);
+			claimed[found->second] = true;
+			unchanged[i] = true;
+			byHash.erase(found);
+		}
+	}
+
+	u32 next = 0;
+	for (u32 i = 0; i < hashes.size(); ++i)
+	{
+		if (result[i] >= 0)
+		{
+			continue;
+		}
+
+		while (next < previous.size() && claimed[next])
+		{
+			++next;
+		}
+
+		if (next < previous.size())
+		{
+			result[i] = static_cast<i32>(next);
+			claimed[next] = true;
+		}
+	}
+
+	return result;
+}
+
+static void ApplyReload(ReloadResult& result)
+{
+	WatchedModel& model = kWatchedModels[result.mModel];
+	if (!result.mSucceeded)
+	{
+		G_ENGINE_ERROR("Reloading {} failed, keeping the loaded version", model.mFile);
+		FinishReload(result.mModel);
+		return;
+	}
+
+	auto uploadQueue = Singletons::Get()->Resolve<gold::UploadQueue>();
+	gold::UploadBatch uploads = uploadQueue->CreateBatch();
+
+	ReloadPatch patch;
+	patch.mModel = result.mModel;
+	patch.mStart = result.mStart;
+
+	std::vector<u64> hashes;
+	if (model.mProcessed)
+	{
+		for (const MappedMesh& mesh : result.mProcessed.mMeshes)
+		{
+			hashes.push_back(mesh.mHash);
+		}
+	}
+	else
+	{
+		for (const ImportedMesh& mesh : result.mImported)
+		{
+			hashes.push_back(mesh.mHash);
+		}
+	}
+
+	std::vector<bool> unchanged;
+	const std::vector<i32> matches = MatchMeshes(model.mMeshes, hashes, unchanged);
+
+	// processed materials are updated in place by position, only changed ones upload their textures again
+	std::unordered_map<std::string, graphics::MaterialHandle> materials;
+	if (model.mProcessed)
+	{
+		const ProcessedModel& processed = result.mProcessed;
+
+		auto residency = Singletons::Get()->Resolve<gold::TextureResidency>();
+		auto materialManager = Singletons::Get()->Resolve<MaterialManager>();
+
+		// submitted ahead of the mesh uploads below
+		std::vector<graphics::TextureHandle> textures(processed.mTextures.size());
+		auto resolve = [&processed, &textures, &residency](u32 index)
+		{
+			if (index >= textures.size() || processed.mTextures[index].mFormat == graphics::TextureFormat::INVALID)
+			{
+				return graphics::TextureHandle{};
+			}
+
+			if (!IsValid(textures[index]))
+			{
+				textures[index] = residency->CreateTexture2D(processed.mTextures[index], processed.mOwner);
+			}
+			return textures[index];
+		};
+
+		const auto previous = std::move(model.mMaterials);
+		model.mMaterials.clear();
+
+		// textures of unchanged materials stay, the rest of the previous version goes once the patch applied
+		std::vector<u32> sampled;
+
+		for (u32 i = 0; i < processed.mMaterials.size(); ++i)
+		{
+			const MappedMaterial& material = processed.mMaterials[i];
+
+			graphics::MaterialHandle handle = i < previous.size() ? previous[i].second : TakeMaterial(model);
+			if (i >= previous.size() || previous[i].first != material.mID)
+			{
+				patch.mMaterials.push_back({ handle, ResolveMappedMaterial(material, resolve) });
+			}
+			else
+			{
+				const glm::uvec4 maps = materialManager->GetMaterial(handle).mapFlags;
+				sampled.insert(sampled.end(), { maps.x, maps.y, maps.z, maps.w });
+			}
+
+			materials[material.mID] = handle;
+			model.mMaterials.push_back({ material.mID, handle });
+		}
+
+		// meshes still drawing these are patched to another material or removed
+		for (size_t i = processed.mMaterials.size(); i < previous.size(); ++i)
+		{
+			model.mSpareMaterials.push_back(previous[i].second);
+		}
+
+		std::vector<graphics::TextureHandle> kept;
+		for (const graphics::TextureHandle& texture : model.mTextures)
+		{
+			if (std::find(sampled.begin(), sampled.end(), texture.idx) != sampled.end())
+			{
+				kept.push_back(texture);
+			}
+			else
+			{
+				patch.mTextures.push_back(texture);
+			}
+		}
+
+		for (const graphics::TextureHandle& texture : textures)
+		{
+			if (IsValid(texture))
+			{
+				kept.push_back(texture);
+			}
+		}
+		model.mTextures = std::move(kept);
+	}
+
+	std::string filepath = model.mFile.substr(0, model.mFile.find_last_of('/'));
+	filepath += '/';
+
+	const aiScene* assimpScene = result.mImporter ? result.mImporter->GetScene() : nullptr;
+
+	u32 changed = 0;
+	u32 added = 0;
+	for (u32 i = 0; i < hashes.size(); ++i)
+	{
+		const i32 match = matches[i];
+
+		WatchedMesh& mesh = patch.mMeshes.emplace_back();
+		mesh.mHash = hashes[i];
+		mesh.mMaterialIndex = model.mProcessed ? 0 : result.mImported[i].mMaterialIndex;
+
+		PatchedRender patched;
+		patched.mMesh = i;
+		if (match >= 0)
+		{
+			mesh.mObject = model.mMeshes[match].mObject;
+			patched.mRender = mesh.mObject.GetComponent<RenderComponent>();
+		}
+
+		bool patchRender = !unchanged[i];
+		if (!unchanged[i])
+		{
+			match >= 0 ? ++changed : ++added;
+
+			if (model.mProcessed)
+			{
+				UploadMappedMesh(result.mProcessed.mMeshes[i], uploads, patched.mRender);
+			}
+			else
+			{
+				patched.mName = result.mImported[i].mName;
+				UploadImportedMesh(result.mImported[i], uploads, patched.mRender);
+			}
+		}
+
+		if (model.mProcessed)
+		{
+			patched.mName = "Mesh " + std::to_string(i);
+
+			auto material = materials.find(result.mProcessed.mMeshes[i].mMaterialID);
+			const graphics::MaterialHandle handle = material != materials.end() ? material->second : graphics::MaterialHandle{};
+			if (handle.idx != patched.mRender.material.idx)
+			{
+				patched.mRender.material = handle;
+				patchRender = true;
+			}
+		}
+		else if (match < 0 || model.mMeshes[match].mMaterialIndex != mesh.mMaterialIndex)
+		{
+			// every imported mesh has a material of its own, matched meshes keep their handle
+			if (match < 0)
+			{
+				patched.mRender.material = TakeMaterial(model);
+			}
+			patch.mMaterials.push_back({ patched.mRender.material, ImportMaterial(filepath, mesh.mMaterialIndex, assimpScene->mMaterials) });
+		}
+
+		if (patchRender)
+		{
+			patch.mRenders.push_back(std::move(patched));
+		}
+	}
+
+	// objects no new mesh claimed go away
+	std::vector<bool> claimed(model.mMeshes.size(), false);
+	for (const i32 match : matches)
+	{
+		if (match >= 0)
+		{
+			claimed[match] = true;
+		}
+	}
+
+	for (u32 i = 0; i < model.mMeshes.size(); ++i)
+	{
+		if (!claimed[i])
+		{
+			patch.mRemoved.push_back(model.mMeshes[i].mObject);
+		}
+	}
+
+	const u64 queuedBytes = uploads.GetBytes();
+	patch.mUploads = SubmitUploads(*uploadQueue, std::move(uploads));
+
+	if (model.mProcessed)
+	{
+		result.mProcessed.mOwner->mUploads = patch.mUploads;
+		kMappedModels.push_back(result.mProcessed.mOwner);
+	}
+
+	G_ENGINE_INFO("Reloading {}: {} of {} meshes changed, {} added, {} removed, {} materials changed, {} KB queued for upload",
+		model.mFile, changed, model.mMeshes.size(), added, patch.mRemoved.size(), patch.mMaterials.size(), queuedBytes / gold::memory::KB);
+
+	kReloadPatches.push_back(std::move(patch));
+}
+
+static void ApplyPatch(ReloadPatch& patch)
+{
+	WatchedModel& model = kWatchedModels[patch.mModel];
+
+	auto materialManager = Singletons::Get()->Resolve<MaterialManager>();
+	for (const auto& [handle, material] : patch.mMaterials)
+	{
+		materialManager->UpdateMaterial(handle, material);
+	}
+
+	RetiredResources retired;
+	for (const PatchedRender& patched : patch.mRenders)
+	{
+		WatchedMesh& mesh = patch.mMeshes[patched.mMesh];
+		if (!mesh.mObject.IsValid())
+		{
+			mesh.mObject = model.mScene->CreateGameObject(patched.mName);
+			mesh.mObject.SetParent(model.mParent);
+			mesh.mObject.AddComponent<RenderComponent>() = patched.mRender;
+			continue;
+		}
+
+		RenderComponent& render = mesh.mObject.GetComponent<RenderComponent>();
+		if (render.mesh.idx != patched.mRender.mesh.idx)
+		{
+			RetireMeshes(render, retired);
+		}
+		render = patched.mRender;
+	}
+
+	for (GameObject& object : patch.mRemoved)
+	{
+		const RenderComponent& render = object.GetComponent<RenderComponent>();
+		RetireMeshes(render, retired);
+		if (!model.mProcessed)
+		{
+			model.mSpareMaterials.push_back(render.material);
+		}
+		object.Destroy();
+	}
+
+	retired.mTextures = std::move(patch.mTextures);
+
+	if (!retired.mMeshes.empty() || !retired.mLevels.empty() || !retired.mTextures.empty())
+	{
+		kRetiredResources.push_back(std::move(retired));
+	}
+
+	model.mMeshes = std::move(patch.mMeshes);
+
+	G_ENGINE_INFO("Reloaded {} in {:.2f}ms, {} render components patched", model.mFile, MillisecondsSince(patch.mStart), patch.mRenders.size());
+
+	FinishReload(patch.mModel);
+}
+
+static void UpdateHotReload()
+{
+	auto uploadQueue = Singletons::Get()->Resolve<gold::UploadQueue>();
+
+	for (const std::string& file : GetFileWatcher().Poll())
+	{
+		auto texture = kWatchedTextures.find(file);
+		if (texture != kWatchedTextures.end())
+		{
+			G_ENGINE_INFO("{} changed, reloading", file);
+			DecodeTexture(texture->second, file);
+		}
+
+		for (u32 i = 0; i < kWatchedModels.size(); ++i)
+		{
+			if (kWatchedModels[i].mFile == file)
+			{
+				G_ENGINE_INFO("{} changed, reloading", file);
+				StartReload(i);
+			}
+		}
+	}
+
+	std::vector<std::unique_ptr<ReloadResult>> results;
+	{
+		std::scoped_lock lock(kReloadMutex);
+		results.swap(kReloadResults);
+	}
+
+	for (const auto& result : results)
+	{
+		ApplyReload(*result);
+	}
+
+	for (size_t i = 0; i < kReloadPatches.size();)
+	{
+		if (uploadQueue->IsComplete(kReloadPatches[i].mUploads))
+		{
+			ReloadPatch patch = std::move(kReloadPatches[i]);
+			kReloadPatches.erase(kReloadPatches.begin() + i);
+			ApplyPatch(patch);
+		}
+		else
+		{
+			++i;
+		}
+	}
+
+	gold::UploadBatch destroys = uploadQueue->CreateBatch();
+	for (auto it = kRetiredResources.begin(); it != kRetiredResources.end();)
+	{
+		if (--it->mFramesLeft > 0)
+		{
+			++it;
+			continue;
+		}
+
+		for (const graphics::MeshHandle& mesh : it->mMeshes)
+		{
+			destroys.DestroyMesh(mesh);
+		}
+
+		for (const graphics::MeshHandle& mesh : it->mLevels)
+		{
+			destroys.DestroyMesh(mesh, false);
+		}
+
+		if (!it->mTextures.empty())
+		{
+			auto residency = Singletons::Get()->Resolve<gold::TextureResidency>();
+			for (const graphics::TextureHandle& texture : it->mTextures)
+			{
+				residency->DestroyTexture(texture);
+			}
+		}
+		it = kRetiredResources.erase(it);
+	}
+
+	if (!destroys.IsEmpty())
+	{
+		uploadQueue->Submit(std::move(destroys));
+	}
+}
+
+void Loader::Update()
+{
+	auto uploadQueue = Singletons::Get()->Resolve<gold::UploadQueue>();
+
+	for (auto it = kMappedModels.begin(); it != kMappedModels.end();)
+	{
+		if (uploadQueue->IsComplete((*it)->mUploads))
+		{
+			it = kMappedModels.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+
+	UpdateHotReload();
+
+	if (kLoading && !IsLoading())
+	{
+		kLoading = false;
+
+		f64 decodeMilliseconds = 0;
+		{
+			std::scoped_lock lock(kLoadMutex);
+			decodeMilliseconds = kDecodeMilliseconds;
+		}
+
+		// serial baseline is what the update thread used to pay: model processing plus every decode back to back
+		G_ENGINE_INFO("Loading complete: {} textures, {:.2f}ms wall time vs {:.2f}ms serial, every upload resident",
+			kLoadTextureCount, MillisecondsSince(kLoadStart), kModelMilliseconds + decodeMilliseconds);
+
+		// a cold start decodes everything, a warm one maps everything, both since startup
+		const auto cache = graphics::texture_cache::GetStatistics();
+		const char* warmth = cache.misses == 0 ? "warm" : cache.hits == 0 ? "cold" : "partially warm";
+		G_ENGINE_INFO("Texture cache ({} start): {} mapped in {:.2f}ms ({} MB), {} decoded in {:.2f}ms",
+			warmth, cache.hits, cache.hitMilliseconds, cache.mappedBytes / gold::memory::MB, cache.misses, cache.missMilliseconds);
+	}
+}
+
+bool Loader::IsLoading()
+{
+	if (kPendingTextureCount > 0)
+	{
+		return true;
+	}
+
+	gold::UploadTicket ticket = 0;
+	{
+		std::scoped_lock lock(kLoadMutex);
+		ticket = kLoadTicket;
+	}
+
+	return !Singletons::Get()->Resolve<gold::UploadQueue>()->IsComplete(ticket);
 }
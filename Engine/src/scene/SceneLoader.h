@@ -2,14 +2,27 @@
 
 #include "core/Core.h"
 #include "SceneGraph.h"
-#include "graphics/FrameEncoder.h"
 
 namespace scene
 {
+	// every GPU resource goes through the upload queue. The scene and the objects created for a model must
+	// outlive the loader
 	class Loader
 	{
 	public:
 		
-		static GameObject LoadGameObjectFromModel(Scene& scene, gold::FrameEncoder& encoder, const std::string& filepath);
+		// Textures are decoded on worker threads, render components reference placeholder
+		// textures until the decoded data went through the upload queue
+		static GameObject LoadGameObjectFromModel(Scene& scene, const std::string& filepath);
+
+		// maps a file written by the AssetProcessor, uploads point straight into the mapping. Returns an invalid
+		// object when the file is missing, from another version or corrupt
+		static GameObject LoadGameObjectFromProcessedModel(Scene& scene, const std::string& filepath);
+
+		// Call once per frame, releases processed model files whose uploads completed and applies hot reloads
+		static void Update();
+
+		// true while textures are decoding or anything a load queued is not uploaded yet
+		static bool IsLoading();
 	};
 }
\ No newline at end of file
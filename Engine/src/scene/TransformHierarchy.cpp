@@ -0,0 +1,436 @@
+#include "TransformHierarchy.h"
+
+#include "BaseComponents.h"
+
+#include <cmath>
+
+// four local matrices at a time with SSE, same result as the scalar path
+#if defined(_M_X64) || defined(__SSE2__)
+#define TRANSFORMS_USE_SSE 1
+#include <emmintrin.h>
+#endif
+
+using namespace scene;
+
+// in world units, objects move this far before their leaf in the tree does
+static constexpr f32 kTreeMargin = 0.5f;
+
+// local transforms of up to kBatch objects, one array per component. Sines and cosines are of the half angles
+struct TRSBatch
+{
+	static constexpr u32 kBatch = 4;
+
+	alignas(16) f32 position[3][kBatch];
+	alignas(16) f32 scale[3][kBatch];
+	alignas(16) f32 cos[3][kBatch];
+	alignas(16) f32 sin[3][kBatch];
+
+	// rotation and scale part, column major: column c row r is at [c * 3 + r]
+	alignas(16) f32 basis[9][kBatch];
+};
+
+// the same as TransformComponent::GetMatrix: glm::quat from euler angles turned into a matrix, columns scaled.
+// Unused lanes of a partial batch are composed as well and ignored
+static void ComposeBatch(TRSBatch& batch)
+{
+#if defined(TRANSFORMS_USE_SSE)
+	const __m128 cx = _mm_load_ps(batch.cos[0]);
+	const __m128 cy = _mm_load_ps(batch.cos[1]);
+	const __m128 cz = _mm_load_ps(batch.cos[2]);
+	const __m128 sx = _mm_load_ps(batch.sin[0]);
+	const __m128 sy = _mm_load_ps(batch.sin[1]);
+	const __m128 sz = _mm_load_ps(batch.sin[2]);
+
+	const __m128 w = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(cx, cy), cz), _mm_mul_ps(_mm_mul_ps(sx, sy), sz));
+	const __m128 x = _mm_sub_ps(_mm_mul_ps(_mm_mul_ps(sx, cy), cz), _mm_mul_ps(_mm_mul_ps(cx, sy), sz));
+	const __m128 y = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(cx, sy), cz), _mm_mul_ps(_mm_mul_ps(sx, cy), sz));
+	const __m128 z = _mm_sub_ps(_mm_mul_ps(_mm_mul_ps(cx, cy), sz), _mm_mul_ps(_mm_mul_ps(sx, sy), cz));
+
+	const __m128 xx = _mm_mul_ps(x, x);
+	const __m128 yy = _mm_mul_ps(y, y);
+	const __m128 zz = _mm_mul_ps(z, z);
+	const __m128 xz = _mm_mul_ps(x, z);
+	const __m128 xy = _mm_mul_ps(x, y);
+	const __m128 yz = _mm_mul_ps(y, z);
+	const __m128 wx = _mm_mul_ps(w, x);
+	const __m128 wy = _mm_mul_ps(w, y);
+	const __m128 wz = _mm_mul_ps(w, z);
+
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 two = _mm_set1_ps(2.0f);
+
+	const __m128 scaleX = _mm_load_ps(batch.scale[0]);
+	const __m128 scaleY = _mm_load_ps(batch.scale[1]);
+	const __m128 scaleZ = _mm_load_ps(batch.scale[2]);
+
+	_mm_store_ps(batch.basis[0], _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), scaleX));
+	_mm_store_ps(batch.basis[1], _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), scaleX));
+	_mm_store_ps(batch.basis[2], _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), scaleX));
+
+	_mm_store_ps(batch.basis[3], _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), scaleY));
+	_mm_store_ps(batch.basis[4], _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), scaleY));
+	_mm_store_ps(batch.basis[5], _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), scaleY));
+
+	_mm_store_ps(batch.basis[6], _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), scaleZ));
+	_mm_store_ps(batch.basis[7], _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), scaleZ));
+	_mm_store_ps(batch.basis[8], _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), scaleZ));
+#else
+	for (u32 i = 0; i < TRSBatch::kBatch; ++i)
+	{
+		const f32 cx = batch.cos[0][i], cy = batch.cos[1][i], cz = batch.cos[2][i];
+		const f32 sx = batch.sin[0][i], sy = batch.sin[1][i], sz = batch.sin[2][i];
+
+		const f32 w = cx * cy * cz + sx * sy * sz;
+		const f32 x = sx * cy * cz - cx * sy * sz;
+		const f32 y = cx * sy * cz + sx * cy * sz;
+		const f32 z = cx * cy * sz - sx * sy * cz;
+
+		const f32 xx = x * x, yy = y * y, zz = z * z;
+		const f32 xz = x * z, xy = x * y, yz = y * z;
+		const f32 wx = w * x, wy = w * y, wz = w * z;
+
+		const f32 scaleX = batch.scale[0][i], scaleY = batch.scale[1][i], scaleZ = batch.scale[2][i];
+
+		batch.basis[0][i] = (1.0f - 2.0f * (yy + zz)) * scaleX;
+		batch.basis[1][i] = (2.0f * (xy + wz)) * scaleX;
+		batch.basis[2][i] = (2.0f * (xz - wy)) * scaleX;
+
+		batch.basis[3][i] = (2.0f * (xy - wz)) * scaleY;
+		batch.basis[4][i] = (1.0f - 2.0f * (xx + zz)) * scaleY;
+		batch.basis[5][i] = (2.0f * (yz + wx)) * scaleY;
+
+		batch.basis[6][i] = (2.0f * (xz + wy)) * scaleZ;
+		batch.basis[7][i] = (2.0f * (yz - wx)) * scaleZ;
+		batch.basis[8][i] = (1.0f - 2.0f * (xx + yy)) * scaleZ;
+	}
+#endif
+}
+
+TransformHierarchy::TransformHierarchy()
+	: mTree(kTreeMargin)
+{
+}
+
+void TransformHierarchy::Update(entt::registry& registry)
+{
+	mStatistics = {};
+
+	auto transforms = registry.view<TransformComponent>();
+
+	// created objects change the count. Destroyed ones either change it or leave an invalid entity behind when
+	// something was created in the same frame, reparented ones flag their transform
+	bool rebuild = transforms.size() != mEntities.size();
+
+	mDirtyLocals.clear();
+	mChanged.assign(mEntities.size(), 0);
+
+	for (u32 i = 0; !rebuild && i < mEntities.size(); ++i)
+	{
+		const entt::entity entity = mEntities[i];
+
+		const auto* transform = registry.valid(entity) ? registry.try_get<TransformComponent>(entity) : nullptr;
+		if (!transform || transform->mParentChanged)
+		{
+			rebuild = true;
+			break;
+		}
+
+		if (transform->mLocalDirty)
+		{
+			mDirtyLocals.push_back(i);
+			mChanged[i] |= WORLD_CHANGED;
+		}
+
+		// a removed render component leaves its bounds and leaf behind
+		const auto* render = registry.try_get<RenderComponent>(entity);
+		if (render ? render->boundsChanged : mProxies[i] != graphics::AABBTree::kNullNode)
+		{
+			mChanged[i] |= BOUNDS_CHANGED;
+		}
+	}
+
+	if (rebuild)
+	{
+		Rebuild(registry);
+	}
+
+	ComposeDirtyLocals(registry);
+
+	for (u32 i = 0; i < mEntities.size(); ++i)
+	{
+		const u32 parent = mParents[i];
+		if (parent != kNoParent && (mChanged[parent] & WORLD_CHANGED))
+		{
+			mChanged[i] |= WORLD_CHANGED;
+		}
+
+		if (!mChanged[i])
+		{
+			continue;
+		}
+
+		const entt::entity entity = mEntities[i];
+		if (mChanged[i] & WORLD_CHANGED)
+		{
+			mWorlds[i] = parent == kNoParent ? mLocals[i] : mWorlds[parent] * mLocals[i];
+			registry.get<WorldTransformComponent>(entity).world = mWorlds[i];
+
+			++mStatistics.updatedCount;
+		}
+
+		auto* render = registry.try_get<RenderComponent>(entity);
+		if (!render)
+		{
+			if (mProxies[i] != graphics::AABBTree::kNullNode)
+			{
+				mTree.DestroyProxy(mProxies[i]);
+				mProxies[i] = graphics::AABBTree::kNullNode;
+				registry.remove<WorldAABBComponent>(entity);
+			}
+
+			mBounds.SetEmpty(i);
+			mChanged[i] |= SUBTREE_CHANGED;
+			continue;
+		}
+
+		const AABB aabb = graphics::TransformAABB({ render->aabbMin, render->aabbMax }, mWorlds[i]);
+		render->boundsChanged = false;
+
+		auto* world = registry.try_get<WorldAABBComponent>(entity);
+		if (!world)
+		{
+			world = &registry.emplace<WorldAABBComponent>(entity);
+		}
+		world->aabb = aabb;
+
+		mBounds.Set(i, aabb);
+
+		// the set's copy, broken bounds are stored covering everything there
+		if (mProxies[i] == graphics::AABBTree::kNullNode)
+		{
+			mProxies[i] = mTree.CreateProxy(mBounds.Get(i), i);
+			world->proxy = mProxies[i];
+		}
+		else
+		{
+			mTree.MoveProxy(mProxies[i], mBounds.Get(i));
+		}
+		mChanged[i] |= SUBTREE_CHANGED;
+
+		++mStatistics.boundsCount;
+	}
+
+	UpdateSubtreeBounds();
+
+	mStatistics.objectCount = static_cast<u32>(mEntities.size());
+	mStatistics.composedCount = static_cast<u32>(mDirtyLocals.size());
+	mStatistics.rebuilt = rebuild;
+}
+
+void TransformHierarchy::Rebuild(entt::registry& registry)
+{
+	// leaves of destroyed objects go, the others keep theirs through WorldAABBComponent
+	for (u32 i = 0; i < mEntities.size(); ++i)
+	{
+		if (mProxies[i] != graphics::AABBTree::kNullNode && !registry.valid(mEntities[i]))
+		{
+			mTree.DestroyProxy(mProxies[i]);
+		}
+	}
+
+	mEntities.clear();
+	mParents.clear();
+	mRebuildStack.clear();
+
+	auto transforms = registry.view<TransformComponent>();
+	for (auto entity : transforms)
+	{
+		const auto* parent = registry.try_get<ParentComponent>(entity);
+		if (!parent || !registry.valid(parent->parent))
+		{
+			mRebuildStack.push_back({ entity, kNoParent });
+		}
+	}
+
+	// depth first, children are pushed in reverse so they come out in the order of ChildrenComponent
+	while (!mRebuildStack.empty())
+	{
+		const auto [entity, parent] = mRebuildStack.back();
+		mRebuildStack.pop_back();
+
+		const u32 index = static_cast<u32>(mEntities.size());
+		mEntities.push_back(entity);
+		mParents.push_back(parent);
+
+		if (!registry.try_get<WorldTransformComponent>(entity))
+		{
+			registry.emplace<WorldTransformComponent>(entity);
+		}
+
+		if (const auto* children = registry.try_get<ChildrenComponent>(entity))
+		{
+			for (auto it = children->children.rbegin(); it != children->children.rend(); ++it)
+			{
+				if (registry.valid(*it) && registry.try_get<TransformComponent>(*it))
+				{
+					mRebuildStack.push_back({ *it, index });
+				}
+			}
+		}
+	}
+
+	DEBUG_ASSERT(mEntities.size() == transforms.size(), "Objects parented in a cycle are left out of the transform hierarchy!");
+
+	const u32 count = static_cast<u32>(mEntities.size());
+
+	mProxies.resize(count);
+	for (u32 i = 0; i < count; ++i)
+	{
+		const auto* world = registry.try_get<WorldAABBComponent>(mEntities[i]);
+		mProxies[i] = world ? world->proxy : graphics::AABBTree::kNullNode;
+		if (mProxies[i] != graphics::AABBTree::kNullNode)
+		{
+			mTree.SetUserData(mProxies[i], i);
+		}
+	}
+
+	mLocals.resize(count);
+	mWorlds.resize(count);
+	mBounds.Resize(count);
+	mSubtreeBounds.resize(count);
+
+	// a subtree ends where the last one below it does, children come after their parent so one backwards pass
+	// sees every child first
+	mSubtreeEnds.resize(count);
+	for (u32 i = 0; i < count; ++i)
+	{
+		mSubtreeEnds[i] = i + 1;
+	}
+	for (u32 i = count; i-- > 0;)
+	{
+		if (mParents[i] != kNoParent)
+		{
+			mSubtreeEnds[mParents[i]] = std::max(mSubtreeEnds[mParents[i]], mSubtreeEnds[i]);
+		}
+	}
+
+	// every matrix and box is recomputed after a rebuild
+	mDirtyLocals.resize(count);
+	for (u32 i = 0; i < count; ++i)
+	{
+		mDirtyLocals[i] = i;
+	}
+	mChanged.assign(count, WORLD_CHANGED | BOUNDS_CHANGED);
+}
+
+void TransformHierarchy::UpdateSubtreeBounds()
+{
+	// children before parents, a changed subtree box marks the one of its parent
+	for (u32 i = static_cast<u32>(mEntities.size()); i-- > 0;)
+	{
+		if (!(mChanged[i] & SUBTREE_CHANGED))
+		{
+			continue;
+		}
+
+		AABB bounds = mBounds.Get(i);
+		for (u32 child = i + 1; child < mSubtreeEnds[i]; child = mSubtreeEnds[child])
+		{
+			bounds.min = glm::min(bounds.min, mSubtreeBounds[child].min);
+			bounds.max = glm::max(bounds.max, mSubtreeBounds[child].max);
+		}
+		mSubtreeBounds[i] = bounds;
+
+		if (mParents[i] != kNoParent)
+		{
+			mChanged[mParents[i]] |= SUBTREE_CHANGED;
+		}
+	}
+}
+
+void TransformHierarchy::CullWorldBounds(const graphics::CullFrustum& frustum, graphics::VisibilityBits& visible) const
+{
+	// smaller subtrees are culled object by object
+	static constexpr u32 kSmallSubtree = 2 * graphics::AABBSet::kBatch;
+
+	const u32 count = static_cast<u32>(mEntities.size());
+	visible.Reset(count);
+
+	// pending run of adjacent small subtrees, [runFirst, runLast)
+	u32 runFirst = 0;
+	u32 runLast = 0;
+
+	u32 i = 0;
+	while (i < count)
+	{
+		const u32 end = mSubtreeEnds[i];
+		if (end - i <= kSmallSubtree)
+		{
+			if (runLast != i)
+			{
+				graphics::CullAABBRange(frustum, mBounds, runFirst, runLast, visible);
+				runFirst = i;
+			}
+			runLast = end;
+			i = end;
+			continue;
+		}
+
+		graphics::CullAABBRange(frustum, mBounds, runFirst, runLast, visible);
+		runFirst = runLast = 0;
+
+		if (!graphics::IsAABBVisible(frustum, mSubtreeBounds[i]))
+		{
+			i = end;
+			continue;
+		}
+
+		// the subtree is seen, its root on its own and everything below it in turn
+		if (graphics::IsAABBVisible(frustum, mBounds.Get(i)))
+		{
+			visible.Set(i);
+		}
+		++i;
+	}
+
+	graphics::CullAABBRange(frustum, mBounds, runFirst, runLast, visible);
+}
+
+void TransformHierarchy::ComposeDirtyLocals(entt::registry& registry)
+{
+	TRSBatch batch;
+
+	for (u32 first = 0; first < mDirtyLocals.size(); first += TRSBatch::kBatch)
+	{
+		const u32 count = std::min<u32>(TRSBatch::kBatch, static_cast<u32>(mDirtyLocals.size()) - first);
+
+		for (u32 lane = 0; lane < TRSBatch::kBatch; ++lane)
+		{
+			// a partial batch repeats its last transform in the unused lanes
+			auto& transform = registry.get<TransformComponent>(mEntities[mDirtyLocals[first + std::min(lane, count - 1)]]);
+			transform.mLocalDirty = false;
+			transform.mParentChanged = false;
+
+			for (u32 axis = 0; axis < 3; ++axis)
+			{
+				const f32 halfAngle = transform.mRotation[axis] * 0.5f;
+				batch.position[axis][lane] = transform.mPosition[axis];
+				batch.scale[axis][lane] = transform.mScale[axis];
+				batch.cos[axis][lane] = std::cos(halfAngle);
+				batch.sin[axis][lane] = std::sin(halfAngle);
+			}
+		}
+
+		ComposeBatch(batch);
+
+		for (u32 lane = 0; lane < count; ++lane)
+		{
+			glm::mat4& local = mLocals[mDirtyLocals[first + lane]];
+			for (u32 column = 0; column < 3; ++column)
+			{
+				local[column] = glm::vec4(batch.basis[column * 3][lane], batch.basis[column * 3 + 1][lane], batch.basis[column * 3 + 2][lane], 0.0f);
+			}
+			local[3] = glm::vec4(batch.position[0][lane], batch.position[1][lane], batch.position[2][lane], 1.0f);
+		}
+	}
+}
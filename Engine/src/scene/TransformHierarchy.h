@@ -0,0 +1,85 @@
+#pragma once
+
+#include "core/Core.h"
+
+#include "graphics/AABBCulling.h"
+#include "graphics/AABBTree.h"
+
+#include <entt/entt.hpp>
+#include <glm/glm.hpp>
+
+namespace scene
+{
+	// world matrices and bounds of every object with a TransformComponent, ordered depth first so a parent
+	// comes before its children. Only what changed since the last update is recomputed
+	class TransformHierarchy
+	{
+	public:
+		struct Statistics
+		{
+			u32 objectCount = 0;
+
+			// local matrices composed, world matrices and world bounds written by the last update
+			u32 composedCount = 0;
+			u32 updatedCount = 0;
+			u32 boundsCount = 0;
+
+			bool rebuilt = false;
+		};
+
+	private:
+		static constexpr u32 kNoParent = ~0u;
+
+		std::vector<entt::entity> mEntities;
+		std::vector<u32> mParents; // index of the parent, kNoParent for roots
+		std::vector<glm::mat4> mLocals;
+		std::vector<glm::mat4> mWorlds;
+
+		// empty for objects without a RenderComponent, they are never visible
+		graphics::AABBSet mBounds;
+
+		// a subtree is [index, mSubtreeEnds[index]), its box covers the bounds of every object in it
+		std::vector<u32> mSubtreeEnds;
+		std::vector<AABB> mSubtreeBounds;
+
+		// leaves hold the index of their object, kNullNode in mProxies for objects without a RenderComponent
+		graphics::AABBTree mTree;
+		std::vector<u32> mProxies;
+
+		// per update, the objects whose local matrix is recomputed and what changed about each object
+		enum : u8 { WORLD_CHANGED = 1, BOUNDS_CHANGED = 2, SUBTREE_CHANGED = 4 };
+		std::vector<u32> mDirtyLocals;
+		std::vector<u8> mChanged;
+
+		std::vector<std::pair<entt::entity, u32>> mRebuildStack;
+
+		Statistics mStatistics;
+
+		void Rebuild(entt::registry& registry);
+		void ComposeDirtyLocals(entt::registry& registry);
+		void UpdateSubtreeBounds();
+
+	public:
+		TransformHierarchy();
+
+		void Update(entt::registry& registry);
+
+		const Statistics& GetStatistics() const { return mStatistics; }
+
+		u32 GetCount() const { return static_cast<u32>(mEntities.size()); }
+		entt::entity GetEntity(u32 index) const { return mEntities[index]; }
+
+		// world bounds by index, as of the last update
+		const graphics::AABBSet& GetWorldBounds() const { return mBounds; }
+
+		u32 GetSubtreeEnd(u32 index) const { return mSubtreeEnds[index]; }
+		const AABB& GetSubtreeBounds(u32 index) const { return mSubtreeBounds[index]; }
+
+		// userData of a leaf is the index of its object
+		const graphics::AABBTree& GetTree() const { return mTree; }
+
+		// sets the bit of every object whose world bounds the frustum sees. Subtrees the frustum misses are skipped
+		// whole, runs of small subtrees are culled in SIMD batches
+		void CullWorldBounds(const graphics::CullFrustum& frustum, graphics::VisibilityBits& visible) const;
+	};
+}
@@ -0,0 +1,184 @@
+#include "ViewVisibility.h"
+
+#include "TransformHierarchy.h"
+
+#include "core/ThreadPool.h"
+#include "graphics/AABBTree.h"
+
+using namespace scene;
+
+void ViewVisibility::Cull(const TransformHierarchy& transforms, const graphics::CullFrustum& frustum)
+{
+	transforms.CullWorldBounds(frustum, mBits);
+	CollectIndices();
+}
+
+void ViewVisibility::CollectIndices()
+{
+	mIndices.clear();
+	mIndices.reserve(mBits.CountSet());
+	mBits.ForEachSet([this](u32 index)
+	{
+		mIndices.push_back(index);
+	});
+}
+
+void ViewCuller::Clear()
+{
+	mFrustums.clear();
+	mViewGroups.clear();
+	mGroups.clear();
+}
+
+u32 ViewCuller::AddGroup(const glm::vec3& center, f32 radius)
+{
+	mGroups.push_back({ center, radius });
+	return static_cast<u32>(mGroups.size() - 1);
+}
+
+u32 ViewCuller::AddView(const glm::mat4& viewProj, u32 group)
+{
+	DEBUG_ASSERT(group == kNoGroup || group < mGroups.size(), "View added to a group that does not exist!");
+
+	mFrustums.emplace_back(viewProj);
+	mViewGroups.push_back(group);
+	return static_cast<u32>(mFrustums.size() - 1);
+}
+
+void ViewCuller::Cull(const TransformHierarchy& transforms, ViewVisibility* results, gold::ThreadPool* pool) const
+{
+	const u32 viewCount = GetViewCount();
+	const u32 walkCount = (viewCount + kViewsPerWalk - 1) / kViewsPerWalk;
+
+	// the hierarchy is only read, every walk writes the results of its own views
+	const auto walk = [this, &transforms, results, viewCount](u32 index)
+	{
+		const u32 first = index * kViewsPerWalk;
+		const u32 count = std::min(kViewsPerWalk, viewCount - first);
+		CullWalk(transforms, first, count, results);
+
+		for (u32 view = first; view < first + count; ++view)
+		{
+			results[view].CollectIndices();
+		}
+	};
+
+	if (pool && walkCount > 1)
+	{
+		pool->ParallelFor(0, walkCount, [&walk](u32 first, u32 last)
+		{
+			for (u32 i = first; i < last; ++i)
+			{
+				walk(i);
+			}
+		}, 1);
+	}
+	else
+	{
+		for (u32 i = 0; i < walkCount; ++i)
+		{
+			walk(i);
+		}
+	}
+}
+
+void ViewCuller::CullWalk(const TransformHierarchy& transforms, u32 firstView, u32 viewCount, ViewVisibility* results) const
+{
+	// same threshold as TransformHierarchy::CullWorldBounds
+	static constexpr u32 kSmallSubtree = 2 * graphics::AABBSet::kBatch;
+
+	// bit v of a mask stands for view firstView + v
+	const u64 allViews = viewCount == 64 ? ~0ull : (1ull << viewCount) - 1;
+
+	u64 ungrouped = 0;
+	std::vector<u64> groupViews(mGroups.size(), 0);
+	for (u32 view = 0; view < viewCount; ++view)
+	{
+		const u32 group = mViewGroups[firstView + view];
+		(group == kNoGroup ? ungrouped : groupViews[group]) |= 1ull << view;
+	}
+
+	// the subset of views that see aabb
+	const auto testViews = [this, firstView, ungrouped, &groupViews](const AABB& aabb, u64 views)
+	{
+		u64 candidates = views & ungrouped;
+		for (u32 group = 0; group < mGroups.size(); ++group)
+		{
+			if ((groupViews[group] & views) && graphics::AABBTree::OverlapsSphere(aabb, mGroups[group].mCenter, mGroups[group].mRadius))
+			{
+				candidates |= groupViews[group] & views;
+			}
+		}
+
+		u64 visible = 0;
+		for (; candidates; candidates &= candidates - 1)
+		{
+			const u32 view = util::CountTrailingZeros(candidates);
+			if (graphics::IsAABBVisible(mFrustums[firstView + view], aabb))
+			{
+				visible |= 1ull << view;
+			}
+		}
+		return visible;
+	};
+
+	const u32 count = transforms.GetCount();
+	for (u32 view = 0; view < viewCount; ++view)
+	{
+		results[firstView + view].mBits.Reset(count);
+	}
+
+	const auto setVisible = [firstView, results](u32 index, u64 views)
+	{
+		for (; views; views &= views - 1)
+		{
+			results[firstView + util::CountTrailingZeros(views)].mBits.Set(index);
+		}
+	};
+
+	// subtrees being walked, their end and the views that see them
+	std::vector<std::pair<u32, u64>> stack;
+
+	const graphics::AABBSet& bounds = transforms.GetWorldBounds();
+
+	u32 i = 0;
+	while (i < count)
+	{
+		while (!stack.empty() && stack.back().first <= i)
+		{
+			stack.pop_back();
+		}
+
+		const u32 end = transforms.GetSubtreeEnd(i);
+		const u64 views = testViews(transforms.GetSubtreeBounds(i), stack.empty() ? allViews : stack.back().second);
+		if (views == 0)
+		{
+			i = end;
+			continue;
+		}
+
+		// a single object's subtree box is its own box
+		if (end - i == 1)
+		{
+			setVisible(i, views);
+			++i;
+			continue;
+		}
+
+		if (end - i <= kSmallSubtree)
+		{
+			for (u64 remaining = views; remaining; remaining &= remaining - 1)
+			{
+				const u32 view = firstView + util::CountTrailingZeros(remaining);
+				graphics::CullAABBRange(mFrustums[view], bounds, i, end, results[view].mBits);
+			}
+			i = end;
+			continue;
+		}
+
+		// the subtree is seen, its root on its own and everything below it only against the views that see it
+		setVisible(i, testViews(bounds.Get(i), views));
+		stack.push_back({ end, views });
+		++i;
+	}
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "core/Core.h"
+
+#include "graphics/AABBCulling.h"
+
+namespace gold
+{
+	class ThreadPool;
+}
+
+namespace scene
+{
+	class TransformHierarchy;
+	class ViewCuller;
+
+	// what one view sees, by index into the scene's TransformHierarchy
+	class ViewVisibility
+	{
+	private:
+		friend class ViewCuller;
+
+		graphics::VisibilityBits mBits;
+		std::vector<u32> mIndices;
+
+		// fills mIndices from mBits
+		void CollectIndices();
+
+	public:
+		// replaces the previous result, valid until the hierarchy updates again
+		void Cull(const TransformHierarchy& transforms, const graphics::CullFrustum& frustum);
+
+		bool IsVisible(u32 index) const { return index < mBits.GetCount() && mBits.Test(index); }
+
+		const graphics::VisibilityBits& GetBits() const { return mBits; }
+		const std::vector<u32>& GetIndices() const { return mIndices; }
+		u32 GetCount() const { return static_cast<u32>(mIndices.size()); }
+	};
+
+	// culls every view of a frame in one walk over the hierarchy, views can share a bounding sphere that rejects
+	// a subtree for all of them at once
+	class ViewCuller
+	{
+	public:
+		static constexpr u32 kNoGroup = ~0u;
+
+		// views tracked by one walk, more views walk the hierarchy again, each walk a task of its own
+		static constexpr u32 kViewsPerWalk = 64;
+
+	private:
+		struct Group
+		{
+			glm::vec3 mCenter{};
+			f32 mRadius = 0.0f;
+		};
+
+		std::vector<graphics::CullFrustum> mFrustums;
+		std::vector<u32> mViewGroups;
+		std::vector<Group> mGroups;
+
+		void CullWalk(const TransformHierarchy& transforms, u32 firstView, u32 viewCount, ViewVisibility* results) const;
+
+	public:
+		void Clear();
+
+		// views of the group see nothing outside the sphere
+		u32 AddGroup(const glm::vec3& center, f32 radius);
+
+		// returns the index of the view's result
+		u32 AddView(const glm::mat4& viewProj, u32 group = kNoGroup);
+
+		u32 GetViewCount() const { return static_cast<u32>(mFrustums.size()); }
+
+		// results holds one ViewVisibility per view, in the order they were added. Walks run on pool when there is
+		// more than one, a null pool walks them in turn on the calling thread
+		void Cull(const TransformHierarchy& transforms, ViewVisibility* results, gold::ThreadPool* pool = nullptr) const;
+	};
+}
@@ -1,7 +1,58 @@
 #pragma once
 
+#include "graphics/TextureResidency.h"
+#include "core/ThreadPool.h"
+
+#include <chrono>
+
 class PerformanceWindow : public ImGuiWindow
 {
+private:
+	using Clock = std::chrono::steady_clock;
+
+	// job pool counters are resampled this often, per frame deltas flicker too much to read
+	static constexpr f64 kJobSampleMS = 500.0;
+
+	struct JobUtilization
+	{
+		f64 busy = 0.0;
+		f64 sleeping = 0.0;
+		u64 executedJobs = 0;
+		u64 stolenJobs = 0;
+	};
+
+	std::vector<gold::ThreadPool::WorkerStatistics> mJobStatistics;
+	std::vector<JobUtilization> mJobUtilization;
+	Clock::time_point mJobSampleTime{};
+
+	// fraction of the last sample period each worker spent running jobs and asleep
+	void SampleJobs(const gold::ThreadPool& jobs)
+	{
+		const Clock::time_point now = Clock::now();
+		const f64 elapsedMS = std::chrono::duration<f64, std::milli>(now - mJobSampleTime).count();
+		if (!mJobStatistics.empty() && elapsedMS < kJobSampleMS)
+		{
+			return;
+		}
+
+		const auto statistics = jobs.GetWorkerStatistics();
+		mJobUtilization.resize(statistics.size());
+		if (mJobStatistics.size() == statistics.size())
+		{
+			const f64 elapsedNS = elapsedMS * 1000000.0;
+			for (size_t i = 0; i < statistics.size(); ++i)
+			{
+				mJobUtilization[i].busy = (statistics[i].busyNS - mJobStatistics[i].busyNS) / elapsedNS;
+				mJobUtilization[i].sleeping = (statistics[i].sleepNS - mJobStatistics[i].sleepNS) / elapsedNS;
+				mJobUtilization[i].executedJobs = statistics[i].executedJobs - mJobStatistics[i].executedJobs;
+				mJobUtilization[i].stolenJobs = statistics[i].stolenJobs - mJobStatistics[i].stolenJobs;
+			}
+		}
+
+		mJobStatistics = statistics;
+		mJobSampleTime = now;
+	}
+
 public:
 	PerformanceWindow(bool showWindow = false)
 		: ImGuiWindow("Performance", showWindow)
@@ -44,5 +95,45 @@ protected:
 			}
 			ImGui::TreePop();
 		}
+
+		if (ImGui::TreeNode("Texture Residency"))
+		{
+			auto residency = Singletons::Get()->Resolve<gold::TextureResidency>();
+			const auto residencyStats = residency->GetStatistics();
+
+			const auto toMB = [](u64 bytes) { return std::to_string(bytes / static_cast<f64>(gold::memory::MB)); };
+
+			std::string text = "- Resident(MB): " + toMB(residencyStats.residentBytes) + " / " + toMB(residencyStats.budgetBytes);
+			text += "\n- Pinned(MB): " + toMB(residencyStats.pinnedBytes);
+			text += "\n- Textures: " + std::to_string(residencyStats.textureCount) + " (" + std::to_string(residencyStats.streamedCount) + " streamed)";
+			text += "\n- Pending Requests: " + std::to_string(residencyStats.pendingRequests);
+			text += "\n- Levels Loaded/Evicted: " + std::to_string(residencyStats.loadedLevels) + " / " + std::to_string(residencyStats.evictedLevels);
+			ImGui::Text(text.c_str());
+
+			int budgetMB = static_cast<int>(residencyStats.budgetBytes / gold::memory::MB);
+			if (ImGui::SliderInt("Budget(MB)", &budgetMB, 16, 4096))
+			{
+				residency->SetBudget(static_cast<u64>(budgetMB) * gold::memory::MB);
+			}
+			ImGui::TreePop();
+		}
+
+		if (ImGui::TreeNode("Jobs"))
+		{
+			auto jobs = Singletons::Get()->Resolve<gold::ThreadPool>();
+			SampleJobs(*jobs);
+
+			const auto toPercent = [](f64 fraction) { return std::to_string(static_cast<u32>(fraction * 100.0 + 0.5)) + "%"; };
+
+			std::string text = "- Workers: " + std::to_string(jobs->GetThreadCount());
+			for (size_t i = 0; i < mJobUtilization.size(); ++i)
+			{
+				const JobUtilization& worker = mJobUtilization[i];
+				text += "\n- Worker " + std::to_string(i) + ": Busy " + toPercent(worker.busy) + ", Asleep " + toPercent(worker.sleeping);
+				text += ", Jobs " + std::to_string(worker.executedJobs) + " (" + std::to_string(worker.stolenJobs) + " stolen)";
+			}
+			ImGui::Text(text.c_str());
+			ImGui::TreePop();
+		}
 	}
 };
\ No newline at end of file
@@ -14,15 +14,26 @@ PropertyWindow::PropertyWindow(scene::Scene& scene, std::function<scene::GameObj
 {
 	AddComponentControl<TransformComponent>("Transform", [this](auto& t)
 	{
-		
-		bool updated = DrawVec3Control("Position", t.position);
+		glm::vec3 position = t.GetPosition();
+		bool updated = DrawVec3Control("Position", position);
+		if (updated)
+		{
+			t.SetPosition(position);
+		}
 
-		DrawVec3Control("Rotation", t.rotation);
+		glm::vec3 rotation = t.GetRotation();
+		if (DrawVec3Control("Rotation", rotation))
+		{
+			t.SetRotation(rotation);
+		}
 
-		DrawVec3Control("Scale", t.scale, 1.0f);
-		t.scale = glm::max(t.scale, { 0,0,0 });
+		glm::vec3 scale = t.GetScale();
+		if (DrawVec3Control("Scale", scale, 1.0f))
+		{
+			t.SetScale(glm::max(scale, { 0,0,0 }));
+		}
 
-		// HACK: dirty flags needed for transforms
+		// point lights keep their own dirty flag for the light buffer
 		if (updated && mGetSelected().HasComponent<PointLightComponent>())
 		{
 			mGetSelected().GetComponent<PointLightComponent>().color.w = 1;
@@ -56,7 +56,7 @@ public:
 				cam.ProcessMouseMovement(mouseDelta);
 			}
 
-			transform.position = glm::inverse(cam.GetViewMatrix())[3];
+			transform.SetPosition(glm::vec3(glm::inverse(cam.GetViewMatrix())[3]));
 		});
 	}
 };
\ No newline at end of file
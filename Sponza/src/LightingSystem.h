@@ -146,7 +146,7 @@ public:
 
 				buffer.lightBuffer.pointLights[pointCount++] = LightBufferComponent::PointLight
 				{
-					{ transform.position, 1},
+					{ transform.GetPosition(), 1},
 					  light.color,
 					{ light.falloff, 0, shadowMapIndices[0], shadowMapIndices[1]},
 					{ shadowMapIndices[2], shadowMapIndices[3], shadowMapIndices[4], shadowMapIndices[5]}
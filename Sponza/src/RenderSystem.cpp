@@ -4,6 +4,8 @@
 
 #include <graphics/Vertex.h>
 #include <graphics/MaterialManager.h>
+#include <graphics/TextureResidency.h>
+#include <core/ThreadPool.h>
 
 #include "ShadowMapService.h"
 
@@ -14,39 +16,23 @@ using namespace graphics;
 
 bool RenderSystem::kReloadShaders = true;
 
-static void PushFrustumCull(scene::Scene& scene, const glm::mat4& viewProj)
+static graphics::LodView MakeLodView(const glm::mat4& viewProj, f32 viewportHeight, int bias)
 {
-	// frustum cull
-	const glm::mat4 transViewProj = glm::transpose(viewProj);
-	const glm::mat4 invViewProj = glm::inverse(viewProj);
-	scene.ForEach<RenderComponent>([&invViewProj, &transViewProj](scene::GameObject obj)
-	{
-		auto aabb = obj.GetAABB();
+	auto toggles = Singletons::Get()->Resolve<RenderingToggles>();
 
-		// invalid AABB? Add to draw list just in case
-		if (aabb.min.x > aabb.max.x || aabb.min.y > aabb.max.y || aabb.min.z > aabb.max.z)
-		{
-			DEBUG_ASSERT(false, "Invalid AABB");
-			obj.AddComponent<NotFrustumCulledComponent>();
-			return;
-		}
+	graphics::LodView view;
+	view.mViewProj = viewProj;
+	view.mViewportHeight = viewportHeight;
+	view.mBias = static_cast<u8>(std::max(bias, 0));
 
-		if (!FrustumCuller::FrustumCulled(invViewProj, transViewProj, aabb))
-		{
-			obj.AddComponent<NotFrustumCulledComponent>();
-		}
-	});
-}
-
-static void PopFrustumCull(scene::Scene& scene)
-{
-	// remove cull component for other passes
-	//NOTE (danielg): instead, NotFrustumCulledComponent should use a bitset to
-	//				  tell which camera the object has been culled from
-	scene.ForEach<NotFrustumCulledComponent>([](scene::GameObject obj)
+	// a view that can never accept any error always picks level 0
+	if (!toggles->meshLods)
 	{
-		obj.RemoveComponent<NotFrustumCulledComponent>();
-	});
+		view.mViewportHeight = std::numeric_limits<f32>::max();
+		view.mBias = 0;
+	}
+
+	return view;
 }
 
 void RenderSystem::InitRenderData(scene::Scene& scene)
@@ -63,6 +49,7 @@ void RenderSystem::InitRenderData(scene::Scene& scene)
 		mPerFrameConstants.u_viewInv = glm::inverse(mPerFrameConstants.u_view);
 		mPerFrameConstants.u_time = { 0,0,0,0 };
 		mPerFrameContantsBuffer = mEncoder->CreateUniformBuffer(&mPerFrameConstants, sizeof(PerFrameConstants));
+		mViewConstantsBuffers = { mPerFrameContantsBuffer };
 	}
 
 	// Per Draw constants
@@ -139,9 +126,14 @@ void RenderSystem::InitRenderData(scene::Scene& scene)
 
 	// cube
 	{
-		VertexBuffer posBuffer(std::move(VertexLayout().Push<VertexLayout::Position3>()));
-		VertexBuffer norBuffer(std::move(VertexLayout().Push<VertexLayout::Normal>()));
-		VertexBuffer uvBuffer(std::move(VertexLayout().Push<VertexLayout::Texcoord2>()));
+		// one stream per attribute
+		using PositionLayout = VertexLayoutT<VertexLayout::Position3>;
+		using NormalLayout = VertexLayoutT<VertexLayout::Normal>;
+		using TexcoordLayout = VertexLayoutT<VertexLayout::Texcoord2>;
+
+		VertexBuffer posBuffer(PositionLayout::ToRuntime());
+		VertexBuffer norBuffer(NormalLayout::ToRuntime());
+		VertexBuffer uvBuffer(TexcoordLayout::ToRuntime());
 
 		std::vector<glm::vec3> frontFace =
 		{
@@ -180,20 +172,12 @@ void RenderSystem::InitRenderData(scene::Scene& scene)
 		rotations.push_back(glm::rotate(glm::mat4(1.0f), glm::radians(90.f), glm::vec3(1.f, 0.f, 0.f)));
 		rotations.push_back(glm::rotate(glm::mat4(1.0f), glm::radians(-90.f), glm::vec3(1.f, 0.f, 0.f)));
 
+		const u32 faceVertexCount = static_cast<u32>(frontFace.size());
 		for (const auto& rot : rotations)
 		{
-			for (const auto& vert : frontFace)
-			{
-				posBuffer.Emplace(glm::vec3(rot * glm::vec4(vert, 1.0)));
-			}
-			for (const auto& nor : frontNor)
-			{
-				norBuffer.Emplace(glm::vec3(rot * glm::vec4(nor, 0.0)));
-			}
-			for (const auto& uv : frontUV)
-			{
-				uvBuffer.Emplace(uv);
-			}
+			posBuffer.Append<PositionLayout>(faceVertexCount).Fill<0>([&](u32 i) { return glm::vec3(rot * glm::vec4(frontFace[i], 1.0)); });
+			norBuffer.Append<NormalLayout>(faceVertexCount).Fill<0>([&](u32 i) { return glm::vec3(rot * glm::vec4(frontNor[i], 0.0)); });
+			uvBuffer.Append<TexcoordLayout>(faceVertexCount).Copy<0>(frontUV.data());
 		}
 
 		MeshDescription desc;
@@ -386,7 +370,7 @@ void RenderSystem::Tick(scene::Scene& scene, float dt)
 		camera = &cam.mCamera;
 	});
 
-	// update per frame buffer
+	// per frame constants, every view starts from these and the camera's are uploaded with the views
 	{
 		mPerFrameConstants.u_proj = camera->GetProjectionMatrix();
 		mPerFrameConstants.u_projInv = glm::inverse(mPerFrameConstants.u_proj);
@@ -399,8 +383,6 @@ void RenderSystem::Tick(scene::Scene& scene, float dt)
 
 		mPerFrameConstants.u_toggles0.z = static_cast<float>(toggles->mipLevel);
 		mPerFrameConstants.u_toggles0.w = toggles->doGlobalIllumination ? 1.0f : 0.0f;
-
-		mEncoder->UpdateUniformBuffer(mPerFrameContantsBuffer, &mPerFrameConstants, sizeof(PerFrameConstants));
 	}
 
 	// update material buffer
@@ -434,6 +416,10 @@ void RenderSystem::Tick(scene::Scene& scene, float dt)
 	});
 
 	
+	mClusterStatistics = {};
+
+	CollectViews(*camera, scene);
+
 	FillShadowAtlas(scene);
 	VoxelizeScene(scene);
 	if (toggles->renderVoxelizedScene)
@@ -442,22 +428,146 @@ void RenderSystem::Tick(scene::Scene& scene, float dt)
 	}
 	else
 	{
-		FillGBuffer(*camera, scene);
+		FillGBuffer(scene);
 		ResolveGBuffer();
 	}
 	DrawSkybox();
 	Tonemap();
 
+	toggles->clusterStatistics = mClusterStatistics;
+
 	mFirstFrame = false;
 	mFrameCount++;
 }
 
+u32 RenderSystem::AddView(const glm::mat4& view, const glm::mat4& proj, const graphics::Viewport& viewport, int lodBias, u32 cullGroup)
+{
+	const u32 index = mViewCuller.AddView(proj * view, cullGroup);
+	DEBUG_ASSERT(index == mViews.size(), "Views and their culling results are out of step!");
+
+	if (index == mViewConstantsBuffers.size())
+	{
+		mViewConstantsBuffers.push_back(mEncoder->CreateUniformBuffer(nullptr, sizeof(PerFrameConstants)));
+	}
+
+	RenderView& result = mViews.emplace_back();
+	result.mView = view;
+	result.mProj = proj;
+	result.mViewport = viewport;
+	result.mLodBias = lodBias;
+	result.mConstantsBuffer = mViewConstantsBuffers[index];
+
+	// time, toggles and u_viewPos are the frame's, voxels are lit as the camera sees them
+	result.mConstants = mPerFrameConstants;
+	result.mConstants.u_view = view;
+	result.mConstants.u_viewInv = glm::inverse(view);
+	result.mConstants.u_proj = proj;
+	result.mConstants.u_projInv = glm::inverse(proj);
+
+	return index;
+}
+
+void RenderSystem::CollectViews(const Camera& camera, scene::Scene& scene)
+{
+	mViews.clear();
+	mShadowViews.clear();
+	mVoxelViews.clear();
+	mViewCuller.Clear();
+
+	// the camera always comes first, full screen passes read its constants through mPerFrameContantsBuffer
+	const graphics::Viewport cameraViewport{ 0, 0, static_cast<int>(mGBuffer.mWidth), static_cast<int>(mGBuffer.mHeight) };
+	AddView(camera.GetViewMatrix(), camera.GetProjectionMatrix(), cameraViewport, 0);
+
+	CollectShadowViews(scene);
+	CollectVoxelViews();
+
+	mViewVisibility.resize(mViews.size());
+
+	auto jobs = Singletons::Get()->Resolve<gold::ThreadPool>();
+	mViewCuller.Cull(scene.GetTransformHierarchy(), mViewVisibility.data(), jobs.get());
+
+	for (const RenderView& view : mViews)
+	{
+		mEncoder->UpdateUniformBuffer(view.mConstantsBuffer, &view.mConstants, sizeof(PerFrameConstants));
+	}
+}
+
+void RenderSystem::PrepareViewDraws(scene::Scene& scene, const scene::ViewVisibility& visibility, const graphics::LodView& lodView, const graphics::ClusterView& clusterView)
+{
+	const scene::TransformHierarchy& transforms = scene.GetTransformHierarchy();
+
+	// only objects with a RenderComponent have bounds a view can see
+	mViewDraws.clear();
+	for (u32 index : visibility.GetIndices())
+	{
+		const scene::GameObject obj = scene.Get(transforms.GetEntity(index));
+
+		// removed since the bounds were last updated, they go with the next UpdateTransforms
+		if (!obj.HasComponent<RenderComponent>())
+		{
+			continue;
+		}
+
+		const auto& render = obj.GetComponent<RenderComponent>();
+		const u8 lod = render.SelectLod(lodView, obj.GetAABB());
+
+		// only level 0 has clusters, coarser levels are drawn whole
+		mViewDraws.push_back({ obj, render.GetLodMesh(lod), lod == 0 && render.clusters ? 0 : -1 });
+	}
+
+	CullViewClusters(clusterView);
+}
+
+void RenderSystem::CullViewClusters(const graphics::ClusterView& view)
+{
+	auto toggles = Singletons::Get()->Resolve<RenderingToggles>();
+
+	u32 jobCount = 0;
+	for (ViewDraw& draw : mViewDraws)
+	{
+		draw.mClusterJob = draw.mClusterJob >= 0 && toggles->clusterCulling ? static_cast<i32>(jobCount++) : -1;
+	}
+
+	mClusterJobs.resize(jobCount);
+	for (const ViewDraw& draw : mViewDraws)
+	{
+		if (draw.mClusterJob < 0)
+		{
+			continue;
+		}
+
+		graphics::ClusterCullJob& job = mClusterJobs[draw.mClusterJob];
+		job.mClusters = draw.mObject.GetComponent<RenderComponent>().clusters.get();
+		job.mTransform = draw.mObject.GetWorldSpaceTransform();
+	}
+
+	auto jobs = Singletons::Get()->Resolve<gold::ThreadPool>();
+	mClusterStatistics += graphics::CullClusters(view, mClusterJobs, jobs.get());
+}
+
+bool RenderSystem::IsViewDrawCulled(const ViewDraw& draw) const
+{
+	return draw.mClusterJob >= 0 && mClusterJobs[draw.mClusterJob].mRanges.empty();
+}
+
+void RenderSystem::DrawViewMesh(const ViewDraw& draw, const graphics::RenderState& state)
+{
+	if (draw.mClusterJob < 0)
+	{
+		mEncoder->DrawMesh(draw.mMesh, state);
+		return;
+	}
+
+	const std::vector<graphics::IndexRange>& ranges = mClusterJobs[draw.mClusterJob].mRanges;
+	mEncoder->DrawMeshRanges(draw.mMesh, state, ranges.data(), static_cast<u32>(ranges.size()));
+}
+
 void RenderSystem::ProcessPointLights(scene::Scene& scene, const Camera& cam)
 {
 	mLightBinning.ProcessPointLights(scene, cam, mResolution.x, mResolution.y, *mEncoder);
 }
 
-void RenderSystem::FillShadowAtlas(scene::Scene& scene)
+void RenderSystem::CollectShadowViews(scene::Scene& scene)
 {
 	auto toggles = Singletons::Get()->Resolve<RenderingToggles>();
 
@@ -467,30 +577,20 @@ void RenderSystem::FillShadowAtlas(scene::Scene& scene)
 		bufferDirty = bufferDirty || obj.GetComponent<ShadowMapComponent>().dirty;
 	});	
 
+	mFillShadowAtlas = true;
 	if (toggles->cacheShadowMaps)
 	{
 		// HACK (danielg): broke shadowmap caching, does not seem to update on the first frame.
 		// fix and remove framecount check
-		if (!bufferDirty && mFrameCount > 2) return;
+		if (!bufferDirty && mFrameCount > 2)
+		{
+			mFillShadowAtlas = false;
+			return;
+		}
 	}
-	
-	
-
-	RenderPass shadowPass;
-	shadowPass.mName = "Shadow Atlas";
-	shadowPass.mClearDepth = true;
-	shadowPass.mTarget = mShadowMapFrameBuffer.mHandle;
-
-	RenderState shadowState;
-	shadowState.mColorWriteEnabled = false;
-	shadowState.mRenderPass = mEncoder->AddRenderPass(shadowPass);
-	shadowState.mShader = mShadowAtlasFillShader;
-	shadowState.SetUniformBlock("ShadowMap_UBO", mPerDrawConstantsBuffer);
-	shadowState.SetUniformBlock("Materials_UBO", mMaterialBuffer);
 
 	// directional light shadows
-	scene.ForEach<DirectionalLightComponent, ShadowMapComponent>(
-	[&scene, &shadowState, this](scene::GameObject obj) 
+	scene.ForEach<DirectionalLightComponent, ShadowMapComponent>([&toggles, this](scene::GameObject obj) 
 	{
 		auto& shadow = obj.GetComponent<ShadowMapComponent>(); // not const so we can modify the dirty flag
 		const auto& light = obj.GetComponent<DirectionalLightComponent>();
@@ -520,45 +620,21 @@ void RenderSystem::FillShadowAtlas(scene::Scene& scene)
 
 		// data for light matrices uniform buffer
 		// NOTE (danielg): adds support for light to follow a position
-		glm::mat4 lightView = glm::lookAt(-glm::vec3(light.direction), glm::vec3(0,0,0), glm::vec3(0.0f, 1.0f, 0.0f));
+		const glm::mat4 lightView = glm::lookAt(-glm::vec3(light.direction), glm::vec3(0,0,0), glm::vec3(0.0f, 1.0f, 0.0f));
+		const glm::mat4 lightProj = glm::ortho(shadow.ortho.left, shadow.ortho.right, shadow.ortho.bottom, shadow.ortho.top, shadow.nearPlane, shadow.farPlane);
 
-		mLightMatrices.mLightSpace[shadowIndex] = glm::ortho(shadow.ortho.left, shadow.ortho.right, shadow.ortho.bottom, shadow.ortho.top, shadow.nearPlane, shadow.farPlane) * lightView;
+		mLightMatrices.mLightSpace[shadowIndex] = lightProj * lightView;
 		mLightMatrices.mLightInv[shadowIndex] = glm::inverse(mLightMatrices.mLightSpace[shadowIndex]);
 
 		//the section of our paged shadowMap to render to 
-		shadowState.mViewport = { page.x, page.y, page.width, page.height };
-
-		PushFrustumCull(scene, mLightMatrices.mLightSpace[shadowIndex]);
-
-		scene.ForEach<TransformComponent, RenderComponent, NotFrustumCulledComponent>(
-		[&](scene::GameObject obj)
-		{
-			const auto& render = obj.GetComponent<RenderComponent>();
-		
-			// reusing the perDrawConstantsBuffer for the model matrix slot
-			PerDrawConstants draw;
-			draw.materialHandle = render.material.idx;
-			draw.u_model = mLightMatrices.mLightSpace[shadowIndex] * obj.GetWorldSpaceTransform();
-			mEncoder->UpdateUniformBuffer(mPerDrawConstantsBuffer, &draw, sizeof(PerDrawConstants)); 
-
-			const auto materialManager = Singletons::Get()->Resolve<MaterialManager>();
-			const auto& material = materialManager->GetMaterial(render.material);
-			
-			if (material.mapFlags.x > 0)
-			{
-				shadowState.SetTexture("u_albedoMap", { material.mapFlags.x });
-			}
-
-			mEncoder->DrawMesh(render.mesh, shadowState);
-		});
-
-		PopFrustumCull(scene);
+		const u32 view = AddView(lightView, lightProj, { page.x, page.y, page.width, page.height }, toggles->shadowLodBias);
+		mShadowViews.push_back({ view, shadowIndex, true });
 	});
 
 	// Point lights
-	scene.ForEach<PointLightComponent, ShadowMapComponent>([this, &shadowState, &scene](scene::GameObject obj)
+	scene.ForEach<PointLightComponent, ShadowMapComponent>([this, &toggles](scene::GameObject obj)
 	{
-		const auto& transform = obj.GetComponent<TransformComponent>();
+		const glm::vec3 position = obj.GetComponent<TransformComponent>().GetPosition();
 		auto& shadow = obj.GetComponent<ShadowMapComponent>();
 
 		const auto& pages = Singletons::Get()->Resolve<ShadowMapService>()->GetPages();
@@ -569,15 +645,21 @@ void RenderSystem::FillShadowAtlas(scene::Scene& scene)
 
 		const std::array<glm::mat4, 6> lightViews
 		{
-			glm::lookAt(transform.position, transform.position + glm::vec3(1,0,0), glm::vec3(0,-1,0)), // +X
-			glm::lookAt(transform.position, transform.position - glm::vec3(1,0,0), glm::vec3(0,-1,0)), // -X
+			glm::lookAt(position, position + glm::vec3(1,0,0), glm::vec3(0,-1,0)), // +X
+			glm::lookAt(position, position - glm::vec3(1,0,0), glm::vec3(0,-1,0)), // -X
 
-			glm::lookAt(transform.position, transform.position + glm::vec3(0,1,0), glm::vec3(0,0,1)), // +Y
-			glm::lookAt(transform.position, transform.position - glm::vec3(0,1,0), glm::vec3(0,0,-1)), // -Y
+			glm::lookAt(position, position + glm::vec3(0,1,0), glm::vec3(0,0,1)), // +Y
+			glm::lookAt(position, position - glm::vec3(0,1,0), glm::vec3(0,0,-1)), // -Y
 
-			glm::lookAt(transform.position, transform.position + glm::vec3(0,0,1), glm::vec3(0,-1,0)), // +Z
-			glm::lookAt(transform.position, transform.position - glm::vec3(0,0,1), glm::vec3(0,-1,0)), // -Z
+			glm::lookAt(position, position + glm::vec3(0,0,1), glm::vec3(0,-1,0)), // +Z
+			glm::lookAt(position, position - glm::vec3(0,0,1), glm::vec3(0,-1,0)), // -Z
 		};
+		const glm::mat4 lightProj = glm::perspective(shadow.perspective.FOV, shadow.perspective.aspect, shadow.nearPlane, shadow.farPlane);
+
+		// the faces see nothing beyond the corners of their far planes
+		const f32 tanHalfFOV = std::tan(shadow.perspective.FOV * 0.5f);
+		const f32 reach = shadow.farPlane * std::sqrt(1.0f + tanHalfFOV * tanHalfFOV * (1.0f + shadow.perspective.aspect * shadow.perspective.aspect));
+		const u32 cullGroup = mViewCuller.AddGroup(position, reach);
 
 		// for every face in the virtual cube map
 		for (uint32_t i = 0; i < shadow.shadowMapIndex.size(); ++i)
@@ -601,30 +683,106 @@ void RenderSystem::FillShadowAtlas(scene::Scene& scene)
 			mShadowPages.mParams[shadowIndex].w = shadow.shadowMapBias[i];
 			mShadowPages.mParams[shadowIndex].z = shadow.PCFSize + 1.0f;
 
-			mLightMatrices.mLightSpace[shadowIndex] = glm::perspective(shadow.perspective.FOV, shadow.perspective.aspect, shadow.nearPlane, shadow.farPlane) * lightViews[i];
+			mLightMatrices.mLightSpace[shadowIndex] = lightProj * lightViews[i];
 			mLightMatrices.mLightInv[shadowIndex] = glm::inverse(mLightMatrices.mLightSpace[shadowIndex]);
-			
 
 			//the section of our paged shadowMap to render to 
-			shadowState.mViewport = { page.x, page.y, page.width, page.height };
+			const u32 view = AddView(lightViews[i], lightProj, { page.x, page.y, page.width, page.height }, toggles->shadowLodBias, cullGroup);
+			mShadowViews.push_back({ view, shadowIndex, false });
+		}
+	});
+}
+
+void RenderSystem::CollectVoxelViews()
+{
+	auto toggles = Singletons::Get()->Resolve<RenderingToggles>();
+
+	const float halfVoxelSize = static_cast<float>(mVoxel.size) / 2.0f;
+	const glm::mat4 proj = glm::ortho(-halfVoxelSize, halfVoxelSize, -halfVoxelSize, halfVoxelSize, -halfVoxelSize, halfVoxelSize);
+	const graphics::Viewport viewport{ 0, 0, static_cast<int>(mVoxel.size * 2), static_cast<int>(mVoxel.size * 2) };
+
+	const std::array<glm::mat4, 3> views =
+	{
+		glm::lookAt(glm::vec3(0,0,0), glm::vec3(0,0,-1), glm::vec3(0,1,0)),
+		glm::lookAt(glm::vec3(0,0,0), glm::vec3(0,-1,0), glm::vec3(0,0,-1)),
+		glm::lookAt(glm::vec3(0,0,0), glm::vec3(-1,0,0), glm::vec3(0,1,0)),
+	};
+
+	// all three look at the same cube around the origin
+	const u32 cullGroup = mViewCuller.AddGroup(glm::vec3(0.0f), halfVoxelSize * std::sqrt(3.0f));
+
+	for (const glm::mat4& view : views)
+	{
+		const u32 index = AddView(view, proj, viewport, toggles->voxelizationLodBias, cullGroup);
+		mViews[index].mConstants.u_toggles0.y = 1;
+		mVoxelViews.push_back(index);
+	}
+}
+
+void RenderSystem::FillShadowAtlas(scene::Scene& scene)
+{
+	if (!mFillShadowAtlas)
+	{
+		return;
+	}
+
+	RenderPass shadowPass;
+	shadowPass.mName = "Shadow Atlas";
+	shadowPass.mClearDepth = true;
+	shadowPass.mTarget = mShadowMapFrameBuffer.mHandle;
+
+	RenderState shadowState;
+	shadowState.mColorWriteEnabled = false;
+	shadowState.mRenderPass = mEncoder->AddRenderPass(shadowPass);
+	shadowState.mShader = mShadowAtlasFillShader;
+	shadowState.SetUniformBlock("ShadowMap_UBO", mPerDrawConstantsBuffer);
+	shadowState.SetUniformBlock("Materials_UBO", mMaterialBuffer);
+
+	const auto materialManager = Singletons::Get()->Resolve<MaterialManager>();
+
+	for (const ShadowView& shadowView : mShadowViews)
+	{
+		RenderView& view = mViews[shadowView.mView];
+		view.mPass = shadowState.mRenderPass;
 
-			PushFrustumCull(scene, mLightMatrices.mLightSpace[shadowIndex]);
-			
-			scene.ForEach<TransformComponent, RenderComponent>([&](scene::GameObject obj)
+		const glm::mat4& lightSpace = mLightMatrices.mLightSpace[shadowView.mShadowIndex];
+		shadowState.mViewport = view.mViewport;
+
+		const graphics::LodView lodView = MakeLodView(lightSpace, static_cast<f32>(view.mViewport.height), view.mLodBias);
+		const graphics::ClusterView clusterView(lightSpace, shadowState.mCullFace);
+
+		PrepareViewDraws(scene, mViewVisibility[shadowView.mView], lodView, clusterView);
+		for (const ViewDraw& draw : mViewDraws)
+		{
+			if (IsViewDrawCulled(draw))
 			{
-				const auto& render = obj.GetComponent<RenderComponent>();
+				continue;
+			}
 
-				// reusing the perDrawConstantsBuffer for the model matrix slot
-				PerDrawConstants draw;
-				draw.u_model = mLightMatrices.mLightSpace[shadowIndex] * obj.GetWorldSpaceTransform();
-				mEncoder->UpdateUniformBuffer(mPerDrawConstantsBuffer, &draw, sizeof(PerDrawConstants));
+			const scene::GameObject obj = draw.mObject;
+			const auto& render = obj.GetComponent<RenderComponent>();
+
+			// reusing the perDrawConstantsBuffer for the model matrix slot
+			PerDrawConstants constants;
+			constants.u_model = lightSpace * obj.GetWorldSpaceTransform();
+			constants.u_positionScale = glm::vec4(render.positionScale, 0);
+			constants.u_positionOffset = glm::vec4(render.positionOffset, 0);
+
+			if (shadowView.mAlphaTested)
+			{
+				constants.materialHandle = render.material.idx;
+
+				const auto& material = materialManager->GetMaterial(render.material);
+				if (material.mapFlags.x > 0)
+				{
+					shadowState.SetTexture("u_albedoMap", { material.mapFlags.x });
+				}
+			}
+			mEncoder->UpdateUniformBuffer(mPerDrawConstantsBuffer, &constants, sizeof(PerDrawConstants));
 
-				mEncoder->DrawMesh(render.mesh, shadowState);
-			});
-			
-			PopFrustumCull(scene);
+			DrawViewMesh(draw, shadowState);
 		}
-	});
+	}
 
 	mEncoder->UpdateUniformBuffer(mLightMatricesBuffer, &mLightMatrices, sizeof(LightMatrices));
 	mEncoder->UpdateUniformBuffer(mShadowPagesBuffer, &mShadowPages, sizeof(ShadowMapPages));
@@ -634,26 +792,6 @@ void RenderSystem::VoxelizeScene(scene::Scene& scene)
 {
 	mEncoder->IssueMemoryBarrier(); // wait for voxel clear to finish
 
-	const float voxelSize = static_cast<float>(mVoxel.size);
-	const float halfVoxelSize = voxelSize / 2.0f;
-
-	// save/restore these: we need to change the viewproj 
-	// TODO (danielg): Maybe set up a view-rendering system instead of a per frame
-	const PerFrameConstants savedConstants = mPerFrameConstants;
-	util::Finally finally([&]()
-	{
-		// restore
-		mPerFrameConstants = savedConstants;
-		mEncoder->UpdateUniformBuffer(mPerFrameContantsBuffer, &mPerFrameConstants, sizeof(PerFrameConstants), 0);
-	});
-
-	const std::array<glm::mat4, 6> views =
-	{
-		glm::lookAt(glm::vec3(0,0,0), glm::vec3(0,0,-1), glm::vec3(0,1,0)),
-		glm::lookAt(glm::vec3(0,0,0), glm::vec3(0,-1,0), glm::vec3(0,0,-1)),
-		glm::lookAt(glm::vec3(0,0,0), glm::vec3(-1,0,0), glm::vec3(0,1,0)),
-	};
-
 	RenderPass passDesc;
 	passDesc.mClearColor = true;
 	passDesc.mClearDepth = true;
@@ -662,31 +800,31 @@ void RenderSystem::VoxelizeScene(scene::Scene& scene)
 	u8 passID = mEncoder->AddRenderPass(passDesc);
 
 	auto materialManager = Singletons::Get()->Resolve<MaterialManager>();
+	const scene::TransformHierarchy& transforms = scene.GetTransformHierarchy();
 
-	for (const auto& view : views)
+	// each axis is its own view with its own constants
+	for (u32 index : mVoxelViews)
 	{
-		mPerFrameConstants.u_view = view;
-		mPerFrameConstants.u_viewInv = glm::inverse(mPerFrameConstants.u_view);
-
-		mPerFrameConstants.u_proj = glm::ortho(-halfVoxelSize,
-			halfVoxelSize,
-			-halfVoxelSize,
-			halfVoxelSize,
-			-halfVoxelSize,
-			halfVoxelSize);
-
-		mPerFrameConstants.u_projInv = glm::inverse(mPerFrameConstants.u_proj);
+		RenderView& view = mViews[index];
+		view.mPass = passID;
 
-		mPerFrameConstants.u_toggles0.y = 1;
-		mEncoder->UpdateUniformBuffer(mPerFrameContantsBuffer, &mPerFrameConstants, sizeof(PerFrameConstants), 0);
+		const graphics::LodView lodView = MakeLodView(view.GetViewProj(), static_cast<f32>(view.mViewport.height), view.mLodBias);
 
-		scene.ForEach<RenderComponent>([this, passID, &materialManager](scene::GameObject obj)
+		for (u32 object : mViewVisibility[index].GetIndices())
 		{
+			const scene::GameObject obj = scene.Get(transforms.GetEntity(object));
+			if (!obj.HasComponent<RenderComponent>())
+			{
+				continue;
+			}
+
 			const auto& render = obj.GetComponent<RenderComponent>();
 
 			PerDrawConstants draw;
 			draw.u_model = obj.GetWorldSpaceTransform();
 			draw.materialHandle = render.material.idx;
+			draw.u_positionScale = glm::vec4(render.positionScale, 0);
+			draw.u_positionOffset = glm::vec4(render.positionOffset, 0);
 			mEncoder->UpdateUniformBuffer(mPerDrawConstantsBuffer, &draw, sizeof(PerDrawConstants), 0);
 
 			auto material = materialManager->GetMaterial(render.material);
@@ -700,10 +838,10 @@ void RenderSystem::VoxelizeScene(scene::Scene& scene)
 			state.mCullFace = CullFace::DISABLED;
 			state.mDepthFunc = DepthFunction::DISABLED;
 
-			state.mViewport = { 0, 0, static_cast<u16>(mVoxel.size * 2), static_cast<u16>(mVoxel.size * 2) };
+			state.mViewport = view.mViewport;
 
 
-			state.SetUniformBlock("PerFrameConstants_UBO", mPerFrameContantsBuffer);
+			state.SetUniformBlock("PerFrameConstants_UBO", view.mConstantsBuffer);
 			state.SetUniformBlock("PerDrawConstants_UBO", mPerDrawConstantsBuffer);
 			state.SetUniformBlock("Lights_UBO", mLightingBuffer);
 			state.SetUniformBlock("LightSpaceMatrices_UBO", mLightMatricesBuffer);
@@ -720,11 +858,8 @@ void RenderSystem::VoxelizeScene(scene::Scene& scene)
 			if (material.mapFlags.z > 0) state.SetTexture("u_metallicMap", { material.mapFlags.z });
 			if (material.mapFlags.w > 0) state.SetTexture("u_roughnessMap", { material.mapFlags.w });
 
-			mEncoder->DrawMesh(render.mesh, state);
-		});
-
-		
-		
+			mEncoder->DrawMesh(render.GetLodMesh(render.SelectLod(lodView, obj.GetAABB())), state);
+		}
 	}
 	mEncoder->IssueMemoryBarrier();
 	
@@ -782,16 +917,36 @@ void RenderSystem::RenderVoxelizedScene(const Camera& camera, scene::Scene& scen
 	mEncoder->DrawMesh(mFullscreenQuad, state);
 }
 
-void RenderSystem::FillGBuffer(const Camera& camera, scene::Scene& scene)
+void RenderSystem::FillGBuffer(scene::Scene& scene)
 {
 	auto materialManager = Singletons::Get()->Resolve<MaterialManager>();
+	auto residency = Singletons::Get()->Resolve<gold::TextureResidency>();
+
+	RenderView& view = mViews[kCameraView];
+	const glm::mat4 viewProj = view.GetViewProj();
+	const f32 viewportHeight = static_cast<f32>(view.mViewport.height);
 
-	PushFrustumCull(scene, camera.GetProjectionMatrix() * camera.GetViewMatrix());
+	const graphics::LodView lodView = MakeLodView(viewProj, viewportHeight, view.mLodBias);
+
+	// texture streaming follows the real footprint even when mesh lods are off
+	const graphics::LodView textureView{ viewProj, viewportHeight };
+
+	// the gbuffer fill state culls back faces
+	const graphics::ClusterView clusterView(viewProj, CullFace::BACK);
 
 	//GBuffer fill
 	uint8_t pass = mEncoder->AddRenderPass("GBuffer Fill", mGBuffer.mHandle, ClearColor::YES, ClearDepth::YES);
-	scene.ForEach<TransformComponent, RenderComponent, NotFrustumCulledComponent>([&](const scene::GameObject obj)
+	view.mPass = pass;
+
+	PrepareViewDraws(scene, mViewVisibility[kCameraView], lodView, clusterView);
+	for (const ViewDraw& draw : mViewDraws)
 	{
+		if (IsViewDrawCulled(draw))
+		{
+			continue;
+		}
+
+		const scene::GameObject obj = draw.mObject;
 		const auto& render = obj.GetComponent<RenderComponent>();
 
 		PerDrawConstants drawConstants =
@@ -799,13 +954,16 @@ void RenderSystem::FillGBuffer(const Camera& camera, scene::Scene& scene)
 			obj.GetWorldSpaceTransform() ,
 			render.material.idx,
 		};
+		drawConstants.u_positionScale = glm::vec4(render.positionScale, 0);
+		drawConstants.u_positionOffset = glm::vec4(render.positionOffset, 0);
 		mEncoder->UpdateUniformBuffer(mPerDrawConstantsBuffer, &drawConstants, sizeof(PerDrawConstants));
 
 		RenderState state{};
 		state.mRenderPass = pass;
 		state.mAlphaBlendEnabled = false;
 		state.mShader = mGBufferFillShader;
-		state.SetUniformBlock("PerFrameConstants_UBO", mPerFrameContantsBuffer);
+		state.mViewport = view.mViewport;
+		state.SetUniformBlock("PerFrameConstants_UBO", view.mConstantsBuffer);
 		state.SetUniformBlock("PerDrawConstants_UBO", mPerDrawConstantsBuffer);
 		state.SetUniformBlock("Materials_UBO", mMaterialBuffer);
 
@@ -817,10 +975,18 @@ void RenderSystem::FillGBuffer(const Camera& camera, scene::Scene& scene)
 		if (material.mapFlags.z > 0) state.SetTexture("u_metallicMap",	{ material.mapFlags.z });
 		if (material.mapFlags.w > 0) state.SetTexture("u_roughnessMap",	{ material.mapFlags.w });
 
-		mEncoder->DrawMesh(render.mesh, state);
-	});
+		// only the gbuffer decides residency, the other passes sample coarser anyway
+		const f32 pixels = LodSelector::GetScreenFootprint(textureView, obj.GetAABB()) * std::max(material.coefficients.w, 1.0f);
+		for (i32 map = 0; map < 4; ++map)
+		{
+			if (material.mapFlags[map] > 0)
+			{
+				residency->Request({ static_cast<u32>(material.mapFlags[map]) }, pixels);
+			}
+		}
 
-	PopFrustumCull(scene);
+		DrawViewMesh(draw, state);
+	}
 }
 
 void RenderSystem::generateSSAO()
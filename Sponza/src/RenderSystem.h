@@ -5,6 +5,9 @@
 #include "graphics/FrameEncoder.h"
 #include "graphics/Texture.h"
 #include "graphics/FrustumCuller.h"
+#include "graphics/ClusterCulling.h"
+#include "graphics/AABBCulling.h"
+#include "scene/ViewVisibility.h"
 
 #include "Components.h"
 
@@ -41,6 +44,10 @@ private:
 		glm::mat4 u_model{};
 		u32 materialHandle{};
 		u32 pad[3];
+
+		// dequantizes vertex positions, xyz only
+		glm::vec4 u_positionScale{ 1, 1, 1, 0 };
+		glm::vec4 u_positionOffset{ 0 };
 	};
 	graphics::UniformBufferHandle mPerDrawConstantsBuffer{};
 
@@ -95,6 +102,60 @@ private:
 
 	graphics::TextureHandle mCubemap{};
 
+	// what one view draws, collected before any of it is encoded
+	struct ViewDraw
+	{
+		scene::GameObject mObject;
+		graphics::MeshHandle mMesh{};
+
+		// into mClusterJobs, -1 draws mMesh whole
+		i32 mClusterJob = -1;
+	};
+	std::vector<ViewDraw> mViewDraws;
+	std::vector<graphics::ClusterCullJob> mClusterJobs;
+	graphics::ClusterCullStatistics mClusterStatistics{};
+
+	// one point of view the scene is drawn from this frame, with its own copy of the per frame constants
+	struct RenderView
+	{
+		glm::mat4 mView{ 1.0f };
+		glm::mat4 mProj{ 1.0f };
+		graphics::Viewport mViewport{};
+
+		// levels added on top of the one the viewport needs
+		int mLodBias = 0;
+
+		// set by the pass drawing the view, passes are added in the order they run
+		u8 mPass = 0;
+
+		PerFrameConstants mConstants{};
+		graphics::UniformBufferHandle mConstantsBuffer{};
+
+		glm::mat4 GetViewProj() const { return mProj * mView; }
+	};
+	static constexpr u32 kCameraView = 0;
+
+	std::vector<RenderView> mViews;
+	std::vector<scene::ViewVisibility> mViewVisibility;
+	scene::ViewCuller mViewCuller;
+
+	// by view index and kept across frames, the camera's is mPerFrameContantsBuffer
+	std::vector<graphics::UniformBufferHandle> mViewConstantsBuffers;
+
+	// a view of the shadow atlas and the page it fills
+	struct ShadowView
+	{
+		u32 mView = 0;
+		i32 mShadowIndex = 0;
+
+		// directional lights test albedo alpha, point lights draw everything opaque
+		bool mAlphaTested = false;
+	};
+	std::vector<ShadowView> mShadowViews;
+	bool mFillShadowAtlas = false;
+
+	std::vector<u32> mVoxelViews;
+
 	bool mFirstFrame = true;
 
 	glm::uvec2 mResolution{};
@@ -104,16 +165,33 @@ private:
 	void InitRenderData(scene::Scene& scene);
 	void ReloadShaders();
 
+	// adds a view drawn this frame with the frame's constants, returns its index into mViews
+	u32 AddView(const glm::mat4& view, const glm::mat4& proj, const graphics::Viewport& viewport, int lodBias, u32 cullGroup = scene::ViewCuller::kNoGroup);
+
+	// fills mViews with every view of the frame, culls them and uploads their constants
+	void CollectViews(const Camera& camera, scene::Scene& scene);
+	void CollectShadowViews(scene::Scene& scene);
+	void CollectVoxelViews();
+
 	void ProcessPointLights(scene::Scene& scene, const Camera& cam);
 	void FillShadowAtlas(scene::Scene& scene);
 	void VoxelizeScene(scene::Scene& scene);
 	void RenderVoxelizedScene(const Camera& camera, scene::Scene& scene);
-	void FillGBuffer(const Camera& camera, scene::Scene& scene);
+	void FillGBuffer(scene::Scene& scene);
 	void generateSSAO();
 	void ResolveGBuffer();
 	void DrawSkybox();
 	void Tonemap();
 
+	// fills mViewDraws with the objects visibility holds, each with the level of detail lodView selects
+	void PrepareViewDraws(scene::Scene& scene, const scene::ViewVisibility& visibility, const graphics::LodView& lodView, const graphics::ClusterView& clusterView);
+
+	void CullViewClusters(const graphics::ClusterView& view);
+
+	// every cluster of the object was culled, nothing to draw
+	bool IsViewDrawCulled(const ViewDraw& draw) const;
+	void DrawViewMesh(const ViewDraw& draw, const graphics::RenderState& state);
+
 public:
 	virtual ~RenderSystem()
 	{
@@ -2,6 +2,7 @@
 
 #include <core/Core.h>
 #include <ui/ImGuiWindow.h>
+#include <scene/BaseComponents.h>
 
 #include <imgui.h>
 
@@ -13,6 +14,15 @@ struct RenderingToggles
 
 	bool doGlobalIllumination = true;
 	bool cacheShadowMaps = true;
+
+	bool meshLods = true;
+	int shadowLodBias = 1;
+	int voxelizationLodBias = 2;
+
+	bool clusterCulling = true;
+
+	// every view of the last frame, written by the render system
+	graphics::ClusterCullStatistics clusterStatistics{};
 };
 
 class RenderingTogglesWindow : public ImGuiWindow
@@ -41,5 +51,19 @@ protected:
 
 		ImGui::Checkbox("ShadowMap Caching Enabled", &toggles->cacheShadowMaps);
 		ImGui::Separator();
+
+		ImGui::Checkbox("Mesh LODs Enabled", &toggles->meshLods);
+		ImGui::SliderInt("Shadow LOD Bias", &toggles->shadowLodBias, 0, RenderComponent::kMaxLods);
+		ImGui::SliderInt("Voxelization LOD Bias", &toggles->voxelizationLodBias, 0, RenderComponent::kMaxLods);
+		ImGui::Separator();
+
+		ImGui::Checkbox("Cluster Culling Enabled", &toggles->clusterCulling);
+
+		const graphics::ClusterCullStatistics& clusters = toggles->clusterStatistics;
+		std::string text = "- Objects/Clusters: " + std::to_string(clusters.objects) + " / " + std::to_string(clusters.clusters);
+		text += "\n- Frustum/Cone Culled: " + std::to_string(clusters.frustumCulled) + " / " + std::to_string(clusters.coneCulled);
+		text += "\n- Triangles: " + std::to_string(clusters.visibleTriangles) + " / " + std::to_string(clusters.triangles) + " in " + std::to_string(clusters.ranges) + " ranges";
+		ImGui::Text(text.c_str());
+		ImGui::Separator();
 	}
 };
\ No newline at end of file
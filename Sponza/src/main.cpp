@@ -1,5 +1,6 @@
 #include "core/Core.h"
 #include "core/Application.h"
+#include "core/VirtualFileSystem.h"
 
 #include "graphics/Vertex.h"
 #include "graphics/FrameEncoder.h"
@@ -24,6 +25,9 @@
 #include "RenderingToggles.h"
 #include "ShadowMapService.h"
 
+#include <algorithm>
+#include <chrono>
+
 class TestApp : public gold::Application
 {
 private:
@@ -39,6 +43,10 @@ private:
 
 	bool mFirstFrame = true;
 
+	// set while the scene is loading
+	const char* mLoadPath = nullptr;
+	std::chrono::steady_clock::time_point mLoadStart{};
+
 public:
 	TestApp(gold::ApplicationConfig&& config)
 		: gold::Application(std::move(config))
@@ -49,6 +57,12 @@ protected:
 
 	virtual void Init() override
 	{
+		// shipping content is a single archive, loose files are still picked up when it is missing
+		if (!gold::vfs::Mount("assets.gpak"))
+		{
+			G_INFO("No assets.gpak found, loading loose files");
+		}
+
 		AddEditorWindow(std::make_unique<LogWindow>());
 		AddEditorWindow(std::make_unique<RenderingTogglesWindow>());
 		AddEditorWindow(std::make_unique<PerformanceWindow>(true));
@@ -73,8 +87,23 @@ protected:
 	{
 		if(mFirstFrame)
 		{
-			auto obj = scene::Loader::LoadGameObjectFromModel(mScene, encoder, "sponza2/sponza.gltf");
-			obj.GetComponent<TransformComponent>().scale = { 0.125f, 0.125f, 0.125f };
+			mLoadStart = std::chrono::steady_clock::now();
+
+			// the processed file is produced by running the AssetProcessor over sponza.gltf
+			const bool forceAssimp = std::find(GetCommandArgs().begin(), GetCommandArgs().end(), "ForceAssimpImport") != GetCommandArgs().end();
+
+			scene::GameObject obj{};
+			if (!forceAssimp)
+			{
+				obj = scene::Loader::LoadGameObjectFromProcessedModel(mScene, "sponza2/sponza.gmdl");
+			}
+
+			mLoadPath = obj.IsValid() ? "processed" : "Assimp";
+			if (!obj.IsValid())
+			{
+				obj = scene::Loader::LoadGameObjectFromModel(mScene, "sponza2/sponza.gltf");
+			}
+			obj.GetComponent<TransformComponent>().SetScale({ 0.125f, 0.125f, 0.125f });
 			
 			{
 				auto lightObj = mScene.CreateGameObject("Red Light");
@@ -83,8 +112,7 @@ protected:
 				auto& light = lightObj.AddComponent<PointLightComponent>();
 				auto& shadow = lightObj.AddComponent<ShadowMapComponent>();
 
-				transform.position.x = -120;
-				transform.position.y = 20;
+				transform.SetPosition({ -120, 20, 0 });
 				light.color = { 500, 0, 0, 1 };
 				light.falloff = 500;
 
@@ -102,8 +130,7 @@ protected:
 				auto& light = lightObj.AddComponent<PointLightComponent>();
 				auto& shadow = lightObj.AddComponent<ShadowMapComponent>();
 
-				transform.position.x = 0;
-				transform.position.y = 70;
+				transform.SetPosition({ 0, 70, 0 });
 				light.color = { 0, 500, 0, 1 };
 				light.falloff = 500;
 
@@ -121,8 +148,7 @@ protected:
 				auto& light = lightObj.AddComponent<PointLightComponent>();
 				auto& shadow = lightObj.AddComponent<ShadowMapComponent>();
 
-				transform.position.x = 120;
-				transform.position.y = 20;
+				transform.SetPosition({ 120, 20, 0 });
 				light.color = { 0, 0, 500, 1 };
 				light.falloff = 500;
 
@@ -155,8 +181,20 @@ protected:
 			mFirstFrame = false;
 		}
 
+		scene::Loader::Update();
+
+		// startup ends once every upload is resident, compare runs with and without ForceAssimpImport
+		if (mLoadPath && !scene::Loader::IsLoading())
+		{
+			const f64 milliseconds = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - mLoadStart).count();
+			G_INFO("Sponza ready in {:.2f}ms from the {} path", milliseconds, mLoadPath);
+			mLoadPath = nullptr;
+		}
+
 		mCameraSystem.Tick(mScene, delta);
 
+		// everything below reads world matrices, objects moved above are picked up here
+		mScene.UpdateTransforms();
 
 		mRenderSystem.SetEncoder(&encoder);
 		u32 width = (u32)GetScreenSize().x;
@@ -1,5 +1,7 @@
 #include "LightBinning.h"
 
+#include <core/ThreadPool.h>
+
 
 graphics::ShaderBufferHandle LightBinning::GetLightBins()
 {
@@ -13,7 +15,7 @@ graphics::ShaderBufferHandle LightBinning::getLightBinIndices()
 
 void LightBinning::ProcessPointLights(scene::Scene& scene, const Camera& camera, u32 width, u32 height, gold::FrameEncoder& encoder)
 {
-	// TODO (danielg): do this on GPU? thread it?
+	// TODO: do this on GPU?
 
 	LightBufferComponent* lightBuffer;
 	scene.ForEach<LightBufferComponent>([&lightBuffer](scene::GameObject obj)
@@ -80,8 +82,8 @@ void LightBinning::ProcessPointLights(scene::Scene& scene, const Camera& camera,
 
 	const glm::mat4 view = camera.GetViewMatrix();
 	const glm::mat4 proj = camera.GetProjectionMatrix();
-	const float zNear = proj[3][2] / (proj[2][2] - 1.0f);
-	auto computeScreenBounds = [&view, &proj, zNear](const glm::vec3 pos, const float radius)
+	const glm::mat4 viewProj = proj * view;
+	auto computeScreenBounds = [&viewProj](const glm::vec3 pos, const float radius)
 		{
 			LightBounds bounds;
 			bounds.min = glm::vec3(FLT_MAX, FLT_MAX, FLT_MAX);
@@ -101,7 +103,7 @@ void LightBinning::ProcessPointLights(scene::Scene& scene, const Camera& camera,
 
 			for (auto& edge : corners)
 			{
-				glm::vec4 projPos = proj * view * edge;
+				glm::vec4 projPos = viewProj * edge;
 
 				bounds.min.x = glm::min(bounds.min.x, projPos.x);
 				bounds.min.y = glm::min(bounds.min.y, -projPos.y);
@@ -112,39 +114,59 @@ void LightBinning::ProcessPointLights(scene::Scene& scene, const Camera& camera,
 			return bounds;
 		};
 
-	i32 binnedLightCount = 0;
-	for (i32 i = 0; i < numPointLights; ++i)
-	{
-		const auto& light = pointLights[i];
+	// binned in two parallel passes, bins come out as binning serially would leave them
+	auto jobs = Singletons::Get()->Resolve<gold::ThreadPool>();
+
+	mLightRects.resize(numPointLights);
+	jobs->ParallelFor(0, static_cast<u32>(numPointLights), [&](u32 first, u32 last)
+		{
+			for (u32 i = first; i < last; ++i)
+			{
+				const auto& light = pointLights[i];
+
+				LightBounds bounds = computeScreenBounds(light.position, static_cast<float>(light.params0.x));
 
-		LightBounds bounds = computeScreenBounds(light.position, static_cast<float>(light.params0.x));
+				i32 startX = glm::clamp((i32)(bounds.min.x * numBinsX), 0, numBinsX - 1);
+				i32 endX = glm::clamp((i32)(bounds.max.x * numBinsX), 0, numBinsX - 1);
+				i32 startY = glm::clamp((i32)(bounds.min.y * numBinsY), 0, numBinsY - 1);
+				i32 endY = glm::clamp((i32)(bounds.max.y * numBinsY), 0, numBinsY - 1);
 
-		i32 startX = glm::clamp((i32)(bounds.min.x * numBinsX), 0, numBinsX - 1);
-		i32 endX = glm::clamp((i32)(bounds.max.x * numBinsX), 0, numBinsX - 1);
-		i32 startY = glm::clamp((i32)(bounds.min.y * numBinsY), 0, numBinsY - 1);
-		i32 endY = glm::clamp((i32)(bounds.max.y * numBinsY), 0, numBinsY - 1);
+				mLightRects[i] = glm::ivec4(startX, startY, endX, endY);
+			}
+		});
 
-		for (i32 y = startY; y <= endY; ++y)
+	std::atomic<i32> binnedLights = 0;
+	jobs->ParallelFor(0, static_cast<u32>(numBinsY), [&](u32 firstRow, u32 lastRow)
 		{
-			for (i32 x = startX; x <= endX; ++x)
+			i32 binned = 0;
+			for (i32 i = 0; i < numPointLights; ++i)
 			{
-				i32 index = (y * numBinsX) + x;
-				auto& bin = mLightBins.u_lightBins[index];
+				const glm::ivec4& rect = mLightRects[i];
 
-				if ((bin.y - bin.x) < (u32)maxLights)
-				{
-					mLightBinIndices[bin.y] = i;
-					bin.y++;
-					binnedLightCount++;
-				}
-				else
+				const i32 startY = std::max(rect.y, static_cast<i32>(firstRow));
+				const i32 endY = std::min(rect.w, static_cast<i32>(lastRow) - 1);
+
+				for (i32 y = startY; y <= endY; ++y)
 				{
-					// NOTE (danielg): do something smarter than ignoring the extra lights?
-					DEBUG_ASSERT(false, "Light bin full!");
+					for (i32 x = rect.x; x <= rect.z; ++x)
+					{
+						i32 index = (y * numBinsX) + x;
+						auto& bin = mLightBins.u_lightBins[index];
+
+						// a full bin drops the extra lights, the next bin may be filled by another task
+						if ((bin.y - bin.x) < LightBins::lightsPerBin)
+						{
+							mLightBinIndices[bin.y] = i;
+							bin.y++;
+							binned++;
+						}
+					}
 				}
 			}
-		}
-	}
+
+			binnedLights += binned;
+		});
+	const i32 binnedLightCount = binnedLights;
 
 	// compact bins
 	{
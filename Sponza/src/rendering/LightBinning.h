@@ -23,6 +23,9 @@ private:
 	std::vector<glm::int32> mLightBinIndices{};
 	graphics::ShaderBufferHandle mLightBinIndicesBuffer{};
 
+	// bins each point light covers, first bin in xy and last bin in zw
+	std::vector<glm::ivec4> mLightRects{};
+
 public:
 
 	void ProcessPointLights(scene::Scene& scene, const Camera& camera, u32 width, u32 height, gold::FrameEncoder& encoder);